@@ -68,6 +68,7 @@ module Common =
     let UC_ERR_HOOK_EXIST = 19
     let UC_ERR_RESOURCE = 20
     let UC_ERR_EXCEPTION = 21
+    let UC_ERR_BREAKPOINT = 22
     let UC_MEM_READ = 16
     let UC_MEM_WRITE = 17
     let UC_MEM_FETCH = 18
@@ -92,6 +93,7 @@ module Common =
     let UC_HOOK_MEM_WRITE = 2048
     let UC_HOOK_MEM_FETCH = 4096
     let UC_HOOK_MEM_READ_AFTER = 8192
+    let UC_HOOK_INSN_PORT = 16384
     let UC_HOOK_MEM_UNMAPPED = 112
     let UC_HOOK_MEM_PROT = 896
     let UC_HOOK_MEM_READ_INVALID = 144
@@ -102,6 +104,19 @@ module Common =
     let UC_QUERY_MODE = 1
     let UC_QUERY_PAGE_SIZE = 2
     let UC_QUERY_ARCH = 3
+    let UC_QUERY_TB_TRANSLATED = 4
+    let UC_QUERY_TB_FLUSHES = 5
+    let UC_QUERY_TB_INVALIDATED = 6
+    let UC_QUERY_CODE_GEN_USED = 7
+    let UC_QUERY_CODE_GEN_SIZE = 8
+    let UC_QUERY_TB_HASH_ENTRIES = 9
+    let UC_QUERY_TB_HASH_BUCKETS = 10
+    let UC_QUERY_TB_HASH_USED = 11
+    let UC_QUERY_TLB_FLUSHES = 12
+    let UC_QUERY_TLB_FILLS = 13
+    let UC_QUERY_HOOK_CALLS = 14
+    let UC_QUERY_CPU_EXITS = 15
+    let UC_QUERY_HOOK_VECTORS = 16
 
     let UC_PROT_NONE = 0
     let UC_PROT_READ = 1
@@ -63,6 +63,7 @@ const (
 	ERR_HOOK_EXIST = 19
 	ERR_RESOURCE = 20
 	ERR_EXCEPTION = 21
+	ERR_BREAKPOINT = 22
 	MEM_READ = 16
 	MEM_WRITE = 17
 	MEM_FETCH = 18
@@ -87,6 +88,7 @@ const (
 	HOOK_MEM_WRITE = 2048
 	HOOK_MEM_FETCH = 4096
 	HOOK_MEM_READ_AFTER = 8192
+	HOOK_INSN_PORT = 16384
 	HOOK_MEM_UNMAPPED = 112
 	HOOK_MEM_PROT = 896
 	HOOK_MEM_READ_INVALID = 144
@@ -97,6 +99,19 @@ const (
 	QUERY_MODE = 1
 	QUERY_PAGE_SIZE = 2
 	QUERY_ARCH = 3
+	QUERY_TB_TRANSLATED = 4
+	QUERY_TB_FLUSHES = 5
+	QUERY_TB_INVALIDATED = 6
+	QUERY_CODE_GEN_USED = 7
+	QUERY_CODE_GEN_SIZE = 8
+	QUERY_TB_HASH_ENTRIES = 9
+	QUERY_TB_HASH_BUCKETS = 10
+	QUERY_TB_HASH_USED = 11
+	QUERY_TLB_FLUSHES = 12
+	QUERY_TLB_FILLS = 13
+	QUERY_HOOK_CALLS = 14
+	QUERY_CPU_EXITS = 15
+	QUERY_HOOK_VECTORS = 16
 
 	PROT_NONE = 0
 	PROT_READ = 1
@@ -65,6 +65,7 @@ public interface UnicornConst {
    public static final int UC_ERR_HOOK_EXIST = 19;
    public static final int UC_ERR_RESOURCE = 20;
    public static final int UC_ERR_EXCEPTION = 21;
+   public static final int UC_ERR_BREAKPOINT = 22;
    public static final int UC_MEM_READ = 16;
    public static final int UC_MEM_WRITE = 17;
    public static final int UC_MEM_FETCH = 18;
@@ -89,6 +90,7 @@ public interface UnicornConst {
    public static final int UC_HOOK_MEM_WRITE = 2048;
    public static final int UC_HOOK_MEM_FETCH = 4096;
    public static final int UC_HOOK_MEM_READ_AFTER = 8192;
+   public static final int UC_HOOK_INSN_PORT = 16384;
    public static final int UC_HOOK_MEM_UNMAPPED = 112;
    public static final int UC_HOOK_MEM_PROT = 896;
    public static final int UC_HOOK_MEM_READ_INVALID = 144;
@@ -99,6 +101,19 @@ public interface UnicornConst {
    public static final int UC_QUERY_MODE = 1;
    public static final int UC_QUERY_PAGE_SIZE = 2;
    public static final int UC_QUERY_ARCH = 3;
+   public static final int UC_QUERY_TB_TRANSLATED = 4;
+   public static final int UC_QUERY_TB_FLUSHES = 5;
+   public static final int UC_QUERY_TB_INVALIDATED = 6;
+   public static final int UC_QUERY_CODE_GEN_USED = 7;
+   public static final int UC_QUERY_CODE_GEN_SIZE = 8;
+   public static final int UC_QUERY_TB_HASH_ENTRIES = 9;
+   public static final int UC_QUERY_TB_HASH_BUCKETS = 10;
+   public static final int UC_QUERY_TB_HASH_USED = 11;
+   public static final int UC_QUERY_TLB_FLUSHES = 12;
+   public static final int UC_QUERY_TLB_FILLS = 13;
+   public static final int UC_QUERY_HOOK_CALLS = 14;
+   public static final int UC_QUERY_CPU_EXITS = 15;
+   public static final int UC_QUERY_HOOK_VECTORS = 16;
 
    public static final int UC_PROT_NONE = 0;
    public static final int UC_PROT_READ = 1;
@@ -0,0 +1,88 @@
+#!/usr/bin/env python
+# Compare the native fast path of the bindings (unicorn/_native.c) with ctypes.
+#
+# Build the extension in place first:
+#   $ python3 setup.py build_ext --inplace
+
+from __future__ import print_function
+import time
+
+from unicorn import *
+from unicorn import unicorn as _unicorn
+from unicorn.x86_const import *
+
+ADDRESS = 0x1000000
+LOOPS = 100000
+# dec ecx; jnz -3
+X86_LOOP = b"\x49\x75\xfd"
+
+REGS = [UC_X86_REG_EAX, UC_X86_REG_EBX, UC_X86_REG_ECX, UC_X86_REG_EDX,
+        UC_X86_REG_ESI, UC_X86_REG_EDI, UC_X86_REG_EBP, UC_X86_REG_ESP]
+
+
+def make_uc(native):
+    mu = Uc(UC_ARCH_X86, UC_MODE_32)
+    if not native:
+        mu._native = None
+    mu.mem_map(ADDRESS, 2 * 1024 * 1024)
+    mu.mem_write(ADDRESS, X86_LOOP)
+    return mu
+
+
+def bench_hooks(native):
+    mu = make_uc(native)
+    count = [0]
+
+    def hook_code(uc, address, size, user_data):
+        count[0] += 1
+
+    mu.hook_add(UC_HOOK_CODE, hook_code)
+    mu.reg_write(UC_X86_REG_ECX, LOOPS)
+    start = time.time()
+    mu.emu_start(ADDRESS, ADDRESS + len(X86_LOOP))
+    elapsed = time.time() - start
+    assert count[0] == 2 * LOOPS
+    return elapsed * 1e9 / count[0]
+
+
+def bench_mem_read(native, size):
+    mu = make_uc(native)
+    start = time.time()
+    for _ in range(1000):
+        mu.mem_read(ADDRESS, size)
+    return (time.time() - start) * 1e6 / 1000
+
+
+def bench_regs(native, batch):
+    mu = make_uc(native)
+    start = time.time()
+    for _ in range(10000):
+        if batch:
+            mu.reg_read_batch(REGS)
+        else:
+            [mu.reg_read(r) for r in REGS]
+    return (time.time() - start) * 1e6 / 10000
+
+
+def main():
+    if _unicorn._native is None:
+        print("The native extension is not available, run 'python3 setup.py build_ext --inplace'")
+        return
+
+    for native in (False, True):
+        print("== %s" % ("native" if native else "ctypes"))
+        print("ns per UC_HOOK_CODE callback:       %8.1f" % bench_hooks(native))
+        print("us per mem_read() of 64 bytes:      %8.2f" % bench_mem_read(native, 64))
+        print("us per mem_read() of 1 MB:          %8.2f" % bench_mem_read(native, 1024 * 1024))
+        print("us per 8 reg_read():                %8.2f" % bench_regs(native, False))
+        print("us per reg_read_batch() of 8 regs:  %8.2f" % bench_regs(native, True))
+
+    mu = make_uc(True)
+    start = time.time()
+    for _ in range(1000):
+        mu.mem_view(ADDRESS, 1024 * 1024)
+    print("us per mem_view() of 1 MB:          %8.2f" % ((time.time() - start) * 1e6 / 1000))
+
+
+if __name__ == '__main__':
+    main()
@@ -10,7 +10,7 @@ import sys
 import platform
 
 from distutils import log
-from distutils.core import setup
+from distutils.core import setup, Extension
 from distutils.util import get_platform
 from distutils.command.build import build
 from distutils.command.sdist import sdist
@@ -252,6 +252,18 @@ try:
 except ImportError:
     print("Proper 'develop' support unavailable.")
 
+# The native fast path of unicorn.py is optional: when it does not build, the
+# bindings go on with ctypes alone. It takes the core functions from the library
+# loaded by ctypes, so it only needs the headers.
+ext_modules = []
+if sys.version_info[0] >= 3:
+    ext_modules.append(Extension(
+        'unicorn._native',
+        sources=[os.path.join('unicorn', '_native.c')],
+        include_dirs=[os.path.join(BUILD_DIR, 'include')],
+        optional=True,
+    ))
+
 def join_all(src, files):
     return tuple(os.path.join(src, f) for f in files)
 
@@ -271,9 +283,10 @@ setup(
     ],
     requires=['ctypes'],
     cmdclass=cmdclass,
-    zip_safe=True,
+    ext_modules=ext_modules,
+    zip_safe=False,
     include_package_data=True,
-    is_pure=True,
+    is_pure=not ext_modules,
     package_data={
         'unicorn': ['lib/*', 'include/unicorn/*']
     }
@@ -0,0 +1,548 @@
+/* Unicorn Python bindings: optional native fast path */
+
+/*
+   This module only speeds up what unicorn.py does with ctypes: it runs the
+   hook callbacks without a ctypes trampoline, reads memory straight into
+   a bytearray or exposes it in place as a memoryview, and reads or writes
+   several registers in one call.
+
+   It does not link against the core: unicorn.py passes in the addresses of
+   the functions of the library it already loaded, so both paths always drive
+   the same engine.
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <unicorn/unicorn.h>
+#include <unicorn/x86.h>
+
+typedef uc_err (*hook_add_t)(uc_engine *uc, uc_hook *hh, int type, void *callback,
+        void *user_data, uint64_t begin, uint64_t end, ...);
+typedef uc_err (*mem_read_t)(uc_engine *uc, uint64_t address, void *bytes, size_t size);
+typedef uc_err (*mem_get_host_ptr_t)(uc_engine *uc, uint64_t address, size_t size, void **ptr);
+typedef uc_err (*reg_read_batch_t)(uc_engine *uc, int *regs, void **vals, int count);
+typedef uc_err (*reg_write_batch_t)(uc_engine *uc, int *regs, void *const *vals, int count);
+
+static struct native_lib {
+    hook_add_t hook_add;
+    mem_read_t mem_read;
+    mem_get_host_ptr_t mem_get_host_ptr;
+    reg_read_batch_t reg_read_batch;
+    reg_write_batch_t reg_write_batch;
+    PyObject *error;    // UcError
+} lib;
+
+#define HOOK_CAPSULE "unicorn._native.hook"
+
+// what a hook callback gets back, owned by the capsule returned by hook_add()
+typedef struct native_hook {
+    PyObject *uc;       // borrowed: the Uc object keeps the capsule
+    PyObject *callback;
+    PyObject *user_data;
+} native_hook;
+
+static PyObject *raise_uc_error(uc_err err)
+{
+    PyObject *exc = PyObject_CallFunction(lib.error, "i", (int)err);
+
+    if (exc) {
+        PyErr_SetObject(lib.error, exc);
+        Py_DECREF(exc);
+    }
+
+    return NULL;
+}
+
+static uc_engine *engine(unsigned long long uch)
+{
+    return (uc_engine *)(uintptr_t)uch;
+}
+
+// call the user callback as (uc, *args, user_data), taking ownership of @args
+static PyObject *call_hook(native_hook *hook, PyObject **args, Py_ssize_t nargs)
+{
+    PyObject *stack[8];
+    PyObject *res = NULL;
+    Py_ssize_t i;
+
+    for (i = 0; i < nargs; i++) {
+        if (args[i] == NULL)
+            goto out;
+    }
+
+    stack[0] = hook->uc;
+    for (i = 0; i < nargs; i++)
+        stack[i + 1] = args[i];
+    stack[nargs + 1] = hook->user_data;
+
+#if PY_VERSION_HEX >= 0x03090000
+    res = PyObject_Vectorcall(hook->callback, stack, nargs + 2, NULL);
+#else
+    {
+        PyObject *tuple = PyTuple_New(nargs + 2);
+
+        if (tuple) {
+            for (i = 0; i < nargs + 2; i++) {
+                Py_INCREF(stack[i]);
+                PyTuple_SET_ITEM(tuple, i, stack[i]);
+            }
+            res = PyObject_Call(hook->callback, tuple, NULL);
+            Py_DECREF(tuple);
+        }
+    }
+#endif
+
+out:
+    for (i = 0; i < nargs; i++)
+        Py_XDECREF(args[i]);
+
+    // like the ctypes trampolines: report it and let the emulation go on
+    if (res == NULL)
+        PyErr_WriteUnraisable(hook->callback);
+
+    return res;
+}
+
+static void hook_code_cb(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    PyGILState_STATE gil = PyGILState_Ensure();
+    PyObject *args[2];
+
+    args[0] = PyLong_FromUnsignedLongLong(address);
+    args[1] = PyLong_FromUnsignedLong(size);
+    Py_XDECREF(call_hook(user_data, args, 2));
+
+    PyGILState_Release(gil);
+}
+
+static void hook_mem_access_cb(uc_engine *uc, uc_mem_type type,
+        uint64_t address, int size, int64_t value, void *user_data)
+{
+    PyGILState_STATE gil = PyGILState_Ensure();
+    PyObject *args[4];
+
+    args[0] = PyLong_FromLong(type);
+    args[1] = PyLong_FromUnsignedLongLong(address);
+    args[2] = PyLong_FromLong(size);
+    args[3] = PyLong_FromLongLong(value);
+    Py_XDECREF(call_hook(user_data, args, 4));
+
+    PyGILState_Release(gil);
+}
+
+static bool hook_mem_invalid_cb(uc_engine *uc, uc_mem_type type,
+        uint64_t address, int size, int64_t value, void *user_data)
+{
+    PyGILState_STATE gil = PyGILState_Ensure();
+    PyObject *args[4], *res;
+    bool ret = false;
+
+    args[0] = PyLong_FromLong(type);
+    args[1] = PyLong_FromUnsignedLongLong(address);
+    args[2] = PyLong_FromLong(size);
+    args[3] = PyLong_FromLongLong(value);
+    res = call_hook(user_data, args, 4);
+    if (res) {
+        ret = PyObject_IsTrue(res) > 0;
+        Py_DECREF(res);
+    }
+    PyErr_Clear();
+
+    PyGILState_Release(gil);
+    return ret;
+}
+
+static void hook_intr_cb(uc_engine *uc, uint32_t intno, void *user_data)
+{
+    PyGILState_STATE gil = PyGILState_Ensure();
+    PyObject *args[1];
+
+    args[0] = PyLong_FromUnsignedLong(intno);
+    Py_XDECREF(call_hook(user_data, args, 1));
+
+    PyGILState_Release(gil);
+}
+
+static uint32_t hook_insn_in_cb(uc_engine *uc, uint32_t port, int size, void *user_data)
+{
+    PyGILState_STATE gil = PyGILState_Ensure();
+    PyObject *args[2], *res;
+    uint32_t ret = 0;
+
+    args[0] = PyLong_FromUnsignedLong(port);
+    args[1] = PyLong_FromLong(size);
+    res = call_hook(user_data, args, 2);
+    if (res) {
+        if (res != Py_None)
+            ret = (uint32_t)PyLong_AsUnsignedLongMask(res);
+        Py_DECREF(res);
+    }
+    if (PyErr_Occurred())
+        PyErr_WriteUnraisable(((native_hook *)user_data)->callback);
+
+    PyGILState_Release(gil);
+    return ret;
+}
+
+static void hook_insn_out_cb(uc_engine *uc, uint32_t port, int size, uint32_t value, void *user_data)
+{
+    PyGILState_STATE gil = PyGILState_Ensure();
+    PyObject *args[3];
+
+    args[0] = PyLong_FromUnsignedLong(port);
+    args[1] = PyLong_FromLong(size);
+    args[2] = PyLong_FromUnsignedLong(value);
+    Py_XDECREF(call_hook(user_data, args, 3));
+
+    PyGILState_Release(gil);
+}
+
+static void hook_insn_syscall_cb(uc_engine *uc, void *user_data)
+{
+    PyGILState_STATE gil = PyGILState_Ensure();
+
+    Py_XDECREF(call_hook(user_data, NULL, 0));
+
+    PyGILState_Release(gil);
+}
+
+static void hook_capsule_free(PyObject *capsule)
+{
+    native_hook *hook = PyCapsule_GetPointer(capsule, HOOK_CAPSULE);
+
+    if (hook) {
+        Py_XDECREF(hook->callback);
+        Py_XDECREF(hook->user_data);
+        free(hook);
+    }
+}
+
+// setup(UcError, {name: address}) -> None
+static PyObject *native_setup(PyObject *self, PyObject *args)
+{
+    static const struct {
+        const char *name;
+        size_t offset;
+    } funcs[] = {
+        { "uc_hook_add", offsetof(struct native_lib, hook_add) },
+        { "uc_mem_read", offsetof(struct native_lib, mem_read) },
+        { "uc_mem_get_host_ptr", offsetof(struct native_lib, mem_get_host_ptr) },
+        { "uc_reg_read_batch", offsetof(struct native_lib, reg_read_batch) },
+        { "uc_reg_write_batch", offsetof(struct native_lib, reg_write_batch) },
+    };
+    PyObject *error, *table, *addr;
+    void *ptr;
+    size_t i;
+
+    if (!PyArg_ParseTuple(args, "OO!", &error, &PyDict_Type, &table))
+        return NULL;
+
+    for (i = 0; i < sizeof(funcs) / sizeof(funcs[0]); i++) {
+        addr = PyDict_GetItemString(table, funcs[i].name);
+        if (addr == NULL)
+            return PyErr_Format(PyExc_KeyError, "%s", funcs[i].name);
+        ptr = PyLong_AsVoidPtr(addr);
+        if (ptr == NULL)
+            return PyErr_Occurred() ? NULL : PyErr_Format(PyExc_ValueError, "%s", funcs[i].name);
+        memcpy((char *)&lib + funcs[i].offset, &ptr, sizeof(ptr));
+    }
+
+    Py_INCREF(error);
+    Py_XSETREF(lib.error, error);
+
+    Py_RETURN_NONE;
+}
+
+// hook_add(uch, htype, uc, callback, user_data, begin, end, arg1) -> (handle, capsule)
+static PyObject *native_hook_add(PyObject *self, PyObject *args)
+{
+    unsigned long long uch, begin, end;
+    PyObject *uc, *callback, *user_data, *capsule, *ret;
+    native_hook *hook;
+    uc_hook hh = 0;
+    void *cb;
+    int htype, arg1;
+    uc_err err;
+
+    if (!PyArg_ParseTuple(args, "KiOOOKKi", &uch, &htype, &uc, &callback, &user_data,
+                &begin, &end, &arg1))
+        return NULL;
+
+    // same choice of callback as Uc.hook_add()
+    if (htype == UC_HOOK_INSN) {
+        if (arg1 == UC_X86_INS_IN)
+            cb = (void *)hook_insn_in_cb;
+        else if (arg1 == UC_X86_INS_OUT)
+            cb = (void *)hook_insn_out_cb;
+        else if (arg1 == UC_X86_INS_SYSCALL || arg1 == UC_X86_INS_SYSENTER)
+            cb = (void *)hook_insn_syscall_cb;
+        else
+            cb = NULL;
+    } else if (htype == UC_HOOK_INTR) {
+        cb = (void *)hook_intr_cb;
+    } else if (htype == UC_HOOK_BLOCK || htype == UC_HOOK_CODE) {
+        cb = (void *)hook_code_cb;
+    } else if (htype & (UC_HOOK_MEM_READ_UNMAPPED | UC_HOOK_MEM_WRITE_UNMAPPED |
+                UC_HOOK_MEM_FETCH_UNMAPPED | UC_HOOK_MEM_READ_PROT |
+                UC_HOOK_MEM_WRITE_PROT | UC_HOOK_MEM_FETCH_PROT)) {
+        cb = (void *)hook_mem_invalid_cb;
+    } else {
+        cb = (void *)hook_mem_access_cb;
+    }
+
+    hook = calloc(1, sizeof(*hook));
+    if (hook == NULL)
+        return PyErr_NoMemory();
+    hook->uc = uc;
+    Py_INCREF(callback);
+    hook->callback = callback;
+    Py_INCREF(user_data);
+    hook->user_data = user_data;
+
+    capsule = PyCapsule_New(hook, HOOK_CAPSULE, hook_capsule_free);
+    if (capsule == NULL) {
+        Py_DECREF(callback);
+        Py_DECREF(user_data);
+        free(hook);
+        return NULL;
+    }
+
+    if (htype == UC_HOOK_INSN)
+        err = lib.hook_add(engine(uch), &hh, htype, cb, hook, begin, end, arg1);
+    else
+        err = lib.hook_add(engine(uch), &hh, htype, cb, hook, begin, end);
+    if (err != UC_ERR_OK) {
+        Py_DECREF(capsule);
+        return raise_uc_error(err);
+    }
+
+    ret = Py_BuildValue("(KN)", (unsigned long long)hh, capsule);
+    if (ret == NULL)
+        Py_DECREF(capsule);
+
+    return ret;
+}
+
+// mem_read(uch, address, size) -> bytearray
+static PyObject *native_mem_read(PyObject *self, PyObject *args)
+{
+    unsigned long long uch, address;
+    Py_ssize_t size;
+    PyObject *data;
+    uc_err err;
+
+    if (!PyArg_ParseTuple(args, "KKn", &uch, &address, &size))
+        return NULL;
+
+    data = PyByteArray_FromStringAndSize(NULL, size);
+    if (data == NULL)
+        return NULL;
+
+    err = lib.mem_read(engine(uch), address, PyByteArray_AS_STRING(data), size);
+    if (err != UC_ERR_OK) {
+        Py_DECREF(data);
+        return raise_uc_error(err);
+    }
+
+    return data;
+}
+
+// mem_view(uch, address, size) -> memoryview over the guest memory itself
+static PyObject *native_mem_view(PyObject *self, PyObject *args)
+{
+    unsigned long long uch, address;
+    Py_ssize_t size;
+    void *ptr;
+    uc_err err;
+
+    if (!PyArg_ParseTuple(args, "KKn", &uch, &address, &size))
+        return NULL;
+
+    err = lib.mem_get_host_ptr(engine(uch), address, size, &ptr);
+    if (err != UC_ERR_OK)
+        return raise_uc_error(err);
+
+    return PyMemoryView_FromMemory(ptr, size, PyBUF_WRITE);
+}
+
+// collect the register IDs of a sequence, returning the count or -1
+static Py_ssize_t reg_ids(PyObject *seq, int **regs)
+{
+    Py_ssize_t i, count = PySequence_Fast_GET_SIZE(seq);
+
+    *regs = PyMem_New(int, count ? count : 1);
+    if (*regs == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        (*regs)[i] = (int)PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i));
+        if ((*regs)[i] == -1 && PyErr_Occurred()) {
+            PyMem_Free(*regs);
+            return -1;
+        }
+    }
+
+    return count;
+}
+
+// a register value, big enough for the widest one (a 512-bit ZMM) so that
+// the library never writes past it; only the low 64 bits are used, the
+// wider registers being rejected by Uc before calling us
+typedef struct {
+    uint64_t q[8];
+} reg_slot;
+
+// reg_read_batch(uch, regs) -> list of int
+static PyObject *native_reg_read_batch(PyObject *self, PyObject *args)
+{
+    unsigned long long uch;
+    PyObject *seq, *list = NULL;
+    reg_slot *vals = NULL;
+    void **ptrs = NULL;
+    int *regs = NULL;
+    Py_ssize_t i, count;
+    uc_err err;
+
+    if (!PyArg_ParseTuple(args, "KO", &uch, &seq))
+        return NULL;
+
+    seq = PySequence_Fast(seq, "registers must be a sequence");
+    if (seq == NULL)
+        return NULL;
+
+    count = reg_ids(seq, &regs);
+    if (count < 0)
+        goto out;
+
+    vals = PyMem_New(reg_slot, count ? count : 1);
+    ptrs = PyMem_New(void *, count ? count : 1);
+    if (vals == NULL || ptrs == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    for (i = 0; i < count; i++) {
+        memset(&vals[i], 0, sizeof(vals[i]));
+        ptrs[i] = &vals[i];
+    }
+
+    err = lib.reg_read_batch(engine(uch), regs, ptrs, (int)count);
+    if (err != UC_ERR_OK) {
+        raise_uc_error(err);
+        goto out;
+    }
+
+    list = PyList_New(count);
+    if (list == NULL)
+        goto out;
+    for (i = 0; i < count; i++) {
+        PyObject *val = PyLong_FromUnsignedLongLong(vals[i].q[0]);
+
+        if (val == NULL) {
+            Py_CLEAR(list);
+            goto out;
+        }
+        PyList_SET_ITEM(list, i, val);
+    }
+
+out:
+    PyMem_Free(ptrs);
+    PyMem_Free(vals);
+    PyMem_Free(regs);
+    Py_DECREF(seq);
+
+    return list;
+}
+
+// reg_write_batch(uch, regs, values) -> None
+static PyObject *native_reg_write_batch(PyObject *self, PyObject *args)
+{
+    unsigned long long uch;
+    PyObject *seq, *values, *ret = NULL;
+    reg_slot *vals = NULL;
+    void **ptrs = NULL;
+    int *regs = NULL;
+    Py_ssize_t i, count;
+    uc_err err;
+
+    if (!PyArg_ParseTuple(args, "KOO", &uch, &seq, &values))
+        return NULL;
+
+    seq = PySequence_Fast(seq, "registers must be a sequence");
+    if (seq == NULL)
+        return NULL;
+    values = PySequence_Fast(values, "values must be a sequence");
+    if (values == NULL) {
+        Py_DECREF(seq);
+        return NULL;
+    }
+
+    count = reg_ids(seq, &regs);
+    if (count < 0)
+        goto out;
+
+    if (PySequence_Fast_GET_SIZE(values) != count) {
+        PyErr_SetString(PyExc_ValueError, "registers and values differ in length");
+        goto out;
+    }
+
+    vals = PyMem_New(reg_slot, count ? count : 1);
+    ptrs = PyMem_New(void *, count ? count : 1);
+    if (vals == NULL || ptrs == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    for (i = 0; i < count; i++) {
+        memset(&vals[i], 0, sizeof(vals[i]));
+        vals[i].q[0] = PyLong_AsUnsignedLongLongMask(PySequence_Fast_GET_ITEM(values, i));
+        if (vals[i].q[0] == (uint64_t)-1 && PyErr_Occurred())
+            goto out;
+        ptrs[i] = &vals[i];
+    }
+
+    err = lib.reg_write_batch(engine(uch), regs, ptrs, (int)count);
+    if (err != UC_ERR_OK) {
+        raise_uc_error(err);
+        goto out;
+    }
+
+    Py_INCREF(Py_None);
+    ret = Py_None;
+
+out:
+    PyMem_Free(ptrs);
+    PyMem_Free(vals);
+    PyMem_Free(regs);
+    Py_DECREF(values);
+    Py_DECREF(seq);
+
+    return ret;
+}
+
+static PyMethodDef native_methods[] = {
+    { "setup", native_setup, METH_VARARGS, "Bind the module to the loaded library." },
+    { "hook_add", native_hook_add, METH_VARARGS, "Add a hook with a native trampoline." },
+    { "mem_read", native_mem_read, METH_VARARGS, "Read memory into a bytearray." },
+    { "mem_view", native_mem_view, METH_VARARGS, "Return a memoryview over guest memory." },
+    { "reg_read_batch", native_reg_read_batch, METH_VARARGS, "Read several registers." },
+    { "reg_write_batch", native_reg_write_batch, METH_VARARGS, "Write several registers." },
+    { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef native_module = {
+    PyModuleDef_HEAD_INIT,
+    "_native",
+    "Native fast path of the Unicorn bindings.",
+    -1,
+    native_methods,
+};
+
+PyMODINIT_FUNC PyInit__native(void)
+{
+    return PyModule_Create(&native_module);
+}
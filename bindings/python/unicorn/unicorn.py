@@ -139,6 +139,10 @@ _setup_prototype(_uc, "uc_free", ucerr, ctypes.c_void_p)
 _setup_prototype(_uc, "uc_context_save", ucerr, uc_engine, uc_context)
 _setup_prototype(_uc, "uc_context_restore", ucerr, uc_engine, uc_context)
 _setup_prototype(_uc, "uc_mem_regions", ucerr, uc_engine, ctypes.POINTER(ctypes.POINTER(_uc_mem_region)), ctypes.POINTER(ctypes.c_uint32))
+_setup_prototype(_uc, "uc_reg_read_batch", ucerr, uc_engine, ctypes.POINTER(ctypes.c_int), ctypes.POINTER(ctypes.c_void_p), ctypes.c_int)
+_setup_prototype(_uc, "uc_reg_write_batch", ucerr, uc_engine, ctypes.POINTER(ctypes.c_int), ctypes.POINTER(ctypes.c_void_p), ctypes.c_int)
+_setup_prototype(_uc, "uc_mem_get_host_ptr", ucerr, uc_engine, ctypes.c_uint64, ctypes.c_size_t, ctypes.POINTER(ctypes.c_void_p))
+_setup_prototype(_uc, "uc_mem_host_written", ucerr, uc_engine, ctypes.c_uint64, ctypes.c_size_t)
 
 # uc_hook_add is special due to variable number of arguments
 _uc.uc_hook_add = _uc.uc_hook_add
@@ -175,6 +179,23 @@ class UcError(Exception):
         return _uc.uc_strerror(self.errno).decode('ascii')
 
 
+# Optional compiled fast path (_native.c): hooks without ctypes trampolines,
+# mem_read() without the intermediate buffer and batched register access.
+# It is handed the functions of the library loaded above rather than linking
+# its own copy. Set UNICORN_NO_NATIVE to stay on the ctypes path.
+_native = None
+if not os.getenv('UNICORN_NO_NATIVE'):
+    try:
+        from . import _native
+        _native.setup(UcError, dict(
+            (name, ctypes.cast(getattr(_uc, name), ctypes.c_void_p).value)
+            for name in ("uc_hook_add", "uc_mem_read", "uc_mem_get_host_ptr",
+                         "uc_reg_read_batch", "uc_reg_write_batch")
+        ))
+    except ImportError:
+        _native = None
+
+
 # return the core's version
 def uc_version():
     major = ctypes.c_int()
@@ -296,6 +317,7 @@ class Uc(object):
         self._callbacks = {}
         self._ctype_cbs = {}
         self._callback_count = 0
+        self._native = _native
         self._cleanup.register(self)
 
     @staticmethod
@@ -417,6 +439,59 @@ class Uc(object):
         if status != uc.UC_ERR_OK:
             raise UcError(status)
 
+    # registers of more than 64 bits, read & written through a structure
+    def _reg_wide(self, reg_id):
+        if self._arch == uc.UC_ARCH_X86:
+            return reg_id in (x86_const.UC_X86_REG_IDTR, x86_const.UC_X86_REG_GDTR,
+                              x86_const.UC_X86_REG_LDTR, x86_const.UC_X86_REG_TR,
+                              x86_const.UC_X86_REG_MSR) or \
+                x86_const.UC_X86_REG_FP0 <= reg_id <= x86_const.UC_X86_REG_FP7 or \
+                x86_const.UC_X86_REG_ST0 <= reg_id <= x86_const.UC_X86_REG_ST7 or \
+                x86_const.UC_X86_REG_XMM0 <= reg_id <= x86_const.UC_X86_REG_XMM31 or \
+                x86_const.UC_X86_REG_YMM0 <= reg_id <= x86_const.UC_X86_REG_YMM31 or \
+                x86_const.UC_X86_REG_ZMM0 <= reg_id <= x86_const.UC_X86_REG_ZMM31
+        if self._arch == uc.UC_ARCH_ARM64:
+            return arm64_const.UC_ARM64_REG_Q0 <= reg_id <= arm64_const.UC_ARM64_REG_Q31 or \
+                arm64_const.UC_ARM64_REG_V0 <= reg_id <= arm64_const.UC_ARM64_REG_V31
+        return False
+
+    def _reg_check_batch(self, reg_ids):
+        for reg_id in reg_ids:
+            if self._reg_wide(reg_id):
+                raise ValueError("register %d is wider than 64 bits, use reg_read()/reg_write()" % reg_id)
+
+    # return the values of several registers in one call; only for registers
+    # of up to 64 bits, which come back as plain numbers
+    def reg_read_batch(self, reg_ids):
+        self._reg_check_batch(reg_ids)
+        if self._native is not None:
+            return self._native.reg_read_batch(self._uch.value, reg_ids)
+
+        count = len(reg_ids)
+        regs = (ctypes.c_int * count)(*reg_ids)
+        vals = (ctypes.c_uint64 * count)()
+        ptrs = (ctypes.c_void_p * count)(*[ctypes.addressof(vals) + i * 8 for i in range(count)])
+        status = _uc.uc_reg_read_batch(self._uch, regs, ptrs, count)
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+        return list(vals)
+
+    # write several registers of up to 64 bits in one call
+    def reg_write_batch(self, reg_ids, values):
+        if len(reg_ids) != len(values):
+            raise ValueError("registers and values differ in length")
+        self._reg_check_batch(reg_ids)
+        if self._native is not None:
+            return self._native.reg_write_batch(self._uch.value, reg_ids, values)
+
+        count = len(reg_ids)
+        regs = (ctypes.c_int * count)(*reg_ids)
+        vals = (ctypes.c_uint64 * count)(*[v & 0xffffffffffffffff for v in values])
+        ptrs = (ctypes.c_void_p * count)(*[ctypes.addressof(vals) + i * 8 for i in range(count)])
+        status = _uc.uc_reg_write_batch(self._uch, regs, ptrs, count)
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+
     # read from MSR - X86 only
     def msr_read(self, msr_id):
         return self.reg_read(x86_const.UC_X86_REG_MSR, msr_id)
@@ -427,12 +502,34 @@ class Uc(object):
 
     # read data from memory
     def mem_read(self, address, size):
+        if self._native is not None:
+            return self._native.mem_read(self._uch.value, address, size)
+
         data = ctypes.create_string_buffer(size)
         status = _uc.uc_mem_read(self._uch, address, data, size)
         if status != uc.UC_ERR_OK:
             raise UcError(status)
         return bytearray(data)
 
+    # return a memoryview over the emulated memory itself, without copying it.
+    # It is only valid until the range is unmapped; after writing through it,
+    # call mem_host_written() on the range.
+    def mem_view(self, address, size):
+        if self._native is not None:
+            return self._native.mem_view(self._uch.value, address, size)
+
+        ptr = ctypes.c_void_p()
+        status = _uc.uc_mem_get_host_ptr(self._uch, address, size, ctypes.byref(ptr))
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+        return memoryview((ctypes.c_ubyte * size).from_address(ptr.value)).cast("B")
+
+    # tell the engine a range was written through mem_view()
+    def mem_host_written(self, address, size):
+        status = _uc.uc_mem_host_written(self._uch, address, size)
+        if status != uc.UC_ERR_OK:
+            raise UcError(status)
+
     # write to memory
     def mem_write(self, address, data):
         status = _uc.uc_mem_write(self._uch, address, data, len(data))
@@ -471,6 +568,14 @@ class Uc(object):
             raise UcError(status)
         return result.value
 
+    # engine statistics by name, e.g. stats()['tb_translated'] for UC_QUERY_TB_TRANSLATED
+    def stats(self):
+        result = {}
+        for name in dir(uc):
+            if name.startswith('UC_QUERY_') and getattr(uc, name) >= uc.UC_QUERY_TB_TRANSLATED:
+                result[name[len('UC_QUERY_'):].lower()] = self.query(getattr(uc, name))
+        return result
+
     def _hookcode_cb(self, handle, address, size, user_data):
         # call user's callback with self object
         (cb, data) = self._callbacks[user_data]
@@ -515,7 +620,14 @@ class Uc(object):
         self._callbacks[self._callback_count] = (callback, user_data)
         cb = None
 
-        if htype == uc.UC_HOOK_INSN:
+        if self._native is not None:
+            # the returned object owns the native hook, keep it alive with us
+            h, cb = self._native.hook_add(self._uch.value, htype, self, callback,
+                                          user_data, begin, end, arg1)
+            self._ctype_cbs[self._callback_count] = cb
+            return h
+
+        if htype in (uc.UC_HOOK_INSN, uc.UC_HOOK_INSN_PORT):
             insn = ctypes.c_int(arg1)
             if arg1 == x86_const.UC_X86_INS_IN:  # IN instruction
                 cb = ctypes.cast(UC_HOOK_INSN_IN_CB(self._hook_insn_in_cb), UC_HOOK_INSN_IN_CB)
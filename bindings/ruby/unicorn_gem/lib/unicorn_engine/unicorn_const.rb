@@ -63,6 +63,7 @@ module UnicornEngine
 	UC_ERR_HOOK_EXIST = 19
 	UC_ERR_RESOURCE = 20
 	UC_ERR_EXCEPTION = 21
+	UC_ERR_BREAKPOINT = 22
 	UC_MEM_READ = 16
 	UC_MEM_WRITE = 17
 	UC_MEM_FETCH = 18
@@ -87,6 +88,7 @@ module UnicornEngine
 	UC_HOOK_MEM_WRITE = 2048
 	UC_HOOK_MEM_FETCH = 4096
 	UC_HOOK_MEM_READ_AFTER = 8192
+	UC_HOOK_INSN_PORT = 16384
 	UC_HOOK_MEM_UNMAPPED = 112
 	UC_HOOK_MEM_PROT = 896
 	UC_HOOK_MEM_READ_INVALID = 144
@@ -97,6 +99,19 @@ module UnicornEngine
 	UC_QUERY_MODE = 1
 	UC_QUERY_PAGE_SIZE = 2
 	UC_QUERY_ARCH = 3
+	UC_QUERY_TB_TRANSLATED = 4
+	UC_QUERY_TB_FLUSHES = 5
+	UC_QUERY_TB_INVALIDATED = 6
+	UC_QUERY_CODE_GEN_USED = 7
+	UC_QUERY_CODE_GEN_SIZE = 8
+	UC_QUERY_TB_HASH_ENTRIES = 9
+	UC_QUERY_TB_HASH_BUCKETS = 10
+	UC_QUERY_TB_HASH_USED = 11
+	UC_QUERY_TLB_FLUSHES = 12
+	UC_QUERY_TLB_FILLS = 13
+	UC_QUERY_HOOK_CALLS = 14
+	UC_QUERY_CPU_EXITS = 15
+	UC_QUERY_HOOK_VECTORS = 16
 
 	UC_PROT_NONE = 0
 	UC_PROT_READ = 1
@@ -45,6 +45,8 @@ typedef QTAILQ_HEAD(, ModuleEntry) ModuleTypeList;
 
 typedef uc_err (*query_t)(struct uc_struct *uc, uc_query_type type, size_t *result);
 
+typedef void (*profile_top_t)(struct uc_struct *uc, uc_tb_profile *blocks, size_t *count);
+
 // return 0 on success, -1 on failure
 typedef int (*reg_read_t)(struct uc_struct *uc, unsigned int *regs, void **vals, int count);
 typedef int (*reg_write_t)(struct uc_struct *uc, unsigned int *regs, void *const *vals, int count);
@@ -70,10 +72,45 @@ typedef MemoryRegion* (*uc_args_uc_ram_size_t)(struct uc_struct*,  hwaddr begin,
 
 typedef MemoryRegion* (*uc_args_uc_ram_size_ptr_t)(struct uc_struct*,  hwaddr begin, size_t size, uint32_t perms, void *ptr);
 
+typedef MemoryRegion* (*uc_args_uc_ram_size_fd_t)(struct uc_struct*,  hwaddr begin, size_t size, uint32_t perms, int fd, uint64_t offset, bool share);
+
+typedef MemoryRegion* (*uc_args_uc_ram_size_mmio_t)(struct uc_struct*,  hwaddr begin, size_t size, uc_cb_mmio_read_t read_cb, uc_cb_mmio_write_t write_cb, void *user_data);
+
 typedef void (*uc_mem_unmap_t)(struct uc_struct*, MemoryRegion *mr);
 
 typedef void (*uc_readonly_mem_t)(MemoryRegion *mr, bool readonly);
 
+typedef void (*uc_invalidate_tb_t)(struct uc_struct *uc, uint64_t start, size_t len);
+
+typedef void (*uc_invalidate_tb_pc_t)(struct uc_struct *uc, uint64_t begin, uint64_t end);
+
+typedef void (*uc_tlb_flush_t)(struct uc_struct *uc);
+
+typedef void (*uc_snapshot_save_t)(struct uc_struct *uc, MemoryRegion *mr, uint8_t *data);
+
+typedef size_t (*uc_snapshot_restore_t)(struct uc_struct *uc, MemoryRegion *mr, const uint8_t *data, bool full);
+
+typedef void *(*uc_memory_host_ptr_t)(struct uc_struct *uc, MemoryRegion *mr, hwaddr offset);
+
+typedef void (*uc_memory_host_written_t)(struct uc_struct *uc, MemoryRegion *mr, hwaddr offset, size_t len);
+
+typedef int (*uc_breakpoint_insert_t)(CPUState *cpu, vaddr pc, int flags, CPUBreakpoint **breakpoint);
+
+typedef int (*uc_breakpoint_remove_t)(CPUState *cpu, vaddr pc, int flags);
+
+// guest PC of the instruction at a host return address, cached by
+// uc_retaddr_pc() for memory traces & hooks as looking it up in the TB is slow
+#define UC_MEM_TRACE_PCS 256
+struct uc_mem_trace_pc {
+    uintptr_t retaddr;
+    uint64_t pc;
+    int tb_flush_count;     // host code is reused once all TBs are flushed
+};
+
+typedef int (*uc_watchpoint_insert_t)(CPUState *cpu, vaddr addr, vaddr len, int flags, CPUWatchpoint **watchpoint);
+
+typedef int (*uc_watchpoint_remove_t)(CPUState *cpu, vaddr addr, vaddr len, int flags);
+
 // which interrupt should make emulation stop?
 typedef bool (*uc_args_int_t)(int intno);
 
@@ -83,6 +120,16 @@ typedef uint64_t (*uc_mem_redirect_t)(uint64_t address);
 // validate if Unicorn supports hooking a given instruction
 typedef bool(*uc_insn_hook_validate)(uint32_t insn_enum);
 
+// engine counters read by uc_query(), the others are kept by TCG itself
+struct uc_stats {
+    uint64_t tb_translated;     // tb_gen_code()
+    uint64_t tlb_flushes;       // whole TLB flushes, for all or some MMU modes
+    uint64_t tlb_fills;         // tlb_set_page_with_attrs()
+    uint64_t hook_calls;        // helper_uc_tracecode()
+    uint64_t cpu_exits;         // cpu_exit()
+    uint64_t hook_vectors;      // hook vectors alive, see hook_vector_get()
+};
+
 struct hook {
     int type;            // UC_HOOK_*
     int insn;            // instruction for HOOK_INSN
@@ -90,6 +137,30 @@ struct hook {
     uint64_t begin, end; // only trigger if PC or memory access is in this address (depends on hook type)
     void *callback;      // a uc_cb_* type
     void *user_data;
+    bool to_delete;      // deleted while emulating, freed once uc_emu_start() returns
+};
+
+// Hooks of one type sorted into the address intervals they cover, so that
+// dispatch only visits the hooks matching an address. Interval i spans
+// [starts[i], starts[i + 1]) and its hooks are hooks[offsets[i]] up to
+// hooks[offsets[i + 1]], in the order of the hook list.
+// Immutable once built: uc_hook_add() & uc_hook_del() build a new one.
+struct hook_table {
+    uint32_t count;         // number of intervals, starts[0] is always 0
+    uint64_t *starts;
+    uint32_t *offsets;      // count + 1 entries
+    struct hook **hooks;
+    struct hook_vector **vectors;   // per interval, filled by hook_vector_get()
+};
+
+// Hooks matching one PC, computed when translating the call to
+// helper_uc_tracecode() and passed to it. Referenced by the table interval
+// caching it and by each TB compiled with it, freed when both are gone.
+struct hook_vector {
+    struct uc_struct *uc;
+    uint32_t refs;
+    uint32_t count;
+    struct hook *hooks[0];
 };
 
 // hook list offsets
@@ -109,37 +180,130 @@ enum uc_hook_idx {
     UC_HOOK_MEM_WRITE_IDX,
     UC_HOOK_MEM_FETCH_IDX,
     UC_HOOK_MEM_READ_AFTER_IDX,
+    UC_HOOK_INSN_PORT_IDX,
 
     UC_HOOK_MAX,
 };
 
+// IN & OUT hooks (UC_HOOK_INSN or UC_HOOK_INSN_PORT) are kept apart from
+// the other UC_HOOK_INSN hooks, in one list per direction indexed by port
+enum uc_hook_port_idx {
+    UC_HOOK_PORT_IN_IDX,
+    UC_HOOK_PORT_OUT_IDX,
+
+    UC_HOOK_PORT_MAX,
+};
+
 #define HOOK_FOREACH_VAR_DECLARE                          \
     struct list_item *cur
 
+#define HOOK_FOREACH_BOUNDED_VAR_DECLARE                  \
+    struct hook **cur_hook, **cur_end
+
 // for loop macro to loop over hook lists
 #define HOOK_FOREACH(uc, hh, idx)                         \
     for (                                                 \
         cur = (uc)->hook[idx##_IDX].head;                 \
         cur != NULL && ((hh) = (struct hook *)cur->data)  \
             /* stop excuting callbacks on stop request */ \
-            && !uc->stop_request;                         \
+            && !uc_exit_requested(uc);                    \
         cur = cur->next)
 
+// for loop macro to loop over the hooks whose range covers addr
+#define HOOK_FOREACH_BOUNDED(uc, hh, idx, addr)                           \
+    for (                                                                 \
+        cur_hook = hook_table_lookup((uc)->hook_table[idx##_IDX], addr, &cur_end), \
+        cur_hook = hook_skip_deleted(cur_hook, cur_end);                  \
+        cur_hook < cur_end && ((hh) = *cur_hook)                          \
+            /* stop excuting callbacks on stop request */                 \
+            && !uc_exit_requested(uc);                                    \
+        cur_hook = hook_skip_deleted(cur_hook + 1, cur_end))
+
+// for loop macro to loop over the IN or OUT hooks whose port range covers port
+#define HOOK_FOREACH_PORT(uc, hh, idx, port)                              \
+    for (                                                                 \
+        cur_hook = hook_table_lookup((uc)->hook_port_table[idx##_IDX], port, &cur_end), \
+        cur_hook = hook_skip_deleted(cur_hook, cur_end);                  \
+        cur_hook < cur_end && ((hh) = *cur_hook)                          \
+            /* stop excuting callbacks on stop request */                 \
+            && !uc_exit_requested(uc);                                    \
+        cur_hook = hook_skip_deleted(cur_hook + 1, cur_end))
+
 // if statement to check hook bounds
 #define HOOK_BOUND_CHECK(hh, addr)                  \
     ((((addr) >= (hh)->begin && (addr) <= (hh)->end) \
          || (hh)->begin > (hh)->end))
 
 #define HOOK_EXISTS(uc, idx) ((uc)->hook[idx##_IDX].head != NULL)
-#define HOOK_EXISTS_BOUNDED(uc, idx, addr) _hook_exists_bounded((uc)->hook[idx##_IDX].head, addr)
+#define HOOK_EXISTS_BOUNDED(uc, idx, addr) _hook_exists_bounded((uc)->hook_table[idx##_IDX], addr)
+#define HOOK_EXISTS_IN_RANGE(uc, idx, begin, end) \
+    _hook_exists_in_range((uc)->hook_table[idx##_IDX], begin, end)
 
-static inline bool _hook_exists_bounded(struct list_item *cur, uint64_t addr)
+// index of the table interval containing addr
+static inline uint32_t hook_table_interval(struct hook_table *table, uint64_t addr)
 {
-    while (cur != NULL) {
-        if (HOOK_BOUND_CHECK((struct hook *)cur->data, addr))
+    uint32_t lo = 0, hi = table->count, mid;
+
+    // last interval starting at or before addr
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (table->starts[mid] <= addr)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+// hooks of a table covering addr, returned as [result, *end)
+static inline struct hook **hook_table_lookup(struct hook_table *table, uint64_t addr,
+        struct hook ***end)
+{
+    uint32_t i;
+
+    if (table == NULL) {
+        *end = NULL;
+        return NULL;
+    }
+
+    i = hook_table_interval(table, addr);
+    *end = table->hooks + table->offsets[i + 1];
+    return table->hooks + table->offsets[i];
+}
+
+// first hook of [cur, end) not deleted by a callback, end if there is none
+static inline struct hook **hook_skip_deleted(struct hook **cur, struct hook **end)
+{
+    while (cur < end && (*cur)->to_delete)
+        cur++;
+
+    return cur;
+}
+
+static inline bool _hook_exists_bounded(struct hook_table *table, uint64_t addr)
+{
+    struct hook **end;
+
+    return hook_table_lookup(table, addr, &end) != end;
+}
+
+// true if any hook of a table covers part of [begin, end]
+static inline bool _hook_exists_in_range(struct hook_table *table, uint64_t begin, uint64_t end)
+{
+    uint32_t i, last;
+
+    if (table == NULL) {
+        return false;
+    }
+
+    last = hook_table_interval(table, end);
+    for (i = hook_table_interval(table, begin); i <= last; i++) {
+        if (table->offsets[i] != table->offsets[i + 1]) {
             return true;
-        cur = cur->next;
+        }
     }
+
     return false;
 }
 
@@ -152,6 +316,8 @@ struct uc_struct {
     uc_err errnum;  // qemu/cpu-exec.c
     AddressSpace as;
     query_t query;
+    query_t stats_query;    // UC_QUERY_* kept by TCG, see tb_stats_query()
+    profile_top_t profile_top;
     reg_read_t reg_read;
     reg_write_t reg_write;
     reg_reset_t reg_reset;
@@ -168,9 +334,22 @@ struct uc_struct {
     uc_args_uc_long_t tcg_exec_init;
     uc_args_uc_ram_size_t memory_map;
     uc_args_uc_ram_size_ptr_t memory_map_ptr;
+    uc_args_uc_ram_size_fd_t memory_map_fd;
+    uc_args_uc_ram_size_mmio_t memory_map_io;
     uc_mem_unmap_t memory_unmap;
     uc_readonly_mem_t readonly_mem;
     uc_mem_redirect_t mem_redirect;
+    uc_invalidate_tb_t uc_invalidate_tb;
+    uc_invalidate_tb_pc_t uc_invalidate_tb_pc;
+    uc_tlb_flush_t uc_tlb_flush;
+    uc_snapshot_save_t snapshot_save;
+    uc_snapshot_restore_t snapshot_restore;
+    uc_memory_host_ptr_t memory_host_ptr;
+    uc_memory_host_written_t memory_host_written;
+    uc_breakpoint_insert_t breakpoint_insert;
+    uc_breakpoint_remove_t breakpoint_remove;
+    uc_watchpoint_insert_t watchpoint_insert;
+    uc_watchpoint_remove_t watchpoint_remove;
     // TODO: remove current_cpu, as it's a flag for something else ("cpu running"?)
     CPUState *cpu, *current_cpu;
 
@@ -253,21 +432,50 @@ struct uc_struct {
 
     // linked lists containing hooks per type
     struct list hook[UC_HOOK_MAX];
-
-    // hook to count number of instructions for uc_emu_start()
-    uc_hook count_hook;
-
-    size_t emu_counter; // current counter of uc_emu_start()
-    size_t emu_count; // save counter of uc_emu_start()
-
-    uint64_t block_addr;    // save the last block address we hooked
+    // the same hooks indexed by address, NULL when there is none
+    struct hook_table *hook_table[UC_HOOK_MAX];
+    // IN & OUT hooks, and their tables indexed by port
+    struct list hook_port[UC_HOOK_PORT_MAX];
+    struct hook_table *hook_port_table[UC_HOOK_PORT_MAX];
+    // tables of lists changed outside of emulation, rebuilt by uc_emu_start()
+    bool hook_table_stale[UC_HOOK_MAX];
+    bool hook_port_table_stale[UC_HOOK_PORT_MAX];
+    // hooks & tables replaced while emulating, freed when uc_emu_start() returns
+    struct list hooks_to_free;
+    struct list hook_tables_to_free;
+    // vectors compiled into the block being translated, see hook_vectors_take()
+    struct list tb_hook_vectors;
+    // vectors of blocks invalidated while they may still run
+    struct list hook_vectors_to_release;
+
+    size_t emu_count; // instruction limit of uc_emu_start(), counted down by icount
+
+    // AFL-style edge coverage compiled into the translated code, see gen_uc_coverage()
+    uint8_t *coverage_map;      // NULL when disabled
+    uint32_t coverage_mask;     // size of the map - 1
+    uint32_t coverage_prev;     // location of the previous block, shifted right by 1
+
+    bool profile_enabled;       // blocks count their runs, see gen_tb_start()
+
+    // accesses recorded by the softmmu helpers, see uc_mem_trace_enable()
+    uc_mem_access *mem_trace;   // NULL when disabled
+    size_t mem_trace_size;      // capacity of mem_trace, in records
+    size_t mem_trace_count;     // records not flushed yet
+    uc_cb_mem_trace_t mem_trace_callback;
+    void *mem_trace_data;
+    struct uc_mem_trace_pc *mem_trace_pcs;  // UC_MEM_TRACE_PCS entries
+    int mem_trace_split;        // > 0 in the halves of a page-crossing access, traced as one
+
+    struct uc_stats stats;
 
     bool init_tcg;      // already initialized local TCGv variables?
+    // the following flags may be accessed from other threads or from signal
+    // handlers, always with atomic_read() / atomic_set()
     bool stop_request;  // request to immediately stop emulation - for uc_emu_stop()
-    bool quit_request;  // request to quit the current TB, but continue to emulate - for uc_mem_protect()
+    bool quit_request;  // request to quit the current TB, but continue to emulate - for uc_emu_quit_tb()
     bool emulation_done;  // emulation is done by uc_emu_start()
-    QemuThread timer;   // timer for emulation timeout
-    uint64_t timeout;   // timeout for uc_emu_start()
+    int64_t timeout_deadline;   // get_clock() stopping uc_emu_start() on timeout
+    struct uc_struct *timeout_next;   // in the engines waiting for the timeout thread
 
     uint64_t invalid_addr;  // invalid address to be accessed
     int invalid_error;  // invalid memory code: 1 = READ, 2 = WRITE, 3 = CODE
@@ -277,10 +485,13 @@ struct uc_struct {
     int thumb;  // thumb mode for ARM
     // full TCG cache leads to middle-block break in the last translation?
     bool block_full;
-    int size_arg;     // what tcg arg slot do we need to update with the size of the block?
+    // blocks cut short by a full TCG buffer or by @addr_end, dropped after each run
+    struct list truncated_tbs;
+    bool tb_flush_request;  // a translation-time hook changed, flush the TB cache
     MemoryRegion **mapped_blocks;
     uint32_t mapped_block_count;
     uint32_t mapped_block_cache_index;
+    struct uc_snapshot *snapshot_last;  // snapshot the dirty page bitmap is relative to
     void *qemu_thread_data; // to support cross compile to Windows (qemu-thread-win32.c)
     uint32_t target_page_size;
     uint32_t target_page_align;
@@ -298,8 +509,72 @@ struct uc_context {
    char data[0];
 };
 
+// How the RAM of a region was allocated, MemoryRegion.backing
+enum uc_mem_backing {
+    UC_MEM_BACKING_ANON,        // uc_mem_map()
+    UC_MEM_BACKING_ZERO,        // uc_mem_map_file() without a file
+    UC_MEM_BACKING_ZERO_SHARED, // same, shared
+    UC_MEM_BACKING_PTR,         // uc_mem_map_ptr(), memory of the user
+    UC_MEM_BACKING_FILE,        // uc_mem_map_file() of a file
+};
+
+// Callbacks of a region of uc_mmio_map(), the opaque of its MemoryRegionOps
+struct uc_mmio {
+    uc_cb_mmio_read_t read;
+    uc_cb_mmio_write_t write;
+    void *user_data;
+};
+
+// Copy of one memory region, part of a uc_snapshot
+struct uc_snapshot_region {
+    MemoryRegion *mr;   // region the copy belongs to, as long as it stays mapped
+    uint64_t begin, end;
+    uint32_t perms;
+    uint8_t *page_perms;    // per-page perms of the region, or NULL
+    uint8_t backing;        // enum uc_mem_backing of a RAM region
+    uint8_t *data;          // NULL for an MMIO region
+    struct uc_mmio mmio;    // callbacks of an MMIO region
+};
+
+// Memory snapshot used with uc_snapshot_*(), regions sorted by address
+struct uc_snapshot {
+    uint32_t count;
+    struct uc_snapshot_region *regions;
+};
+
 // check if this address is mapped in (via uc_mem_map())
 MemoryRegion *memory_mapping(struct uc_struct* uc, uint64_t address);
+// permissions of the page of this address in its region @mr
+uint32_t memory_page_perms(struct uc_struct *uc, MemoryRegion *mr, uint64_t address);
+void uc_mem_trace_flush(struct uc_struct *uc);
+
+// index of the first mapped block ending after this address (binary search)
+uint32_t mapped_block_bsearch(struct uc_struct *uc, uint64_t address);
+
+// hooks of list @idx matching @pc, for helper_uc_tracecode()
+struct hook_vector *hook_vector_get(struct uc_struct *uc, int idx, uint64_t pc);
+
+// NULL terminated array of the vectors compiled into the block just
+// translated, holding a reference on each; NULL when there is none
+struct hook_vector **hook_vectors_take(struct uc_struct *uc);
+
+// drop the references of a block on its vectors, now or once no block runs
+void hook_vectors_release(struct hook_vector **vectors);
+void hook_vectors_release_later(struct hook_vector **vectors);
+
+// no block runs: drop the vectors of an aborted translation and those of
+// the blocks invalidated meanwhile
+void hook_vectors_reset(struct uc_struct *uc);
+
+// quit the current TB, but continue to emulate at the same place,
+// e.g. once the translated code became stale
+void uc_emu_quit_tb(struct uc_struct *uc);
+
+// stop or quit requested: callbacks left for the current instruction are skipped
+static inline bool uc_exit_requested(struct uc_struct *uc)
+{
+    return atomic_read(&uc->stop_request) || atomic_read(&uc->quit_request);
+}
 
 // Defined in util/cacheinfo.c. Made externally linked to
 // allow calling it directly.
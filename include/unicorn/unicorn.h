@@ -152,7 +152,8 @@ typedef enum uc_err {
     UC_ERR_FETCH_UNALIGNED,  // Unaligned fetch
     UC_ERR_HOOK_EXIST,  // hook for this event already existed
     UC_ERR_RESOURCE,    // Insufficient resource: uc_emu_start()
-    UC_ERR_EXCEPTION // Unhandled CPU exception
+    UC_ERR_EXCEPTION, // Unhandled CPU exception
+    UC_ERR_BREAKPOINT, // Quit emulation on a breakpoint of uc_breakpoint_add(): uc_emu_start()
 } uc_err;
 
 
@@ -191,6 +192,27 @@ typedef uint32_t (*uc_cb_insn_in_t)(uc_engine *uc, uint32_t port, int size, void
 */
 typedef void (*uc_cb_insn_out_t)(uc_engine *uc, uint32_t port, int size, uint32_t value, void *user_data);
 
+/*
+  Callback function for reads from a region of uc_mmio_map()
+
+  @offset: offset of the access in the region
+  @size: data size (1/2/4/8) to be read
+  @user_data: user data passed to uc_mmio_map()
+
+  @return the value read
+*/
+typedef uint64_t (*uc_cb_mmio_read_t)(uc_engine *uc, uint64_t offset, unsigned size, void *user_data);
+
+/*
+  Callback function for writes to a region of uc_mmio_map()
+
+  @offset: offset of the access in the region
+  @size: data size (1/2/4/8) to be written
+  @value: data value to be written
+  @user_data: user data passed to uc_mmio_map()
+*/
+typedef void (*uc_cb_mmio_write_t)(uc_engine *uc, uint64_t offset, unsigned size, uint64_t value, void *user_data);
+
 // All type of memory accesses for UC_HOOK_MEM_*
 typedef enum uc_mem_type {
     UC_MEM_READ = 16,   // Memory is read from
@@ -236,6 +258,9 @@ typedef enum uc_hook_type {
     // Hook memory read events, but only successful access.
     // The callback will be triggered after successful read.
     UC_HOOK_MEM_READ_AFTER = 1 << 13,
+    // Hook IN or OUT instructions (x86 only) on the ports in [begin, end].
+    // UC_HOOK_INSN hooks on them are called for every port.
+    UC_HOOK_INSN_PORT = 1 << 14,
 } uc_hook_type;
 
 // Hook type for all events of unmapped memory access
@@ -293,6 +318,38 @@ typedef void (*uc_cb_hookmem_t)(uc_engine *uc, uc_mem_type type,
 typedef bool (*uc_cb_eventmem_t)(uc_engine *uc, uc_mem_type type,
         uint64_t address, int size, int64_t value, void *user_data);
 
+/*
+  Memory access recorded by uc_mem_trace_enable()
+*/
+typedef struct uc_mem_access {
+    uint64_t pc;        // address of the instruction making the access
+    uint64_t address;   // address accessed
+    uint64_t value;     // value read or written
+    uint32_t size;      // size of the access, in bytes
+    uint32_t type;      // UC_MEM_READ or UC_MEM_WRITE
+} uc_mem_access;
+
+/*
+  Callback function receiving the records of uc_mem_trace_enable()
+
+  @records: the records, oldest first. They are overwritten once the
+    callback returns.
+  @count: number of records
+  @user_data: user data passed to uc_mem_trace_enable()
+*/
+typedef void (*uc_cb_mem_trace_t)(uc_engine *uc, const uc_mem_access *records,
+        size_t count, void *user_data);
+
+/*
+  Translated block reported by uc_profile_top()
+*/
+typedef struct uc_tb_profile {
+    uint64_t pc;        // address of the first instruction of the block
+    uint64_t count;     // number of times the block ran
+    uint32_t size;      // size of the guest code of the block, in bytes
+    uint32_t host_size; // size of the translated host code, in bytes
+} uc_tb_profile;
+
 /*
   Memory region mapped by uc_mem_map() and uc_mem_map_ptr()
   Retrieve the list of memory regions with uc_mem_regions()
@@ -309,12 +366,33 @@ typedef enum uc_query_type {
     UC_QUERY_MODE = 1,
     UC_QUERY_PAGE_SIZE,
     UC_QUERY_ARCH,
+
+    // Engine statistics, counted since uc_open() unless noted.
+    // They can be read at any time, even from a hook: the TB_HASH ones walk
+    // the hash table (a few us), the others are plain counters.
+    UC_QUERY_TB_TRANSLATED,     // blocks translated
+    UC_QUERY_TB_FLUSHES,        // flushes of all the translated code
+    UC_QUERY_TB_INVALIDATED,    // blocks dropped one by one (code written, unmapped, ...)
+    UC_QUERY_CODE_GEN_USED,     // bytes of host code in the translation buffer now
+    UC_QUERY_CODE_GEN_SIZE,     // size of the translation buffer
+    UC_QUERY_TB_HASH_ENTRIES,   // blocks in the lookup hash table now
+    UC_QUERY_TB_HASH_BUCKETS,   // head buckets of the lookup hash table now
+    UC_QUERY_TB_HASH_USED,      // of them, the non-empty ones
+    UC_QUERY_TLB_FLUSHES,       // flushes of the whole soft TLB
+    UC_QUERY_TLB_FILLS,         // soft TLB misses, filled by a page walk
+    UC_QUERY_HOOK_CALLS,        // UC_HOOK_CODE / UC_HOOK_BLOCK dispatches
+    UC_QUERY_CPU_EXITS,         // requests to leave the CPU loop
+    UC_QUERY_HOOK_VECTORS,      // hook sets compiled into the translated code, alive now
 } uc_query_type;
 
 // Opaque storage for CPU context, used with uc_context_*()
 struct uc_context;
 typedef struct uc_context uc_context;
 
+// Opaque storage for a copy of the mapped memory, used with uc_snapshot_*()
+struct uc_snapshot;
+typedef struct uc_snapshot uc_snapshot;
+
 /*
  Return combined API version & major and minor version numbers.
 
@@ -383,6 +461,8 @@ uc_err uc_close(uc_engine *uc);
  @type: query type. See uc_query_type
 
  @result: save the internal status queried
+   A translation storm shows as UC_QUERY_TB_TRANSLATED growing along with
+   UC_QUERY_TB_FLUSHES or UC_QUERY_TB_INVALIDATED.
 
  @return: error code of uc_err enum type (UC_ERR_*, see above)
 */
@@ -497,6 +577,42 @@ uc_err uc_mem_write(uc_engine *uc, uint64_t address, const void *bytes, size_t s
 UNICORN_EXPORT
 uc_err uc_mem_read(uc_engine *uc, uint64_t address, void *bytes, size_t size);
 
+/*
+ Get a host pointer to a range of emulated memory, to read or write it in
+ place instead of copying it with uc_mem_read() / uc_mem_write().
+
+ The pointer stays valid until the memory is unmapped or @uc is closed.
+ Like uc_mem_write(), it ignores the protection of the memory.
+ After writing through it, call uc_mem_host_written() on the range, so that
+ code translated from it is dropped and uc_snapshot_restore() copies it back.
+
+ @uc: handle returned by uc_open()
+ @address: starting memory address of the range.
+ @size: size of the range, which must be in a single region of uc_mem_map()
+   or uc_mem_map_ptr().
+ @ptr: pointer to a variable receiving the host pointer.
+
+ @return UC_ERR_OK on success, UC_ERR_READ_UNMAPPED if @address is not mapped,
+   UC_ERR_ARG if the range is empty or leaves its region, or other value on
+   failure (refer to uc_err enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mem_get_host_ptr(uc_engine *uc, uint64_t address, size_t size, void **ptr);
+
+/*
+ Tell Unicorn that a range was written through the pointer of
+ uc_mem_get_host_ptr().
+
+ @uc: handle returned by uc_open()
+ @address: starting memory address of the range.
+ @size: size of the range.
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mem_host_written(uc_engine *uc, uint64_t address, size_t size);
+
 /*
  Emulate machine code in a specific duration of time.
 
@@ -508,15 +624,24 @@ uc_err uc_mem_read(uc_engine *uc, uint64_t address, void *bytes, size_t size);
  @count: the number of instructions to be emulated. When this value is 0,
         we will emulate all the code available, until the code is finished.
 
- @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
-   for detailed error).
+ @return UC_ERR_OK on success, UC_ERR_BREAKPOINT if a breakpoint of
+   uc_breakpoint_add() was hit, or other value on failure (refer to uc_err
+   enum for detailed error).
 */
 UNICORN_EXPORT
 uc_err uc_emu_start(uc_engine *uc, uint64_t begin, uint64_t until, uint64_t timeout, size_t count);
 
 /*
  Stop emulation (which was started by uc_emu_start() API.
- This is typically called from callback functions registered via tracing APIs.
+ This is typically called from callback functions registered via tracing APIs,
+ but may also be called from another thread.
+
+ Called from a callback, no further callback is run and the emulation stops
+ before the next guest instruction. Called from another thread, the guest
+ observes the request when entering its next translation block, or at the
+ next callback. A request made while uc_emu_start() is not running is ignored.
+ This only sets atomic flags without waiting for anything, so it is also
+ safe to call from a signal handler.
 
  @uc: handle returned by uc_open()
 
@@ -526,6 +651,146 @@ uc_err uc_emu_start(uc_engine *uc, uint64_t begin, uint64_t until, uint64_t time
 UNICORN_EXPORT
 uc_err uc_emu_stop(uc_engine *uc);
 
+/*
+ Count the edges taken between translation blocks in an AFL-style bitmap.
+ The translated code updates the bitmap itself, without any callback:
+ for each block executed, bitmap[cur ^ prev]++ where cur is a hash of the
+ block address and prev the one of the previous block, shifted right by 1.
+ Counters wrap around at 256. prev is reset by every uc_emu_start().
+ Changing the bitmap drops all the translated code.
+
+ @uc: handle returned by uc_open()
+ @bitmap: counters, which must stay valid until coverage is disabled or
+   @uc is closed. NULL disables coverage.
+ @size: size of @bitmap in bytes, a power of two no larger than 2GB.
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_coverage_enable(uc_engine *uc, uint8_t *bitmap, size_t size);
+
+/*
+ Count how many times each translated block runs, to find the hot code.
+ The translated code increments its own counter, without any callback,
+ which is much cheaper than a UC_HOOK_BLOCK hook.
+ Changing the setting drops all the translated code, and so the counts.
+ The counts of a block are also lost when its code is modified or the
+ translation cache is flushed.
+
+ @uc: handle returned by uc_open()
+ @enable: true to count, false to stop counting
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_profile_enable(uc_engine *uc, bool enable);
+
+/*
+ Retrieve the translated blocks run most often since uc_profile_enable().
+ A block of code translated several times, for example in different CPU
+ modes, is reported once per translation.
+
+ @uc: handle returned by uc_open()
+ @blocks: array receiving the blocks, hottest first
+ @count: on input, number of entries in @blocks. On output, number of
+   entries filled, which is smaller if fewer blocks ran.
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_profile_top(uc_engine *uc, uc_tb_profile *blocks, size_t *count);
+
+/*
+ Set a breakpoint: emulation stops right before executing the instruction
+ at @address, with uc_emu_start() returning UC_ERR_BREAKPOINT and the PC on
+ @address. Only the translated code containing @address is affected, other
+ code runs at full speed however many breakpoints are set.
+ A uc_emu_start() beginning on a breakpoint runs over it, so emulation can
+ be resumed from where it stopped.
+
+ @uc: handle returned by uc_open()
+ @address: address of the instruction
+
+ @return UC_ERR_OK on success, UC_ERR_ARG if there is already a breakpoint
+   at @address, or other value on failure (refer to uc_err enum for detailed
+   error).
+*/
+UNICORN_EXPORT
+uc_err uc_breakpoint_add(uc_engine *uc, uint64_t address);
+
+/*
+ Remove a breakpoint set by uc_breakpoint_add().
+
+ @uc: handle returned by uc_open()
+ @address: address of the breakpoint
+
+ @return UC_ERR_OK on success, UC_ERR_ARG if there is no breakpoint at
+   @address, or other value on failure (refer to uc_err enum for detailed
+   error).
+*/
+UNICORN_EXPORT
+uc_err uc_breakpoint_del(uc_engine *uc, uint64_t address);
+
+/*
+ Set a data watchpoint: @callback runs on every load or store of emulated
+ code that touches [@address, @address + @size), exactly like a
+ UC_HOOK_MEM_READ or UC_HOOK_MEM_WRITE hook on that range.
+ Only the pages of the watched range leave the TLB fast path, accesses to
+ other pages run at full speed.
+
+ @uc: handle returned by uc_open()
+ @address: first watched byte
+ @size: number of watched bytes
+ @type: UC_HOOK_MEM_READ, UC_HOOK_MEM_WRITE or both
+ @callback: a uc_cb_hookmem_t, called with UC_MEM_READ (before the load)
+   or UC_MEM_WRITE (before the store). It may remove its own watchpoint.
+ @user_data: user-defined data, passed to @callback
+
+ @return UC_ERR_OK on success, UC_ERR_ARG if the same watchpoint is already
+   set or an argument is invalid, or other value on failure (refer to uc_err
+   enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_watchpoint_add(uc_engine *uc, uint64_t address, size_t size, int type,
+        void *callback, void *user_data);
+
+/*
+ Remove a watchpoint set by uc_watchpoint_add().
+
+ @uc: handle returned by uc_open()
+ @address, @size, @type: the same as given to uc_watchpoint_add()
+
+ @return UC_ERR_OK on success, UC_ERR_ARG if there is no such watchpoint,
+   or other value on failure (refer to uc_err enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_watchpoint_del(uc_engine *uc, uint64_t address, size_t size, int type);
+
+/*
+ Record every load and store of emulated code into @buffer, instead of
+ calling a UC_HOOK_MEM_READ / UC_HOOK_MEM_WRITE hook for each of them.
+ @callback gets the records whenever @buffer is full, and when
+ uc_emu_start() returns. Reads are recorded once done, with the value read;
+ writes are recorded right before they happen.
+
+ @uc: handle returned by uc_open()
+ @buffer: array of @count records, which must stay valid until tracing is
+   disabled or @uc is closed. NULL disables tracing, after handing the
+   pending records to the previous callback.
+ @count: number of records in @buffer
+ @callback: callback receiving the records
+ @user_data: user-defined data, passed to @callback
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mem_trace_enable(uc_engine *uc, uc_mem_access *buffer, size_t count,
+        uc_cb_mem_trace_t callback, void *user_data);
+
 /*
  Register callback for a hook event.
  The callback will be run when the hook event is hit.
@@ -540,8 +805,13 @@ uc_err uc_emu_stop(uc_engine *uc);
  @end: end address of the area where the callback is effect (inclusive)
    NOTE 1: the callback is called only if related address is in range [@begin, @end]
    NOTE 2: if @begin > @end, callback is called whenever this hook type is triggered
+   NOTE 3: for UC_HOOK_INSN_PORT, this is the range of ports. UC_HOOK_INSN
+     hooks on UC_X86_INS_IN & UC_X86_INS_OUT cover every port. The first IN
+     hook covering a port provides the value read, all the OUT hooks covering
+     it are called.
  @...: variable arguments (depending on @type)
-   NOTE: if @type = UC_HOOK_INSN, this is the instruction ID (ex: UC_X86_INS_OUT)
+   NOTE: if @type = UC_HOOK_INSN or UC_HOOK_INSN_PORT, this is the instruction
+     ID (ex: UC_X86_INS_OUT)
 
  @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
    for detailed error).
@@ -614,6 +884,63 @@ uc_err uc_mem_map(uc_engine *uc, uint64_t address, size_t size, uint32_t perms);
 UNICORN_EXPORT
 uc_err uc_mem_map_ptr(uc_engine *uc, uint64_t address, size_t size, uint32_t perms, void *ptr);
 
+/*
+ Map a file, or demand-zero memory, in for emulation, like mmap() does.
+ Host memory is only taken by the pages the emulation or the host touches,
+ so large sparse address spaces and big images are cheap to map.
+ Not available on Windows.
+
+ @uc: handle returned by uc_open()
+ @address: starting address of the new memory region to be mapped in.
+    This address must be aligned to 4KB, or this will return with UC_ERR_ARG error.
+ @size: size of the new memory region to be mapped in.
+    This size must be multiple of 4KB, or this will return with UC_ERR_ARG error.
+    When @fd is a regular file, @offset + @size must not go past its end,
+    or this will return with UC_ERR_ARG error.
+ @perms: Permissions for the newly mapped region.
+    This must be some combination of UC_PROT_READ | UC_PROT_WRITE | UC_PROT_EXEC,
+    or this will return with UC_ERR_ARG error.
+ @fd: file to map, opened for reading (and writing if not @private_map),
+    or -1 for memory filled with zeros. It can be closed once mapped.
+    UC_ERR_ARG is returned if it is not an open file descriptor.
+ @offset: offset of the region in the file, a multiple of the host page size.
+ @private_map: true to keep writes in the emulation (copy-on-write), false to
+    write them to the file.
+
+ @return UC_ERR_OK on success, UC_ERR_NOMEM if the file cannot be mapped, or
+   other value on failure (refer to uc_err enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mem_map_file(uc_engine *uc, uint64_t address, size_t size, uint32_t perms,
+        int fd, uint64_t offset, bool private_map);
+
+/*
+ Map a memory-mapped peripheral in for emulation: every access to the region
+ calls @read_cb or @write_cb instead of touching memory.
+ Only these accesses leave the fast path of the emulated CPU, unlike
+ UC_HOOK_MEM_READ / UC_HOOK_MEM_WRITE hooks which slow down all of them.
+
+ The region is readable if @read_cb is set and writable if @write_cb is set,
+ other accesses fail with UC_ERR_READ_PROT / UC_ERR_WRITE_PROT. It is never
+ executable, and uc_mem_protect() cannot change it. uc_mem_read() and
+ uc_mem_write() go through the callbacks too.
+
+ @uc: handle returned by uc_open()
+ @address: starting address of the new memory region to be mapped in.
+    This address must be aligned to 4KB, or this will return with UC_ERR_ARG error.
+ @size: size of the new memory region to be mapped in.
+    This size must be multiple of 4KB, or this will return with UC_ERR_ARG error.
+ @read_cb: callback for reads, or NULL.
+ @write_cb: callback for writes, or NULL.
+ @user_data: user-defined data, passed to both callbacks.
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mmio_map(uc_engine *uc, uint64_t address, size_t size,
+        uc_cb_mmio_read_t read_cb, uc_cb_mmio_write_t write_cb, void *user_data);
+
 /*
  Unmap a region of emulation memory.
  This API deletes a memory mapping from the emulation memory space.
@@ -723,6 +1050,55 @@ uc_err uc_context_save(uc_engine *uc, uc_context *context);
 UNICORN_EXPORT
 uc_err uc_context_restore(uc_engine *uc, uc_context *context);
 
+/*
+ Take a snapshot of all memory currently mapped, along with the layout
+ and permissions of the memory regions.
+ Unicorn tracks the pages written after this call, so that restoring the
+ latest snapshot only costs the pages that actually changed. CPU registers
+ are not part of the snapshot, save them with uc_context_save().
+
+ @uc: handle returned by uc_open()
+ @snapshot: pointer to a uc_snapshot*. This will be updated with the pointer
+   to the new snapshot on successful return of this function.
+   Later, this snapshot must be freed with uc_snapshot_free().
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_snapshot_take(uc_engine *uc, uc_snapshot **snapshot);
+
+/*
+ Roll the mapped memory back to a snapshot taken by uc_snapshot_take().
+ Regions mapped since the snapshot are unmapped, regions unmapped since are
+ mapped again, and permissions are reset. Only the pages written since the
+ last uc_snapshot_take() or uc_snapshot_restore() are copied back; restoring
+ a different snapshot than that one copies all of its pages.
+ NOTE: writes done directly to the host memory given to uc_mem_map_ptr() are
+ not tracked. A region of uc_mem_map_ptr(), or of uc_mem_map_file() with a
+ file, cannot be mapped again once unmapped since its memory may be gone:
+ UC_ERR_MAP is returned then, before anything is changed.
+
+ @uc: handle returned by uc_open()
+ @snapshot: handle returned by uc_snapshot_take()
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_snapshot_restore(uc_engine *uc, uc_snapshot *snapshot);
+
+/*
+ Free a snapshot allocated by uc_snapshot_take().
+
+ @snapshot: handle returned by uc_snapshot_take()
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_snapshot_free(uc_snapshot *snapshot);
+
 #ifdef __cplusplus
 }
 #endif
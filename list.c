@@ -90,3 +90,16 @@ bool list_remove(struct list *list, void *data)
     }
     return false;
 }
+
+// returns true if the data exists in the list
+bool list_exists(struct list *list, void *data)
+{
+    struct list_item *cur;
+
+    for (cur = list->head; cur != NULL; cur = cur->next) {
+        if (cur->data == data) {
+            return true;
+        }
+    }
+    return false;
+}
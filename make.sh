@@ -14,6 +14,13 @@ asan() {
   ${MAKE} V=1
 }
 
+# build for TSAN
+tsan() {
+  UNICORN_DEBUG=yes
+  UNICORN_TSAN=yes
+  ${MAKE} V=1
+}
+
 # build iOS lib for all iDevices, or only specific device
 build_iOS() {
   IOS_SDK=`xcrun --sdk iphoneos --show-sdk-path`
@@ -122,6 +129,7 @@ export CC INSTALL_BIN PREFIX PKGCFGDIR LIBDIRARCH LIBARCHS CFLAGS LDFLAGS
 case "$1" in
   "" ) ${MAKE};;
   "asan" ) asan;;
+  "tsan" ) tsan;;
   "install" ) install;;
   "uninstall" ) uninstall;;
   "macos-universal" ) MACOS_UNIVERSAL=yes ${MAKE};;
@@ -0,0 +1,9 @@
+# Automatically generated by configure - do not modify
+TARGET_AARCH64=y
+TARGET_NAME=aarch64
+TARGET_BASE_ARCH=arm
+CONFIG_SOFTMMU=y
+TARGET_SUPPORTS_MTTCG=y
+LDFLAGS+=
+QEMU_CFLAGS+=
+QEMU_CFLAGS+=-include aarch64.h
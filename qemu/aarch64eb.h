@@ -315,6 +315,7 @@
 #define cpu_physical_memory_range_includes_clean cpu_physical_memory_range_includes_clean_aarch64eb
 #define cpu_physical_memory_reset_dirty cpu_physical_memory_reset_dirty_aarch64eb
 #define cpu_physical_memory_rw cpu_physical_memory_rw_aarch64eb
+#define cpu_physical_memory_test_and_clear_dirty cpu_physical_memory_test_and_clear_dirty_aarch64eb
 #define cpu_physical_memory_unmap cpu_physical_memory_unmap_aarch64eb
 #define cpu_physical_memory_write_rom cpu_physical_memory_write_rom_aarch64eb
 #define cpu_physical_memory_write_rom_internal cpu_physical_memory_write_rom_internal_aarch64eb
@@ -1757,7 +1758,9 @@
 #define memory_listener_register memory_listener_register_aarch64eb
 #define memory_listener_unregister memory_listener_unregister_aarch64eb
 #define memory_map memory_map_aarch64eb
+#define memory_map_fd memory_map_fd_aarch64eb
 #define memory_map_init memory_map_init_aarch64eb
+#define memory_map_io memory_map_io_aarch64eb
 #define memory_map_ptr memory_map_ptr_aarch64eb
 #define memory_mapping_filter memory_mapping_filter_aarch64eb
 #define memory_mapping_list_add_mapping_sorted memory_mapping_list_add_mapping_sorted_aarch64eb
@@ -1799,6 +1802,7 @@
 #define memory_region_init_io memory_region_init_io_aarch64eb
 #define memory_region_init_ram_device_ptr memory_region_init_ram_device_ptr_aarch64eb
 #define memory_region_init_ram_nomigrate memory_region_init_ram_nomigrate_aarch64eb
+#define memory_region_init_ram_from_fd memory_region_init_ram_from_fd_aarch64eb
 #define memory_region_init_ram_ptr memory_region_init_ram_ptr_aarch64eb
 #define memory_region_init_reservation memory_region_init_reservation_aarch64eb
 #define memory_region_init_resizeable_ram memory_region_init_resizeable_ram_aarch64eb
@@ -1833,6 +1837,10 @@
 #define memory_region_write_accessor memory_region_write_accessor_aarch64eb
 #define memory_region_wrong_endianness memory_region_wrong_endianness_aarch64eb
 #define memory_register_types memory_register_types_aarch64eb
+#define memory_host_ptr memory_host_ptr_aarch64eb
+#define memory_host_written memory_host_written_aarch64eb
+#define memory_snapshot_restore memory_snapshot_restore_aarch64eb
+#define memory_snapshot_save memory_snapshot_save_aarch64eb
 #define memory_try_enable_merging memory_try_enable_merging_aarch64eb
 #define memory_unmap memory_unmap_aarch64eb
 #define module_call_init module_call_init_aarch64eb
@@ -2152,6 +2160,7 @@
 #define qemu_ram_addr_from_host qemu_ram_addr_from_host_aarch64eb
 #define qemu_ram_addr_from_host_nofail qemu_ram_addr_from_host_nofail_aarch64eb
 #define qemu_ram_alloc qemu_ram_alloc_aarch64eb
+#define qemu_ram_alloc_from_fd qemu_ram_alloc_from_fd_aarch64eb
 #define qemu_ram_alloc_from_ptr qemu_ram_alloc_from_ptr_aarch64eb
 #define qemu_ram_alloc_resizeable qemu_ram_alloc_resizeable_aarch64eb
 #define qemu_ram_block_by_name qemu_ram_block_by_name_aarch64eb
@@ -2438,6 +2447,8 @@
 #define tb_find_pc tb_find_pc_aarch64eb
 #define tb_find_slow tb_find_slow_aarch64eb
 #define tb_flush tb_flush_aarch64eb
+#define tb_stats_query tb_stats_query_aarch64eb
+#define tb_profile_top tb_profile_top_aarch64eb
 #define tb_flush_jmp_cache tb_flush_jmp_cache_aarch64eb
 #define tb_gen_code tb_gen_code_aarch64eb
 #define tb_hash_remove tb_hash_remove_aarch64eb
@@ -2931,11 +2942,13 @@
 #define tlb_flush_page tlb_flush_page_aarch64eb
 #define tlb_flush_page_by_mmuidx tlb_flush_page_by_mmuidx_aarch64eb
 #define tlb_is_dirty_ram tlb_is_dirty_ram_aarch64eb
+#define tlb_protect_code tlb_protect_code_aarch64eb
 #define tlb_reset_dirty tlb_reset_dirty_aarch64eb
 #define tlb_reset_dirty_range tlb_reset_dirty_range_aarch64eb
 #define tlb_set_dirty tlb_set_dirty_aarch64eb
 #define tlb_set_page tlb_set_page_aarch64eb
 #define tlb_set_page_with_attrs tlb_set_page_with_attrs_aarch64eb
+#define tlb_unprotect_code tlb_unprotect_code_aarch64eb
 #define tlb_vaddr_to_host tlb_vaddr_to_host_aarch64eb
 #define tlbi_aa64_asid_is_write tlbi_aa64_asid_is_write_aarch64eb
 #define tlbi_aa64_asid_write tlbi_aa64_asid_write_aarch64eb
@@ -2978,6 +2991,12 @@
 #define type_table_add type_table_add_aarch64eb
 #define type_table_get type_table_get_aarch64eb
 #define type_table_lookup type_table_lookup_aarch64eb
+#define uc_invalidate_tb uc_invalidate_tb_aarch64eb
+#define uc_invalidate_tb_pc uc_invalidate_tb_pc_aarch64eb
+#define uc_tb_insn_pc uc_tb_insn_pc_aarch64eb
+#define uc_tlb_flush uc_tlb_flush_aarch64eb
+#define uc_watchpoint_check uc_watchpoint_check_aarch64eb
+#define uc_watchpoint_flags uc_watchpoint_flags_aarch64eb
 #define uint16_to_float16 uint16_to_float16_aarch64eb
 #define uint16_to_float32 uint16_to_float32_aarch64eb
 #define uint16_to_float64 uint16_to_float64_aarch64eb
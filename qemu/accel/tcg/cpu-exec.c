@@ -65,14 +65,13 @@ static inline tcg_target_ulong cpu_tb_exec(CPUState *cpu, TranslationBlock *itb)
         //                       lookup_symbol(last_tb->pc));
         if (cc->synchronize_from_tb) {
             // avoid sync twice when helper_uc_tracecode() already did this.
-            if (env->uc->emu_counter <= env->uc->emu_count &&
-                    !env->uc->stop_request && !env->uc->quit_request) {
+            if (!uc_exit_requested(env->uc)) {
                 cc->synchronize_from_tb(cpu, last_tb);
             }
         } else {
             assert(cc->set_pc);
             // avoid sync twice when helper_uc_tracecode() already did this.
-            if (env->uc->emu_counter <= env->uc->emu_count && !env->uc->quit_request) {
+            if (!atomic_read(&env->uc->quit_request)) {
                 cc->set_pc(cpu, last_tb->pc);
             }
         }
@@ -410,7 +409,8 @@ static inline bool cpu_handle_interrupt(CPUState *cpu,
             *last_tb = NULL;
         }
     }
-    if (unlikely(cpu->exit_request)) {
+    // Unicorn: also leave on a stop request, whether or not it exited the TB
+    if (unlikely(cpu->exit_request || atomic_read(&cpu->uc->stop_request))) {
         cpu->exit_request = 0;
         cpu->exception_index = EXCP_INTERRUPT;
         return true;
@@ -461,6 +461,8 @@ static inline void cpu_loop_exec_tb(CPUState *cpu, TranslationBlock *tb,
                 // Unicorn: commented out
                 //align_clocks(sc, cpu);
             }
+            // Unicorn: the instruction limit of uc_emu_start() is reached
+            atomic_set(&cpu->uc->stop_request, true);
             cpu->exception_index = EXCP_INTERRUPT;
             cpu_loop_exit(cpu);
         }
@@ -529,6 +531,7 @@ int cpu_exec(struct uc_struct *uc, CPUState *cpu)
 {
     CPUArchState *env = cpu->env_ptr;
     CPUClass *cc = CPU_GET_CLASS(uc, cpu);
+    struct list_item *cur;
     int ret;
 
     if (cpu_handle_halt(cpu)) {
@@ -538,6 +541,18 @@ int cpu_exec(struct uc_struct *uc, CPUState *cpu)
     atomic_mb_set(&uc->current_cpu, cpu);
     atomic_mb_set(&uc->tcg_current_rr_cpu, cpu);
 
+    // Unicorn: a stop requested before current_cpu was set did not make
+    // the vCPU exit, see emu_exit_request()
+    if (atomic_read(&uc->stop_request)) {
+        return EXCP_INTERRUPT;
+    }
+
+    // Unicorn: a hook checked at translation time was added or removed
+    if (uc->tb_flush_request) {
+        uc->tb_flush_request = false;
+        tb_flush(cpu);
+    }
+
     cc->cpu_exec_enter(cpu);
     cpu->exception_index = -1;
     env->invalid_error = UC_ERR_OK;
@@ -558,6 +573,8 @@ int cpu_exec(struct uc_struct *uc, CPUState *cpu)
         g_assert(cc == CPU_GET_CLASS(uc, cpu));
 #endif /* buggy compiler */
         cpu->can_do_io = 1;
+        // Unicorn: a fault may leave a page-crossing access half done
+        uc->mem_trace_split = 0;
         // Unicorn: commented out
         //tb_lock_reset();
     }
@@ -594,10 +611,13 @@ int cpu_exec(struct uc_struct *uc, CPUState *cpu)
 
     cc->cpu_exec_exit(cpu);
 
-    // Unicorn: flush JIT cache to because emulation might stop in
-    // the middle of translation, thus generate incomplete code.
-    // TODO: optimize this for better performance
-    tb_flush(cpu);
+    // Unicorn: emulation might stop in the middle of translation, thus
+    // generate incomplete code. Only drop those blocks, the rest of the
+    // translation cache is kept for the next uc_emu_start().
+    for (cur = uc->truncated_tbs.head; cur != NULL; cur = cur->next) {
+        tb_phys_invalidate(uc, (TranslationBlock *)cur->data, -1);
+    }
+    list_clear(&uc->truncated_tbs);
 
     return ret;
 }
@@ -28,6 +28,7 @@
 #include "exec/cputlb.h"
 #include "exec/memory-internal.h"
 #include "exec/ram_addr.h"
+#include "translate-all.h"
 #include "tcg/tcg.h"
 #include "exec/helper-proto.h"
 #include "qemu/atomic.h"
@@ -75,6 +76,7 @@ void tlb_flush(CPUState *cpu)
 {
     CPUArchState *env = cpu->env_ptr;
 
+    cpu->uc->stats.tlb_flushes++;
     memset(env->tlb_table, -1, sizeof(env->tlb_table));
     memset(env->tlb_v_table, -1, sizeof(env->tlb_v_table));
     cpu_tb_jmp_cache_clear(cpu);
@@ -119,6 +121,21 @@ void tlb_flush_page(CPUState *cpu, target_ulong addr)
     tb_flush_jmp_cache(cpu, addr);
 }
 
+/* update the TLBs so that writes to code in the page of 'ram_addr'
+   can be detected */
+void tlb_protect_code(struct uc_struct *uc, ram_addr_t ram_addr)
+{
+    cpu_physical_memory_test_and_clear_dirty(uc, ram_addr, TARGET_PAGE_SIZE,
+                                             DIRTY_MEMORY_CODE);
+}
+
+/* update the TLB so that writes in physical page 'phys_addr' are no longer
+   tested for self modifying code */
+void tlb_unprotect_code(struct uc_struct *uc, ram_addr_t ram_addr)
+{
+    cpu_physical_memory_set_dirty_flag(uc, ram_addr, DIRTY_MEMORY_CODE);
+}
+
 void tlb_reset_dirty_range(CPUTLBEntry *tlb_entry, uintptr_t start,
                            uintptr_t length)
 {
@@ -177,6 +194,44 @@ void tlb_set_dirty(CPUState *cpu, target_ulong vaddr)
 }
 
 
+/* Unicorn: TLB_HOOKED if a memory hook or a watchpoint of that direction
+   covers part of the page of @vaddr, or if accesses are traced.  */
+static target_ulong tlb_hooked_flag(CPUState *cpu, target_ulong vaddr,
+                                    bool is_write)
+{
+    struct uc_struct *uc = cpu->uc;
+    uint64_t begin = vaddr & TARGET_PAGE_MASK;
+    uint64_t end = begin + TARGET_PAGE_SIZE - 1;
+
+    if (is_write) {
+        if (HOOK_EXISTS_IN_RANGE(uc, UC_HOOK_MEM_WRITE, begin, end)) {
+            return TLB_HOOKED;
+        }
+    } else {
+        if (HOOK_EXISTS_IN_RANGE(uc, UC_HOOK_MEM_READ, begin, end) ||
+            HOOK_EXISTS_IN_RANGE(uc, UC_HOOK_MEM_READ_AFTER, begin, end)) {
+            return TLB_HOOKED;
+        }
+    }
+    if (uc->mem_trace != NULL) {
+        return TLB_HOOKED;
+    }
+    if (unlikely(!QTAILQ_EMPTY(&cpu->watchpoints)) &&
+        (uc_watchpoint_flags(cpu, begin, TARGET_PAGE_SIZE) &
+         (is_write ? BP_MEM_WRITE : BP_MEM_READ))) {
+        return TLB_HOOKED;
+    }
+    return 0;
+}
+
+/* Unicorn: drop all TLB entries, so that TLB_HOOKED follows hook changes */
+void uc_tlb_flush(struct uc_struct *uc)
+{
+    if (uc->cpu) {
+        tlb_flush(uc->cpu);
+    }
+}
+
 /* Add a new TLB entry. At most one entry for a given virtual address
    is permitted. Only a single TARGET_PAGE_SIZE region is mapped, the
    supplied size is only used by tlb_flush_page.  */
@@ -191,10 +246,12 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
     target_ulong code_address;
     uintptr_t addend;
     CPUTLBEntry *te;
+
     hwaddr iotlb, xlat, sz;
     unsigned vidx = env->vtlb_index++ % CPU_VTLB_SIZE;
     int asidx = cpu_asidx_from_attrs(cpu, attrs);
 
+    cpu->uc->stats.tlb_fills++;
     assert(size >= TARGET_PAGE_SIZE);
     if (size != TARGET_PAGE_SIZE) {
         tlb_add_large_page(env, vaddr, size);
@@ -234,7 +291,7 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
     env->iotlb[mmu_idx][index].attrs = attrs;
     te->addend = (uintptr_t)(addend - vaddr);
     if (prot & PAGE_READ) {
-        te->addr_read = address;
+        te->addr_read = address | tlb_hooked_flag(cpu, vaddr, false);
     } else {
         te->addr_read = -1;
     }
@@ -245,14 +302,21 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
         te->addr_code = -1;
     }
     if (prot & PAGE_WRITE) {
-        if ((memory_region_is_ram(section->mr) && section->readonly)
+        /* Unicorn: uc_mem_protect() can make single pages read-only */
+        if ((memory_region_is_ram(section->mr) &&
+             (section->readonly ||
+              !(memory_page_perms(cpu->uc, section->mr, section->mr->addr + xlat) &
+                UC_PROT_WRITE)))
             || memory_region_is_romd(section->mr)) {
             /* Write access calls the I/O callback.  */
             te->addr_write = address | TLB_MMIO;
-        } else if (memory_region_is_ram(section->mr)) {
-            te->addr_write = address | TLB_NOTDIRTY;
+        } else if (memory_region_is_ram(section->mr)
+                   && cpu_physical_memory_is_clean(cpu->uc,
+                        memory_region_get_ram_addr(section->mr) + xlat)) {
+            te->addr_write = address | TLB_NOTDIRTY |
+                             tlb_hooked_flag(cpu, vaddr, true);
         } else {
-            te->addr_write = address;
+            te->addr_write = address | tlb_hooked_flag(cpu, vaddr, true);
         }
     } else {
         te->addr_write = -1;
@@ -347,8 +411,10 @@ tb_page_addr_t get_page_addr_code(CPUArchState *env, target_ulong addr)
 
 static void tlb_set_dirty1(CPUTLBEntry *tlb_entry, target_ulong vaddr)
 {
-    if (tlb_entry->addr_write == (vaddr | TLB_NOTDIRTY)) {
-        tlb_entry->addr_write = vaddr;
+    /* Unicorn: a hooked page stays on the slow path, but not through
+       notdirty_mem_write() */
+    if ((tlb_entry->addr_write & ~TLB_HOOKED) == (vaddr | TLB_NOTDIRTY)) {
+        tlb_entry->addr_write &= ~TLB_NOTDIRTY;
     }
 }
 
@@ -387,6 +453,7 @@ static inline void v_tlb_flush_by_mmuidx(CPUState *cpu, uint16_t idxmap)
     int mmu_idx;
 
     tlb_debug("start\n");
+    cpu->uc->stats.tlb_flushes++;
 
     for (mmu_idx = 0; mmu_idx < NB_MMU_MODES; mmu_idx++) {
         if (test_bit(mmu_idx, &mmu_idx_bitmask)) {
@@ -596,9 +663,24 @@ static void *atomic_mmu_lookup(CPUArchState *env, target_ulong addr,
 
     /* Check notdirty */
     if (unlikely(tlb_addr & TLB_NOTDIRTY)) {
-        tlb_set_dirty(ENV_GET_CPU(env), addr);
+        /* Unicorn: as notdirty_mem_write(), which keeps cached translations
+           and snapshots up to date. */
+        struct uc_struct *uc = env->uc;
+        ram_addr_t ram_addr = qemu_ram_addr_from_host_nofail(uc,
+                                (void *)((uintptr_t)addr + tlbe->addend));
+
+        if (!cpu_physical_memory_get_dirty_flag(uc, ram_addr, DIRTY_MEMORY_CODE)) {
+            tb_invalidate_phys_page_range(uc, ram_addr, ram_addr + (1 << s_bits), 0);
+        }
+        cpu_physical_memory_set_dirty_range(uc, ram_addr, 1 << s_bits,
+                                            DIRTY_CLIENTS_NOCODE);
+        if (!cpu_physical_memory_is_clean(uc, ram_addr)) {
+            tlb_set_dirty(ENV_GET_CPU(env), addr);
+        }
         tlb_addr = tlb_addr & ~TLB_NOTDIRTY;
     }
+    /* Unicorn: memory hooks are not called for atomic operations */
+    tlb_addr = tlb_addr & ~TLB_HOOKED;
 
     /* Notice an IO access  */
     if (unlikely(tlb_addr & ~TARGET_PAGE_MASK)) {
@@ -608,7 +690,7 @@ static void *atomic_mmu_lookup(CPUArchState *env, target_ulong addr,
     }
 
     /* Let the guest notice RMW on a write-only page.  */
-    if (unlikely(tlbe->addr_read != tlb_addr)) {
+    if (unlikely((tlbe->addr_read & ~TLB_HOOKED) != tlb_addr)) {
         tlb_fill(ENV_GET_CPU(env), addr, 1 << s_bits, MMU_DATA_LOAD,
                  mmu_idx, retaddr);
         /* Since we don't support reads and writes to different addresses,
@@ -631,6 +713,78 @@ static void *atomic_mmu_lookup(CPUArchState *env, target_ulong addr,
 # define TGT_LE(X)  (X)
 #endif
 
+/* Unicorn: guest PC of the instruction at host return address @retaddr,
+   cached as looking it up in the TB is slow.  */
+static bool uc_retaddr_pc(CPUArchState *env, uintptr_t retaddr,
+                          target_ulong *pc)
+{
+    struct uc_struct *uc = env->uc;
+    struct uc_mem_trace_pc *cached;
+    int flush_count = atomic_read(&uc->tb_ctx.tb_flush_count);
+
+    if (uc->mem_trace_pcs == NULL) {
+        uc->mem_trace_pcs = g_new0(struct uc_mem_trace_pc, UC_MEM_TRACE_PCS);
+    }
+
+    cached = &uc->mem_trace_pcs[(retaddr >> 2) & (UC_MEM_TRACE_PCS - 1)];
+    if (retaddr != 0 && cached->retaddr == retaddr &&
+        cached->tb_flush_count == flush_count) {
+        *pc = cached->pc;
+        return true;
+    }
+    if (uc_tb_insn_pc(ENV_GET_CPU(env), retaddr, pc)) {
+        cached->retaddr = retaddr;
+        cached->pc = *pc;
+        cached->tb_flush_count = flush_count;
+        return true;
+    }
+    return false;
+}
+
+/* Unicorn: append an access to the buffer of uc_mem_trace_enable(),
+   flushing it first if it is full.  */
+static void uc_mem_trace_record(CPUArchState *env, uc_mem_type type,
+                                target_ulong addr, int size, uint64_t value,
+                                uintptr_t retaddr)
+{
+    struct uc_struct *uc = env->uc;
+    uc_mem_access *rec;
+    target_ulong pc, cs_base;
+    uint32_t flags;
+
+    if (uc->mem_trace_count == uc->mem_trace_size) {
+        uc_mem_trace_flush(uc);
+        if (uc->mem_trace == NULL) {
+            /* disabled by the callback */
+            return;
+        }
+    }
+
+    if (!uc_retaddr_pc(env, retaddr, &pc)) {
+        /* called without a return address: the PC of the block */
+        cpu_get_tb_cpu_state(env, &pc, &cs_base, &flags);
+    }
+
+    rec = &uc->mem_trace[uc->mem_trace_count++];
+    rec->pc = pc;
+    rec->address = addr;
+    rec->value = value;
+    rec->size = size;
+    rec->type = type;
+}
+
+/* Unicorn: the translated code does not keep the guest PC up to date,
+   sync it before calling memory hooks like helper_uc_tracecode() does.  */
+static void uc_mem_hook_sync_pc(CPUArchState *env, uintptr_t retaddr)
+{
+    struct uc_struct *uc = env->uc;
+    target_ulong pc;
+
+    if (uc->set_pc && uc_retaddr_pc(env, retaddr, &pc)) {
+        uc->set_pc(uc, pc);
+    }
+}
+
 #define MMUSUFFIX _mmu
 
 #define DATA_SIZE 1
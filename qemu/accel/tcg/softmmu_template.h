@@ -119,7 +119,7 @@ WORD_TYPE helper_le_ld_name(CPUArchState *env, target_ulong addr,
     int error_code;
     struct hook *hook;
     bool handled;
-    HOOK_FOREACH_VAR_DECLARE;
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
 
     struct uc_struct *uc = env->uc;
     MemoryRegion *mr = memory_mapping(uc, addr);
@@ -127,19 +127,16 @@ WORD_TYPE helper_le_ld_name(CPUArchState *env, target_ulong addr,
     // memory might be still unmapped while reading or fetching
     if (mr == NULL) {
         handled = false;
+        uc_mem_hook_sync_pc(env, retaddr);
 #if defined(SOFTMMU_CODE_ACCESS)
         error_code = UC_ERR_FETCH_UNMAPPED;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_FETCH_UNMAPPED) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_FETCH_UNMAPPED, addr) {
             if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_FETCH_UNMAPPED, addr, DATA_SIZE, 0, hook->user_data)))
                 break;
         }
 #else
         error_code = UC_ERR_READ_UNMAPPED;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ_UNMAPPED) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_READ_UNMAPPED, addr) {
             if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_READ_UNMAPPED, addr, DATA_SIZE, 0, hook->user_data)))
                 break;
         }
@@ -158,11 +155,10 @@ WORD_TYPE helper_le_ld_name(CPUArchState *env, target_ulong addr,
 
 #if defined(SOFTMMU_CODE_ACCESS)
     // Unicorn: callback on fetch from NX
-    if (mr != NULL && !(mr->perms & UC_PROT_EXEC)) {  // non-executable
+    if (mr != NULL && !(memory_page_perms(uc, mr, addr) & UC_PROT_EXEC)) {  // non-executable
         handled = false;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_FETCH_PROT) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        uc_mem_hook_sync_pc(env, retaddr);
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_FETCH_PROT, addr) {
             if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_FETCH_PROT, addr, DATA_SIZE, 0, hook->user_data)))
                 break;
         }
@@ -184,20 +180,24 @@ WORD_TYPE helper_le_ld_name(CPUArchState *env, target_ulong addr,
     // the callback if read access is succesful, or not.
     // See UC_HOOK_MEM_READ_AFTER & UC_MEM_READ_AFTER if you only care
     // about successful read
-    if (READ_ACCESS_TYPE == MMU_DATA_LOAD) {
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+    if (READ_ACCESS_TYPE == MMU_DATA_LOAD && HOOK_EXISTS_BOUNDED(uc, UC_HOOK_MEM_READ, addr)) {
+        uc_mem_hook_sync_pc(env, retaddr);
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_READ, addr) {
             ((uc_cb_hookmem_t)hook->callback)(env->uc, UC_MEM_READ, addr, DATA_SIZE, 0, hook->user_data);
         }
     }
 
+    // Unicorn: callback of a uc_watchpoint_add() watchpoint
+    if (READ_ACCESS_TYPE == MMU_DATA_LOAD &&
+        unlikely(!QTAILQ_EMPTY(&ENV_GET_CPU(env)->watchpoints))) {
+        uc_watchpoint_check(ENV_GET_CPU(env), addr, DATA_SIZE, BP_MEM_READ, 0);
+    }
+
     // Unicorn: callback on non-readable memory
-    if (READ_ACCESS_TYPE == MMU_DATA_LOAD && mr != NULL && !(mr->perms & UC_PROT_READ)) {  //non-readable
+    if (READ_ACCESS_TYPE == MMU_DATA_LOAD && mr != NULL && !(memory_page_perms(uc, mr, addr) & UC_PROT_READ)) {  //non-readable
         handled = false;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ_PROT) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        uc_mem_hook_sync_pc(env, retaddr);
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_READ_PROT, addr) {
             if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_READ_PROT, addr, DATA_SIZE, 0, hook->user_data)))
                 break;
         }
@@ -229,7 +229,7 @@ WORD_TYPE helper_le_ld_name(CPUArchState *env, target_ulong addr,
     }
 
     /* Handle an IO access.  */
-    if (unlikely(tlb_addr & ~TARGET_PAGE_MASK)) {
+    if (unlikely(tlb_addr & ~(TARGET_PAGE_MASK | TLB_HOOKED))) {
         CPUIOTLBEntry *iotlbentry;
         if ((addr & (DATA_SIZE - 1)) != 0) {
             goto do_unaligned_access;
@@ -262,8 +262,10 @@ WORD_TYPE helper_le_ld_name(CPUArchState *env, target_ulong addr,
     do_unaligned_access:
         addr1 = addr & ~(DATA_SIZE - 1);
         addr2 = addr1 + DATA_SIZE;
+        uc->mem_trace_split++;
         res1 = helper_le_ld_name(env, addr1, oi, retaddr);
         res2 = helper_le_ld_name(env, addr2, oi, retaddr);
+        uc->mem_trace_split--;
         shift = (addr & (DATA_SIZE - 1)) * 8;
 
         /* Little-endian combine.  */
@@ -281,13 +283,16 @@ WORD_TYPE helper_le_ld_name(CPUArchState *env, target_ulong addr,
 _out:
     // Unicorn: callback on successful read
     if (READ_ACCESS_TYPE == MMU_DATA_LOAD) {
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ_AFTER) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_READ_AFTER, addr) {
             ((uc_cb_hookmem_t)hook->callback)(env->uc, UC_MEM_READ_AFTER, addr, DATA_SIZE, res, hook->user_data);
         }
     }
 
+    // Unicorn: record of uc_mem_trace_enable()
+    if (READ_ACCESS_TYPE == MMU_DATA_LOAD && uc->mem_trace != NULL && !uc->mem_trace_split) {
+        uc_mem_trace_record(env, UC_MEM_READ, addr, DATA_SIZE, res, retaddr);
+    }
+
     return res;
 }
 
@@ -304,7 +309,7 @@ WORD_TYPE helper_be_ld_name(CPUArchState *env, target_ulong addr,
     int error_code;
     struct hook *hook;
     bool handled;
-    HOOK_FOREACH_VAR_DECLARE;
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
 
     struct uc_struct *uc = env->uc;
     MemoryRegion *mr = memory_mapping(uc, addr);
@@ -312,19 +317,16 @@ WORD_TYPE helper_be_ld_name(CPUArchState *env, target_ulong addr,
     // memory can be unmapped while reading or fetching
     if (mr == NULL) {
         handled = false;
+        uc_mem_hook_sync_pc(env, retaddr);
 #if defined(SOFTMMU_CODE_ACCESS)
         error_code = UC_ERR_FETCH_UNMAPPED;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_FETCH_UNMAPPED) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_FETCH_UNMAPPED, addr) {
             if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_FETCH_UNMAPPED, addr, DATA_SIZE, 0, hook->user_data)))
                 break;
         }
 #else
         error_code = UC_ERR_READ_UNMAPPED;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ_UNMAPPED) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_READ_UNMAPPED, addr) {
             if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_READ_UNMAPPED, addr, DATA_SIZE, 0, hook->user_data)))
                 break;
         }
@@ -343,11 +345,10 @@ WORD_TYPE helper_be_ld_name(CPUArchState *env, target_ulong addr,
 
 #if defined(SOFTMMU_CODE_ACCESS)
     // Unicorn: callback on fetch from NX
-    if (mr != NULL && !(mr->perms & UC_PROT_EXEC)) {  // non-executable
+    if (mr != NULL && !(memory_page_perms(uc, mr, addr) & UC_PROT_EXEC)) {  // non-executable
         handled = false;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_FETCH_PROT) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        uc_mem_hook_sync_pc(env, retaddr);
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_FETCH_PROT, addr) {
             if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_FETCH_PROT, addr, DATA_SIZE, 0, hook->user_data)))
                 break;
         }
@@ -369,20 +370,24 @@ WORD_TYPE helper_be_ld_name(CPUArchState *env, target_ulong addr,
     // the callback if read access is succesful, or not.
     // See UC_HOOK_MEM_READ_AFTER & UC_MEM_READ_AFTER if you only care
     // about successful read
-    if (READ_ACCESS_TYPE == MMU_DATA_LOAD) {
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+    if (READ_ACCESS_TYPE == MMU_DATA_LOAD && HOOK_EXISTS_BOUNDED(uc, UC_HOOK_MEM_READ, addr)) {
+        uc_mem_hook_sync_pc(env, retaddr);
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_READ, addr) {
             ((uc_cb_hookmem_t)hook->callback)(env->uc, UC_MEM_READ, addr, DATA_SIZE, 0, hook->user_data);
         }
     }
 
+    // Unicorn: callback of a uc_watchpoint_add() watchpoint
+    if (READ_ACCESS_TYPE == MMU_DATA_LOAD &&
+        unlikely(!QTAILQ_EMPTY(&ENV_GET_CPU(env)->watchpoints))) {
+        uc_watchpoint_check(ENV_GET_CPU(env), addr, DATA_SIZE, BP_MEM_READ, 0);
+    }
+
     // Unicorn: callback on non-readable memory
-    if (READ_ACCESS_TYPE == MMU_DATA_LOAD && mr != NULL && !(mr->perms & UC_PROT_READ)) {  //non-readable
+    if (READ_ACCESS_TYPE == MMU_DATA_LOAD && mr != NULL && !(memory_page_perms(uc, mr, addr) & UC_PROT_READ)) {  //non-readable
         handled = false;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ_PROT) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        uc_mem_hook_sync_pc(env, retaddr);
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_READ_PROT, addr) {
             if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_READ_PROT, addr, DATA_SIZE, 0, hook->user_data)))
                 break;
         }
@@ -414,7 +419,7 @@ WORD_TYPE helper_be_ld_name(CPUArchState *env, target_ulong addr,
     }
 
     /* Handle an IO access.  */
-    if (unlikely(tlb_addr & ~TARGET_PAGE_MASK)) {
+    if (unlikely(tlb_addr & ~(TARGET_PAGE_MASK | TLB_HOOKED))) {
         CPUIOTLBEntry *iotlbentry;
         if ((addr & (DATA_SIZE - 1)) != 0) {
             goto do_unaligned_access;
@@ -446,8 +451,10 @@ WORD_TYPE helper_be_ld_name(CPUArchState *env, target_ulong addr,
     do_unaligned_access:
         addr1 = addr & ~(DATA_SIZE - 1);
         addr2 = addr1 + DATA_SIZE;
+        uc->mem_trace_split++;
         res1 = helper_be_ld_name(env, addr1, oi, retaddr);
         res2 = helper_be_ld_name(env, addr2, oi, retaddr);
+        uc->mem_trace_split--;
         shift = (addr & (DATA_SIZE - 1)) * 8;
 
         /* Big-endian combine.  */
@@ -461,13 +468,16 @@ WORD_TYPE helper_be_ld_name(CPUArchState *env, target_ulong addr,
 _out:
     // Unicorn: callback on successful read
     if (READ_ACCESS_TYPE == MMU_DATA_LOAD) {
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ_AFTER) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_READ_AFTER, addr) {
             ((uc_cb_hookmem_t)hook->callback)(env->uc, UC_MEM_READ_AFTER, addr, DATA_SIZE, res, hook->user_data);
         }
     }
 
+    // Unicorn: record of uc_mem_trace_enable()
+    if (READ_ACCESS_TYPE == MMU_DATA_LOAD && uc->mem_trace != NULL && !uc->mem_trace_split) {
+        uc_mem_trace_record(env, UC_MEM_READ, addr, DATA_SIZE, res, retaddr);
+    }
+
     return res;
 }
 #endif /* DATA_SIZE > 1 */
@@ -512,24 +522,29 @@ void helper_le_st_name(CPUArchState *env, target_ulong addr, DATA_TYPE val,
     uintptr_t haddr;
     struct hook *hook;
     bool handled;
-    HOOK_FOREACH_VAR_DECLARE;
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
 
     struct uc_struct *uc = env->uc;
     MemoryRegion *mr = memory_mapping(uc, addr);
 
     // Unicorn: callback on memory write
-    HOOK_FOREACH(uc, hook, UC_HOOK_MEM_WRITE) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
-        ((uc_cb_hookmem_t)hook->callback)(uc, UC_MEM_WRITE, addr, DATA_SIZE, val, hook->user_data);
+    if (HOOK_EXISTS_BOUNDED(uc, UC_HOOK_MEM_WRITE, addr)) {
+        uc_mem_hook_sync_pc(env, retaddr);
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_WRITE, addr) {
+            ((uc_cb_hookmem_t)hook->callback)(uc, UC_MEM_WRITE, addr, DATA_SIZE, val, hook->user_data);
+        }
+    }
+
+    // Unicorn: callback of a uc_watchpoint_add() watchpoint
+    if (unlikely(!QTAILQ_EMPTY(&ENV_GET_CPU(env)->watchpoints))) {
+        uc_watchpoint_check(ENV_GET_CPU(env), addr, DATA_SIZE, BP_MEM_WRITE, val);
     }
 
     // Unicorn: callback on invalid memory
     if (mr == NULL) {
         handled = false;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_WRITE_UNMAPPED) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        uc_mem_hook_sync_pc(env, retaddr);
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_WRITE_UNMAPPED, addr) {
             if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_WRITE_UNMAPPED, addr, DATA_SIZE, val, hook->user_data)))
                 break;
         }
@@ -548,11 +563,10 @@ void helper_le_st_name(CPUArchState *env, target_ulong addr, DATA_TYPE val,
     }
 
     // Unicorn: callback on non-writable memory
-    if (mr != NULL && !(mr->perms & UC_PROT_WRITE)) {  //non-writable
+    if (mr != NULL && !(memory_page_perms(uc, mr, addr) & UC_PROT_WRITE)) {  //non-writable
         handled = false;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_WRITE_PROT) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        uc_mem_hook_sync_pc(env, retaddr);
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_WRITE_PROT, addr) {
             if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_WRITE_PROT, addr, DATA_SIZE, val, hook->user_data)))
                 break;
         }
@@ -573,6 +587,11 @@ void helper_le_st_name(CPUArchState *env, target_ulong addr, DATA_TYPE val,
                              mmu_idx, retaddr);
     }
 
+    // Unicorn: record of uc_mem_trace_enable()
+    if (uc->mem_trace != NULL && !uc->mem_trace_split) {
+        uc_mem_trace_record(env, UC_MEM_WRITE, addr, DATA_SIZE, val, retaddr);
+    }
+
     /* If the TLB entry is for a different page, reload and try again.  */
     if ((addr & TARGET_PAGE_MASK)
         != (tlb_addr & (TARGET_PAGE_MASK | TLB_INVALID_MASK))) {
@@ -584,7 +603,7 @@ void helper_le_st_name(CPUArchState *env, target_ulong addr, DATA_TYPE val,
     }
 
     /* Handle an IO access.  */
-    if (unlikely(tlb_addr & ~TARGET_PAGE_MASK)) {
+    if (unlikely(tlb_addr & ~(TARGET_PAGE_MASK | TLB_HOOKED))) {
         CPUIOTLBEntry *iotlbentry;
         if ((addr & (DATA_SIZE - 1)) != 0) {
             goto do_unaligned_access;
@@ -627,6 +646,7 @@ void helper_le_st_name(CPUArchState *env, target_ulong addr, DATA_TYPE val,
         /* XXX: not efficient, but simple.  */
         /* This loop must go in the forward direction to avoid issues
            with self-modifying code in Windows 64-bit.  */
+        uc->mem_trace_split++;
         for (i = 0; i < DATA_SIZE; ++i) {
             /* Little-endian extract.  */
             uint8_t val8 = (uint8_t)(val >> (i * 8));
@@ -635,6 +655,7 @@ void helper_le_st_name(CPUArchState *env, target_ulong addr, DATA_TYPE val,
             if (env->invalid_error != UC_ERR_OK)
                 break;
         }
+        uc->mem_trace_split--;
         return;
     }
 
@@ -657,24 +678,29 @@ void helper_be_st_name(CPUArchState *env, target_ulong addr, DATA_TYPE val,
     uintptr_t haddr;
     struct hook *hook;
     bool handled;
-    HOOK_FOREACH_VAR_DECLARE;
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
 
     struct uc_struct *uc = env->uc;
     MemoryRegion *mr = memory_mapping(uc, addr);
 
     // Unicorn: callback on memory write
-    HOOK_FOREACH(uc, hook, UC_HOOK_MEM_WRITE) {
-        if (!HOOK_BOUND_CHECK(hook, addr))
-            continue;
-        ((uc_cb_hookmem_t)hook->callback)(uc, UC_MEM_WRITE, addr, DATA_SIZE, val, hook->user_data);
+    if (HOOK_EXISTS_BOUNDED(uc, UC_HOOK_MEM_WRITE, addr)) {
+        uc_mem_hook_sync_pc(env, retaddr);
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_WRITE, addr) {
+            ((uc_cb_hookmem_t)hook->callback)(uc, UC_MEM_WRITE, addr, DATA_SIZE, val, hook->user_data);
+        }
+    }
+
+    // Unicorn: callback of a uc_watchpoint_add() watchpoint
+    if (unlikely(!QTAILQ_EMPTY(&ENV_GET_CPU(env)->watchpoints))) {
+        uc_watchpoint_check(ENV_GET_CPU(env), addr, DATA_SIZE, BP_MEM_WRITE, val);
     }
 
     // Unicorn: callback on invalid memory
     if (mr == NULL) {
         handled = false;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_WRITE_UNMAPPED) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        uc_mem_hook_sync_pc(env, retaddr);
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_WRITE_UNMAPPED, addr) {
             if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_WRITE_UNMAPPED, addr, DATA_SIZE, val, hook->user_data)))
                 break;
         }
@@ -693,11 +719,10 @@ void helper_be_st_name(CPUArchState *env, target_ulong addr, DATA_TYPE val,
     }
 
     // Unicorn: callback on non-writable memory
-    if (mr != NULL && !(mr->perms & UC_PROT_WRITE)) {  //non-writable
+    if (mr != NULL && !(memory_page_perms(uc, mr, addr) & UC_PROT_WRITE)) {  //non-writable
         handled = false;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_WRITE_PROT) {
-            if (!HOOK_BOUND_CHECK(hook, addr))
-                continue;
+        uc_mem_hook_sync_pc(env, retaddr);
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_WRITE_PROT, addr) {
             if ((handled = ((uc_cb_eventmem_t)hook->callback)(uc, UC_MEM_WRITE_PROT, addr, DATA_SIZE, val, hook->user_data)))
                 break;
         }
@@ -718,6 +743,11 @@ void helper_be_st_name(CPUArchState *env, target_ulong addr, DATA_TYPE val,
                              mmu_idx, retaddr);
     }
 
+    // Unicorn: record of uc_mem_trace_enable()
+    if (uc->mem_trace != NULL && !uc->mem_trace_split) {
+        uc_mem_trace_record(env, UC_MEM_WRITE, addr, DATA_SIZE, val, retaddr);
+    }
+
     /* If the TLB entry is for a different page, reload and try again.  */
     if ((addr & TARGET_PAGE_MASK)
         != (tlb_addr & (TARGET_PAGE_MASK | TLB_INVALID_MASK))) {
@@ -729,7 +759,7 @@ void helper_be_st_name(CPUArchState *env, target_ulong addr, DATA_TYPE val,
     }
 
     /* Handle an IO access.  */
-    if (unlikely(tlb_addr & ~TARGET_PAGE_MASK)) {
+    if (unlikely(tlb_addr & ~(TARGET_PAGE_MASK | TLB_HOOKED))) {
         CPUIOTLBEntry *iotlbentry;
         if ((addr & (DATA_SIZE - 1)) != 0) {
             goto do_unaligned_access;
@@ -772,6 +802,7 @@ void helper_be_st_name(CPUArchState *env, target_ulong addr, DATA_TYPE val,
         /* XXX: not efficient, but simple */
         /* This loop must go in the forward direction to avoid issues
            with self-modifying code.  */
+        uc->mem_trace_split++;
         for (i = 0; i < DATA_SIZE; ++i) {
             /* Big-endian extract.  */
             uint8_t val8 = (uint8_t)(val >> (((DATA_SIZE - 1) * 8) - (i * 8)));
@@ -780,6 +811,7 @@ void helper_be_st_name(CPUArchState *env, target_ulong addr, DATA_TYPE val,
             if (env->invalid_error != UC_ERR_OK)
                 break;
         }
+        uc->mem_trace_split--;
         return;
     }
 
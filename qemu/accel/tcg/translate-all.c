@@ -190,6 +190,8 @@ void tb_cleanup(struct uc_struct *uc)
     void** lp = uc->l1_map + ((index >> uc->v_l1_shift) & (uc->v_l1_size - 1));
     /* Level 2..N-1.  */
     tb_clean_internal(uc, uc->v_l1_shift / V_L2_BITS, lp);
+
+    list_clear(&uc->truncated_tbs);
 }
 
 /* Encode VAL as a signed leb128 sequence at P.
@@ -280,17 +282,14 @@ static int encode_search(TCGContext *tcg_ctx, TranslationBlock *tb, uint8_t *blo
 /* The cpu state corresponding to 'searched_pc' is restored.
  * Called with tb_lock held.
  */
-static int cpu_restore_state_from_tb(CPUState *cpu, TranslationBlock *tb,
-                                     uintptr_t searched_pc)
+/* Reconstruct in @data the stored insn data of the instruction at host
+   address @searched_pc, and return its index in @tb, or -1.  */
+static int tb_insn_data(TranslationBlock *tb, uintptr_t searched_pc,
+                        target_ulong *data)
 {
-    target_ulong data[TARGET_INSN_START_WORDS] = { tb->pc };
     uintptr_t host_pc = (uintptr_t)tb->tc.ptr;
-    CPUArchState *env = cpu->env_ptr;
     uint8_t *p = tb->tc.ptr + tb->tc.size;
     int i, j, num_insns = tb->icount;
-#ifdef CONFIG_PROFILER
-    int64_t ti = profile_getclock();
-#endif
 
     searched_pc -= GETPC_ADJ;
 
@@ -298,6 +297,11 @@ static int cpu_restore_state_from_tb(CPUState *cpu, TranslationBlock *tb,
         return -1;
     }
 
+    data[0] = tb->pc;
+    for (j = 1; j < TARGET_INSN_START_WORDS; ++j) {
+        data[j] = 0;
+    }
+
     /* Reconstruct the stored insn data while looking for the point at
        which the end of the insn exceeds the searched_pc.  */
     for (i = 0; i < num_insns; ++i) {
@@ -306,22 +310,32 @@ static int cpu_restore_state_from_tb(CPUState *cpu, TranslationBlock *tb,
         }
         host_pc += decode_sleb128(&p);
         if (host_pc > searched_pc) {
-            goto found;
+            return i;
         }
     }
     return -1;
+}
 
-found:
-    // UNICORN: Commented out
-    //if (tb->cflags & CF_USE_ICOUNT) {
-    //    assert(use_icount);
-    //    /* Reset the cycle counter to the start of the block.  */
-    //    cpu->icount_decr.u16.low += num_insns;
-    //    /* Clear the IO flag.  */
-    //    cpu->can_do_io = 0;
-    //}
-
-    cpu->icount_decr.u16.low -= i;
+static int cpu_restore_state_from_tb(CPUState *cpu, TranslationBlock *tb,
+                                     uintptr_t searched_pc)
+{
+    target_ulong data[TARGET_INSN_START_WORDS];
+    CPUArchState *env = cpu->env_ptr;
+    int i, num_insns = tb->icount;
+#ifdef CONFIG_PROFILER
+    int64_t ti = profile_getclock();
+#endif
+
+    i = tb_insn_data(tb, searched_pc, data);
+    if (i < 0) {
+        return -1;
+    }
+
+    if (tb_cflags(tb) & CF_USE_ICOUNT) {
+        /* Reset the cycle counter to the start of the block
+           and shift if to the number of actually executed instructions */
+        cpu->icount_decr.u16.low += num_insns - i;
+    }
     restore_state_to_opc(env, tb, data);
 
 #ifdef CONFIG_PROFILER
@@ -331,6 +345,26 @@ found:
     return 0;
 }
 
+/* Unicorn: the guest PC of the instruction at host address @retaddr,
+   like cpu_restore_state() but without touching the CPU state.  */
+bool uc_tb_insn_pc(CPUState *cpu, uintptr_t retaddr, target_ulong *pc)
+{
+    target_ulong data[TARGET_INSN_START_WORDS];
+    TranslationBlock *tb;
+
+    if (!retaddr) {
+        return false;
+    }
+
+    tb = tb_find_pc(cpu->uc, retaddr);
+    if (!tb || tb_insn_data(tb, retaddr, data) < 0) {
+        return false;
+    }
+
+    *pc = data[0];
+    return true;
+}
+
 bool cpu_restore_state(CPUState *cpu, uintptr_t retaddr)
 {
     TranslationBlock *tb;
@@ -762,6 +796,15 @@ static int ptr_cmp_tb_tc(const void *ptr, const struct tb_tc *s)
     return 0;
 }
 
+/* Unicorn: a TB leaving the tree (flushed or removed) drops its hook vectors */
+static void tb_tree_value_destroy(gpointer value)
+{
+    TranslationBlock *tb = value;
+
+    hook_vectors_release(tb->hook_vectors);
+    tb->hook_vectors = NULL;
+}
+
 static gint tb_tc_cmp(gconstpointer ap, gconstpointer bp)
 {
     const struct tb_tc *a = ap;
@@ -808,7 +851,8 @@ static inline void code_gen_alloc(struct uc_struct *uc, size_t tb_size)
        still haven't deducted the prologue from the buffer size here,
        but that's minimal and won't affect the estimate much.  */
     /* size this conservatively -- realloc later if needed */
-    uc->tb_ctx.tb_tree = g_tree_new(tb_tc_cmp);
+    uc->tb_ctx.tb_tree = g_tree_new_full((GCompareDataFunc)tb_tc_cmp, NULL, NULL,
+                                         tb_tree_value_destroy);
 }
 
 static void tb_htable_init(struct uc_struct *uc)
@@ -962,11 +1006,94 @@ void tb_flush(CPUState *cpu)
     page_flush_tb(uc);
 
     tcg_region_reset_all(uc);
+    list_clear(&uc->truncated_tbs);
     /* XXX: flush processor icache at this point if cache flush is
        expensive */
     atomic_mb_set(&uc->tb_ctx.tb_flush_count, uc->tb_ctx.tb_flush_count + 1);
 }
 
+/* Unicorn: the uc_query() statistics kept by TCG itself */
+uc_err tb_stats_query(struct uc_struct *uc, uc_query_type type, size_t *result)
+{
+    struct qht_stats hst;
+
+    switch (type) {
+    case UC_QUERY_TB_FLUSHES:
+        *result = atomic_read(&uc->tb_ctx.tb_flush_count);
+        break;
+    case UC_QUERY_TB_INVALIDATED:
+        *result = uc->tb_ctx.tb_phys_invalidate_count;
+        break;
+    case UC_QUERY_CODE_GEN_USED:
+        *result = tcg_code_size(uc);
+        break;
+    case UC_QUERY_CODE_GEN_SIZE:
+        *result = tcg_code_capacity(uc);
+        break;
+    case UC_QUERY_TB_HASH_ENTRIES:
+    case UC_QUERY_TB_HASH_BUCKETS:
+    case UC_QUERY_TB_HASH_USED:
+        qht_statistics_init(&uc->tb_ctx.htable, &hst);
+        if (type == UC_QUERY_TB_HASH_ENTRIES) {
+            *result = hst.entries;
+        } else if (type == UC_QUERY_TB_HASH_BUCKETS) {
+            *result = hst.head_buckets;
+        } else {
+            *result = hst.used_head_buckets;
+        }
+        qht_statistics_destroy(&hst);
+        break;
+    default:
+        return UC_ERR_ARG;
+    }
+
+    return UC_ERR_OK;
+}
+
+struct tb_profile_top {
+    uc_tb_profile *blocks;
+    size_t size, count;
+};
+
+static gboolean tb_profile_iter(gpointer key, gpointer value, gpointer data)
+{
+    const TranslationBlock *tb = value;
+    struct tb_profile_top *top = data;
+    size_t i;
+
+    if (tb->exec_count == 0 || (tb->cflags & CF_INVALID)) {
+        return false;
+    }
+    if (top->count == top->size) {
+        if (top->size == 0 || tb->exec_count <= top->blocks[top->size - 1].count) {
+            return false;
+        }
+        // drop the coldest block
+        top->count--;
+    }
+
+    // keep the blocks sorted, hottest first
+    for (i = top->count; i > 0 && top->blocks[i - 1].count < tb->exec_count; i--) {
+        top->blocks[i] = top->blocks[i - 1];
+    }
+    top->blocks[i].pc = tb->pc;
+    top->blocks[i].count = tb->exec_count;
+    top->blocks[i].size = tb->size;
+    top->blocks[i].host_size = tb->tc.size;
+    top->count++;
+
+    return false;
+}
+
+/* Unicorn: the @count translated blocks run most often, see uc_profile_top() */
+void tb_profile_top(struct uc_struct *uc, uc_tb_profile *blocks, size_t *count)
+{
+    struct tb_profile_top top = { blocks, *count, 0 };
+
+    g_tree_foreach(uc->tb_ctx.tb_tree, tb_profile_iter, &top);
+    *count = top.count;
+}
+
 /*
  * Formerly ifdef DEBUG_TB_CHECK. These debug functions are user-mode-only,
  * so in order to prevent bit rot we compile them unconditionally in user-mode,
@@ -1118,6 +1245,11 @@ void tb_phys_invalidate(struct uc_struct *uc,
         return;
     }
 
+    /* Unicorn: the TB may still be running, e.g. it called the hook
+     * deleting itself */
+    hook_vectors_release_later(tb->hook_vectors);
+    tb->hook_vectors = NULL;
+
     /* remove the TB from the page list */
     if (tb->page_addr[0] != page_addr) {
         p = page_find(uc, tb->page_addr[0] >> TARGET_PAGE_BITS);
@@ -1248,6 +1380,13 @@ static inline void tb_alloc_page(struct uc_struct *uc, TranslationBlock *tb,
             printf("protecting code page: 0x" TB_PAGE_ADDR_FMT "\n", page_addr);
         }
     }
+#else
+    /* if some code is already present, then the pages are already
+       protected. So we handle the case where only the first TB is
+       allocated in a physical page */
+    if (!page_already_protected) {
+        tlb_protect_code(uc, page_addr);
+    }
 #endif
 }
 
@@ -1291,13 +1430,18 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tb_page_addr_t phys_pc, phys_page2;
     tcg_insn_unit *gen_code_buf;
     int gen_code_size, search_size;
+    bool continued;
 #ifdef CONFIG_PROFILER
     int64_t ti;
 #endif
 
     phys_pc = get_page_addr_code(env, pc);
+    // Unicorn: was the previous translation broken by a full TCG buffer?
+    continued = env->uc->block_full;
 
  buffer_overflow:
+    // Unicorn: no TB runs while translating
+    hook_vectors_reset(env->uc);
     tb = tb_alloc(env->uc, pc);
     if (unlikely(!tb)) {
         /* flush must be done */
@@ -1313,6 +1457,8 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tb->flags = flags;
     tb->cflags = cflags;
     tb->trace_vcpu_dstate = 0;
+    tb->exec_count = 0;
+    tb->hook_vectors = NULL;
     tcg_ctx->tb_cflags = cflags;
 
 #ifdef CONFIG_PROFILER
@@ -1327,16 +1473,11 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     gen_intermediate_code(cpu, tb);
     tcg_ctx->cpu = NULL;
 
-    // Unicorn: FIXME: Needs to be amended to work with new TCG
-#if 0
     // Unicorn: when tracing block, patch block size operand for callback
-    if (env->uc->size_arg != -1 && HOOK_EXISTS_BOUNDED(env->uc, UC_HOOK_BLOCK, tb->pc)) {
-        if (env->uc->block_full)    // block size is unknown
-            *(tcg_ctx->gen_opparam_buf + env->uc->size_arg) = 0;
-        else
-            *(tcg_ctx->gen_opparam_buf + env->uc->size_arg) = tb->size;
+    if (tcg_ctx->block_size_op) {
+        // a block split by a full TCG buffer has no known size
+        tcg_set_insn_param(tcg_ctx->block_size_op, 1, env->uc->block_full ? 0 : tb->size);
     }
-#endif
 
     // UNICORN: Commented out
     //trace_translate_block(tb, tb->pc, tb->tc.ptr);
@@ -1413,8 +1554,20 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
      * memory barrier is required before tb_link_page() makes the TB visible
      * through the physical hash table and physical page list.
      */
+    tb->hook_vectors = hook_vectors_take(env->uc);
     tb_link_page(cpu->uc, tb, phys_pc, phys_page2);
     g_tree_insert(cpu->uc->tb_ctx.tb_tree, &tb->tc, tb);
+
+    // Unicorn: translations stay cached across uc_emu_start() calls, except
+    // for blocks that do not cover a whole basic block: those split by a full
+    // TCG buffer and those stopped at (or starting on) the "until" address.
+    // cpu_exec() invalidates them once the current run is over.
+    if (continued || env->uc->block_full ||
+            (pc <= env->uc->addr_end && env->uc->addr_end <= pc + tb->size)) {
+        list_append(&env->uc->truncated_tbs, tb);
+    }
+    env->uc->stats.tb_translated++;
+
     return tb;
 }
 
@@ -1548,6 +1701,7 @@ void tb_invalidate_phys_page_range(struct uc_struct *uc, tb_page_addr_t start, t
     /* if no code remaining, no need to continue to use slow writes */
     if (!p->first_tb) {
         invalidate_page_bitmap(p);
+        tlb_unprotect_code(uc, start);
     }
 #endif
 #ifdef TARGET_HAS_PRECISE_SMC
@@ -1579,6 +1733,8 @@ void tb_invalidate_phys_page_fast(struct uc_struct* uc, tb_page_addr_t start, in
 #endif
     p = page_find(uc, start >> TARGET_PAGE_BITS);
     if (!p) {
+        /* Unicorn: no code was ever translated from this page */
+        tlb_unprotect_code(uc, start);
         return;
     }
     if (!p->code_bitmap &&
@@ -1699,6 +1855,76 @@ void tb_invalidate_phys_addr(AddressSpace *as, hwaddr addr)
     ram_addr = memory_region_get_ram_addr(mr) + addr;
     tb_invalidate_phys_page_range(as->uc, ram_addr, ram_addr + 1, 0);
 }
+
+/* Unicorn: invalidate all TBs overlapping the guest range [start; start + len[,
+ * used when memory is changed behind the back of the CPU.
+ */
+void uc_invalidate_tb(struct uc_struct *uc, uint64_t start, size_t len)
+{
+    AddressSpace *as = uc->cpu->as;
+    ram_addr_t ram_addr;
+    MemoryRegion *mr;
+    hwaddr addr, l;
+
+    while (len > 0) {
+        l = MIN(len, TARGET_PAGE_SIZE - (start & ~TARGET_PAGE_MASK));
+        mr = address_space_translate(as, start, &addr, &l, false);
+        if (memory_region_is_ram(mr) || memory_region_is_romd(mr)) {
+            ram_addr = memory_region_get_ram_addr(mr) + addr;
+            tb_invalidate_phys_page_range(uc, ram_addr, ram_addr + l, 0);
+        }
+        start += l;
+        len -= l;
+    }
+}
+
+struct tb_pc_range {
+    uint64_t begin, end;
+    GSList *tbs;
+};
+
+static gboolean tb_pc_range_iter(gpointer key, gpointer value, gpointer data)
+{
+    TranslationBlock *tb = value;
+    struct tb_pc_range *range = data;
+
+    if (!(tb->cflags & CF_INVALID) &&
+        tb->pc <= range->end && tb->pc + tb->size > range->begin) {
+        range->tbs = g_slist_prepend(range->tbs, tb);
+    }
+    return false;
+}
+
+/* Unicorn: invalidate all TBs whose guest code overlaps the virtual range
+ * [begin; end], used when the hooks compiled into them change.
+ */
+void uc_invalidate_tb_pc(struct uc_struct *uc, uint64_t begin, uint64_t end)
+{
+    struct tb_pc_range range = { begin, end, NULL };
+    uint64_t first = begin & TARGET_PAGE_MASK, last = end & TARGET_PAGE_MASK;
+    uint64_t addr;
+    GSList *l;
+
+    /* a range of fewer pages than TBs, mapped 1:1 as usual: only visit the
+     * TBs of its pages, like uc_invalidate_tb() does */
+    if ((last - first) >> TARGET_PAGE_BITS < g_tree_nnodes(uc->tb_ctx.tb_tree)) {
+        for (addr = first; ; addr += TARGET_PAGE_SIZE) {
+            if (cpu_get_phys_page_debug(uc->cpu, addr) != addr) {
+                break;
+            }
+            if (addr == last) {
+                uc_invalidate_tb(uc, begin, end - begin + 1);
+                return;
+            }
+        }
+    }
+
+    g_tree_foreach(uc->tb_ctx.tb_tree, tb_pc_range_iter, &range);
+    for (l = range.tbs; l != NULL; l = l->next) {
+        tb_phys_invalidate(uc, l->data, -1);
+    }
+    g_slist_free(range.tbs);
+}
 #endif /* !defined(CONFIG_USER_ONLY) */
 
 /* Called with tb_lock held.  */
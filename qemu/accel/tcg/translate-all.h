@@ -26,6 +26,7 @@ void tb_invalidate_phys_page_range(struct uc_struct *uc, tb_page_addr_t start, t
                                    int is_cpu_write_access);
 void tb_invalidate_phys_range(struct uc_struct *uc, tb_page_addr_t start, tb_page_addr_t end);
 void tb_cleanup(struct uc_struct *uc);
+bool uc_tb_insn_pc(CPUState *cpu, uintptr_t retaddr, target_ulong *pc);
 
 #ifdef CONFIG_USER_ONLY
 int page_unprotect(struct uc_struct *uc, target_ulong address, uintptr_t pc);
@@ -34,6 +34,7 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
 {
     TCGContext *tcg_ctx = cpu->uc->tcg_ctx;
     int max_insns;
+    bool continued;
 
     /* Initialize DisasContext */
     db->tb = tb;
@@ -44,6 +45,8 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
     db->singlestep_enabled = cpu->singlestep_enabled;
     db->uc = cpu->uc;
 
+    /* Unicorn: was the previous translation broken by a full TCG buffer? */
+    continued = db->uc->block_full;
     db->uc->block_full = false;
 
     /* Instruction counting */
@@ -65,31 +68,25 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
     /* Reset the temp count so that we can identify leaks */
     tcg_clear_temp_count();
 
-    /* Unicorn: early check to see if the address of this block is
-     * the "run until" address. */
-    if (tb->pc == cpu->uc->addr_end) {
-        gen_tb_start(tcg_ctx, tb);
-        goto tb_end;
-    }
+    /* Start translating.  */
+    gen_tb_start(tcg_ctx, db->tb);
 
-    /* Unicorn: trace this block on request
+    /* Unicorn: trace this block on request, once it is known to run.
      * Only hook this block if it is not broken from previous translation due to
-     * full translation cache
+     * full translation cache, nor stopped right away by the "run until"
+     * address, which translate_insn checks. Its size is patched in by
+     * tb_gen_code().
      */
-    if (!cpu->uc->block_full && HOOK_EXISTS_BOUNDED(cpu->uc, UC_HOOK_BLOCK, db->pc_first)) {
-    // Unicorn: FIXME: Needs to be adjusted to work with new TCG
-#if 0
-        // Save block address to see if we need to patch block size later
-        cpu->uc->block_addr = db->pc_first;
-        cpu->uc->size_arg = tcg_ctx->gen_op_buf[tcg_ctx->gen_op_buf[0].prev].args;
-        gen_uc_tracecode(tcg_ctx, 0xf8f8f8f8, UC_HOOK_BLOCK_IDX, cpu->uc, db->pc_first);
-#endif
-    } else {
-        cpu->uc->size_arg = -1;
+    if (!continued && db->pc_first != cpu->uc->addr_end &&
+            HOOK_EXISTS_BOUNDED(cpu->uc, UC_HOOK_BLOCK, db->pc_first)) {
+        tcg_ctx->block_size_op = gen_uc_tracecode(tcg_ctx, 0, UC_HOOK_BLOCK_IDX, cpu->uc, db->pc_first);
+    }
+
+    /* Unicorn: count the edge from the previous block on request */
+    if (cpu->uc->coverage_map && db->pc_first != cpu->uc->addr_end) {
+        gen_uc_coverage(tcg_ctx, cpu->uc, db->pc_first);
     }
 
-    /* Start translating.  */
-    gen_tb_start(tcg_ctx, db->tb);
     ops->tb_start(db, cpu);
     tcg_debug_assert(db->is_jmp == DISAS_NEXT);  /* no early exit */
 
@@ -99,7 +96,8 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
         tcg_debug_assert(db->is_jmp == DISAS_NEXT);  /* no early exit */
 
         /* Pass breakpoint hits to target for further processing */
-        if (unlikely(!QTAILQ_EMPTY(&cpu->breakpoints))) {
+        if (unlikely(!QTAILQ_EMPTY(&cpu->breakpoints)) &&
+                !(tb_cflags(db->tb) & CF_NOBREAK)) {
             CPUBreakpoint *bp;
             QTAILQ_FOREACH(bp, &cpu->breakpoints, entry) {
                 if (bp->pc == db->pc_next) {
@@ -144,7 +142,6 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
         }
     }
 
-tb_end:
     /* Emit code to exit the TB, as indicated by db->is_jmp.  */
     ops->tb_stop(db, cpu);
     gen_tb_end(tcg_ctx, db->tb, db->num_insns);
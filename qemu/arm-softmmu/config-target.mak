@@ -0,0 +1,9 @@
+# Automatically generated by configure - do not modify
+TARGET_ARM=y
+TARGET_NAME=arm
+TARGET_BASE_ARCH=arm
+CONFIG_SOFTMMU=y
+TARGET_SUPPORTS_MTTCG=y
+LDFLAGS+=
+QEMU_CFLAGS+=
+QEMU_CFLAGS+=-include arm.h
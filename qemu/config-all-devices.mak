@@ -0,0 +1 @@
+CONFIG_APIC:=$(findstring y,$(CONFIG_APIC)y)
@@ -0,0 +1,12 @@
+/* Automatically generated by create_config - do not modify */
+#define HOST_X86_64 1
+#define CONFIG_POSIX 1
+#define CONFIG_LINUX 1
+#define CONFIG_BYTESWAP_H 1
+#define CONFIG_TCG 1
+#define CONFIG_AVX2_OPT 1
+#define CONFIG_CPUID_H 1
+#define CONFIG_INT128 1
+#define CONFIG_ATOMIC64 1
+#define CONFIG_VECTOR16 1
+#define CONFIG_POSIX_MEMALIGN 1
@@ -40,7 +40,6 @@
 #include "uc_priv.h"
 
 static bool cpu_can_run(CPUState *cpu);
-static void cpu_handle_guest_debug(CPUState *cpu);
 static int tcg_cpu_exec(struct uc_struct *uc, CPUState *cpu);
 static bool tcg_exec_all(struct uc_struct* uc);
 static int qemu_tcg_init_vcpu(CPUState *cpu);
@@ -78,6 +77,8 @@ void run_on_cpu(CPUState *cpu, run_on_cpu_func func, void *data)
 int resume_all_vcpus(struct uc_struct *uc)
 {
     CPUState *cpu = uc->cpu;
+    target_ulong pc, cs_base;
+    uint32_t flags;
     // Fix call multiple time (vu).
     // We have to check whether this is the second time, then reset all CPU.
     if (!cpu->created) {
@@ -89,6 +90,21 @@ int resume_all_vcpus(struct uc_struct *uc)
 
     //qemu_clock_enable(QEMU_CLOCK_VIRTUAL, true);
     cpu_resume(cpu);
+
+    // Unicorn: instruction limit of uc_emu_start(), see gen_tb_start()
+    cpu->icount_decr.u16.low = MIN(0xffff, uc->emu_count);
+    cpu->icount_extra = uc->emu_count - cpu->icount_decr.u16.low;
+
+    // Unicorn: resuming from a breakpoint of uc_breakpoint_add() runs its
+    // instruction alone, in a block translated without it
+    cpu->cflags_next_tb = -1;
+    if (unlikely(!QTAILQ_EMPTY(&cpu->breakpoints))) {
+        cpu_get_tb_cpu_state(cpu->env_ptr, &pc, &cs_base, &flags);
+        if (cpu_breakpoint_test(cpu, pc, BP_GDB)) {
+            cpu->cflags_next_tb = curr_cflags(uc) | CF_NOBREAK | 1;
+        }
+    }
+
     qemu_tcg_cpu_loop(uc);
 
     return 0;
@@ -155,14 +171,12 @@ static bool tcg_exec_all(struct uc_struct* uc)
         //qemu_clock_enable(QEMU_CLOCK_VIRTUAL,
         //                  (cpu->singlestep_enabled & SSTEP_NOTIMER) == 0);
         if (cpu_can_run(cpu)) {
-            uc->quit_request = false;
+            atomic_set(&uc->quit_request, false);
             r = tcg_cpu_exec(uc, cpu);
 
-            // quit current TB but continue emulating?
-            if (uc->quit_request) {
-                // reset stop_request
-                uc->stop_request = false;
-            } else if (uc->stop_request) {
+            // a quit request only leaves the current TB, and does not
+            // hide a stop request made meanwhile
+            if (atomic_read(&uc->stop_request)) {
                 finish = true;
                 break;
             }
@@ -175,8 +189,10 @@ static bool tcg_exec_all(struct uc_struct* uc)
                 break;
             }
 
+            // Unicorn: a breakpoint of uc_breakpoint_add() was hit
             if (r == EXCP_DEBUG) {
-                cpu_handle_guest_debug(cpu);
+                uc->invalid_error = UC_ERR_BREAKPOINT;
+                finish = true;
                 break;
             }
             if (r == EXCP_HLT) {
@@ -209,11 +225,6 @@ static bool cpu_can_run(CPUState *cpu)
     return true;
 }
 
-static void cpu_handle_guest_debug(CPUState *cpu)
-{
-    cpu->stopped = true;
-}
-
 #if 0
 #ifndef _WIN32
 static void qemu_tcg_init_cpu_signals(void)
@@ -66,6 +66,11 @@
  */
 #define RAM_RESIZEABLE (1 << 2)
 
+/* Unicorn: RAM is a MAP_NORESERVE mapping of its own, of a file or of
+ * demand-zero memory, and is freed with munmap().
+ */
+#define RAM_NORESERVE  (1 << 3)
+
 #endif
 
 bool set_preferred_target_page_bits(struct uc_struct *uc, int bits)
@@ -666,6 +671,25 @@ int cpu_watchpoint_insert(CPUState *cpu, vaddr addr, vaddr len,
     return -ENOSYS;
 }
 #else
+/* Unicorn: a watchpoint may cover several pages, flush all of them */
+static void watchpoint_flush_pages(CPUState *cpu, CPUWatchpoint *wp)
+{
+    vaddr page = wp->vaddr & TARGET_PAGE_MASK;
+    vaddr last = (wp->vaddr + wp->len - 1) & TARGET_PAGE_MASK;
+
+    if (last - page >= 16 * TARGET_PAGE_SIZE) {
+        tlb_flush(cpu);
+        return;
+    }
+    for (;;) {
+        tlb_flush_page(cpu, page);
+        if (page == last) {
+            break;
+        }
+        page += TARGET_PAGE_SIZE;
+    }
+}
+
 /* Add a watchpoint.  */
 int cpu_watchpoint_insert(CPUState *cpu, vaddr addr, vaddr len,
         int flags, CPUWatchpoint **watchpoint)
@@ -676,7 +700,7 @@ int cpu_watchpoint_insert(CPUState *cpu, vaddr addr, vaddr len,
     if (len == 0 || (addr + len - 1) < addr) {
         return -EINVAL;
     }
-    wp = g_malloc(sizeof(*wp));
+    wp = g_malloc0(sizeof(*wp));
 
     wp->vaddr = addr;
     wp->len = len;
@@ -689,7 +713,7 @@ int cpu_watchpoint_insert(CPUState *cpu, vaddr addr, vaddr len,
         QTAILQ_INSERT_TAIL(&cpu->watchpoints, wp, entry);
     }
 
-    tlb_flush_page(cpu, addr);
+    watchpoint_flush_pages(cpu, wp);
 
     if (watchpoint)
         *watchpoint = wp;
@@ -717,7 +741,7 @@ void cpu_watchpoint_remove_by_ref(CPUState *cpu, CPUWatchpoint *watchpoint)
 {
     QTAILQ_REMOVE(&cpu->watchpoints, watchpoint, entry);
 
-    tlb_flush_page(cpu, watchpoint->vaddr);
+    watchpoint_flush_pages(cpu, watchpoint);
 
     g_free(watchpoint);
 }
@@ -754,6 +778,38 @@ static inline bool cpu_watchpoint_address_matches(CPUWatchpoint *wp,
     return !(addr > wpend || wp->vaddr > addrend);
 }
 
+/* Unicorn: the BP_MEM_* flags of the watchpoints that overlap a range */
+int uc_watchpoint_flags(CPUState *cpu, vaddr addr, vaddr len)
+{
+    CPUWatchpoint *wp;
+    int flags = 0;
+
+    QTAILQ_FOREACH(wp, &cpu->watchpoints, entry) {
+        if (cpu_watchpoint_address_matches(wp, addr, len)) {
+            flags |= wp->flags & BP_MEM_ACCESS;
+        }
+    }
+
+    return flags;
+}
+
+/* Unicorn: run the callbacks of the watchpoints of uc_watchpoint_add()
+   that overlap an access.  The callback may remove its own watchpoint.  */
+void uc_watchpoint_check(CPUState *cpu, vaddr addr, vaddr len, int flags,
+                         uint64_t value)
+{
+    CPUWatchpoint *wp, *next;
+    uc_mem_type type = (flags & BP_MEM_WRITE) ? UC_MEM_WRITE : UC_MEM_READ;
+
+    QTAILQ_FOREACH_SAFE(wp, &cpu->watchpoints, entry, next) {
+        if ((wp->flags & flags) && wp->callback &&
+            cpu_watchpoint_address_matches(wp, addr, len)) {
+            ((uc_cb_hookmem_t)wp->callback)(cpu->uc, type, addr, (int)len,
+                                            value, wp->user_data);
+        }
+    }
+}
+
 #endif
 
 /* Add a breakpoint.  */
@@ -886,6 +942,60 @@ found:
     return block;
 }
 
+static void tlb_reset_dirty_range_all(struct uc_struct *uc, ram_addr_t start,
+                                      ram_addr_t length)
+{
+    ram_addr_t start1;
+    RAMBlock *block;
+    ram_addr_t end;
+
+    end = TARGET_PAGE_ALIGN(start + length);
+    start &= TARGET_PAGE_MASK;
+
+    block = qemu_get_ram_block(uc, start);
+    assert(block == qemu_get_ram_block(uc, end - 1));
+    start1 = (uintptr_t)ramblock_ptr(block, start - block->offset);
+    if (uc->cpu) {
+        tlb_reset_dirty(uc->cpu, start1, length);
+    }
+}
+
+/* Note: start and end must be within the same ram block.  */
+bool cpu_physical_memory_test_and_clear_dirty(struct uc_struct *uc,
+                                              ram_addr_t start,
+                                              ram_addr_t length,
+                                              unsigned client)
+{
+    DirtyMemoryBlocks *blocks;
+    unsigned long end, page;
+    bool dirty = false;
+
+    if (length == 0) {
+        return false;
+    }
+
+    end = TARGET_PAGE_ALIGN(start + length) >> TARGET_PAGE_BITS;
+    page = start >> TARGET_PAGE_BITS;
+
+    blocks = atomic_read(&uc->ram_list.dirty_memory[client]);
+
+    while (page < end) {
+        unsigned long idx = page / DIRTY_MEMORY_BLOCK_SIZE;
+        unsigned long offset = page % DIRTY_MEMORY_BLOCK_SIZE;
+        unsigned long num = MIN(end - page, DIRTY_MEMORY_BLOCK_SIZE - offset);
+
+        dirty |= bitmap_test_and_clear_atomic(blocks->blocks[idx],
+                                              offset, num);
+        page += num;
+    }
+
+    if (dirty) {
+        tlb_reset_dirty_range_all(uc, start, length);
+    }
+
+    return dirty;
+}
+
 hwaddr memory_region_section_get_iotlb(CPUState *cpu,
         MemoryRegionSection *section,
         target_ulong vaddr,
@@ -894,13 +1004,14 @@ hwaddr memory_region_section_get_iotlb(CPUState *cpu,
         target_ulong *address)
 {
     hwaddr iotlb;
-    CPUWatchpoint *wp;
 
     if (memory_region_is_ram(section->mr)) {
         /* Normal RAM.  */
         iotlb = (memory_region_get_ram_addr(section->mr) & TARGET_PAGE_MASK)
             + xlat;
-        if (!section->readonly) {
+        if (!section->readonly &&
+            (memory_page_perms(cpu->uc, section->mr, section->mr->addr + xlat) &
+             UC_PROT_WRITE)) {
             iotlb |= PHYS_SECTION_NOTDIRTY;
         } else {
             iotlb |= PHYS_SECTION_ROM;
@@ -913,18 +1024,8 @@ hwaddr memory_region_section_get_iotlb(CPUState *cpu,
         iotlb += xlat;
     }
 
-    /* Make accesses to pages with watchpoints go via the
-       watchpoint trap routines.  */
-    QTAILQ_FOREACH(wp, &cpu->watchpoints, entry) {
-        if (cpu_watchpoint_address_matches(wp, vaddr, TARGET_PAGE_SIZE)) {
-            /* Avoid trapping reads of pages with a write breakpoint. */
-            if ((prot & PAGE_WRITE) || (wp->flags & BP_MEM_READ)) {
-                iotlb = PHYS_SECTION_WATCH + paddr;
-                *address |= TLB_MMIO;
-                break;
-            }
-        }
-    }
+    /* Unicorn: pages with watchpoints are marked TLB_HOOKED by
+       tlb_set_page_with_attrs(), there is no io_mem_watch.  */
 
     return iotlb;
 }
@@ -1073,10 +1174,19 @@ void flatview_add_to_dispatch(FlatView *fv, MemoryRegionSection *section)
 
 #endif
 
+static int ram_block_cmp_offset(const void *a, const void *b)
+{
+    const RAMBlock *ba = *(RAMBlock * const *)a;
+    const RAMBlock *bb = *(RAMBlock * const *)b;
+
+    return ba->offset < bb->offset ? -1 : ba->offset > bb->offset;
+}
+
 static ram_addr_t find_ram_offset(struct uc_struct *uc, ram_addr_t size)
 {
-    RAMBlock *block, *next_block;
+    RAMBlock *block, **sorted;
     ram_addr_t offset = RAM_ADDR_MAX, mingap = RAM_ADDR_MAX;
+    size_t i, n = 0;
 
     assert(size != 0); /* it would hand out same offset multiple times */
 
@@ -1084,21 +1194,31 @@ static ram_addr_t find_ram_offset(struct uc_struct *uc, ram_addr_t size)
         return 0;
     }
 
+    /* Unicorn: there is one block per mapping, so instead of looking for
+     * the block following each one, sort them by offset once; the block
+     * following each one is then the next in the array. */
+    QLIST_FOREACH(block, &uc->ram_list.blocks, next) {
+        n++;
+    }
+    sorted = g_new(RAMBlock *, n);
+    n = 0;
     QLIST_FOREACH(block, &uc->ram_list.blocks, next) {
-        ram_addr_t end, next = RAM_ADDR_MAX;
+        sorted[n++] = block;
+    }
+    qsort(sorted, n, sizeof(*sorted), ram_block_cmp_offset);
 
-        end = block->offset + block->max_length;
+    for (i = 0; i < n; i++) {
+        ram_addr_t end, next;
+
+        end = sorted[i]->offset + sorted[i]->max_length;
+        next = i + 1 < n ? sorted[i + 1]->offset : RAM_ADDR_MAX;
 
-        QLIST_FOREACH(next_block, &uc->ram_list.blocks, next) {
-            if (next_block->offset >= end) {
-                next = MIN(next, next_block->offset);
-            }
-        }
         if (next - end >= size && next - end < mingap) {
             offset = end;
             mingap = next - end;
         }
     }
+    g_free(sorted);
 
     if (offset == RAM_ADDR_MAX) {
         fprintf(stderr, "Failed to find gap of requested size: %" PRIu64 "\n",
@@ -1188,6 +1308,50 @@ int qemu_ram_resize(struct uc_struct *uc, RAMBlock *block, ram_addr_t newsize, E
     return 0;
 }
 
+/* Called with ram_list.mutex held */
+static void dirty_memory_extend(struct uc_struct *uc, ram_addr_t new_ram_size)
+{
+    ram_addr_t new_num_blocks = DIV_ROUND_UP(new_ram_size,
+                                             DIRTY_MEMORY_BLOCK_SIZE);
+    ram_addr_t old_num_blocks;
+    int i;
+
+    // Unicorn: blocks are never shrunk, so the current count is kept with them
+    // instead of being derived from the previous RAM size.
+    old_num_blocks = uc->ram_list.dirty_memory[0] ?
+                     uc->ram_list.dirty_memory[0]->num_blocks : 0;
+
+    /* Only need to extend if block count increased */
+    if (new_num_blocks <= old_num_blocks) {
+        return;
+    }
+
+    for (i = 0; i < DIRTY_MEMORY_NUM; i++) {
+        DirtyMemoryBlocks *old_blocks;
+        DirtyMemoryBlocks *new_blocks;
+        int j;
+
+        old_blocks = uc->ram_list.dirty_memory[i];
+        new_blocks = g_malloc(sizeof(*new_blocks) +
+                              sizeof(new_blocks->blocks[0]) * new_num_blocks);
+        new_blocks->num_blocks = new_num_blocks;
+
+        if (old_num_blocks) {
+            memcpy(new_blocks->blocks, old_blocks->blocks,
+                   old_num_blocks * sizeof(old_blocks->blocks[0]));
+        }
+
+        for (j = old_num_blocks; j < new_num_blocks; j++) {
+            new_blocks->blocks[j] = bitmap_new(DIRTY_MEMORY_BLOCK_SIZE);
+        }
+
+        uc->ram_list.dirty_memory[i] = new_blocks;
+
+        // Unicorn: no RCU, nobody else can be reading the old array
+        g_free(old_blocks);
+    }
+}
+
 static void ram_block_add(struct uc_struct *uc, RAMBlock *new_block, Error **errp)
 {
     RAMBlock *block;
@@ -1212,6 +1376,7 @@ static void ram_block_add(struct uc_struct *uc, RAMBlock *new_block, Error **err
 
     new_ram_size = MAX(old_ram_size,
               (new_block->offset + new_block->max_length) >> TARGET_PAGE_BITS);
+    dirty_memory_extend(uc, new_ram_size);
 
     /* Keep the list sorted from biggest to smallest block.  Unlike QTAILQ,
      * QLIST (which has an RCU-friendly variant) does not have insertion at
@@ -1236,6 +1401,12 @@ static void ram_block_add(struct uc_struct *uc, RAMBlock *new_block, Error **err
     smp_wmb();
     uc->ram_list.version++;
 
+    /* Unicorn: the offset may have belonged to a block that is gone now,
+     * so a snapshot must not trust its bits for the new one. */
+    cpu_physical_memory_set_dirty_range(uc, new_block->offset,
+                                        new_block->used_length,
+                                        DIRTY_CLIENTS_ALL);
+
     if (new_block->host) {
         qemu_ram_setup_dump(new_block->host, new_block->max_length);
         // Unicorn: commented out
@@ -1297,6 +1468,55 @@ RAMBlock *qemu_ram_alloc(ram_addr_t size, MemoryRegion *mr, Error **errp)
     return qemu_ram_alloc_internal(size, size, NULL, NULL, false, mr, errp);
 }
 
+/* Unicorn: RAM mapped from @fd at @offset, or demand-zero if @fd is -1.
+ * Only the pages touched take memory, and the mapping is copy-on-write
+ * unless @share. @fd is not kept.
+ */
+RAMBlock *qemu_ram_alloc_from_fd(ram_addr_t size, MemoryRegion *mr,
+                                 bool share, int fd, uint64_t offset,
+                                 Error **errp)
+{
+#ifndef _WIN32
+    RAMBlock *new_block;
+    Error *local_err = NULL;
+    void *host;
+    int flags = MAP_NORESERVE | (share ? MAP_SHARED : MAP_PRIVATE);
+
+    if (fd < 0) {
+        flags |= MAP_ANONYMOUS;
+        offset = 0;
+    }
+
+    size = TARGET_PAGE_ALIGN(size);
+    host = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, fd, offset);
+    if (host == MAP_FAILED) {
+        error_setg_errno(errp, errno, "cannot map guest memory '%s'",
+                         memory_region_name(mr));
+        return NULL;
+    }
+
+    new_block = g_malloc0(sizeof(*new_block));
+    new_block->mr = mr;
+    new_block->used_length = size;
+    new_block->max_length = size;
+    new_block->fd = -1;
+    new_block->host = host;
+    new_block->flags = RAM_NORESERVE | (share ? RAM_SHARED : 0);
+    ram_block_add(mr->uc, new_block, &local_err);
+    if (local_err) {
+        munmap(host, size);
+        g_free(new_block);
+        error_propagate(errp, local_err);
+        return NULL;
+    }
+    return new_block;
+#else
+    error_setg(errp, "cannot map guest memory '%s' from a file",
+               memory_region_name(mr));
+    return NULL;
+#endif
+}
+
 RAMBlock *qemu_ram_alloc_resizeable(ram_addr_t size, ram_addr_t maxsz,
                                     void (*resized)(const char*,
                                                     uint64_t length,
@@ -1311,6 +1531,8 @@ static void reclaim_ramblock(RAMBlock *block)
     if (block->flags & RAM_PREALLOC) {
         ;
 #ifndef _WIN32
+    } else if (block->flags & RAM_NORESERVE) {
+        munmap(block->host, block->max_length);
     } else if (block->fd >= 0) {
         munmap(block->host, block->max_length);
         close(block->fd);
@@ -1524,6 +1746,94 @@ ram_addr_t qemu_ram_addr_from_host(struct uc_struct* uc, void *ptr)
     return block->offset + offset;
 }
 
+/* Unicorn: DIRTY_MEMORY_SNAPSHOT has a bit set for each page written since
+ * the block was last saved or restored, so that restoring a snapshot only
+ * copies those pages back.
+ */
+void memory_snapshot_save(struct uc_struct *uc, MemoryRegion *mr,
+                          uint8_t *data)
+{
+    RAMBlock *block = mr->ram_block;
+
+    memcpy(data, block->host, block->used_length);
+
+    /* the next write to each page goes through notdirty_mem_write() again */
+    cpu_physical_memory_test_and_clear_dirty(uc, block->offset,
+                                             block->used_length,
+                                             DIRTY_MEMORY_SNAPSHOT);
+}
+
+/* Unicorn: host address of @offset in the RAM of @mr, NULL if @mr is not RAM */
+void *memory_host_ptr(struct uc_struct *uc, MemoryRegion *mr, hwaddr offset)
+{
+    if (!memory_region_is_ram(mr)) {
+        return NULL;
+    }
+
+    return qemu_map_ram_ptr(uc, mr->ram_block, offset);
+}
+
+/* Unicorn: @len bytes of @mr from @offset were written through the pointer
+ * of memory_host_ptr(): drop the code translated from them, and mark them
+ * dirty for the next snapshot restore.
+ */
+void memory_host_written(struct uc_struct *uc, MemoryRegion *mr, hwaddr offset,
+                         size_t len)
+{
+    ram_addr_t addr;
+
+    if (!memory_region_is_ram(mr)) {
+        return;
+    }
+
+    addr = memory_region_get_ram_addr(mr) + offset;
+    tb_invalidate_phys_range(uc, addr, addr + len);
+    cpu_physical_memory_set_dirty_range(uc, addr, len,
+                                        1 << DIRTY_MEMORY_SNAPSHOT);
+}
+
+/* Copy back the pages of @mr written since the last save or restore, or all
+ * of them if @full.  Returns the number of pages copied.
+ */
+size_t memory_snapshot_restore(struct uc_struct *uc, MemoryRegion *mr,
+                               const uint8_t *data, bool full)
+{
+    RAMBlock *block = mr->ram_block;
+    DirtyMemoryBlocks *blocks = uc->ram_list.dirty_memory[DIRTY_MEMORY_SNAPSHOT];
+    unsigned long page = block->offset >> TARGET_PAGE_BITS;
+    unsigned long end = TARGET_PAGE_ALIGN(block->offset + block->used_length)
+                        >> TARGET_PAGE_BITS;
+    size_t restored = 0;
+
+    while (page < end) {
+        unsigned long idx = page / DIRTY_MEMORY_BLOCK_SIZE;
+        unsigned long offset = page % DIRTY_MEMORY_BLOCK_SIZE;
+        unsigned long num = MIN(end - page, DIRTY_MEMORY_BLOCK_SIZE - offset);
+        unsigned long *bitmap = blocks->blocks[idx];
+        unsigned long bit;
+
+        bit = full ? offset : find_next_bit(bitmap, offset + num, offset);
+        while (bit < offset + num) {
+            ram_addr_t addr = (ram_addr_t)(page + bit - offset) << TARGET_PAGE_BITS;
+            ram_addr_t ofs = addr - block->offset;
+
+            memcpy(block->host + ofs, data + ofs, TARGET_PAGE_SIZE);
+            /* the page may hold code translated since the snapshot */
+            tb_invalidate_phys_page_range(uc, addr, addr + TARGET_PAGE_SIZE, 0);
+            restored++;
+
+            bit = full ? bit + 1 : find_next_bit(bitmap, offset + num, bit + 1);
+        }
+        bitmap_clear(bitmap, offset, num);
+        page += num;
+    }
+
+    /* the next write to each page goes through notdirty_mem_write() again */
+    tlb_reset_dirty_range_all(uc, block->offset, block->used_length);
+
+    return restored;
+}
+
 static MemTxResult flatview_write(FlatView *fv, hwaddr addr, MemTxAttrs attrs,
                                   const uint8_t *buf, int len);
 static bool flatview_access_valid(FlatView *fv, hwaddr addr, int len,
@@ -1642,6 +1952,11 @@ static int subpage_register (subpage_t *mmio, uint32_t start, uint32_t end,
 static void notdirty_mem_write(struct uc_struct* uc, void *opaque, hwaddr ram_addr,
                                uint64_t val, unsigned size)
 {
+    /* Unicorn: translations are kept across runs, drop the ones covering
+       code the guest overwrites. */
+    if (!cpu_physical_memory_get_dirty_flag(uc, ram_addr, DIRTY_MEMORY_CODE)) {
+        tb_invalidate_phys_page_fast(uc, ram_addr, size);
+    }
     switch (size) {
     case 1:
         stb_p(qemu_map_ram_ptr(uc, NULL, ram_addr), val);
@@ -1655,6 +1970,15 @@ static void notdirty_mem_write(struct uc_struct* uc, void *opaque, hwaddr ram_ad
     default:
         abort();
     }
+    /* Set the snapshot bit as well to remove the notdirty callback faster.
+     */
+    cpu_physical_memory_set_dirty_range(uc, ram_addr, size,
+                                        DIRTY_CLIENTS_NOCODE);
+    /* we remove the notdirty callback only if the code has been
+       flushed */
+    if (!cpu_physical_memory_is_clean(uc, ram_addr)) {
+        tlb_set_dirty(uc->current_cpu, uc->current_cpu->mem_io_vaddr);
+    }
 }
 
 static bool notdirty_mem_accepts(void *opaque, hwaddr addr,
@@ -1879,6 +2203,18 @@ static int memory_access_size(MemoryRegion *mr, unsigned l, hwaddr addr)
     return l;
 }
 
+/* Unicorn: writes that bypass the TLB still have to drop the translations
+ * of the code they overwrite and be seen by the next snapshot restore. */
+static void invalidate_and_set_dirty(MemoryRegion *mr, hwaddr addr,
+                                     hwaddr length)
+{
+    ram_addr_t addr1 = memory_region_get_ram_addr(mr) + addr;
+
+    tb_invalidate_phys_range(mr->uc, addr1, addr1 + length);
+    cpu_physical_memory_set_dirty_range(mr->uc, addr1, length,
+                                        1 << DIRTY_MEMORY_SNAPSHOT);
+}
+
 static MemTxResult flatview_write_continue(FlatView *fv, hwaddr addr,
                                            MemTxAttrs attrs,
                                            const uint8_t *buf,
@@ -1933,6 +2269,7 @@ static MemTxResult flatview_write_continue(FlatView *fv, hwaddr addr,
             /* RAM case */
             ptr = qemu_map_ram_ptr(mr->uc, mr->ram_block, addr1);
             memcpy(ptr, buf, l);
+            invalidate_and_set_dirty(mr, addr1, l);
         }
 
         /* Unicorn: commented out
@@ -2131,6 +2468,7 @@ static inline void cpu_physical_memory_write_rom_internal(AddressSpace *as,
             switch (type) {
                 case WRITE_DATA:
                     memcpy(ptr, buf, l);
+                    invalidate_and_set_dirty(mr, addr1, l);
                     break;
                 case FLUSH_CACHE:
                     flush_icache_range((uintptr_t)ptr, (uintptr_t)ptr + l);
@@ -2322,7 +2660,7 @@ void cpu_physical_memory_unmap(AddressSpace *as, void *buffer, hwaddr len,
 #define TRANSLATE(...)           address_space_translate(as, __VA_ARGS__)
 #define IS_DIRECT(mr, is_write)  memory_access_is_direct(mr, is_write)
 #define MAP_RAM(mr, ofs)         qemu_map_ram_ptr((mr)->uc, (mr)->ram_block, ofs)
-#define INVALIDATE(mr, ofs, len)
+#define INVALIDATE(mr, ofs, len) invalidate_and_set_dirty(mr, ofs, len)
 #define RCU_READ_LOCK(...)       rcu_read_lock()
 #define RCU_READ_UNLOCK(...)     rcu_read_unlock()
 #include "memory_ldst.inc.c"
@@ -2412,7 +2750,7 @@ void address_space_cache_destroy(MemoryRegionCache *cache)
     address_space_translate(cache->as, cache->xlat + (addr), __VA_ARGS__)
 #define IS_DIRECT(mr, is_write)  true
 #define MAP_RAM(mr, ofs)         qemu_map_ram_ptr((mr)->uc, (mr)->ram_block, ofs)
-#define INVALIDATE(mr, ofs, len)
+#define INVALIDATE(mr, ofs, len) invalidate_and_set_dirty(mr, ofs, len)
 #define RCU_READ_LOCK()          //rcu_read_lock()
 #define RCU_READ_UNLOCK()        //rcu_read_unlock()
 #include "memory_ldst.inc.c"
@@ -321,6 +321,7 @@ symbols = (
     'cpu_physical_memory_range_includes_clean',
     'cpu_physical_memory_reset_dirty',
     'cpu_physical_memory_rw',
+    'cpu_physical_memory_test_and_clear_dirty',
     'cpu_physical_memory_unmap',
     'cpu_physical_memory_write_rom',
     'cpu_physical_memory_write_rom_internal',
@@ -1763,7 +1764,9 @@ symbols = (
     'memory_listener_register',
     'memory_listener_unregister',
     'memory_map',
+    'memory_map_fd',
     'memory_map_init',
+    'memory_map_io',
     'memory_map_ptr',
     'memory_mapping_filter',
     'memory_mapping_list_add_mapping_sorted',
@@ -1805,6 +1808,7 @@ symbols = (
     'memory_region_init_io',
     'memory_region_init_ram_device_ptr',
     'memory_region_init_ram_nomigrate',
+    'memory_region_init_ram_from_fd',
     'memory_region_init_ram_ptr',
     'memory_region_init_reservation',
     'memory_region_init_resizeable_ram',
@@ -1839,6 +1843,10 @@ symbols = (
     'memory_region_write_accessor',
     'memory_region_wrong_endianness',
     'memory_register_types',
+    'memory_host_ptr',
+    'memory_host_written',
+    'memory_snapshot_restore',
+    'memory_snapshot_save',
     'memory_try_enable_merging',
     'memory_unmap',
     'module_call_init',
@@ -2158,6 +2166,7 @@ symbols = (
     'qemu_ram_addr_from_host',
     'qemu_ram_addr_from_host_nofail',
     'qemu_ram_alloc',
+    'qemu_ram_alloc_from_fd',
     'qemu_ram_alloc_from_ptr',
     'qemu_ram_alloc_resizeable',
     'qemu_ram_block_by_name',
@@ -2444,6 +2453,8 @@ symbols = (
     'tb_find_pc',
     'tb_find_slow',
     'tb_flush',
+    'tb_stats_query',
+    'tb_profile_top',
     'tb_flush_jmp_cache',
     'tb_gen_code',
     'tb_hash_remove',
@@ -2937,11 +2948,13 @@ symbols = (
     'tlb_flush_page',
     'tlb_flush_page_by_mmuidx',
     'tlb_is_dirty_ram',
+    'tlb_protect_code',
     'tlb_reset_dirty',
     'tlb_reset_dirty_range',
     'tlb_set_dirty',
     'tlb_set_page',
     'tlb_set_page_with_attrs',
+    'tlb_unprotect_code',
     'tlb_vaddr_to_host',
     'tlbi_aa64_asid_is_write',
     'tlbi_aa64_asid_write',
@@ -2984,6 +2997,12 @@ symbols = (
     'type_table_add',
     'type_table_get',
     'type_table_lookup',
+    'uc_invalidate_tb',
+    'uc_invalidate_tb_pc',
+    'uc_tb_insn_pc',
+    'uc_tlb_flush',
+    'uc_watchpoint_check',
+    'uc_watchpoint_flags',
     'uint16_to_float16',
     'uint16_to_float32',
     'uint16_to_float64',
@@ -109,7 +109,8 @@ static X86CPU *pc_new_cpu(struct uc_struct *uc, const char *cpu_model, int64_t a
         return NULL;
     }
 
-    object_property_set_int(uc, OBJECT(cpu), apic_id, "apic-id", &local_err);
+    // Unicorn: "apic-id" is a qdev property, which is not registered
+    cpu->apic_id = apic_id;
     object_property_set_bool(uc, OBJECT(cpu), true, "realized", &local_err);
 
     if (local_err) {
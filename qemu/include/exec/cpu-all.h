@@ -359,11 +359,14 @@ CPUArchState *cpu_copy(CPUArchState *env);
 #define TLB_NOTDIRTY        (1 << (TARGET_PAGE_BITS - 2))
 /* Set if TLB entry is an IO callback.  */
 #define TLB_MMIO            (1 << (TARGET_PAGE_BITS - 3))
+/* Unicorn: set if a memory hook covers part of the page, so that accesses
+   leave the fast path and reach the hooks in the slow path.  */
+#define TLB_HOOKED          (1 << (TARGET_PAGE_BITS - 4))
 
 /* Use this mask to check interception with an alignment mask
  * in a TCG backend.
  */
-#define TLB_FLAGS_MASK  (TLB_INVALID_MASK | TLB_NOTDIRTY | TLB_MMIO)
+#define TLB_FLAGS_MASK  (TLB_INVALID_MASK | TLB_NOTDIRTY | TLB_MMIO | TLB_HOOKED)
 
 ram_addr_t last_ram_offset(struct uc_struct *uc);
 void qemu_mutex_lock_ramlist(struct uc_struct *uc);
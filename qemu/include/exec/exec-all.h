@@ -171,6 +171,9 @@ void tlb_set_page(CPUState *cpu, target_ulong vaddr,
                   int mmu_idx, target_ulong size);
 
 void tb_invalidate_phys_addr(AddressSpace *as, hwaddr addr);
+void uc_invalidate_tb(struct uc_struct *uc, uint64_t start, size_t len);
+void uc_invalidate_tb_pc(struct uc_struct *uc, uint64_t begin, uint64_t end);
+void uc_tlb_flush(struct uc_struct *uc);
 void probe_write(CPUArchState *env, target_ulong addr, int size, int mmu_idx,
                  uintptr_t retaddr);
 
@@ -234,9 +237,10 @@ struct TranslationBlock {
 #define CF_USE_ICOUNT  0x00020000
 #define CF_INVALID     0x00040000 /* TB is stale. Setters need tb_lock */
 #define CF_PARALLEL    0x00080000 /* Generate code for a parallel context */
+#define CF_NOBREAK     0x00100000 /* Unicorn: ignore breakpoints, to resume from one */
 /* cflags' mask for hashing/comparison */
 #define CF_HASH_MASK   \
-    (CF_COUNT_MASK | CF_LAST_IO | CF_USE_ICOUNT | CF_PARALLEL)
+    (CF_COUNT_MASK | CF_LAST_IO | CF_USE_ICOUNT | CF_PARALLEL | CF_NOBREAK)
 
     /* Per-vCPU dynamic tracing state used to generate this TB */
     uint32_t trace_vcpu_dstate;
@@ -275,6 +279,16 @@ struct TranslationBlock {
      */
     uintptr_t jmp_list_next[2];
     uintptr_t jmp_list_first;
+
+    /* Unicorn: times this block ran, counted by its own code while
+     * uc_profile_enable() is on, see gen_tb_start()
+     */
+    uint64_t exec_count;
+
+    /* Unicorn: hook vectors compiled into this block, NULL terminated,
+     * released when it is invalidated, see hook_vectors_take()
+     */
+    struct hook_vector **hook_vectors;
 };
 
 /* Hide the atomic_read to make code a little easier on the eyes */
@@ -286,13 +300,15 @@ static inline uint32_t tb_cflags(const TranslationBlock *tb)
 /* current cflags for hashing/comparison */
 static inline uint32_t curr_cflags(struct uc_struct *uc)
 {
-    return (uc->parallel_cpus ? CF_PARALLEL : 0);
-// Unicorn: commented out
-//         | (use_icount ? CF_USE_ICOUNT : 0);
+    // Unicorn: icount counts instructions for the limit of uc_emu_start()
+    return (uc->parallel_cpus ? CF_PARALLEL : 0)
+         | (uc->emu_count ? CF_USE_ICOUNT : 0);
 }
 
 void tb_remove(struct uc_struct *uc, TranslationBlock *tb);
 void tb_flush(CPUState *cpu);
+uc_err tb_stats_query(struct uc_struct *uc, uc_query_type type, size_t *result);
+void tb_profile_top(struct uc_struct *uc, uc_tb_profile *blocks, size_t *count);
 void tb_phys_invalidate(struct uc_struct *uc,
     TranslationBlock *tb, tb_page_addr_t page_addr);
 TranslationBlock *tb_htable_lookup(CPUState *cpu, target_ulong pc,
@@ -5,14 +5,9 @@
 
 /* Helpers for instruction counting code generation.  */
 
-//static TCGOp *icount_start_insn;
-//static TCGLabel *icount_label;
-//static TCGLabel *exitreq_label;
-
 static inline void gen_tb_start(TCGContext *tcg_ctx, TranslationBlock *tb)
 {
-    //TCGv_i32 count, flag, imm;
-    TCGv_i32 flag;
+    TCGv_i32 count, flag, imm;
 
     tcg_ctx->exitreq_label = gen_new_label(tcg_ctx);
     flag = tcg_temp_new_i32(tcg_ctx);
@@ -21,30 +16,40 @@ static inline void gen_tb_start(TCGContext *tcg_ctx, TranslationBlock *tb)
     tcg_gen_brcondi_i32(tcg_ctx, TCG_COND_NE, flag, 0, tcg_ctx->exitreq_label);
     tcg_temp_free_i32(tcg_ctx, flag);
 
-#if 0
-    if (!(tb_cflags(tb) & CF_USE_ICOUNT))
-        return;
-    }
+    // Unicorn: icount implements the instruction limit of uc_emu_start()
+    if (tb_cflags(tb) & CF_USE_ICOUNT) {
+        tcg_ctx->icount_label = gen_new_label(tcg_ctx);
+        count = tcg_temp_local_new_i32(tcg_ctx);
+        tcg_gen_ld_i32(tcg_ctx, count, tcg_ctx->uc->cpu_env,
+                       -ENV_OFFSET + offsetof(CPUState, icount_decr.u32));
+        imm = tcg_temp_new_i32(tcg_ctx);
+        /* We emit a movi with a dummy immediate argument. Keep the insn index
+         * of the movi so that we later (when we know the actual insn count)
+         * can update the immediate argument with the actual insn count.  */
+        tcg_gen_movi_i32(tcg_ctx, imm, 0xdeadbeef);
+        tcg_ctx->icount_start_insn = tcg_last_op(tcg_ctx);
+
+        tcg_gen_sub_i32(tcg_ctx, count, count, imm);
+        tcg_temp_free_i32(tcg_ctx, imm);
 
-    icount_label = gen_new_label(tcg_ctx);
-    count = tcg_temp_local_new_i32(tcg_ctx);
-    tcg_gen_ld_i32(tcg_ctx, count, tcg_ctx->uc->cpu_env,
-                   -ENV_OFFSET + offsetof(CPUState, icount_decr.u32));
-    imm = tcg_temp_new_i32(tcg_ctx);
-    /* We emit a movi with a dummy immediate argument. Keep the insn index
-     * of the movi so that we later (when we know the actual insn count)
-     * can update the immediate argument with the actual insn count.  */
-    icount_start_insn = tcg_last_op(tcg_ctx);
-    tcg_gen_movi_i32(tcg_ctx, imm, 0xdeadbeef);
+        tcg_gen_brcondi_i32(tcg_ctx, TCG_COND_LT, count, 0, tcg_ctx->icount_label);
+        tcg_gen_st16_i32(tcg_ctx, count, tcg_ctx->uc->cpu_env,
+                         -ENV_OFFSET + offsetof(CPUState, icount_decr.u16.low));
+        tcg_temp_free_i32(tcg_ctx, count);
+    }
 
-    tcg_gen_sub_i32(tcg_ctx, count, count, imm);
-    tcg_temp_free_i32(tcg_ctx, imm);
+    // Unicorn: count the runs of this block on request, see uc_profile_top().
+    // The block stopped right away by the "run until" address does not run.
+    if (tcg_ctx->uc->profile_enabled && tb->pc != tcg_ctx->uc->addr_end) {
+        TCGv_ptr ttb = tcg_const_ptr(tcg_ctx, tb);
+        TCGv_i64 runs = tcg_temp_new_i64(tcg_ctx);
 
-    tcg_gen_brcondi_i32(tcg_ctx, TCG_COND_LT, count, 0, icount_label);
-    tcg_gen_st16_i32(tcg_ctx, count, tcg_ctx->uc->cpu_env,
-                     -ENV_OFFSET + offsetof(CPUState, icount_decr.u16.low));
-    tcg_temp_free_i32(tcg_ctx, count);
-#endif
+        tcg_gen_ld_i64(tcg_ctx, runs, ttb, offsetof(TranslationBlock, exec_count));
+        tcg_gen_addi_i64(tcg_ctx, runs, runs, 1);
+        tcg_gen_st_i64(tcg_ctx, runs, ttb, offsetof(TranslationBlock, exec_count));
+        tcg_temp_free_i64(tcg_ctx, runs);
+        tcg_temp_free_ptr(tcg_ctx, ttb);
+    }
 }
 
 static inline void gen_tb_end(TCGContext *tcg_ctx, TranslationBlock *tb, int num_insns)
@@ -52,15 +57,13 @@ static inline void gen_tb_end(TCGContext *tcg_ctx, TranslationBlock *tb, int num
     gen_set_label(tcg_ctx, tcg_ctx->exitreq_label);
     tcg_gen_exit_tb(tcg_ctx, (uintptr_t)tb + TB_EXIT_REQUESTED);
 
-#if 0
     if (tb_cflags(tb) & CF_USE_ICOUNT) {
         /* Update the num_insn immediate parameter now that we know
          * the actual insn count.  */
         tcg_set_insn_param(tcg_ctx->icount_start_insn, 1, num_insns);
-        gen_set_label(tcg_ctx, icount_label);
+        gen_set_label(tcg_ctx, tcg_ctx->icount_label);
         tcg_gen_exit_tb(tcg_ctx, (uintptr_t)tb + TB_EXIT_ICOUNT_EXPIRED);
     }
-#endif
 }
 
 #if 0
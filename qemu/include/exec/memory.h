@@ -17,6 +17,7 @@
 #ifndef CONFIG_USER_ONLY
 
 #include "unicorn/platform.h"
+#include "unicorn/unicorn.h"
 #include "exec/cpu-common.h"
 #include "exec/hwaddr.h"
 #include "exec/memattrs.h"
@@ -186,6 +187,9 @@ struct MemoryRegion {
     const char *name;
     struct uc_struct *uc;
     uint32_t perms;   //all perms, partially redundant with readonly
+    uint8_t *page_perms;  //perms of each page once they differ, or NULL
+    uint64_t page_perms_count[UC_PROT_ALL + 1];  //pages with each perms, while page_perms is set
+    uint8_t backing;  //enum uc_mem_backing, how the RAM was allocated
     uint64_t end;
 };
 
@@ -358,6 +362,34 @@ void memory_region_init_ram_nomigrate(struct uc_struct *uc,
                                       uint32_t perms,
                                       Error **errp);
 
+/**
+ * memory_region_init_ram_from_fd:  Initialize RAM memory region with a
+ *                                  mmap-ed backend.
+ *
+ * @mr: the #MemoryRegion to be initialized.
+ * @owner: the object that tracks the region's reference count
+ * @name: the name of the region.
+ * @size: size of the region.
+ * @share: %true if memory must be mmaped with the MAP_SHARED flag
+ * @fd: the fd to mmap, or -1 for demand-zero memory.
+ * @offset: offset of the region in the file of @fd.
+ * @perms: permissions on the region (UC_PROT_READ, UC_PROT_WRITE, UC_PROT_EXEC).
+ * @errp: pointer to Error*, to store an error if it happens.
+ *
+ * Unicorn: the mapping is made with MAP_NORESERVE, host memory is only
+ * taken by the pages touched.
+ */
+void memory_region_init_ram_from_fd(struct uc_struct *uc,
+                                    MemoryRegion *mr,
+                                    struct Object *owner,
+                                    const char *name,
+                                    uint64_t size,
+                                    bool share,
+                                    int fd,
+                                    uint64_t offset,
+                                    uint32_t perms,
+                                    Error **errp);
+
 /**
  * memory_region_init_ram_ptr:  Initialize RAM memory region from a
  *                              user-provided pointer.  Accesses into the
@@ -1271,8 +1303,20 @@ void memory_register_types(struct uc_struct *uc);
 
 MemoryRegion *memory_map(struct uc_struct *uc, hwaddr begin, size_t size, uint32_t perms);
 MemoryRegion *memory_map_ptr(struct uc_struct *uc, hwaddr begin, size_t size, uint32_t perms, void *ptr);
+MemoryRegion *memory_map_fd(struct uc_struct *uc, hwaddr begin, size_t size, uint32_t perms,
+                            int fd, uint64_t offset, bool share);
+MemoryRegion *memory_map_io(struct uc_struct *uc, hwaddr begin, size_t size,
+                            uc_cb_mmio_read_t read_cb, uc_cb_mmio_write_t write_cb,
+                            void *user_data);
 void memory_unmap(struct uc_struct *uc, MemoryRegion *mr);
 int memory_free(struct uc_struct *uc);
+void memory_snapshot_save(struct uc_struct *uc, MemoryRegion *mr,
+                          uint8_t *data);
+size_t memory_snapshot_restore(struct uc_struct *uc, MemoryRegion *mr,
+                               const uint8_t *data, bool full);
+void *memory_host_ptr(struct uc_struct *uc, MemoryRegion *mr, hwaddr offset);
+void memory_host_written(struct uc_struct *uc, MemoryRegion *mr, hwaddr offset,
+                         size_t len);
 
 /* Internal functions, part of the implementation of address_space_read.  */
 MemTxResult flatview_read_continue(FlatView *fv, hwaddr addr,
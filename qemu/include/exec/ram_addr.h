@@ -56,6 +56,9 @@ static inline void *ramblock_ptr(RAMBlock *block, ram_addr_t offset)
 RAMBlock *qemu_ram_alloc_from_ptr(ram_addr_t size, void *host,
                                   MemoryRegion *mr, Error **errp);
 RAMBlock *qemu_ram_alloc(ram_addr_t size, MemoryRegion *mr, Error **errp);
+RAMBlock *qemu_ram_alloc_from_fd(ram_addr_t size, MemoryRegion *mr,
+                                 bool share, int fd, uint64_t offset,
+                                 Error **errp);
 RAMBlock *qemu_ram_alloc_resizeable(ram_addr_t size, ram_addr_t max_size,
                                     void (*resized)(const char*,
                                                     uint64_t length,
@@ -157,6 +160,21 @@ static inline bool cpu_physical_memory_all_dirty(struct uc_struct *uc, ram_addr_
     return dirty;
 }
 
+static inline bool cpu_physical_memory_get_dirty_flag(struct uc_struct *uc, ram_addr_t addr,
+                                                      unsigned client)
+{
+    return cpu_physical_memory_get_dirty(uc, addr, 1, client);
+}
+
+/* Unicorn: writes to a clean page go through notdirty_mem_write(), which
+ * drops the code translated from it and marks it dirty for the snapshots */
+static inline bool cpu_physical_memory_is_clean(struct uc_struct *uc, ram_addr_t addr)
+{
+    bool code = cpu_physical_memory_get_dirty_flag(uc, addr, DIRTY_MEMORY_CODE);
+    bool snapshot = cpu_physical_memory_get_dirty_flag(uc, addr, DIRTY_MEMORY_SNAPSHOT);
+    return !(code && snapshot);
+}
+
 static inline bool cpu_physical_memory_range_includes_clean(struct uc_struct *uc, ram_addr_t start,
                                                             ram_addr_t length, uint8_t mask)
 {
@@ -193,5 +211,56 @@ static inline void cpu_physical_memory_set_dirty_flag(struct uc_struct *uc, ram_
     //rcu_read_unlock();
 }
 
+static inline void cpu_physical_memory_set_dirty_range(struct uc_struct *uc, ram_addr_t start,
+                                                       ram_addr_t length,
+                                                       uint8_t mask)
+{
+    DirtyMemoryBlocks *blocks[DIRTY_MEMORY_NUM];
+    unsigned long end, page;
+    unsigned long idx, offset, base;
+    int i;
+
+    if (!mask) {
+        return;
+    }
+
+    end = TARGET_PAGE_ALIGN(start + length) >> TARGET_PAGE_BITS;
+    page = start >> TARGET_PAGE_BITS;
+
+    // Unicorn: commented out
+    //rcu_read_lock();
+
+    for (i = 0; i < DIRTY_MEMORY_NUM; i++) {
+        // Unicorn: atomic_read used instead of atomic_rcu_read
+        blocks[i] = atomic_read(&uc->ram_list.dirty_memory[i]);
+    }
+
+    idx = page / DIRTY_MEMORY_BLOCK_SIZE;
+    offset = page % DIRTY_MEMORY_BLOCK_SIZE;
+    base = page - offset;
+    while (page < end) {
+        unsigned long next = MIN(end, base + DIRTY_MEMORY_BLOCK_SIZE);
+
+        for (i = 0; i < DIRTY_MEMORY_NUM; i++) {
+            if (mask & (1 << i)) {
+                bitmap_set_atomic(blocks[i]->blocks[idx], offset, next - page);
+            }
+        }
+
+        page = next;
+        idx++;
+        offset = 0;
+        base += DIRTY_MEMORY_BLOCK_SIZE;
+    }
+
+    // Unicorn: commented out
+    //rcu_read_unlock();
+}
+
+bool cpu_physical_memory_test_and_clear_dirty(struct uc_struct *uc,
+                                              ram_addr_t start,
+                                              ram_addr_t length,
+                                              unsigned client);
+
 #endif
 #endif
@@ -5,7 +5,8 @@
 #include "qemu/thread.h"
 
 #define DIRTY_MEMORY_CODE      0
-#define DIRTY_MEMORY_NUM       1        /* num of dirty bits */
+#define DIRTY_MEMORY_SNAPSHOT  1        /* Unicorn: pages written since uc_snapshot_take() */
+#define DIRTY_MEMORY_NUM       2        /* num of dirty bits */
 
 /* The dirty memory bitmap is split into fixed-size blocks to allow growth
  * under RCU.  The bitmap for a block can be accessed as follows:
@@ -23,7 +23,9 @@
 #include "qemu/thread.h"
 #include "qemu/qht.h"
 
-#define CODE_GEN_HTABLE_BITS     15
+// Unicorn: processes may run many engines, so start with a small table,
+// it grows with the number of TBs (QHT_MODE_AUTO_RESIZE)
+#define CODE_GEN_HTABLE_BITS     10
 #define CODE_GEN_HTABLE_SIZE     (1 << CODE_GEN_HTABLE_BITS)
 
 typedef struct TranslationBlock TranslationBlock;
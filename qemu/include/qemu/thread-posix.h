@@ -4,6 +4,16 @@
 #include <pthread.h>
 #include <semaphore.h>
 
+struct QemuMutex {
+    pthread_mutex_t lock;
+};
+#define QEMU_MUTEX_INITIALIZER { PTHREAD_MUTEX_INITIALIZER }
+
+struct QemuCond {
+    pthread_cond_t cond;
+};
+#define QEMU_COND_INITIALIZER { PTHREAD_COND_INITIALIZER }
+
 struct QemuThread {
     pthread_t thread;
 };
@@ -3,6 +3,8 @@
 
 #include "unicorn/platform.h"
 
+typedef struct QemuMutex QemuMutex;
+typedef struct QemuCond QemuCond;
 typedef struct QemuThread QemuThread;
 
 #ifdef _WIN32
@@ -14,6 +16,13 @@ typedef struct QemuThread QemuThread;
 #define QEMU_THREAD_JOINABLE 0
 #define QEMU_THREAD_DETACHED 1
 
+// statically initialized with QEMU_MUTEX_INITIALIZER / QEMU_COND_INITIALIZER
+void qemu_mutex_lock(QemuMutex *mutex);
+void qemu_mutex_unlock(QemuMutex *mutex);
+void qemu_cond_signal(QemuCond *cond);
+// return false if @timeout (in nanoseconds) expired
+bool qemu_cond_timedwait(QemuCond *cond, QemuMutex *mutex, int64_t timeout);
+
 struct uc_struct;
 // return -1 on error, 0 on success
 int qemu_thread_create(struct uc_struct *uc, QemuThread *thread, const char *name,
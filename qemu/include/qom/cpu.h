@@ -194,6 +194,9 @@ struct CPUWatchpoint {
     vaddr len;
     vaddr hitaddr;
     int flags; /* BP_* */
+    // Unicorn: uc_cb_hookmem_t of uc_watchpoint_add()
+    void *callback;
+    void *user_data;
     QTAILQ_ENTRY(CPUWatchpoint) entry;
 };
 
@@ -772,6 +775,9 @@ int cpu_watchpoint_remove(CPUState *cpu, vaddr addr,
                           vaddr len, int flags);
 void cpu_watchpoint_remove_by_ref(CPUState *cpu, CPUWatchpoint *watchpoint);
 void cpu_watchpoint_remove_all(CPUState *cpu, int mask);
+int uc_watchpoint_flags(CPUState *cpu, vaddr addr, vaddr len);
+void uc_watchpoint_check(CPUState *cpu, vaddr addr, vaddr len, int flags,
+                         uint64_t value);
 
 /**
  * cpu_get_address_space:
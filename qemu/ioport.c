@@ -78,12 +78,11 @@ void cpu_outb(struct uc_struct *uc, uint32_t addr, uint8_t val)
 {
     // Unicorn: commented out
     //trace_cpu_out(addr, 'b', val);
-    // Unicorn: call registered OUT callbacks
+    // Unicorn: call the OUT callbacks covering this port
     struct hook *hook;
-    HOOK_FOREACH_VAR_DECLARE;
-    HOOK_FOREACH(uc, hook, UC_HOOK_INSN) {
-        if (hook->insn == UC_X86_INS_OUT)
-            ((uc_cb_insn_out_t)hook->callback)(uc, addr, 1, val, hook->user_data);
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
+    HOOK_FOREACH_PORT(uc, hook, UC_HOOK_PORT_OUT, addr) {
+        ((uc_cb_insn_out_t)hook->callback)(uc, addr, 1, val, hook->user_data);
     }
 }
 
@@ -91,12 +90,11 @@ void cpu_outw(struct uc_struct *uc, uint32_t addr, uint16_t val)
 {
     // Unicorn: commented out
     //trace_cpu_out(addr, 'w', val);
-    // Unicorn: call registered OUT callbacks
+    // Unicorn: call the OUT callbacks covering this port
     struct hook *hook;
-    HOOK_FOREACH_VAR_DECLARE;
-    HOOK_FOREACH(uc, hook, UC_HOOK_INSN) {
-        if (hook->insn == UC_X86_INS_OUT)
-            ((uc_cb_insn_out_t)hook->callback)(uc, addr, 2, val, hook->user_data);
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
+    HOOK_FOREACH_PORT(uc, hook, UC_HOOK_PORT_OUT, addr) {
+        ((uc_cb_insn_out_t)hook->callback)(uc, addr, 2, val, hook->user_data);
     }
 }
 
@@ -104,12 +102,11 @@ void cpu_outl(struct uc_struct *uc, uint32_t addr, uint32_t val)
 {
     // Unicorn: commented out
     //trace_cpu_out(addr, 'l', val);
-    // Unicorn: call registered OUT callbacks
+    // Unicorn: call the OUT callbacks covering this port
     struct hook *hook;
-    HOOK_FOREACH_VAR_DECLARE;
-    HOOK_FOREACH(uc, hook, UC_HOOK_INSN) {
-        if (hook->insn == UC_X86_INS_OUT)
-            ((uc_cb_insn_out_t)hook->callback)(uc, addr, 4, val, hook->user_data);
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
+    HOOK_FOREACH_PORT(uc, hook, UC_HOOK_PORT_OUT, addr) {
+        ((uc_cb_insn_out_t)hook->callback)(uc, addr, 4, val, hook->user_data);
     }
 }
 
@@ -117,12 +114,11 @@ uint8_t cpu_inb(struct uc_struct *uc, uint32_t addr)
 {
     // Unicorn: commented out
     //trace_cpu_in(addr, 'b', val);
-    // Unicorn: call registered IN callbacks
+    // Unicorn: the first IN callback covering this port provides the value
     struct hook *hook;
-    HOOK_FOREACH_VAR_DECLARE;
-    HOOK_FOREACH(uc, hook, UC_HOOK_INSN) {
-        if (hook->insn == UC_X86_INS_IN)
-            return ((uc_cb_insn_in_t)hook->callback)(uc, addr, 1, hook->user_data);
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
+    HOOK_FOREACH_PORT(uc, hook, UC_HOOK_PORT_IN, addr) {
+        return ((uc_cb_insn_in_t)hook->callback)(uc, addr, 1, hook->user_data);
     }
 
     return 0;
@@ -132,12 +128,11 @@ uint16_t cpu_inw(struct uc_struct *uc, uint32_t addr)
 {
     // Unicorn: commented out
     //trace_cpu_in(addr, 'w', val);
-    // Unicorn: call registered IN callbacks
+    // Unicorn: the first IN callback covering this port provides the value
     struct hook *hook;
-    HOOK_FOREACH_VAR_DECLARE;
-    HOOK_FOREACH(uc, hook, UC_HOOK_INSN) {
-        if (hook->insn == UC_X86_INS_IN)
-            return ((uc_cb_insn_in_t)hook->callback)(uc, addr, 2, hook->user_data);
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
+    HOOK_FOREACH_PORT(uc, hook, UC_HOOK_PORT_IN, addr) {
+        return ((uc_cb_insn_in_t)hook->callback)(uc, addr, 2, hook->user_data);
     }
 
     return 0;
@@ -147,12 +142,11 @@ uint32_t cpu_inl(struct uc_struct *uc, uint32_t addr)
 {
     // Unicorn: commented out
     //trace_cpu_in(addr, 'l', val);
-    // Unicorn: call registered IN callbacks
+    // Unicorn: the first IN callback covering this port provides the value
     struct hook *hook;
-    HOOK_FOREACH_VAR_DECLARE;
-    HOOK_FOREACH(uc, hook, UC_HOOK_INSN) {
-        if (hook->insn == UC_X86_INS_IN)
-            return ((uc_cb_insn_in_t)hook->callback)(uc, addr, 4, hook->user_data);
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
+    HOOK_FOREACH_PORT(uc, hook, UC_HOOK_PORT_IN, addr) {
+        return ((uc_cb_insn_in_t)hook->callback)(uc, addr, 4, hook->user_data);
     }
 
     return 0;
@@ -0,0 +1,6 @@
+/* Automatically generated by create_config - do not modify */
+#define TARGET_M68K 1
+#define TARGET_NAME "m68k"
+#define TARGET_M68K 1
+#define TARGET_WORDS_BIGENDIAN 1
+#define CONFIG_SOFTMMU 1
@@ -46,6 +46,7 @@ MemoryRegion *memory_map(struct uc_struct *uc, hwaddr begin, size_t size, uint32
         // out of memory
         return NULL;
     }
+    ram->backing = UC_MEM_BACKING_ANON;
 
     memory_region_add_subregion(get_system_memory(uc), begin, ram);
 
@@ -65,6 +66,7 @@ MemoryRegion *memory_map_ptr(struct uc_struct *uc, hwaddr begin, size_t size, ui
         // out of memory
         return NULL;
     }
+    ram->backing = UC_MEM_BACKING_PTR;
 
     memory_region_add_subregion(get_system_memory(uc), begin, ram);
 
@@ -74,11 +76,110 @@ MemoryRegion *memory_map_ptr(struct uc_struct *uc, hwaddr begin, size_t size, ui
     return ram;
 }
 
+MemoryRegion *memory_map_fd(struct uc_struct *uc, hwaddr begin, size_t size, uint32_t perms,
+                            int fd, uint64_t offset, bool share)
+{
+    MemoryRegion *ram = g_new(MemoryRegion, 1);
+
+    memory_region_init_ram_from_fd(uc, ram, NULL, "pc.ram", size, share, fd, offset,
+                                   perms, NULL);
+    if (ram->ram_block == NULL) {
+        // bad file, or out of address space: drop the region again
+        Object *obj = OBJECT(ram);
+        obj->ref = 1;
+        obj->free = g_free;
+        g_free((char *)ram->name);
+        ram->name = NULL;
+        object_property_del_child(uc, qdev_get_machine(uc), obj, &error_abort);
+        return NULL;
+    }
+    if (fd >= 0)
+        ram->backing = UC_MEM_BACKING_FILE;
+    else
+        ram->backing = share ? UC_MEM_BACKING_ZERO_SHARED : UC_MEM_BACKING_ZERO;
+
+    memory_region_add_subregion(get_system_memory(uc), begin, ram);
+
+    if (uc->current_cpu)
+        tlb_flush(uc->current_cpu);
+
+    return ram;
+}
+
+static uint64_t mmio_read(struct uc_struct *uc, void *opaque, hwaddr addr, unsigned size)
+{
+    struct uc_mmio *mmio = opaque;
+
+    if (mmio->read == NULL) {
+        return 0;
+    }
+
+    return mmio->read(uc, addr, size, mmio->user_data);
+}
+
+static void mmio_write(struct uc_struct *uc, void *opaque, hwaddr addr, uint64_t data,
+                       unsigned size)
+{
+    struct uc_mmio *mmio = opaque;
+
+    if (mmio->write != NULL) {
+        mmio->write(uc, addr, size, data, mmio->user_data);
+    }
+}
+
+static const MemoryRegionOps mmio_ops = {
+    .read = mmio_read,
+    .write = mmio_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid = {
+        .min_access_size = 1,
+        .max_access_size = 8,
+        .unaligned = true,
+    },
+    .impl = {
+        .min_access_size = 1,
+        .max_access_size = 8,
+    },
+};
+
+static void memory_region_destructor_mmio(MemoryRegion *mr)
+{
+    // like memory_region_destructor_ram(), this runs twice on unmap
+    g_free(mr->opaque);
+    mr->opaque = NULL;
+}
+
+/* Unicorn: a region of uc_mmio_map(), whose accesses all go to the callbacks.
+ * Its perms follow the callbacks it has.
+ */
+MemoryRegion *memory_map_io(struct uc_struct *uc, hwaddr begin, size_t size,
+                            uc_cb_mmio_read_t read_cb, uc_cb_mmio_write_t write_cb,
+                            void *user_data)
+{
+    MemoryRegion *mmio = g_new(MemoryRegion, 1);
+    struct uc_mmio *ops = g_new(struct uc_mmio, 1);
+
+    ops->read = read_cb;
+    ops->write = write_cb;
+    ops->user_data = user_data;
+
+    memory_region_init_io(uc, mmio, NULL, &mmio_ops, ops, "mmio", size);
+    mmio->destructor = memory_region_destructor_mmio;
+    mmio->perms = (read_cb ? UC_PROT_READ : 0) | (write_cb ? UC_PROT_WRITE : 0);
+
+    memory_region_add_subregion(get_system_memory(uc), begin, mmio);
+
+    if (uc->current_cpu)
+        tlb_flush(uc->current_cpu);
+
+    return mmio;
+}
+
 static void memory_region_update_container_subregions(MemoryRegion *subregion);
 
 void memory_unmap(struct uc_struct *uc, MemoryRegion *mr)
 {
-    int i;
+    uint32_t i;
     target_ulong addr;
     Object *obj;
 
@@ -91,20 +192,20 @@ void memory_unmap(struct uc_struct *uc, MemoryRegion *mr)
     }
     memory_region_del_subregion(get_system_memory(uc), mr);
 
-    for (i = 0; i < uc->mapped_block_count; i++) {
-        if (uc->mapped_blocks[i] == mr) {
-            uc->mapped_block_count--;
-            //shift remainder of array down over deleted pointer
-            memmove(&uc->mapped_blocks[i], &uc->mapped_blocks[i + 1], sizeof(MemoryRegion*) * (uc->mapped_block_count - i));
-            mr->destructor(mr);
-            obj = OBJECT(mr);
-            obj->ref = 1;
-            obj->free = g_free;
-            g_free((char *)mr->name);
-            mr->name = NULL;
-            object_property_del_child(mr->uc, qdev_get_machine(mr->uc), obj, &error_abort);
-            break;
-        }
+    i = mapped_block_bsearch(uc, mr->addr);
+    if (i < uc->mapped_block_count && uc->mapped_blocks[i] == mr) {
+        uc->mapped_block_count--;
+        //shift remainder of array down over deleted pointer
+        memmove(&uc->mapped_blocks[i], &uc->mapped_blocks[i + 1], sizeof(MemoryRegion*) * (uc->mapped_block_count - i));
+        mr->destructor(mr);
+        g_free(mr->page_perms);
+        mr->page_perms = NULL;
+        obj = OBJECT(mr);
+        obj->ref = 1;
+        obj->free = g_free;
+        g_free((char *)mr->name);
+        mr->name = NULL;
+        object_property_del_child(mr->uc, qdev_get_machine(mr->uc), obj, &error_abort);
     }
 }
 
@@ -119,12 +220,27 @@ int memory_free(struct uc_struct *uc)
         mr->enabled = false;
         memory_region_del_subregion(get_system_memory(uc), mr);
         mr->destructor(mr);
+        g_free(mr->page_perms);
+        mr->page_perms = NULL;
         obj = OBJECT(mr);
         obj->ref = 1;
         obj->free = g_free;
         object_property_del_child(mr->uc, qdev_get_machine(mr->uc), obj, &error_abort);
     }
 
+    for (i = 0; i < DIRTY_MEMORY_NUM; i++) {
+        DirtyMemoryBlocks *blocks = uc->ram_list.dirty_memory[i];
+        size_t j;
+
+        if (blocks) {
+            for (j = 0; j < blocks->num_blocks; j++) {
+                g_free(blocks->blocks[j]);
+            }
+            g_free(blocks);
+            uc->ram_list.dirty_memory[i] = NULL;
+        }
+    }
+
     return 0;
 }
 
@@ -609,6 +725,27 @@ static AddressSpace *memory_region_to_address_space(MemoryRegion *mr)
     return NULL;
 }
 
+/* Unicorn: index of the first range of @view that ends after @addr.  Every
+ * mapping is a subregion of the same root, so the view can hold thousands
+ * of ranges and walking them all for each of them is quadratic.
+ */
+static unsigned flatview_find_range(FlatView *view, Int128 addr)
+{
+    unsigned lo = 0, hi = view->nr;
+
+    while (lo < hi) {
+        unsigned mid = lo + (hi - lo) / 2;
+
+        if (int128_ge(addr, addrrange_end(view->ranges[mid].addr))) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
 /* Render a memory region into the global view.  Ranges in @view obscure
  * ranges in @mr.
  */
@@ -666,7 +803,7 @@ static void render_memory_region(FlatView *view,
     fr.readonly = readonly;
 
     /* Render the region itself into any gaps left by the current view. */
-    for (i = 0; i < view->nr && int128_nz(remain); ++i) {
+    for (i = flatview_find_range(view, base); i < view->nr && int128_nz(remain); ++i) {
         if (int128_ge(base, addrrange_end(view->ranges[i].addr))) {
             continue;
         }
@@ -977,6 +1114,9 @@ static void memory_region_destructor_none(MemoryRegion *mr)
 static void memory_region_destructor_ram(MemoryRegion *mr)
 {
     qemu_ram_free(mr->uc, memory_region_get_ram_addr(mr));
+    // Unicorn: memory_unmap() runs the destructor before finalize does it
+    // again, so do not leave the freed block behind to look its offset up
+    mr->ram_block = NULL;
 }
 
 static bool memory_region_need_escape(char c)
@@ -1392,6 +1532,29 @@ void memory_region_init_ram_nomigrate(struct uc_struct *uc,
     mr->dirty_log_mask = tcg_enabled(uc) ? (1 << DIRTY_MEMORY_CODE) : 0;
 }
 
+void memory_region_init_ram_from_fd(struct uc_struct *uc,
+                                    MemoryRegion *mr,
+                                    Object *owner,
+                                    const char *name,
+                                    uint64_t size,
+                                    bool share,
+                                    int fd,
+                                    uint64_t offset,
+                                    uint32_t perms,
+                                    Error **errp)
+{
+    memory_region_init(uc, mr, owner, name, size);
+    mr->ram = true;
+    if (!(perms & UC_PROT_WRITE)) {
+        mr->readonly = true;
+    }
+    mr->perms = perms;
+    mr->terminates = true;
+    mr->destructor = memory_region_destructor_ram;
+    mr->ram_block = qemu_ram_alloc_from_fd(size, mr, share, fd, offset, errp);
+    mr->dirty_log_mask = tcg_enabled(uc) ? (1 << DIRTY_MEMORY_CODE) : 0;
+}
+
 void memory_region_init_ram_ptr(struct uc_struct *uc, MemoryRegion *mr,
                                 Object *owner,
                                 const char *name,
@@ -1660,7 +1823,8 @@ static void memory_region_add_subregion_common(MemoryRegion *mr,
     assert(!subregion->container);
     subregion->container = mr;
     subregion->addr = offset;
-    subregion->end = offset + int128_get64(subregion->size);
+    // Unicorn: a region spanning the whole address space (2^64) wraps around
+    subregion->end = offset + int128_getlo(subregion->size);
     memory_region_update_container_subregions(subregion);
 }
 
@@ -390,6 +390,11 @@ void glue(address_space_stl_notdirty, SUFFIX)(ARG1_DECL,
     } else {
         ptr = MAP_RAM(mr, addr1);
         stl_p(ptr, val);
+
+        // Unicorn: code is left alone, but snapshots still see the write
+        cpu_physical_memory_set_dirty_range(mr->uc,
+                                            memory_region_get_ram_addr(mr) + addr1,
+                                            4, 1 << DIRTY_MEMORY_SNAPSHOT);
         r = MEMTX_OK;
     }
     if (result) {
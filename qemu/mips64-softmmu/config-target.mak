@@ -0,0 +1,10 @@
+# Automatically generated by configure - do not modify
+TARGET_ABI_MIPSN64=y
+TARGET_MIPS64=y
+TARGET_NAME=mips64
+TARGET_BASE_ARCH=mips
+TARGET_WORDS_BIGENDIAN=y
+CONFIG_SOFTMMU=y
+LDFLAGS+=
+QEMU_CFLAGS+=
+QEMU_CFLAGS+=-include mips64.h
@@ -0,0 +1,9 @@
+# Automatically generated by configure - do not modify
+TARGET_ABI_MIPSO32=y
+TARGET_MIPS=y
+TARGET_NAME=mipsel
+TARGET_BASE_ARCH=mips
+CONFIG_SOFTMMU=y
+LDFLAGS+=
+QEMU_CFLAGS+=
+QEMU_CFLAGS+=-include mipsel.h
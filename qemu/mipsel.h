@@ -315,6 +315,7 @@
 #define cpu_physical_memory_range_includes_clean cpu_physical_memory_range_includes_clean_mipsel
 #define cpu_physical_memory_reset_dirty cpu_physical_memory_reset_dirty_mipsel
 #define cpu_physical_memory_rw cpu_physical_memory_rw_mipsel
+#define cpu_physical_memory_test_and_clear_dirty cpu_physical_memory_test_and_clear_dirty_mipsel
 #define cpu_physical_memory_unmap cpu_physical_memory_unmap_mipsel
 #define cpu_physical_memory_write_rom cpu_physical_memory_write_rom_mipsel
 #define cpu_physical_memory_write_rom_internal cpu_physical_memory_write_rom_internal_mipsel
@@ -1757,7 +1758,9 @@
 #define memory_listener_register memory_listener_register_mipsel
 #define memory_listener_unregister memory_listener_unregister_mipsel
 #define memory_map memory_map_mipsel
+#define memory_map_fd memory_map_fd_mipsel
 #define memory_map_init memory_map_init_mipsel
+#define memory_map_io memory_map_io_mipsel
 #define memory_map_ptr memory_map_ptr_mipsel
 #define memory_mapping_filter memory_mapping_filter_mipsel
 #define memory_mapping_list_add_mapping_sorted memory_mapping_list_add_mapping_sorted_mipsel
@@ -1799,6 +1802,7 @@
 #define memory_region_init_io memory_region_init_io_mipsel
 #define memory_region_init_ram_device_ptr memory_region_init_ram_device_ptr_mipsel
 #define memory_region_init_ram_nomigrate memory_region_init_ram_nomigrate_mipsel
+#define memory_region_init_ram_from_fd memory_region_init_ram_from_fd_mipsel
 #define memory_region_init_ram_ptr memory_region_init_ram_ptr_mipsel
 #define memory_region_init_reservation memory_region_init_reservation_mipsel
 #define memory_region_init_resizeable_ram memory_region_init_resizeable_ram_mipsel
@@ -1833,6 +1837,10 @@
 #define memory_region_write_accessor memory_region_write_accessor_mipsel
 #define memory_region_wrong_endianness memory_region_wrong_endianness_mipsel
 #define memory_register_types memory_register_types_mipsel
+#define memory_host_ptr memory_host_ptr_mipsel
+#define memory_host_written memory_host_written_mipsel
+#define memory_snapshot_restore memory_snapshot_restore_mipsel
+#define memory_snapshot_save memory_snapshot_save_mipsel
 #define memory_try_enable_merging memory_try_enable_merging_mipsel
 #define memory_unmap memory_unmap_mipsel
 #define module_call_init module_call_init_mipsel
@@ -2152,6 +2160,7 @@
 #define qemu_ram_addr_from_host qemu_ram_addr_from_host_mipsel
 #define qemu_ram_addr_from_host_nofail qemu_ram_addr_from_host_nofail_mipsel
 #define qemu_ram_alloc qemu_ram_alloc_mipsel
+#define qemu_ram_alloc_from_fd qemu_ram_alloc_from_fd_mipsel
 #define qemu_ram_alloc_from_ptr qemu_ram_alloc_from_ptr_mipsel
 #define qemu_ram_alloc_resizeable qemu_ram_alloc_resizeable_mipsel
 #define qemu_ram_block_by_name qemu_ram_block_by_name_mipsel
@@ -2438,6 +2447,8 @@
 #define tb_find_pc tb_find_pc_mipsel
 #define tb_find_slow tb_find_slow_mipsel
 #define tb_flush tb_flush_mipsel
+#define tb_stats_query tb_stats_query_mipsel
+#define tb_profile_top tb_profile_top_mipsel
 #define tb_flush_jmp_cache tb_flush_jmp_cache_mipsel
 #define tb_gen_code tb_gen_code_mipsel
 #define tb_hash_remove tb_hash_remove_mipsel
@@ -2931,11 +2942,13 @@
 #define tlb_flush_page tlb_flush_page_mipsel
 #define tlb_flush_page_by_mmuidx tlb_flush_page_by_mmuidx_mipsel
 #define tlb_is_dirty_ram tlb_is_dirty_ram_mipsel
+#define tlb_protect_code tlb_protect_code_mipsel
 #define tlb_reset_dirty tlb_reset_dirty_mipsel
 #define tlb_reset_dirty_range tlb_reset_dirty_range_mipsel
 #define tlb_set_dirty tlb_set_dirty_mipsel
 #define tlb_set_page tlb_set_page_mipsel
 #define tlb_set_page_with_attrs tlb_set_page_with_attrs_mipsel
+#define tlb_unprotect_code tlb_unprotect_code_mipsel
 #define tlb_vaddr_to_host tlb_vaddr_to_host_mipsel
 #define tlbi_aa64_asid_is_write tlbi_aa64_asid_is_write_mipsel
 #define tlbi_aa64_asid_write tlbi_aa64_asid_write_mipsel
@@ -2978,6 +2991,12 @@
 #define type_table_add type_table_add_mipsel
 #define type_table_get type_table_get_mipsel
 #define type_table_lookup type_table_lookup_mipsel
+#define uc_invalidate_tb uc_invalidate_tb_mipsel
+#define uc_invalidate_tb_pc uc_invalidate_tb_pc_mipsel
+#define uc_tb_insn_pc uc_tb_insn_pc_mipsel
+#define uc_tlb_flush uc_tlb_flush_mipsel
+#define uc_watchpoint_check uc_watchpoint_check_mipsel
+#define uc_watchpoint_flags uc_watchpoint_flags_mipsel
 #define uint16_to_float16 uint16_to_float16_mipsel
 #define uint16_to_float32 uint16_to_float32_mipsel
 #define uint16_to_float64 uint16_to_float64_mipsel
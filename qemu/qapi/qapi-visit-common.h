@@ -0,0 +1,21 @@
+/* AUTOMATICALLY GENERATED, DO NOT MODIFY */
+
+/*
+ * Schema-defined QAPI visitors
+ *
+ * Copyright IBM, Corp. 2011
+ * Copyright (C) 2014-2018 Red Hat, Inc.
+ *
+ * This work is licensed under the terms of the GNU LGPL, version 2.1 or later.
+ * See the COPYING.LIB file in the top-level directory.
+ */
+
+#ifndef QAPI_VISIT_COMMON_H
+#define QAPI_VISIT_COMMON_H
+
+#include "qapi/qapi-builtin-visit.h"
+#include "qapi-types-common.h"
+
+void visit_type_QapiErrorClass(Visitor *v, const char *name, QapiErrorClass *obj, Error **errp);
+
+#endif /* QAPI_VISIT_COMMON_H */
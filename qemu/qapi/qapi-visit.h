@@ -0,0 +1,22 @@
+/* AUTOMATICALLY GENERATED, DO NOT MODIFY */
+
+/*
+ * Schema-defined QAPI visitors
+ *
+ * Copyright IBM, Corp. 2011
+ * Copyright (C) 2014-2018 Red Hat, Inc.
+ *
+ * This work is licensed under the terms of the GNU LGPL, version 2.1 or later.
+ * See the COPYING.LIB file in the top-level directory.
+ */
+
+#ifndef QAPI_VISIT_H
+#define QAPI_VISIT_H
+
+#include "qapi/qapi-builtin-visit.h"
+#include "qapi-types.h"
+
+#include "qapi-visit-common.h"
+#include "qapi-visit-misc.h"
+
+#endif /* QAPI_VISIT_H */
@@ -11650,13 +11650,6 @@ static void disas_thumb_insn(DisasContext *s, uint32_t insn)
     TCGv_i32 tmp2;
     TCGv_i32 addr;
 
-    // Unicorn: end address tells us to stop emulation
-    if (s->pc == s->uc->addr_end) {
-        // imitate WFI instruction to halt emulation
-        s->base.is_jmp = DISAS_WFI;
-        return;
-    }
-
     // Unicorn: trace this instruction on request
     if (HOOK_EXISTS_BOUNDED(uc, UC_HOOK_CODE, s->pc)) {
         // determine instruction size (Thumb/Thumb2)
@@ -12699,6 +12692,14 @@ static void arm_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
     CPUARMState *env = cpu->env_ptr;
     unsigned int insn;
 
+    // Unicorn: end address tells us to stop emulation
+    if (dc->pc == dc->uc->addr_end) {
+        // imitate WFI instruction to halt emulation
+        gen_set_pc_im(dc, dc->pc);
+        dc->base.is_jmp = DISAS_WFI;
+        return;
+    }
+
     if (arm_pre_translate_insn(dc)) {
         return;
     }
@@ -12768,6 +12769,14 @@ static void thumb_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
     uint32_t insn;
     bool is_16bit;
 
+    // Unicorn: end address tells us to stop emulation
+    if (dc->pc == dc->uc->addr_end) {
+        // imitate WFI instruction to halt emulation
+        gen_set_pc_im(dc, dc->pc);
+        dc->base.is_jmp = DISAS_WFI;
+        return;
+    }
+
     if (arm_pre_translate_insn(dc)) {
         return;
     }
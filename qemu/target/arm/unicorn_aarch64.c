@@ -185,8 +185,7 @@ int arm64_reg_write(struct uc_struct *uc, unsigned int *regs, void* const* vals,
                 case UC_ARM64_REG_PC:
                     state->pc = *(uint64_t *)value;
                     // force to quit execution and flush TB
-                    uc->quit_request = true;
-                    uc_emu_stop(uc);
+                    uc_emu_quit_tb(uc);
                     break;
                 case UC_ARM64_REG_SP:
                     state->xregs[31] = *(uint64_t *)value;
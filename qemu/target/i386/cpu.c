@@ -2705,12 +2705,15 @@ typedef struct PropValue {
     const char *prop, *value;
 } PropValue;
 
+// Unicorn: applied by hand in x86_cpu_load_def()
+#if 0
 /* TCG-specific defaults that override all CPU models when using TCG
  */
 static PropValue tcg_default_props[] = {
     { "vme", "off" },
     { NULL, NULL },
 };
+#endif
 
 static uint32_t x86_cpu_get_supported_feature_word(struct uc_struct *uc,
                                                    FeatureWord w, bool migratable);
@@ -3111,6 +3114,8 @@ static void x86_cpu_report_filtered_features(X86CPU *cpu)
     }
 }
 
+// Unicorn: commented out, the feature bits are not registered as properties
+#if 0
 static void x86_cpu_apply_props(X86CPU *cpu, PropValue *props)
 {
     CPUX86State *env = &cpu->env;
@@ -3123,6 +3128,7 @@ static void x86_cpu_apply_props(X86CPU *cpu, PropValue *props)
                               &error_abort);
     }
 }
+#endif
 
 /* Load data from X86CPUDefinition
  */
@@ -3132,19 +3138,21 @@ static void x86_cpu_load_def(X86CPU *cpu, X86CPUDefinition *def, Error **errp)
     const char *vendor;
     FeatureWord w;
 
-    object_property_set_int(env->uc, OBJECT(cpu), def->level, "level", errp);
+    // Unicorn: "level" and "xlevel" are qdev properties, which are not registered
+    env->cpuid_level = def->level;
     object_property_set_int(env->uc, OBJECT(cpu), def->family, "family", errp);
     object_property_set_int(env->uc, OBJECT(cpu), def->model, "model", errp);
     object_property_set_int(env->uc, OBJECT(cpu), def->stepping, "stepping", errp);
-    object_property_set_int(env->uc, OBJECT(cpu), def->xlevel, "xlevel", errp);
+    env->cpuid_xlevel = def->xlevel;
     cpu->cache_info_passthrough = def->cache_info_passthrough;
     object_property_set_str(env->uc, OBJECT(cpu), def->model_id, "model-id", errp);
     for (w = 0; w < FEATURE_WORDS; w++) {
         env->features[w] = def->features[w];
     }
 
+    // Unicorn: tcg_default_props, the feature bits are not properties
     if (tcg_enabled(env->uc)) {
-        x86_cpu_apply_props(cpu, tcg_default_props);
+        env->features[FEAT_1_EDX] &= ~CPUID_VME;
     }
 
     env->features[FEAT_1_ECX] |= CPUID_EXT_HYPERVISOR;
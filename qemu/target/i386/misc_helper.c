@@ -31,8 +31,8 @@ void helper_outb(CPUX86State *env, uint32_t port, uint32_t data)
 #ifdef CONFIG_USER_ONLY
     fprintf(stderr, "outb: port=0x%04x, data=%02x\n", port, data);
 #else
-    address_space_stb(&env->uc->as, port, data,
-                      cpu_get_mem_attrs(env), NULL);
+    // Unicorn: ports are served by the IN & OUT hooks
+    cpu_outb(env->uc, port, data);
 #endif
 }
 
@@ -42,8 +42,8 @@ target_ulong helper_inb(CPUX86State *env, uint32_t port)
     fprintf(stderr, "inb: port=0x%04x\n", port);
     return 0;
 #else
-    return address_space_ldub(&env->uc->as, port,
-                              cpu_get_mem_attrs(env), NULL);
+    // Unicorn: ports are served by the IN & OUT hooks
+    return cpu_inb(env->uc, port);
 #endif
 }
 
@@ -52,8 +52,8 @@ void helper_outw(CPUX86State *env, uint32_t port, uint32_t data)
 #ifdef CONFIG_USER_ONLY
     fprintf(stderr, "outw: port=0x%04x, data=%04x\n", port, data);
 #else
-    address_space_stw(&env->uc->as, port, data,
-                      cpu_get_mem_attrs(env), NULL);
+    // Unicorn: ports are served by the IN & OUT hooks
+    cpu_outw(env->uc, port, data);
 #endif
 }
 
@@ -63,8 +63,8 @@ target_ulong helper_inw(CPUX86State *env, uint32_t port)
     fprintf(stderr, "inw: port=0x%04x\n", port);
     return 0;
 #else
-    return address_space_lduw(&env->uc->as, port,
-                              cpu_get_mem_attrs(env), NULL);
+    // Unicorn: ports are served by the IN & OUT hooks
+    return cpu_inw(env->uc, port);
 #endif
 }
 
@@ -73,8 +73,8 @@ void helper_outl(CPUX86State *env, uint32_t port, uint32_t data)
 #ifdef CONFIG_USER_ONLY
     fprintf(stderr, "outw: port=0x%04x, data=%08x\n", port, data);
 #else
-    address_space_stl(&env->uc->as, port, data,
-                      cpu_get_mem_attrs(env), NULL);
+    // Unicorn: ports are served by the IN & OUT hooks
+    cpu_outl(env->uc, port, data);
 #endif
 }
 
@@ -84,8 +84,8 @@ target_ulong helper_inl(CPUX86State *env, uint32_t port)
     fprintf(stderr, "inl: port=0x%04x\n", port);
     return 0;
 #else
-    return address_space_ldl(&env->uc->as, port,
-                             cpu_get_mem_attrs(env), NULL);
+    // Unicorn: ports are served by the IN & OUT hooks
+    return cpu_inl(env->uc, port);
 #endif
 }
 
@@ -964,10 +964,8 @@ void helper_syscall(CPUX86State *env, int next_eip_addend)
 {
     // Unicorn: call registered syscall hooks
     struct hook *hook;
-    HOOK_FOREACH_VAR_DECLARE;
-    HOOK_FOREACH(env->uc, hook, UC_HOOK_INSN) {
-        if (!HOOK_BOUND_CHECK(hook, env->eip))
-            continue;
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
+    HOOK_FOREACH_BOUNDED(env->uc, hook, UC_HOOK_INSN, env->eip) {
         if (hook->insn == UC_X86_INS_SYSCALL)
             ((uc_cb_insn_syscall_t)hook->callback)(env->uc, hook->user_data);
     }
@@ -2268,10 +2266,8 @@ void helper_sysenter(CPUX86State *env, int next_eip_addend)
 {
     // Unicorn: call registered SYSENTER hooks
     struct hook *hook;
-    HOOK_FOREACH_VAR_DECLARE;
-    HOOK_FOREACH(env->uc, hook, UC_HOOK_INSN) {
-        if (!HOOK_BOUND_CHECK(hook, env->eip))
-            continue;
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
+    HOOK_FOREACH_BOUNDED(env->uc, hook, UC_HOOK_INSN, env->eip) {
         if (hook->insn == UC_X86_INS_SYSENTER)
             ((uc_cb_insn_syscall_t)hook->callback)(env->uc, hook->user_data);
     }
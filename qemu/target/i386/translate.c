@@ -93,7 +93,6 @@ typedef struct DisasContext {
     int vex_v;  /* vex vvvv register, without 1's compliment.  */
     int ss32;   /* 32 bit stack segment */
     CCOp cc_op;  /* current CC operation */
-    CCOp last_cc_op;  /* Unicorn: last CC operation. Save this to see if cc_op has changed */
     bool cc_op_dirty;
     int addseg; /* non zero if either DS/ES/SS have a non zero base */
     int f_st;   /* currently unused */
@@ -490,15 +489,11 @@ static inline void gen_op_add_reg_T0(TCGContext *s, TCGMemOp size, int reg)
 
 static inline void gen_op_ld_v(DisasContext *s, int idx, TCGv t0, TCGv a0)
 {
-    if (HOOK_EXISTS(s->uc, UC_HOOK_MEM_READ))
-        gen_jmp_im(s, s->prev_pc); // Unicorn: sync EIP
     tcg_gen_qemu_ld_tl(s->uc, t0, a0, s->mem_index, idx | MO_LE);
 }
 
 static inline void gen_op_st_v(DisasContext *s, int idx, TCGv t0, TCGv a0)
 {
-    if (HOOK_EXISTS(s->uc, UC_HOOK_MEM_WRITE))
-        gen_jmp_im(s, s->prev_pc); // Unicorn: sync EIP
     tcg_gen_qemu_st_tl(s->uc, t0, a0, s->mem_index, idx | MO_LE);
 }
 
@@ -764,7 +759,7 @@ static inline void gen_movs(DisasContext *s, TCGMemOp ot)
 
 static void gen_op_update1_cc(TCGContext *s)
 {
-    TCGv cpu_cc_dst = *(TCGv *)s->cpu_cc_dst;
+    TCGv cpu_cc_dst = s->cpu_cc_dst;
     TCGv cpu_T0 = s->cpu_T0;
 
     tcg_gen_mov_tl(s, cpu_cc_dst, cpu_T0);
@@ -772,8 +767,8 @@ static void gen_op_update1_cc(TCGContext *s)
 
 static void gen_op_update2_cc(TCGContext *s)
 {
-    TCGv cpu_cc_dst = *(TCGv *)s->cpu_cc_dst;
-    TCGv cpu_cc_src = *(TCGv *)s->cpu_cc_src;
+    TCGv cpu_cc_dst = s->cpu_cc_dst;
+    TCGv cpu_cc_src = s->cpu_cc_src;
     TCGv cpu_T0 = s->cpu_T0;
     TCGv cpu_T1 = s->cpu_T1;
 
@@ -783,9 +778,9 @@ static void gen_op_update2_cc(TCGContext *s)
 
 static void gen_op_update3_cc(TCGContext *s, TCGv reg)
 {
-    TCGv cpu_cc_dst = *(TCGv *)s->cpu_cc_dst;
-    TCGv cpu_cc_src = *(TCGv *)s->cpu_cc_src;
-    TCGv cpu_cc_src2 = *(TCGv *)s->cpu_cc_src2;
+    TCGv cpu_cc_dst = s->cpu_cc_dst;
+    TCGv cpu_cc_src = s->cpu_cc_src;
+    TCGv cpu_cc_src2 = s->cpu_cc_src2;
     TCGv cpu_T0 = s->cpu_T0;
     TCGv cpu_T1 = s->cpu_T1;
 
@@ -796,7 +791,7 @@ static void gen_op_update3_cc(TCGContext *s, TCGv reg)
 
 static inline void gen_op_testl_T0_T1_cc(TCGContext *s)
 {
-    TCGv cpu_cc_dst = *(TCGv *)s->cpu_cc_dst;
+    TCGv cpu_cc_dst = s->cpu_cc_dst;
     TCGv cpu_T0 = s->cpu_T0;
     TCGv cpu_T1 = s->cpu_T1;
 
@@ -805,9 +800,9 @@ static inline void gen_op_testl_T0_T1_cc(TCGContext *s)
 
 static void gen_op_update_neg_cc(TCGContext *s)
 {
-    TCGv cpu_cc_dst = *(TCGv *)s->cpu_cc_dst;
-    TCGv cpu_cc_src = *(TCGv *)s->cpu_cc_src;
-    TCGv cpu_cc_srcT = *(TCGv *)s->cpu_cc_srcT;
+    TCGv cpu_cc_dst = s->cpu_cc_dst;
+    TCGv cpu_cc_src = s->cpu_cc_src;
+    TCGv cpu_cc_srcT = s->cpu_cc_srcT;
     TCGv cpu_T0 = s->cpu_T0;
 
     tcg_gen_mov_tl(s, cpu_cc_dst, cpu_T0);
@@ -1469,6 +1464,7 @@ static void gen_op(DisasContext *s, int op, TCGMemOp ot, int d)
     }
     switch(op) {
     case OP_ADCL:
+        gen_compute_eflags_c(s, cpu_tmp4);
         if (s->prefix & PREFIX_LOCK) {
             tcg_gen_add_tl(tcg_ctx, cpu_T0, cpu_tmp4, cpu_T1);
             tcg_gen_atomic_add_fetch_tl(tcg_ctx, cpu_T0, cpu_A0, cpu_T0,
@@ -1482,6 +1478,7 @@ static void gen_op(DisasContext *s, int op, TCGMemOp ot, int d)
         set_cc_op(s, CC_OP_ADCB + ot);
         break;
     case OP_SBBL:
+        gen_compute_eflags_c(s, cpu_tmp4);
         if (s->prefix & PREFIX_LOCK) {
             tcg_gen_add_tl(tcg_ctx, cpu_T0, cpu_T1, cpu_tmp4);
             tcg_gen_neg_tl(tcg_ctx, cpu_T0, cpu_T0);
@@ -2479,6 +2476,7 @@ static inline void gen_goto_tb(DisasContext *s, int tb_num, target_ulong eip)
         s->base.is_jmp = DISAS_NORETURN;
     } else {
         /* jump to another page */
+        gen_jmp_im(s, eip);
         gen_jr(s, tcg_ctx->cpu_tmp0);
     }
 }
@@ -5040,17 +5038,6 @@ static void gen_sse(CPUX86State *env, DisasContext *s, int b,
     }
 }
 
-// Unicorn: sync EFLAGS on demand
-static void sync_eflags(DisasContext *s, TCGContext *tcg_ctx)
-{
-    TCGv cpu_T0 = tcg_ctx->cpu_T0;
-    TCGv_ptr cpu_env = tcg_ctx->uc->cpu_env;
-
-    gen_update_cc_op(s);
-    gen_helper_read_eflags(tcg_ctx, cpu_T0, cpu_env);
-    tcg_gen_st_tl(tcg_ctx, cpu_T0, cpu_env, offsetof(CPUX86State, eflags));
-}
-
 /*
 static void restore_eflags(DisasContext *s, TCGContext *tcg_ctx)
 {
@@ -5094,7 +5081,6 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
     TCGv *cpu_seg_base = tcg_ctx->cpu_seg_base;
     //TCGArg* save_opparam_ptr = tcg_ctx->gen_opparam_buf + tcg_ctx->gen_op_buf[tcg_ctx->gen_op_buf[0].prev].args;
     //bool cc_op_dirty = s->cc_op_dirty;
-    bool changed_cc_op = false;
 
     s->pc_start = s->pc = pc_start;
 
@@ -5110,11 +5096,9 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
 
     // Unicorn: trace this instruction on request
     if (HOOK_EXISTS_BOUNDED(env->uc, UC_HOOK_CODE, pc_start)) {
-        if (s->last_cc_op != s->cc_op) {
-            sync_eflags(s, tcg_ctx);
-            s->last_cc_op = s->cc_op;
-            changed_cc_op = true;
-        }
+        // only spill cc_op: cc_src/cc_dst are globals the helper call saves,
+        // and uc_reg_read() computes EFLAGS from them when asked
+        gen_update_cc_op(s);
         gen_uc_tracecode(tcg_ctx, 0xf1f1f1f1, UC_HOOK_CODE_IDX, env->uc, pc_start);
         // the callback might want to stop emulation immediately
         check_exit_request(tcg_ctx);
@@ -9186,7 +9170,7 @@ static int i386_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cpu,
     dc->cpl = (flags >> HF_CPL_SHIFT) & 3;
     dc->iopl = (flags >> IOPL_SHIFT) & 3;
     dc->tf = (flags >> TF_SHIFT) & 1;
-    dc->last_cc_op = dc->cc_op = CC_OP_DYNAMIC;
+    dc->cc_op = CC_OP_DYNAMIC;
     dc->cc_op_dirty = false;
     dc->cs_base = cs_base;
     dc->popl_esp_hack = 0;
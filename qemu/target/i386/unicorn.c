@@ -964,14 +964,12 @@ int x86_reg_write(struct uc_struct *uc, unsigned int *regs, void *const *vals, i
                     case UC_X86_REG_EIP:
                         state->eip = *(uint32_t *)value;
                         // force to quit execution and flush TB
-                        uc->quit_request = true;
-                        uc_emu_stop(uc);
+                        uc_emu_quit_tb(uc);
                         break;
                     case UC_X86_REG_IP:
                         WRITE_WORD(state->eip, *(uint16_t *)value);
                         // force to quit execution and flush TB
-                        uc->quit_request = true;
-                        uc_emu_stop(uc);
+                        uc_emu_quit_tb(uc);
                         break;
                     case UC_X86_REG_CS:
                         cpu_x86_load_seg(state, R_CS, *(uint16_t *)value);
@@ -1154,20 +1152,17 @@ int x86_reg_write(struct uc_struct *uc, unsigned int *regs, void *const *vals, i
                     case UC_X86_REG_RIP:
                         state->eip = *(uint64_t *)value;
                         // force to quit execution and flush TB
-                        uc->quit_request = true;
-                        uc_emu_stop(uc);
+                        uc_emu_quit_tb(uc);
                         break;
                     case UC_X86_REG_EIP:
                         WRITE_DWORD(state->eip, *(uint32_t *)value);
                         // force to quit execution and flush TB
-                        uc->quit_request = true;
-                        uc_emu_stop(uc);
+                        uc_emu_quit_tb(uc);
                         break;
                     case UC_X86_REG_IP:
                         WRITE_WORD(state->eip, *(uint16_t *)value);
                         // force to quit execution and flush TB
-                        uc->quit_request = true;
-                        uc_emu_stop(uc);
+                        uc_emu_quit_tb(uc);
                         break;
                     case UC_X86_REG_CS:
                         state->segs[R_CS].selector = *(uint16_t *)value;
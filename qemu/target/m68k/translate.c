@@ -6357,28 +6357,27 @@ void gen_intermediate_code(CPUState *cs, TranslationBlock *tb)
         goto done_generating;
     }
 
-    // Unicorn: FIXME: Update to work with new TCG API
-    // Unicorn: trace this block on request
+    gen_tb_start(tcg_ctx, tb);
+
+    // Unicorn: trace this block on request, once it is known to run.
     // Only hook this block if it is not broken from previous translation due to
-    // full translation cache
+    // full translation cache. Its size is patched in by tb_gen_code().
     if (!env->uc->block_full && HOOK_EXISTS_BOUNDED(env->uc, UC_HOOK_BLOCK, pc_start)) {
-#if 0
-        // save block address to see if we need to patch block size later
-        env->uc->block_addr = pc_start;
-        env->uc->size_arg = tcg_ctx->gen_op_buf[tcg_ctx->gen_op_buf[0].prev].args;
-        gen_uc_tracecode(tcg_ctx, 0xf8f8f8f8, UC_HOOK_BLOCK_IDX, env->uc, pc_start);
-#endif
-    } else {
-        env->uc->size_arg = -1;
+        tcg_ctx->block_size_op = gen_uc_tracecode(tcg_ctx, 0, UC_HOOK_BLOCK_IDX, env->uc, pc_start);
+    }
+
+    // Unicorn: count the edge from the previous block on request
+    if (env->uc->coverage_map) {
+        gen_uc_coverage(tcg_ctx, env->uc, pc_start);
     }
 
-    gen_tb_start(tcg_ctx, tb);
     do {
         pc_offset = dc->pc - pc_start;
         tcg_gen_insn_start(tcg_ctx, dc->pc, dc->cc_op);
         num_insns++;
 
-        if (unlikely(cpu_breakpoint_test(cs, dc->pc, BP_ANY))) {
+        if (unlikely(cpu_breakpoint_test(cs, dc->pc, BP_ANY)) &&
+                !(tb_cflags(tb) & CF_NOBREAK)) {
             gen_exception(dc, dc->pc, EXCP_DEBUG);
             dc->is_jmp = DISAS_JUMP;
             /* The address covered by the breakpoint must be included in
@@ -80,8 +80,7 @@ int m68k_reg_write(struct uc_struct *uc, unsigned int *regs, void *const *vals,
                 case UC_M68K_REG_PC:
                          state->pc = *(uint32_t *)value;
                          // force to quit execution and flush TB
-                         uc->quit_request = true;
-                         uc_emu_stop(uc);
+                         uc_emu_quit_tb(uc);
                          break;
             }
         }
@@ -20505,28 +20505,26 @@ void gen_intermediate_code(CPUState *cs, struct TranslationBlock *tb)
         goto done_generating;
     }
 
-    // Unicorn: trace this block on request
+    gen_tb_start(tcg_ctx, tb);
+
+    // Unicorn: trace this block on request, once it is known to run.
     // Only hook this block if it is not broken from previous translation due to
-    // full translation cache
+    // full translation cache. Its size is patched in by tb_gen_code().
     if (!env->uc->block_full && HOOK_EXISTS_BOUNDED(env->uc, UC_HOOK_BLOCK, pc_start)) {
-        // Unicorn: FIXME: Amend to work with the new TCG API
-#if 0
-        int arg_i = tcg_ctx->gen_op_buf[tcg_ctx->gen_op_buf[0].prev].args;
-        // save block address to see if we need to patch block size later
-        env->uc->block_addr = pc_start;
-        env->uc->size_arg = arg_i + 1;
-        gen_uc_tracecode(tcg_ctx, 0xf8f8f8f8, UC_HOOK_BLOCK_IDX, env->uc, pc_start);
-#endif
-    } else {
-        env->uc->size_arg = -1;
+        tcg_ctx->block_size_op = gen_uc_tracecode(tcg_ctx, 0, UC_HOOK_BLOCK_IDX, env->uc, pc_start);
+    }
+
+    // Unicorn: count the edge from the previous block on request
+    if (env->uc->coverage_map) {
+        gen_uc_coverage(tcg_ctx, env->uc, pc_start);
     }
 
-    gen_tb_start(tcg_ctx, tb);
     while (ctx.bstate == BS_NONE) {
         tcg_gen_insn_start(tcg_ctx, ctx.pc, ctx.hflags & MIPS_HFLAG_BMASK, ctx.btarget);
         num_insns++;
 
-        if (unlikely(cpu_breakpoint_test(cs, ctx.pc, BP_ANY))) {
+        if (unlikely(cpu_breakpoint_test(cs, ctx.pc, BP_ANY)) &&
+                !(tb_cflags(tb) & CF_NOBREAK)) {
             save_cpu_state(&ctx, 1);
             ctx.bstate = BS_BRANCH;
             gen_helper_raise_exception_debug(tcg_ctx, uc->cpu_env);
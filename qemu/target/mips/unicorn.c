@@ -106,8 +106,7 @@ int mips_reg_write(struct uc_struct *uc, unsigned int *regs, void *const *vals,
                 case UC_MIPS_REG_PC:
                     state->active_tc.PC = *(mipsreg_t *)value;
                     // force to quit execution and flush TB
-                    uc->quit_request = true;
-                    uc_emu_stop(uc);
+                    uc_emu_quit_tb(uc);
                     break;
             }
         }
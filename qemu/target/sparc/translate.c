@@ -6038,20 +6038,20 @@ void gen_intermediate_code(CPUState *cs, TranslationBlock * tb)
         goto done_generating;
     }
 
-    // Unicorn: FIXME: Amend to work with new TCG API
-    // Unicorn: trace this block on request
+    gen_tb_start(tcg_ctx, tb);
+
+    // Unicorn: trace this block on request, once it is known to run.
     // Only hook this block if it is not broken from previous translation due to
-    // full translation cache
-#if 0
+    // full translation cache. Its size is patched in by tb_gen_code().
     if (!env->uc->block_full && HOOK_EXISTS_BOUNDED(uc, UC_HOOK_BLOCK, pc_start)) {
-        // save block address to see if we need to patch block size later
-        env->uc->block_addr = pc_start;
-        env->uc->size_arg = tcg_ctx->gen_op_buf[tcg_ctx->gen_op_buf[0].prev].args;
-        gen_uc_tracecode(tcg_ctx, 0xf8f8f8f8, UC_HOOK_BLOCK_IDX, uc, pc_start);
+        tcg_ctx->block_size_op = gen_uc_tracecode(tcg_ctx, 0, UC_HOOK_BLOCK_IDX, uc, pc_start);
+    }
+
+    // Unicorn: count the edge from the previous block on request
+    if (uc->coverage_map) {
+        gen_uc_coverage(tcg_ctx, uc, pc_start);
     }
-#endif
 
-    gen_tb_start(tcg_ctx, tb);
     do {
         if (dc->npc & JUMP_PC) {
             assert(dc->jump_pc[1] == dc->pc + 4);
@@ -6062,7 +6062,8 @@ void gen_intermediate_code(CPUState *cs, TranslationBlock * tb)
         num_insns++;
         last_pc = dc->pc;
 
-        if (unlikely(cpu_breakpoint_test(cs, dc->pc, BP_ANY))) {
+        if (unlikely(cpu_breakpoint_test(cs, dc->pc, BP_ANY)) &&
+                !(tb_cflags(tb) & CF_NOBREAK)) {
             if (dc->pc != pc_start) {
                 save_state(dc);
             }
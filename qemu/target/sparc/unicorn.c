@@ -103,8 +103,7 @@ int sparc_reg_write(struct uc_struct *uc, unsigned int *regs, void *const *vals,
                     state->pc = *(uint32_t *)value;
                     state->npc = *(uint32_t *)value + 4;
                     // force to quit execution and flush TB
-                    uc->quit_request = true;
-                    uc_emu_stop(uc);
+                    uc_emu_quit_tb(uc);
                     break;
             }
         }
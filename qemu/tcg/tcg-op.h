@@ -40,13 +40,22 @@ void vec_gen_2(TCGContext *, TCGOpcode, TCGType, unsigned, TCGArg, TCGArg);
 void vec_gen_3(TCGContext *, TCGOpcode, TCGType, unsigned, TCGArg, TCGArg, TCGArg);
 void vec_gen_4(TCGContext *, TCGOpcode, TCGType, unsigned, TCGArg, TCGArg, TCGArg, TCGArg);
 
-static inline void gen_uc_tracecode(TCGContext *tcg_ctx, int32_t size, int32_t type, void *uc, uint64_t pc)
+// Unicorn: returns the op loading @size, for sizes only known at the end of
+// the translation (see tcg_set_insn_param())
+static inline TCGOp *gen_uc_tracecode(TCGContext *tcg_ctx, int32_t size, int32_t type, void *uc, uint64_t pc)
 {
     TCGv_i32 tsize = tcg_const_i32(tcg_ctx, size);
+    TCGOp *size_op = tcg_last_op(tcg_ctx);
     TCGv_i32 ttype = tcg_const_i32(tcg_ctx, type);
-    TCGv_ptr tuc = tcg_const_ptr(tcg_ctx, uc);
+    // Unicorn: the helper gets the hooks matching @pc, computed right now
+    TCGv_ptr thooks = tcg_const_ptr(tcg_ctx, hook_vector_get(uc, type, pc));
     TCGv_i64 tpc = tcg_const_i64(tcg_ctx, pc);
-    gen_helper_uc_tracecode(tcg_ctx, tsize, ttype, tuc, tpc);
+    gen_helper_uc_tracecode(tcg_ctx, tsize, ttype, thooks, tpc);
+    tcg_temp_free_i64(tcg_ctx, tpc);
+    tcg_temp_free_ptr(tcg_ctx, thooks);
+    tcg_temp_free_i32(tcg_ctx, ttype);
+    tcg_temp_free_i32(tcg_ctx, tsize);
+    return size_op;
 }
 
 static inline void tcg_gen_op1_i32(TCGContext *s, TCGOpcode opc, TCGv_i32 a1)
@@ -1167,3 +1176,30 @@ void tcg_gen_stl_vec(TCGContext *, TCGv_vec r, TCGv_ptr base, TCGArg offset, TCG
 # define tcg_gen_ext_i32_ptr(S, R, A) \
     tcg_gen_ext_i32_i64(S, TCGV_PTR_TO_NAT(R), (A))
 #endif /* UINTPTR_MAX == UINT32_MAX */
+
+// Unicorn: AFL-style edge coverage, inline without any helper call:
+// map[cur ^ prev]++ then prev = cur >> 1, where cur is a hash of @pc
+static inline void gen_uc_coverage(TCGContext *tcg_ctx, struct uc_struct *uc, uint64_t pc)
+{
+    uint32_t cur = (uint32_t)((pc >> 4) ^ (pc << 8)) & uc->coverage_mask;
+    TCGv_ptr tuc = tcg_const_ptr(tcg_ctx, uc);
+    TCGv_ptr tmap = tcg_temp_new_ptr(tcg_ctx);
+    TCGv_i32 tidx = tcg_temp_new_i32(tcg_ctx);
+    TCGv_i32 tcount = tcg_temp_new_i32(tcg_ctx);
+
+    tcg_gen_ld_i32(tcg_ctx, tidx, tuc, offsetof(struct uc_struct, coverage_prev));
+    tcg_gen_xori_i32(tcg_ctx, tidx, tidx, cur);
+    // the mask fits in 31 bits, so sign extension is fine
+    tcg_gen_ext_i32_ptr(tcg_ctx, tmap, tidx);
+    tcg_gen_addi_ptr(tcg_ctx, tmap, tmap, (intptr_t)uc->coverage_map);
+    tcg_gen_ld8u_i32(tcg_ctx, tcount, tmap, 0);
+    tcg_gen_addi_i32(tcg_ctx, tcount, tcount, 1);
+    tcg_gen_st8_i32(tcg_ctx, tcount, tmap, 0);
+    tcg_gen_movi_i32(tcg_ctx, tidx, cur >> 1);
+    tcg_gen_st_i32(tcg_ctx, tidx, tuc, offsetof(struct uc_struct, coverage_prev));
+
+    tcg_temp_free_i32(tcg_ctx, tcount);
+    tcg_temp_free_i32(tcg_ctx, tidx);
+    tcg_temp_free_ptr(tcg_ctx, tmap);
+    tcg_temp_free_ptr(tcg_ctx, tuc);
+}
@@ -505,22 +505,13 @@ void tcg_register_thread(struct uc_struct *uc)
 void tcg_register_thread(struct uc_struct *uc)
 {
     TCGContext **tcg_ctxs = uc->tcg_ctxs;
-    TCGContext *tcg_init_ctx = uc->tcg_init_ctx;
-    TCGContext *s = g_malloc(sizeof(*s));
-    unsigned int i, n;
+    // Unicorn: an engine has a single vCPU, which can translate with the
+    // init context itself rather than a copy of this large structure.
+    // It is then freed with the other contexts of tcg_ctxs[].
+    TCGContext *s = uc->tcg_init_ctx;
+    unsigned int n;
     bool err;
 
-    *s = *tcg_init_ctx;
-
-    /* Relink mem_base.  */
-    for (i = 0, n = tcg_init_ctx->nb_globals; i < n; ++i) {
-        if (tcg_init_ctx->temps[i].mem_base) {
-            ptrdiff_t b = tcg_init_ctx->temps[i].mem_base - tcg_init_ctx->temps;
-            tcg_debug_assert(b >= 0 && b < n);
-            s->temps[i].mem_base = &s->temps[b];
-        }
-    }
-
     /* Claim an entry in tcg_ctxs */
     n = atomic_fetch_inc(&uc->n_tcg_ctxs);
     // Unicorn: commented out
@@ -856,6 +847,7 @@ void tcg_func_start(TCGContext *s)
 
     s->nb_labels = 0;
     s->current_frame_offset = s->frame_start;
+    s->block_size_op = NULL;
 
 #ifdef CONFIG_DEBUG_TCG
     s->goto_tb_issue_mask = 0;
@@ -2128,8 +2120,11 @@ static inline void tcg_la_br_end(TCGContext *s)
     for (i = 0; i < ng; i++) {
         s->temps[i].state = TS_MEM;
     }
+    // local temps must still be saved to memory, as at the end of a block
     for(i = ng; i < nt; i++) {
-        s->temps[i].state = s->temps[i].temp_local;
+        if (s->temps[i].temp_local) {
+            s->temps[i].state |= TS_MEM;
+        }
     }
 }
 
@@ -927,6 +927,9 @@ struct TCGContext {
     TCGv cpu_wim;
 
     TCGLabel *exitreq_label;  // gen_tb_start()
+    TCGLabel *icount_label;   // gen_tb_start()
+    TCGOp *icount_start_insn;
+    TCGOp *block_size_op;     // size of the block hook, NULL if not traced
 };
 
 static inline size_t temp_idx(TCGContext *tcg_ctx, TCGTemp *ts)
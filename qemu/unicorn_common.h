@@ -10,13 +10,13 @@
 static inline bool cpu_physical_mem_read(AddressSpace *as, hwaddr addr,
                                             uint8_t *buf, int len)
 {
-    return !cpu_physical_memory_rw(as, addr, (void *)buf, len, 0);
+    return cpu_physical_memory_rw(as, addr, (void *)buf, len, 0);
 }
 
 static inline bool cpu_physical_mem_write(AddressSpace *as, hwaddr addr,
                                             const uint8_t *buf, int len)
 {
-    return !cpu_physical_memory_rw(as, addr, (void *)buf, len, 1);
+    return cpu_physical_memory_rw(as, addr, (void *)buf, len, 1);
 }
 
 void tb_cleanup(struct uc_struct *uc);
@@ -98,7 +98,6 @@ static void release_common(void *t)
     struct uc_struct *uc = s->uc;
 
     // Clean TCG.
-    free_tcg_contexts(uc);
     g_tree_destroy(uc->tb_ctx.tb_tree);
     qht_destroy(&uc->tb_ctx.htable);
 
@@ -113,6 +112,9 @@ static void release_common(void *t)
     tb_cleanup(uc);
     free_code_gen_buffer(uc);
     free_machine_class_name(uc);
+
+    // last, the above may use uc->tcg_ctx
+    free_tcg_contexts(uc);
 }
 
 static inline void uc_common_init(struct uc_struct* uc)
@@ -126,8 +128,23 @@ static inline void uc_common_init(struct uc_struct* uc)
     uc->vm_start = vm_start;
     uc->memory_map = memory_map;
     uc->memory_map_ptr = memory_map_ptr;
+    uc->memory_map_fd = memory_map_fd;
+    uc->memory_map_io = memory_map_io;
+    uc->stats_query = tb_stats_query;
+    uc->profile_top = tb_profile_top;
     uc->memory_unmap = memory_unmap;
     uc->readonly_mem = memory_region_set_readonly;
+    uc->uc_invalidate_tb = uc_invalidate_tb;
+    uc->uc_invalidate_tb_pc = uc_invalidate_tb_pc;
+    uc->uc_tlb_flush = uc_tlb_flush;
+    uc->snapshot_save = memory_snapshot_save;
+    uc->snapshot_restore = memory_snapshot_restore;
+    uc->memory_host_ptr = memory_host_ptr;
+    uc->memory_host_written = memory_host_written;
+    uc->breakpoint_insert = cpu_breakpoint_insert;
+    uc->breakpoint_remove = cpu_breakpoint_remove;
+    uc->watchpoint_insert = cpu_watchpoint_insert;
+    uc->watchpoint_remove = cpu_watchpoint_remove;
 
     uc->target_page_size = TARGET_PAGE_SIZE;
     uc->target_page_align = TARGET_PAGE_SIZE - 1;
@@ -26,6 +26,54 @@ static void error_exit(int err, const char *msg)
     abort();
 }
 
+void qemu_mutex_lock(QemuMutex *mutex)
+{
+    int err;
+
+    err = pthread_mutex_lock(&mutex->lock);
+    if (err) {
+        error_exit(err, __func__);
+    }
+}
+
+void qemu_mutex_unlock(QemuMutex *mutex)
+{
+    int err;
+
+    err = pthread_mutex_unlock(&mutex->lock);
+    if (err) {
+        error_exit(err, __func__);
+    }
+}
+
+void qemu_cond_signal(QemuCond *cond)
+{
+    int err;
+
+    err = pthread_cond_signal(&cond->cond);
+    if (err) {
+        error_exit(err, __func__);
+    }
+}
+
+bool qemu_cond_timedwait(QemuCond *cond, QemuMutex *mutex, int64_t timeout)
+{
+    struct timespec ts;
+    int err;
+
+    /* the condition variable waits on CLOCK_REALTIME */
+    clock_gettime(CLOCK_REALTIME, &ts);
+    timeout += ts.tv_nsec;
+    ts.tv_sec += timeout / 1000000000LL;
+    ts.tv_nsec = timeout % 1000000000LL;
+
+    err = pthread_cond_timedwait(&cond->cond, &mutex->lock, &ts);
+    if (err && err != ETIMEDOUT) {
+        error_exit(err, __func__);
+    }
+    return err != ETIMEDOUT;
+}
+
 int qemu_thread_create(struct uc_struct *uc, QemuThread *thread, const char *name,
                        void *(*start_routine)(void*),
                        void *arg, int mode)
@@ -29,6 +29,35 @@ static void error_exit(int err, const char *msg)
     //abort();
 }
 
+void qemu_mutex_lock(QemuMutex *mutex)
+{
+    AcquireSRWLockExclusive(&mutex->lock);
+}
+
+void qemu_mutex_unlock(QemuMutex *mutex)
+{
+    ReleaseSRWLockExclusive(&mutex->lock);
+}
+
+void qemu_cond_signal(QemuCond *cond)
+{
+    WakeConditionVariable(&cond->var);
+}
+
+bool qemu_cond_timedwait(QemuCond *cond, QemuMutex *mutex, int64_t timeout)
+{
+    /* round up to whole milliseconds, so that the timeout did expire */
+    DWORD ms = (timeout + 999999) / 1000000;
+
+    if (!SleepConditionVariableSRW(&cond->var, &mutex->lock, ms, 0)) {
+        if (GetLastError() != ERROR_TIMEOUT) {
+            error_exit(GetLastError(), __func__);
+        }
+        return false;
+    }
+    return true;
+}
+
 struct QemuThreadData {
     /* Passed to win32_start_routine.  */
     void             *(*start_routine)(void *);
@@ -47,19 +76,22 @@ static unsigned __stdcall win32_start_routine(void *arg)
     QemuThreadData *data = (QemuThreadData *) arg;
     void *(*start_routine)(void *) = data->start_routine;
     void *thread_arg = data->arg;
+    struct uc_struct *uc = data->uc;
 
     if (data->mode == QEMU_THREAD_DETACHED) {
-        data->uc->qemu_thread_data = NULL;
+        if (uc) {
+            uc->qemu_thread_data = NULL;
+        }
         g_free(data);
         data = NULL;
     }
-    qemu_thread_exit(data->uc, start_routine(thread_arg));
+    qemu_thread_exit(uc, start_routine(thread_arg));
     abort();
 }
 
 void qemu_thread_exit(struct uc_struct *uc, void *arg)
 {
-    QemuThreadData *data = uc->qemu_thread_data;
+    QemuThreadData *data = uc ? uc->qemu_thread_data : NULL;
 
     if (data) {
         assert(data->mode != QEMU_THREAD_DETACHED);
@@ -116,7 +148,10 @@ int qemu_thread_create(struct uc_struct *uc, QemuThread *thread, const char *nam
     data->exited = false;
     data->uc = uc;
 
-    uc->qemu_thread_data = data;
+    // detached threads may run for no engine in particular
+    if (uc) {
+        uc->qemu_thread_data = data;
+    }
 
     if (data->mode != QEMU_THREAD_DETACHED) {
         InitializeCriticalSection(&data->cs);
@@ -794,8 +794,6 @@ bool qht_resize(struct qht *ht, size_t n_elems)
 /* pass @stats to qht_statistics_destroy() when done */
 void qht_statistics_init(struct qht *ht, struct qht_stats *stats)
 {
-    // Unicorn: commented out
-#if 0
     struct qht_map *map;
     int i;
 
@@ -803,8 +801,7 @@ void qht_statistics_init(struct qht *ht, struct qht_stats *stats)
 
     stats->used_head_buckets = 0;
     stats->entries = 0;
-    qdist_init(&stats->chain);
-    qdist_init(&stats->occupancy);
+    // Unicorn: no distributions, only the counts
     /* bail out if the qht has not yet been initialized */
     if (unlikely(map == NULL)) {
         stats->head_buckets = 0;
@@ -815,39 +812,26 @@ void qht_statistics_init(struct qht *ht, struct qht_stats *stats)
     for (i = 0; i < map->n_buckets; i++) {
         struct qht_bucket *head = &map->buckets[i];
         struct qht_bucket *b;
-        unsigned int version;
-        size_t buckets;
         size_t entries;
         int j;
 
-        //do {
-            //version = seqlock_read_begin(&head->sequence);
-            buckets = 0;
-            entries = 0;
-            b = head;
-            do {
-                for (j = 0; j < QHT_BUCKET_ENTRIES; j++) {
-                    if (atomic_read(&b->pointers[j]) == NULL) {
-                        break;
-                    }
-                    entries++;
+        entries = 0;
+        b = head;
+        do {
+            for (j = 0; j < QHT_BUCKET_ENTRIES; j++) {
+                if (atomic_read(&b->pointers[j]) == NULL) {
+                    break;
                 }
-                buckets++;
-                b = atomic_rcu_read(&b->next);
-            } while (b);
-        //} while (seqlock_read_retry(&head->sequence, version));
+                entries++;
+            }
+            b = atomic_rcu_read(&b->next);
+        } while (b);
 
         if (entries) {
-            qdist_inc(&stats->chain, buckets);
-            qdist_inc(&stats->occupancy,
-                      (double)entries / QHT_BUCKET_ENTRIES / buckets);
             stats->used_head_buckets++;
             stats->entries += entries;
-        } else {
-            qdist_inc(&stats->occupancy, 0);
         }
     }
-#endif
 }
 
 void qht_statistics_destroy(struct qht_stats *stats)
@@ -0,0 +1,3 @@
+# Default configuration for x86_64-softmmu
+
+CONFIG_APIC=y
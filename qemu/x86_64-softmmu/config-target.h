@@ -0,0 +1,5 @@
+/* Automatically generated by create_config - do not modify */
+#define TARGET_X86_64 1
+#define TARGET_NAME "x86_64"
+#define TARGET_I386 1
+#define CONFIG_SOFTMMU 1
@@ -0,0 +1,242 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define ADDRESS 0x1000000
+
+/******************************************************************************/
+
+static uc_engine *open_x86(const uint8_t *code, size_t size)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, ADDRESS, 0x2000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, ADDRESS, code, size));
+
+    return uc;
+}
+
+static uint32_t read_eip(uc_engine *uc)
+{
+    uint32_t eip;
+
+    OK(uc_reg_read(uc, UC_X86_REG_EIP, &eip));
+    return eip;
+}
+
+static uint32_t read_eax(uc_engine *uc)
+{
+    uint32_t eax;
+
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    return eax;
+}
+
+// Emulation stops before the instruction, and resumes over it.
+static void test_breakpoint_x86(void **state)
+{
+    const uint8_t code[] = { 0x40, 0x40, 0x40, 0x40 };  // inc eax (x4)
+    uc_engine *uc = open_x86(code, sizeof(code));
+
+    OK(uc_breakpoint_add(uc, ADDRESS + 2));
+
+    uc_assert_err(UC_ERR_BREAKPOINT, uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    assert_int_equal(read_eip(uc), ADDRESS + 2);
+    assert_int_equal(read_eax(uc), 2);
+
+    OK(uc_emu_start(uc, ADDRESS + 2, ADDRESS + sizeof(code), 0, 0));
+    assert_int_equal(read_eax(uc), 4);
+
+    OK(uc_close(uc));
+}
+
+// Each pass through a loop hits the breakpoint again.
+static void test_breakpoint_loop(void **state)
+{
+    const uint8_t code[] = {
+        0xB9, 0x0A, 0x00, 0x00, 0x00,   // mov ecx, 10
+        0x49,                           // a: dec ecx
+        0x75, 0xFD,                     // jnz a
+    };
+    uc_engine *uc = open_x86(code, sizeof(code));
+    uint32_t ecx, hits = 0;
+    uint64_t pc = ADDRESS;
+
+    OK(uc_breakpoint_add(uc, ADDRESS + 5));
+
+    while (uc_emu_start(uc, pc, ADDRESS + sizeof(code), 0, 0) == UC_ERR_BREAKPOINT) {
+        pc = read_eip(uc);
+        assert_int_equal(pc, ADDRESS + 5);
+        OK(uc_reg_read(uc, UC_X86_REG_ECX, &ecx));
+        assert_int_equal(ecx, 10 - hits);
+        hits++;
+    }
+    assert_int_equal(hits, 10);
+
+    // removed: the same code runs through
+    OK(uc_breakpoint_del(uc, ADDRESS + 5));
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &ecx));
+    assert_int_equal(ecx, 0);
+
+    OK(uc_close(uc));
+}
+
+// Code translated before the breakpoint was set is dropped.
+static void test_breakpoint_cached(void **state)
+{
+    const uint8_t code[] = { 0x40, 0x40, 0x40, 0x40 };  // inc eax (x4)
+    uc_engine *uc = open_x86(code, sizeof(code));
+    uint32_t eax = 0;
+
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    assert_int_equal(read_eax(uc), 4);
+
+    OK(uc_breakpoint_add(uc, ADDRESS + 3));
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &eax));
+    uc_assert_err(UC_ERR_BREAKPOINT, uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    assert_int_equal(read_eip(uc), ADDRESS + 3);
+    assert_int_equal(read_eax(uc), 3);
+
+    OK(uc_breakpoint_del(uc, ADDRESS + 3));
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &eax));
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    assert_int_equal(read_eax(uc), 4);
+
+    OK(uc_close(uc));
+}
+
+static void test_breakpoint_arg(void **state)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_breakpoint_add(uc, ADDRESS));
+    uc_assert_err(UC_ERR_ARG, uc_breakpoint_add(uc, ADDRESS));
+    OK(uc_breakpoint_del(uc, ADDRESS));
+    uc_assert_err(UC_ERR_ARG, uc_breakpoint_del(uc, ADDRESS));
+    OK(uc_close(uc));
+}
+
+static void test_breakpoint_arm(void **state)
+{
+    const uint8_t code[] = {
+        0x01, 0x00, 0xA0, 0xE3,     // mov r0, #1
+        0x01, 0x00, 0x80, 0xE2,     // add r0, r0, #1
+        0x01, 0x00, 0x80, 0xE2,     // add r0, r0, #1
+    };
+    uc_engine *uc;
+    uint32_t r0, pc;
+
+    OK(uc_open(UC_ARCH_ARM, UC_MODE_ARM, &uc));
+    OK(uc_mem_map(uc, ADDRESS, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+    OK(uc_breakpoint_add(uc, ADDRESS + 8));
+
+    uc_assert_err(UC_ERR_BREAKPOINT, uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_ARM_REG_PC, &pc));
+    OK(uc_reg_read(uc, UC_ARM_REG_R0, &r0));
+    assert_int_equal(pc, ADDRESS + 8);
+    assert_int_equal(r0, 2);
+
+    OK(uc_emu_start(uc, pc, ADDRESS + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_ARM_REG_R0, &r0));
+    assert_int_equal(r0, 3);
+
+    OK(uc_close(uc));
+}
+
+// MIPS has its own translation loop
+static void test_breakpoint_mips(void **state)
+{
+    const uint8_t code[] = {
+        0x01, 0x00, 0x08, 0x24,     // addiu $t0, $zero, 1
+        0x01, 0x00, 0x08, 0x25,     // addiu $t0, $t0, 1
+        0x01, 0x00, 0x08, 0x25,     // addiu $t0, $t0, 1
+    };
+    uc_engine *uc;
+    uint32_t t0, pc;
+
+    OK(uc_open(UC_ARCH_MIPS, UC_MODE_MIPS32 | UC_MODE_LITTLE_ENDIAN, &uc));
+    OK(uc_mem_map(uc, ADDRESS, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+    OK(uc_breakpoint_add(uc, ADDRESS + 4));
+
+    uc_assert_err(UC_ERR_BREAKPOINT, uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_MIPS_REG_PC, &pc));
+    OK(uc_reg_read(uc, UC_MIPS_REG_T0, &t0));
+    assert_int_equal(pc, ADDRESS + 4);
+    assert_int_equal(t0, 1);
+
+    OK(uc_emu_start(uc, pc, ADDRESS + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_MIPS_REG_T0, &t0));
+    assert_int_equal(t0, 3);
+
+    OK(uc_close(uc));
+}
+
+/******************************************************************************/
+
+#define BENCH_LOOPS 2000000
+#define BENCH_BREAKPOINTS 500
+
+static double bench_run(uc_engine *uc, const uint8_t *code, size_t size)
+{
+    uint32_t loops = BENCH_LOOPS;
+    struct timespec start, end;
+
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &loops));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + size, 0, 0));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / (2.0 * BENCH_LOOPS);
+}
+
+// Micro-benchmark: breakpoints elsewhere do not slow a loop down
+static void test_breakpoint_bench(void **state)
+{
+    const uint8_t code[] = {
+        0x49,                           // a: dec ecx
+        0x75, 0xFD,                     // jnz a
+    };
+    uc_engine *uc = open_x86(code, sizeof(code));
+    double none, many;
+    int i;
+
+    bench_run(uc, code, sizeof(code));
+    none = bench_run(uc, code, sizeof(code));
+
+    for (i = 0; i < BENCH_BREAKPOINTS; i++) {
+        OK(uc_breakpoint_add(uc, ADDRESS + 0x1000 + i * 4));
+    }
+    bench_run(uc, code, sizeof(code));
+    many = bench_run(uc, code, sizeof(code));
+
+    printf("ns per instruction: %.2f without breakpoints, %.2f with %d elsewhere\n",
+           none, many, BENCH_BREAKPOINTS);
+
+    OK(uc_close(uc));
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_breakpoint_x86),
+        cmocka_unit_test(test_breakpoint_loop),
+        cmocka_unit_test(test_breakpoint_cached),
+        cmocka_unit_test(test_breakpoint_arg),
+        cmocka_unit_test(test_breakpoint_arm),
+        cmocka_unit_test(test_breakpoint_mips),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_breakpoint_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
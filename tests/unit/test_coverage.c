@@ -0,0 +1,191 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define ADDRESS 0x1000000
+#define MAP_SIZE 0x10000
+
+/******************************************************************************/
+
+// mov ecx, 100 ; a: dec ecx ; jmp b ; b: jnz a
+// block 0 runs once, then blocks 8 and 5 alternate 99 times
+static const uint8_t x86_code[] = {
+    0xB9, 0x64, 0x00, 0x00, 0x00,   // mov ecx, 100
+    0x49,                           // a: dec ecx
+    0xEB, 0x00,                     // jmp b
+    0x75, 0xFB,                     // b: jnz a
+};
+
+static uc_engine *open_x86(const uint8_t *code, size_t size)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, ADDRESS, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, ADDRESS, code, size));
+
+    return uc;
+}
+
+static void map_stats(const uint8_t *map, unsigned int *sum, unsigned int *edges)
+{
+    unsigned int i;
+
+    *sum = *edges = 0;
+    for (i = 0; i < MAP_SIZE; i++) {
+        *sum += map[i];
+        *edges += map[i] != 0;
+    }
+}
+
+static void test_coverage_x86(void **state)
+{
+    static uint8_t map[MAP_SIZE];
+    uc_engine *uc = open_x86(x86_code, sizeof(x86_code));
+    unsigned int sum, edges;
+
+    memset(map, 0, sizeof(map));
+    OK(uc_coverage_enable(uc, map, sizeof(map)));
+
+    // entry, 0 -> 8, then 99 times 8 -> 5 and 5 -> 8
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(x86_code), 0, 0));
+    map_stats(map, &sum, &edges);
+    assert_int_equal(sum, 200);
+    assert_int_equal(edges, 4);
+
+    // the second run reuses the cached translations and starts a new path
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(x86_code), 0, 0));
+    map_stats(map, &sum, &edges);
+    assert_int_equal(sum, 400);
+    assert_int_equal(edges, 4);
+
+    // disabled: the map is left alone
+    OK(uc_coverage_enable(uc, NULL, 0));
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(x86_code), 0, 0));
+    map_stats(map, &sum, &edges);
+    assert_int_equal(sum, 400);
+
+    OK(uc_close(uc));
+}
+
+// MIPS has its own translation loop
+static void test_coverage_mips(void **state)
+{
+    static uint8_t map[MAP_SIZE];
+    // addiu $t0, $zero, 100 ; a: addiu $t0, $t0, -1 ; bnez $t0, a ; nop
+    const uint8_t code[] = {
+        0x64, 0x00, 0x08, 0x24,
+        0xFF, 0xFF, 0x08, 0x25,
+        0xFE, 0xFF, 0x00, 0x15,
+        0x00, 0x00, 0x00, 0x00,
+    };
+    uc_engine *uc;
+    unsigned int sum, edges;
+
+    OK(uc_open(UC_ARCH_MIPS, UC_MODE_MIPS32 | UC_MODE_LITTLE_ENDIAN, &uc));
+    OK(uc_mem_map(uc, ADDRESS, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+
+    memset(map, 0, sizeof(map));
+    OK(uc_coverage_enable(uc, map, sizeof(map)));
+
+    // entry, 0 -> 4, then 98 times 4 -> 4
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    map_stats(map, &sum, &edges);
+    assert_int_equal(sum, 100);
+    assert_int_equal(edges, 3);
+
+    OK(uc_close(uc));
+}
+
+static void test_coverage_size(void **state)
+{
+    static uint8_t map[MAP_SIZE];
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    uc_assert_err(UC_ERR_ARG, uc_coverage_enable(uc, map, 0));
+    uc_assert_err(UC_ERR_ARG, uc_coverage_enable(uc, map, MAP_SIZE - 1));
+    OK(uc_coverage_enable(uc, map, 1));
+    OK(uc_close(uc));
+}
+
+/******************************************************************************/
+
+#define BENCH_LOOPS 2000000
+
+static uint8_t hook_map[MAP_SIZE];
+static uint32_t hook_prev;
+
+// what a fuzzer had to do before: the same update from a block hook
+static void hook_block(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    uint32_t cur = (uint32_t)((address >> 4) ^ (address << 8)) & (MAP_SIZE - 1);
+
+    hook_map[cur ^ hook_prev]++;
+    hook_prev = cur >> 1;
+}
+
+static double bench_run(uc_engine *uc)
+{
+    uint32_t loops = BENCH_LOOPS;
+    struct timespec start, end;
+
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &loops));
+    hook_prev = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    // skip the mov, the loop count is set above
+    OK(uc_emu_start(uc, ADDRESS + 5, ADDRESS + sizeof(x86_code), 0, 0));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / (2.0 * BENCH_LOOPS);
+}
+
+// Micro-benchmark: cost per block of inline coverage versus a block hook
+static void test_coverage_bench(void **state)
+{
+    static uint8_t map[MAP_SIZE];
+    uc_engine *uc = open_x86(x86_code, sizeof(x86_code));
+    uc_hook trace;
+    double none, inline_cov, hook;
+
+    // the first run of each mode translates the code
+    bench_run(uc);
+    none = bench_run(uc);
+
+    OK(uc_coverage_enable(uc, map, sizeof(map)));
+    bench_run(uc);
+    inline_cov = bench_run(uc);
+    OK(uc_coverage_enable(uc, NULL, 0));
+
+    OK(uc_hook_add(uc, &trace, UC_HOOK_BLOCK, hook_block, NULL, 1, 0));
+    bench_run(uc);
+    hook = bench_run(uc);
+    OK(uc_hook_del(uc, trace));
+
+    printf("ns per block: %.2f without coverage, %.2f inline, %.2f with UC_HOOK_BLOCK\n",
+           none, inline_cov, hook);
+
+    // both ways count the same edges
+    assert_memory_equal(map, hook_map, sizeof(map));
+
+    OK(uc_close(uc));
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_coverage_x86),
+        cmocka_unit_test(test_coverage_mips),
+        cmocka_unit_test(test_coverage_size),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_coverage_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,159 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define ADDRESS 0x1000000
+
+/* Called before every test to set up a new instance */
+static int setup32(void **state)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, ADDRESS, 2 * 1024 * 1024, UC_PROT_ALL));
+
+    *state = uc;
+    return 0;
+}
+
+/* Called after every test to clean up */
+static int teardown(void **state)
+{
+    uc_engine *uc = *state;
+
+    OK(uc_close(uc));
+
+    *state = NULL;
+    return 0;
+}
+
+/******************************************************************************/
+
+// loop: inc eax ; inc ebx ; jmp loop
+static const uint8_t loop_code[] = { 0x40, 0x43, 0xEB, 0xFC };
+
+static uint32_t reg32(uc_engine *uc, int regid)
+{
+    uint32_t val;
+
+    OK(uc_reg_read(uc, regid, &val));
+    return val;
+}
+
+static void clear_regs(uc_engine *uc)
+{
+    uint32_t zero = 0;
+
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &zero));
+    OK(uc_reg_write(uc, UC_X86_REG_EBX, &zero));
+}
+
+// Emulation stops right before the instruction over the limit,
+// which may be in the middle of a block.
+static void test_emu_count_precise(void **state)
+{
+    uc_engine *uc = *state;
+
+    OK(uc_mem_write(uc, ADDRESS, loop_code, sizeof(loop_code)));
+
+    clear_regs(uc);
+    OK(uc_emu_start(uc, ADDRESS, 0, 0, 10));
+    // 3 full iterations and one inc
+    assert_int_equal(reg32(uc, UC_X86_REG_EAX), 4);
+    assert_int_equal(reg32(uc, UC_X86_REG_EBX), 3);
+    assert_int_equal(reg32(uc, UC_X86_REG_EIP), ADDRESS + 1);
+
+    // the same blocks, another limit
+    clear_regs(uc);
+    OK(uc_emu_start(uc, ADDRESS, 0, 0, 5));
+    assert_int_equal(reg32(uc, UC_X86_REG_EAX), 2);
+    assert_int_equal(reg32(uc, UC_X86_REG_EBX), 2);
+    assert_int_equal(reg32(uc, UC_X86_REG_EIP), ADDRESS + 2);
+}
+
+// Limits beyond the 16 bit decrementer are refilled.
+static void test_emu_count_large(void **state)
+{
+    uc_engine *uc = *state;
+
+    OK(uc_mem_write(uc, ADDRESS, loop_code, sizeof(loop_code)));
+
+    clear_regs(uc);
+    OK(uc_emu_start(uc, ADDRESS, 0, 0, 3 * 100000 + 2));
+    assert_int_equal(reg32(uc, UC_X86_REG_EAX), 100001);
+    assert_int_equal(reg32(uc, UC_X86_REG_EBX), 100001);
+    assert_int_equal(reg32(uc, UC_X86_REG_EIP), ADDRESS + 2);
+}
+
+static void count_insn(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    unsigned int *count = user_data;
+
+    (*count)++;
+}
+
+// Code hooks see exactly the counted instructions, and reaching @until
+// first still ends the emulation.
+static void test_emu_count_hook(void **state)
+{
+    uc_engine *uc = *state;
+    unsigned int count = 0;
+    uc_hook trace;
+
+    OK(uc_mem_write(uc, ADDRESS, loop_code, sizeof(loop_code)));
+    OK(uc_hook_add(uc, &trace, UC_HOOK_CODE, count_insn, &count, 1, 0));
+
+    OK(uc_emu_start(uc, ADDRESS, 0, 0, 7));
+    assert_int_equal(count, 7);
+
+    count = 0;
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + 2, 0, 7));
+    assert_int_equal(count, 2);
+}
+
+// Micro-benchmark: run a fixed number of instructions in slices, as a
+// scheduler interleaving several engines would.
+static void test_emu_count_bench(void **state)
+{
+    uc_engine *uc = *state;
+    struct timespec start, end;
+    uint32_t pc = ADDRESS;
+    int i;
+#define SLICES 1000
+#define SLICE 10000
+
+    OK(uc_mem_write(uc, ADDRESS, loop_code, sizeof(loop_code)));
+    clear_regs(uc);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < SLICES; i++) {
+        OK(uc_emu_start(uc, pc, 0, 0, SLICE));
+        pc = reg32(uc, UC_X86_REG_EIP);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    assert_int_equal(reg32(uc, UC_X86_REG_EAX) + reg32(uc, UC_X86_REG_EBX),
+                     (SLICES * SLICE) / 3 * 2 + (SLICES * SLICE) % 3);
+    printf("%d instructions in %.3f s\n", SLICES * SLICE,
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+#undef SLICES
+#undef SLICE
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_emu_count_precise, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_emu_count_large, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_emu_count_hook, setup32, teardown),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test_setup_teardown(test_emu_count_bench, setup32, teardown),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,156 @@
+#include "unicorn_test.h"
+#include <pthread.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/time.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define ADDRESS 0x1000000
+#define RUNS    200
+
+/* Called before every test to set up a new instance */
+static int setup32(void **state)
+{
+    uc_engine *uc;
+    // loop: inc eax ; jmp loop
+    const uint8_t code[] = { 0x40, 0xEB, 0xFD };
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, ADDRESS, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+
+    *state = uc;
+    return 0;
+}
+
+/* Called after every test to clean up */
+static int teardown(void **state)
+{
+    uc_engine *uc = *state;
+
+    OK(uc_close(uc));
+
+    *state = NULL;
+    return 0;
+}
+
+/******************************************************************************/
+
+struct supervisor {
+    uc_engine *uc;
+    int done;
+};
+
+static void *stop_loop(void *arg)
+{
+    struct supervisor *sv = arg;
+
+    // requests made between two runs are ignored, so keep asking
+    while (!__atomic_load_n(&sv->done, __ATOMIC_ACQUIRE)) {
+        OK(uc_emu_stop(sv->uc));
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+// An endless guest loop is stopped from another thread, run after run.
+static void test_emu_stop_thread(void **state)
+{
+    struct supervisor sv = { *state, 0 };
+    pthread_t thread;
+    int i;
+
+    assert_int_equal(pthread_create(&thread, NULL, stop_loop, &sv), 0);
+    for (i = 0; i < RUNS; i++) {
+        OK(uc_emu_start(sv.uc, ADDRESS, 0, 0, 0));
+    }
+    __atomic_store_n(&sv.done, 1, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+}
+
+static uc_engine *alarm_uc;
+
+static void on_alarm(int sig)
+{
+    uc_emu_stop(alarm_uc);
+}
+
+// uc_emu_stop() from a signal handler.
+static void test_emu_stop_signal(void **state)
+{
+    struct itimerval timer = { { 0, 1000 }, { 0, 1000 } };     // 1 ms
+    struct itimerval off = { { 0, 0 }, { 0, 0 } };
+    int i;
+
+    alarm_uc = *state;
+    signal(SIGALRM, on_alarm);
+    setitimer(ITIMER_REAL, &timer, NULL);
+    for (i = 0; i < RUNS / 10; i++) {
+        OK(uc_emu_start(alarm_uc, ADDRESS, 0, 0, 0));
+    }
+    setitimer(ITIMER_REAL, &off, NULL);
+    signal(SIGALRM, SIG_DFL);
+}
+
+// A 1 us timeout makes the timer thread stop the run as it begins, most
+// often before the vCPU enters its loop: the stop must not be lost.
+static void test_emu_stop_early(void **state)
+{
+    uc_engine *uc = *state;
+    int i;
+
+    for (i = 0; i < 50 * RUNS; i++) {
+        OK(uc_emu_start(uc, ADDRESS, 0, 1, 0));
+    }
+}
+
+static void *start_loop(void *arg)
+{
+    uc_engine *uc = arg;
+    int i;
+
+    for (i = 0; i < RUNS; i++) {
+        OK(uc_emu_start(uc, ADDRESS, 0, 1000, 0));     // 1 ms
+    }
+
+    return NULL;
+}
+
+// Stop requests racing with timeouts and with the start of each run.
+static void test_emu_stop_stress(void **state)
+{
+    struct supervisor sv[2] = { { *state, 0 }, { *state, 0 } };
+    pthread_t threads[2], runner;
+    uint32_t count;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        assert_int_equal(pthread_create(&threads[i], NULL, stop_loop, &sv[i]), 0);
+    }
+    assert_int_equal(pthread_create(&runner, NULL, start_loop, sv[0].uc), 0);
+    pthread_join(runner, NULL);
+    for (i = 0; i < 2; i++) {
+        __atomic_store_n(&sv[i].done, 1, __ATOMIC_RELEASE);
+        pthread_join(threads[i], NULL);
+    }
+
+    // still usable once the requests are over
+    count = 0;
+    OK(uc_reg_write(sv[0].uc, UC_X86_REG_EAX, &count));
+    OK(uc_emu_start(sv[0].uc, ADDRESS, 0, 0, 10));
+    OK(uc_reg_read(sv[0].uc, UC_X86_REG_EAX, &count));
+    assert_int_equal(count, 5);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_emu_stop_thread, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_emu_stop_signal, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_emu_stop_early, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_emu_stop_stress, setup32, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,109 @@
+#include "unicorn_test.h"
+#include <pthread.h>
+#include <time.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define ADDRESS 0x1000000
+#define NB_ENGINES 64
+
+/******************************************************************************/
+
+// loop: inc eax ; jmp loop
+static const uint8_t loop_code[] = { 0x40, 0xEB, 0xFD };
+
+static uc_engine *open_loop(void)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, ADDRESS, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, ADDRESS, loop_code, sizeof(loop_code)));
+
+    return uc;
+}
+
+static double elapsed(const struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// An endless loop is stopped by the timeout, several times in a row.
+static void test_emu_timeout_loop(void **state)
+{
+    uc_engine *uc = open_loop();
+    struct timespec start;
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        OK(uc_emu_start(uc, ADDRESS, 0, 20000, 0));     // 20 ms
+        assert_true(elapsed(&start) >= 0.02);
+        assert_true(elapsed(&start) < 1);
+    }
+
+    OK(uc_close(uc));
+}
+
+// A timeout longer than the emulation does not delay uc_emu_start().
+static void test_emu_timeout_early(void **state)
+{
+    uc_engine *uc = open_loop();
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    OK(uc_emu_start(uc, ADDRESS, 0, 10 * 1000000, 1000));   // 10 s
+    assert_true(elapsed(&start) < 1);
+
+    OK(uc_close(uc));
+}
+
+static void *run_engine(void *arg)
+{
+    uc_engine *uc = arg;
+    uint64_t timeout = 10000 + (((uintptr_t)arg >> 4) % 8) * 10000;
+
+    OK(uc_emu_start(uc, ADDRESS, 0, timeout, 0));
+
+    return NULL;
+}
+
+// Engines running concurrently, each with its own timeout.
+static void test_emu_timeout_engines(void **state)
+{
+    uc_engine *uc[NB_ENGINES];
+    pthread_t threads[NB_ENGINES];
+    struct timespec start;
+    int i;
+
+    for (i = 0; i < NB_ENGINES; i++) {
+        uc[i] = open_loop();
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < NB_ENGINES; i++) {
+        assert_int_equal(pthread_create(&threads[i], NULL, run_engine, uc[i]), 0);
+    }
+    for (i = 0; i < NB_ENGINES; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    // the longest timeout is 80 ms
+    assert_true(elapsed(&start) < 1);
+
+    for (i = 0; i < NB_ENGINES; i++) {
+        OK(uc_close(uc[i]));
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_emu_timeout_loop),
+        cmocka_unit_test(test_emu_timeout_early),
+        cmocka_unit_test(test_emu_timeout_engines),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,117 @@
+#include "unicorn_test.h"
+
+#define OK(x)   uc_assert_success(x)
+
+#define ADDRESS 0x10000
+#define MAX_BLOCKS 16
+
+/******************************************************************************/
+
+struct blocks {
+    unsigned int count;
+    uint64_t address[MAX_BLOCKS];
+    uint32_t size[MAX_BLOCKS];
+};
+
+static void hook_block(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    struct blocks *blocks = user_data;
+
+    if (blocks->count < MAX_BLOCKS) {
+        blocks->address[blocks->count] = address;
+        blocks->size[blocks->count] = size;
+    }
+    blocks->count++;
+}
+
+static void run_blocks(uc_arch arch, uc_mode mode, const uint8_t *code, size_t size,
+        struct blocks *blocks)
+{
+    uc_engine *uc;
+    uc_hook trace;
+
+    OK(uc_open(arch, mode, &uc));
+    OK(uc_mem_map(uc, ADDRESS, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, ADDRESS, code, size));
+    OK(uc_hook_add(uc, &trace, UC_HOOK_BLOCK, hook_block, blocks, 1, 0));
+
+    // twice: the second run reuses the cached translations
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + size, 0, 0));
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + size, 0, 0));
+
+    OK(uc_close(uc));
+}
+
+static void assert_blocks(const struct blocks *blocks, unsigned int count,
+        const uint64_t *address, const uint32_t *size)
+{
+    unsigned int i;
+
+    assert_int_equal(blocks->count, 2 * count);
+    for (i = 0; i < 2 * count; i++) {
+        assert_int_equal(blocks->address[i], address[i % count]);
+        assert_int_equal(blocks->size[i], size[i % count]);
+    }
+}
+
+static void test_hook_block_x86(void **state)
+{
+    struct blocks blocks = { 0 };
+    const uint8_t code[] = {
+        0x40,                   // inc eax
+        0x43,                   // inc ebx
+        0xEB, 0x01,             // jmp next
+        0x90,                   // nop (skipped)
+        0x41,                   // next: inc ecx
+        0x42,                   // inc edx
+    };
+    const uint64_t address[] = { ADDRESS, ADDRESS + 5 };
+    const uint32_t size[] = { 4, 2 };
+
+    run_blocks(UC_ARCH_X86, UC_MODE_32, code, sizeof(code), &blocks);
+    assert_blocks(&blocks, 2, address, size);
+}
+
+static void test_hook_block_arm(void **state)
+{
+    struct blocks blocks = { 0 };
+    const uint8_t code[] = {
+        0x01, 0x00, 0x80, 0xE2, // add r0, r0, #1
+        0x02, 0x10, 0x81, 0xE2, // add r1, r1, #2
+        0x00, 0x00, 0x00, 0xEA, // b next
+        0x00, 0x00, 0xA0, 0xE1, // nop (skipped)
+        0x03, 0x20, 0x82, 0xE2, // next: add r2, r2, #3
+    };
+    const uint64_t address[] = { ADDRESS, ADDRESS + 16 };
+    const uint32_t size[] = { 12, 4 };
+
+    run_blocks(UC_ARCH_ARM, UC_MODE_ARM, code, sizeof(code), &blocks);
+    assert_blocks(&blocks, 2, address, size);
+}
+
+static void test_hook_block_mips(void **state)
+{
+    struct blocks blocks = { 0 };
+    const uint8_t code[] = {
+        0x01, 0x00, 0x84, 0x24, // addiu $a0, $a0, 1
+        0x02, 0x00, 0x00, 0x10, // b next
+        0x02, 0x00, 0xA5, 0x24, // addiu $a1, $a1, 2 (delay slot)
+        0x00, 0x00, 0x00, 0x00, // nop (skipped)
+        0x03, 0x00, 0xC6, 0x24, // next: addiu $a2, $a2, 3
+    };
+    const uint64_t address[] = { ADDRESS, ADDRESS + 16 };
+    const uint32_t size[] = { 12, 4 };
+
+    run_blocks(UC_ARCH_MIPS, UC_MODE_MIPS32 | UC_MODE_LITTLE_ENDIAN, code, sizeof(code), &blocks);
+    assert_blocks(&blocks, 2, address, size);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_hook_block_x86),
+        cmocka_unit_test(test_hook_block_arm),
+        cmocka_unit_test(test_hook_block_mips),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
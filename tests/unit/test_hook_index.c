@@ -0,0 +1,336 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define ADDRESS     0x1000000
+#define NB_HOOKS    256
+#define NB_MANY     5000
+
+/* Called before every test to set up a new instance */
+static int setup32(void **state)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, ADDRESS, 2 * 1024 * 1024, UC_PROT_ALL));
+
+    *state = uc;
+    return 0;
+}
+
+/* Called after every test to clean up */
+static int teardown(void **state)
+{
+    uc_engine *uc = *state;
+
+    OK(uc_close(uc));
+
+    *state = NULL;
+    return 0;
+}
+
+/******************************************************************************/
+
+static void count_insn(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    unsigned int *count = user_data;
+
+    (*count)++;
+}
+
+// NB_HOOKS hooks, each bounded to one instruction of a run of inc eax
+static void test_hook_index_bounded(void **state)
+{
+    uc_engine *uc = *state;
+    static uint8_t code[NB_HOOKS];
+    unsigned int counts[NB_HOOKS] = { 0 };
+    unsigned int all = 0;
+    uc_hook hooks[NB_HOOKS], global;
+    int i;
+
+    memset(code, 0x40, sizeof(code));   // inc eax
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+
+    for (i = 0; i < NB_HOOKS; i++) {
+        OK(uc_hook_add(uc, &hooks[i], UC_HOOK_CODE, count_insn, &counts[i], ADDRESS + i, ADDRESS + i));
+    }
+    OK(uc_hook_add(uc, &global, UC_HOOK_CODE, count_insn, &all, 1, 0));
+
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    for (i = 0; i < NB_HOOKS; i++) {
+        assert_int_equal(counts[i], 1);
+    }
+    assert_int_equal(all, NB_HOOKS);
+
+    // every other hook removed
+    for (i = 0; i < NB_HOOKS; i += 2) {
+        OK(uc_hook_del(uc, hooks[i]));
+    }
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    for (i = 0; i < NB_HOOKS; i++) {
+        assert_int_equal(counts[i], i % 2 ? 2 : 1);
+    }
+    assert_int_equal(all, 2 * NB_HOOKS);
+}
+
+struct order {
+    unsigned int calls[8];
+    unsigned int n;
+};
+
+static void record(struct order *order, char name)
+{
+    order->calls[order->n++ % 8] = name;
+}
+
+static void record_a(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    record(user_data, 'a');
+}
+
+static void record_b(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    record(user_data, 'b');
+}
+
+static void record_c(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    record(user_data, 'c');
+}
+
+// Overlapping hooks are still called in the order they were added.
+static void test_hook_index_order(void **state)
+{
+    uc_engine *uc = *state;
+    const uint8_t code[] = { 0x40, 0x40, 0x40 };    // inc eax (x3)
+    struct order order = { { 0 }, 0 };
+    uc_hook a, b, c;
+
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+    OK(uc_hook_add(uc, &a, UC_HOOK_CODE, record_a, &order, ADDRESS + 1, ADDRESS + 2));
+    OK(uc_hook_add(uc, &b, UC_HOOK_CODE, record_b, &order, 1, 0));
+    OK(uc_hook_add(uc, &c, UC_HOOK_CODE, record_c, &order, ADDRESS, ADDRESS + 1));
+
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+
+    assert_int_equal(order.n, 7);
+    // ADDRESS: b c, ADDRESS + 1: a b c, ADDRESS + 2: a b
+    assert_int_equal(order.calls[0], 'b');
+    assert_int_equal(order.calls[1], 'c');
+    assert_int_equal(order.calls[2], 'a');
+    assert_int_equal(order.calls[3], 'b');
+    assert_int_equal(order.calls[4], 'c');
+    assert_int_equal(order.calls[5], 'a');
+    assert_int_equal(order.calls[6], 'b');
+}
+
+struct self_del {
+    uc_hook hook;
+    unsigned int count;
+};
+
+static void del_self(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    struct self_del *d = user_data;
+
+    d->count++;
+    OK(uc_hook_del(uc, d->hook));
+}
+
+// A hook deleting itself from its callback is not called again.
+static void test_hook_index_del_in_callback(void **state)
+{
+    uc_engine *uc = *state;
+    const uint8_t code[] = { 0x40, 0x40, 0x40 };    // inc eax (x3)
+    struct self_del d = { 0, 0 };
+    unsigned int count = 0;
+    uc_hook other;
+
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+    OK(uc_hook_add(uc, &d.hook, UC_HOOK_CODE, del_self, &d, 1, 0));
+    OK(uc_hook_add(uc, &other, UC_HOOK_CODE, count_insn, &count, 1, 0));
+
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    assert_int_equal(d.count, 1);
+    assert_int_equal(count, 3);
+}
+
+// Hooks added or deleted between runs only affect the code in their range,
+// which is the only code retranslated.
+static void test_hook_index_add_late(void **state)
+{
+    uc_engine *uc = *state;
+    const uint8_t code[] = {
+        0x40,                           // inc  eax
+        0xE9, 0xFA, 0x0F, 0x00, 0x00,   // jmp  ADDRESS + 0x1000
+    };
+    const uint8_t code2[] = { 0x40, 0x40 };  // inc eax (x2)
+    unsigned int count = 0;
+    uc_hook hook;
+
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+    OK(uc_mem_write(uc, ADDRESS + 0x1000, code2, sizeof(code2)));
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + 0x1000 + sizeof(code2), 0, 0));
+
+    OK(uc_hook_add(uc, &hook, UC_HOOK_CODE, count_insn, &count, ADDRESS + 0x1000, ADDRESS + 0x1fff));
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + 0x1000 + sizeof(code2), 0, 0));
+    assert_int_equal(count, 2);
+
+    OK(uc_hook_del(uc, hook));
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + 0x1000 + sizeof(code2), 0, 0));
+    assert_int_equal(count, 2);
+}
+
+static size_t query(uc_engine *uc, uc_query_type type)
+{
+    size_t result;
+
+    OK(uc_query(uc, type, &result));
+    return result;
+}
+
+// Hooks added & deleted over and over, also from their own callback: the
+// hook vectors of the retranslated code do not pile up, and only the block
+// in the hook range is invalidated each time.
+static void test_hook_index_no_leak(void **state)
+{
+    uc_engine *uc = *state;
+    const uint8_t code[] = {
+        0x40,                           // inc  eax
+        0xE9, 0xFA, 0x0F, 0x00, 0x00,   // jmp  ADDRESS + 0x1000
+    };
+    const uint8_t code2[] = {
+        0x40, 0x40,                     // inc  eax (x2)
+        0xEB, 0x01,                     // jmp  $+3, ending a block cached across runs
+        0x90,                           // nop
+    };
+    struct self_del d = { 0, 0 };
+    unsigned int count = 0;
+    size_t vectors = 0, invalidated;
+    uc_hook hook;
+    int i;
+
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+    OK(uc_mem_write(uc, ADDRESS + 0x1000, code2, sizeof(code2)));
+    OK(uc_hook_add(uc, &hook, UC_HOOK_CODE, count_insn, &count, ADDRESS, ADDRESS));
+
+    for (i = 0; i < 1000; i++) {
+        OK(uc_hook_add(uc, &d.hook, UC_HOOK_CODE, del_self, &d, ADDRESS + 0x1000, ADDRESS + 0x1fff));
+        OK(uc_emu_start(uc, ADDRESS, ADDRESS + 0x1000 + sizeof(code2), 0, 0));
+        assert_int_equal(d.count, i + 1);
+
+        OK(uc_hook_add(uc, &d.hook, UC_HOOK_CODE, count_insn, &count, ADDRESS + 0x1000, ADDRESS + 0x1fff));
+        OK(uc_emu_start(uc, ADDRESS, ADDRESS + 0x1000 + sizeof(code2), 0, 0));
+        invalidated = query(uc, UC_QUERY_TB_INVALIDATED);
+        OK(uc_hook_del(uc, d.hook));
+        assert_int_equal(query(uc, UC_QUERY_TB_INVALIDATED), invalidated + 1);
+
+        if (i == 0)
+            vectors = query(uc, UC_QUERY_HOOK_VECTORS);
+        assert_int_equal(query(uc, UC_QUERY_HOOK_VECTORS), vectors);
+    }
+    assert_int_equal(count, 5 * 1000);
+    assert_int_equal(query(uc, UC_QUERY_TB_FLUSHES), 0);
+}
+
+static double elapsed(const struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void count_out(uc_engine *uc, uint32_t port, int size, uint32_t value, void *user_data)
+{
+    unsigned int *count = user_data;
+
+    (*count)++;
+}
+
+// Thousands of code & port hooks, each bounded to its own address or port,
+// are added & half of them deleted in well under a second.
+static void test_hook_index_many(void **state)
+{
+    uc_engine *uc = *state;
+    static uint8_t code[NB_MANY + 5];
+    static unsigned int counts[NB_MANY], outs[NB_MANY];
+    static uc_hook hooks[NB_MANY], ports[NB_MANY];
+    struct timespec start;
+    int i;
+
+    memset(code, 0x40, NB_MANY);    // inc eax
+    memcpy(code + NB_MANY, "\x66\xBA\xE1\x10"   // mov  dx, 4321
+                           "\xEE", 5);            // out  dx, al
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < NB_MANY; i++) {
+        OK(uc_hook_add(uc, &hooks[i], UC_HOOK_CODE, count_insn, &counts[i], ADDRESS + i, ADDRESS + i));
+        OK(uc_hook_add(uc, &ports[i], UC_HOOK_INSN_PORT, count_out, &outs[i], i, i, UC_X86_INS_OUT));
+    }
+    for (i = 0; i < NB_MANY; i += 2) {
+        OK(uc_hook_del(uc, hooks[i]));
+        OK(uc_hook_del(uc, ports[i]));
+    }
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    assert_true(elapsed(&start) < 1);
+
+    for (i = 0; i < NB_MANY; i++) {
+        assert_int_equal(counts[i], i % 2);
+        assert_int_equal(outs[i], i == 4321);
+    }
+}
+
+// Micro-benchmark: a hot loop with many hooks bounded elsewhere.
+static void test_hook_index_bench(void **state)
+{
+    uc_engine *uc = *state;
+    const uint8_t code[] = {
+        0xB9, 0x40, 0x42, 0x0F, 0x00,   // mov  ecx, 1000000
+        0x40,                           // loop: inc eax
+        0x49,                           // dec  ecx
+        0x75, 0xFC,                     // jnz  loop
+    };
+    unsigned int counts[NB_HOOKS] = { 0 };
+    unsigned int hot = 0;
+    struct timespec start, end;
+    uc_hook hook;
+    int i;
+
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+    for (i = 0; i < NB_HOOKS; i++) {
+        OK(uc_hook_add(uc, &hook, UC_HOOK_CODE, count_insn, &counts[i],
+                    ADDRESS + 0x1000 + i * 0x100, ADDRESS + 0x1000 + i * 0x100 + 0xff));
+    }
+    OK(uc_hook_add(uc, &hook, UC_HOOK_CODE, count_insn, &hot, ADDRESS + 5, ADDRESS + 5));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    OK(uc_emu_start(uc, ADDRESS, ADDRESS + sizeof(code), 0, 0));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    assert_int_equal(hot, 1000000);
+    printf("%d bounded hooks, 3M instructions in %.3f s\n", NB_HOOKS,
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_hook_index_bounded, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_hook_index_order, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_hook_index_del_in_callback, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_hook_index_add_late, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_hook_index_no_leak, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_hook_index_many, setup32, teardown),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test_setup_teardown(test_hook_index_bench, setup32, teardown),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,247 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define CODE    0x1000000
+
+/******************************************************************************/
+
+struct device {
+    uint32_t base;
+    uint32_t value;
+    int ins, outs;
+    uint32_t last_port;
+};
+
+static uint32_t device_in(uc_engine *uc, uint32_t port, int size, void *user_data)
+{
+    struct device *dev = user_data;
+
+    dev->ins++;
+    dev->last_port = port;
+    return dev->value + (port - dev->base);
+}
+
+static void device_out(uc_engine *uc, uint32_t port, int size, uint32_t value, void *user_data)
+{
+    struct device *dev = user_data;
+
+    dev->outs++;
+    dev->last_port = port;
+    dev->value = value;
+}
+
+static uc_engine *setup_x86(const uint8_t *code, size_t size)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, CODE, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, CODE, code, size));
+
+    return uc;
+}
+
+// Each device only sees the ports of its range.
+static void test_port_ranges(void **state)
+{
+    const uint8_t code[] = {
+        0xB0, 0x41,     // mov al, 0x41
+        0xE6, 0x60,     // out 0x60, al
+        0xB0, 0x42,     // mov al, 0x42
+        0xE6, 0x71,     // out 0x71, al
+        0xE4, 0x64,     // in al, 0x64
+        0x88, 0xC3,     // mov bl, al
+        0xE4, 0x70,     // in al, 0x70
+    };
+    struct device kbd = { 0x60 }, rtc = { 0x70 };
+    uint32_t eax, ebx;
+    uc_engine *uc = setup_x86(code, sizeof(code));
+    uc_hook h1, h2, h3, h4;
+
+    OK(uc_hook_add(uc, &h1, UC_HOOK_INSN_PORT, device_in, &kbd, 0x60, 0x64, UC_X86_INS_IN));
+    OK(uc_hook_add(uc, &h2, UC_HOOK_INSN_PORT, device_out, &kbd, 0x60, 0x64, UC_X86_INS_OUT));
+    OK(uc_hook_add(uc, &h3, UC_HOOK_INSN_PORT, device_in, &rtc, 0x70, 0x71, UC_X86_INS_IN));
+    OK(uc_hook_add(uc, &h4, UC_HOOK_INSN_PORT, device_out, &rtc, 0x70, 0x71, UC_X86_INS_OUT));
+
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    OK(uc_reg_read(uc, UC_X86_REG_EBX, &ebx));
+    assert_int_equal(ebx & 0xff, 0x41 + 4);
+    assert_int_equal(eax & 0xff, 0x42);
+    assert_int_equal(kbd.ins, 1);
+    assert_int_equal(kbd.outs, 1);
+    assert_int_equal(kbd.last_port, 0x64);
+    assert_int_equal(rtc.ins, 1);
+    assert_int_equal(rtc.outs, 1);
+    assert_int_equal(rtc.last_port, 0x70);
+
+    OK(uc_close(uc));
+}
+
+// Overlapping hooks: all see OUT, the first one answers IN.
+static void test_port_overlap(void **state)
+{
+    const uint8_t code[] = {
+        0x66, 0xBA, 0xF8, 0x03, // mov dx, 0x3f8
+        0xB0, 0x55,             // mov al, 0x55
+        0xEE,                   // out dx, al
+        0xED,                   // in eax, dx
+        0xE6, 0x80,             // out 0x80, al
+    };
+    struct device uart = { 0x3f8 }, tracer = { 0 }, post = { 0x80 };
+    uint32_t eax;
+    uc_engine *uc = setup_x86(code, sizeof(code));
+    uc_hook h1, h2, h3, h4, h5;
+
+    OK(uc_hook_add(uc, &h1, UC_HOOK_INSN_PORT, device_in, &uart, 0x3f8, 0x3ff, UC_X86_INS_IN));
+    OK(uc_hook_add(uc, &h2, UC_HOOK_INSN_PORT, device_out, &uart, 0x3f8, 0x3ff, UC_X86_INS_OUT));
+    // plain UC_HOOK_INSN hooks see every port, whatever their range
+    OK(uc_hook_add(uc, &h3, UC_HOOK_INSN, device_in, &tracer, 0x1234, 0x1234, UC_X86_INS_IN));
+    OK(uc_hook_add(uc, &h4, UC_HOOK_INSN, device_out, &tracer, 0x1234, 0x1234, UC_X86_INS_OUT));
+    OK(uc_hook_add(uc, &h5, UC_HOOK_INSN_PORT, device_out, &post, 0x80, 0x80, UC_X86_INS_OUT));
+
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    assert_int_equal(eax, 0x55);
+    assert_int_equal(uart.ins, 1);
+    assert_int_equal(uart.outs, 1);
+    assert_int_equal(tracer.ins, 0);
+    assert_int_equal(tracer.outs, 2);
+    assert_int_equal(post.outs, 1);
+    assert_int_equal(post.value, 0x55);
+
+    // the catch-all answers once the device is gone
+    OK(uc_hook_del(uc, h1));
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    assert_int_equal(eax, 0x55 + 0x3f8);
+    assert_int_equal(uart.ins, 1);
+    assert_int_equal(tracer.ins, 1);
+
+    OK(uc_close(uc));
+}
+
+static void device_out_unplug(uc_engine *uc, uint32_t port, int size, uint32_t value, void *user_data)
+{
+    uc_hook *hh = user_data;
+
+    OK(uc_hook_del(uc, *hh));
+}
+
+// A hook removed by a callback is not called again.
+static void test_port_hook_del(void **state)
+{
+    const uint8_t code[] = {
+        0xE6, 0x10,     // out 0x10, al
+        0xE6, 0x10,     // out 0x10, al
+    };
+    struct device dev = { 0x10 };
+    uc_engine *uc = setup_x86(code, sizeof(code));
+    uc_hook h1, h2;
+
+    OK(uc_hook_add(uc, &h1, UC_HOOK_INSN_PORT, device_out_unplug, &h1, 0x10, 0x10, UC_X86_INS_OUT));
+    OK(uc_hook_add(uc, &h2, UC_HOOK_INSN_PORT, device_out, &dev, 0x10, 0x10, UC_X86_INS_OUT));
+
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+
+    assert_int_equal(dev.outs, 2);
+
+    OK(uc_close(uc));
+}
+
+static void hook_syscall(uc_engine *uc, void *user_data)
+{
+}
+
+// Port ranges are only for IN & OUT on x86.
+static void test_port_hook_type(void **state)
+{
+    const uint8_t code[] = { 0x90 };
+    uc_engine *uc = setup_x86(code, sizeof(code));
+    uc_hook hh;
+
+    uc_assert_err(UC_ERR_HOOK, uc_hook_add(uc, &hh, UC_HOOK_INSN_PORT, hook_syscall, NULL,
+                                           0x10, 0x10, UC_X86_INS_SYSCALL));
+    OK(uc_close(uc));
+
+    OK(uc_open(UC_ARCH_ARM, UC_MODE_ARM, &uc));
+    uc_assert_err(UC_ERR_HOOK, uc_hook_add(uc, &hh, UC_HOOK_INSN_PORT, device_out, NULL,
+                                           0x10, 0x10, UC_X86_INS_OUT));
+    OK(uc_close(uc));
+}
+
+/******************************************************************************/
+
+#define BENCH_LOOPS 1000000
+
+static double bench_run(int devices)
+{
+    const uint8_t code[] = {
+        0xEE,           // loop: out dx, al
+        0xEC,           // in al, dx
+        0x49,           // dec ecx
+        0x75, 0xFB,     // jnz loop
+    };
+    struct device *devs = calloc(devices, sizeof(*devs));
+    struct timespec start, end;
+    uint32_t ecx = BENCH_LOOPS, edx = 0x3f8;
+    uc_engine *uc = setup_x86(code, sizeof(code));
+    uc_hook hh;
+    int i;
+
+    // eight ports per device, the polled one last
+    for (i = 0; i < devices; i++) {
+        devs[i].base = 0x3f8 - 8 * (devices - 1 - i);
+        OK(uc_hook_add(uc, &hh, UC_HOOK_INSN_PORT, device_in, &devs[i],
+                       devs[i].base, devs[i].base + 7, UC_X86_INS_IN));
+        OK(uc_hook_add(uc, &hh, UC_HOOK_INSN_PORT, device_out, &devs[i],
+                       devs[i].base, devs[i].base + 7, UC_X86_INS_OUT));
+        OK(uc_hook_add(uc, &hh, UC_HOOK_INSN, hook_syscall, NULL, 1, 0, UC_X86_INS_SYSCALL));
+    }
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &ecx));
+    OK(uc_reg_write(uc, UC_X86_REG_EDX, &edx));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    assert_int_equal(devs[devices - 1].outs, BENCH_LOOPS);
+    assert_int_equal(devs[0].outs, devices == 1 ? BENCH_LOOPS : 0);
+    OK(uc_close(uc));
+    free(devs);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / (2.0 * BENCH_LOOPS);
+}
+
+// Micro-benchmark: port accesses with few or many devices hooked
+static void test_port_bench(void **state)
+{
+    double one, many;
+
+    one = bench_run(1);
+    many = bench_run(100);
+
+    printf("ns per port access: %.1f with 1 device, %.1f with 100 devices\n", one, many);
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_port_ranges),
+        cmocka_unit_test(test_port_overlap),
+        cmocka_unit_test(test_port_hook_del),
+        cmocka_unit_test(test_port_hook_type),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_port_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
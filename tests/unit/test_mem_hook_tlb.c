@@ -0,0 +1,261 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define CODE    0x1000000
+#define DATA    0x2000000
+#define PAGE    0x1000
+
+/* Called before every test to set up a new instance */
+static int setup32(void **state)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, CODE, 0x10000, UC_PROT_ALL));
+    OK(uc_mem_map(uc, DATA, 0x10000, UC_PROT_ALL));
+
+    *state = uc;
+    return 0;
+}
+
+/* Called after every test to clean up */
+static int teardown(void **state)
+{
+    uc_engine *uc = *state;
+
+    OK(uc_close(uc));
+
+    *state = NULL;
+    return 0;
+}
+
+/******************************************************************************/
+
+struct access {
+    unsigned int count;
+    uint64_t address;
+};
+
+static void hook_mem(uc_engine *uc, uc_mem_type type, uint64_t address,
+        int size, int64_t value, void *user_data)
+{
+    struct access *access = user_data;
+
+    access->count++;
+    access->address = address;
+}
+
+// mov eax, [esi] ; mov [edi], eax
+static const uint8_t copy_code[] = { 0x8B, 0x06, 0x89, 0x07 };
+
+static void run_copy(uc_engine *uc, uint32_t src, uint32_t dst)
+{
+    OK(uc_reg_write(uc, UC_X86_REG_ESI, &src));
+    OK(uc_reg_write(uc, UC_X86_REG_EDI, &dst));
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(copy_code), 0, 0));
+}
+
+// Only accesses within the hook range are reported, whether or not
+// they share a page with it.
+static void test_mem_hook_tlb_bounded(void **state)
+{
+    uc_engine *uc = *state;
+    struct access reads = { 0 }, writes = { 0 };
+    uc_hook h1, h2;
+
+    OK(uc_mem_write(uc, CODE, copy_code, sizeof(copy_code)));
+    OK(uc_hook_add(uc, &h1, UC_HOOK_MEM_READ, hook_mem, &reads, DATA + 0x100, DATA + 0x103));
+    OK(uc_hook_add(uc, &h2, UC_HOOK_MEM_WRITE, hook_mem, &writes, DATA + 2 * PAGE, DATA + 2 * PAGE + 3));
+
+    // other pages
+    run_copy(uc, DATA + 4 * PAGE, DATA + 5 * PAGE);
+    assert_int_equal(reads.count, 0);
+    assert_int_equal(writes.count, 0);
+
+    // hooked pages, outside of the ranges
+    run_copy(uc, DATA + 0x200, DATA + 2 * PAGE + 0x200);
+    assert_int_equal(reads.count, 0);
+    assert_int_equal(writes.count, 0);
+
+    // within the ranges
+    run_copy(uc, DATA + 0x100, DATA + 2 * PAGE);
+    assert_int_equal(reads.count, 1);
+    assert_int_equal(reads.address, DATA + 0x100);
+    assert_int_equal(writes.count, 1);
+    assert_int_equal(writes.address, DATA + 2 * PAGE);
+}
+
+// Hooks added or removed between runs apply to pages already in the TLB.
+static void test_mem_hook_tlb_hook_change(void **state)
+{
+    uc_engine *uc = *state;
+    struct access reads = { 0 };
+    uc_hook h;
+
+    OK(uc_mem_write(uc, CODE, copy_code, sizeof(copy_code)));
+    run_copy(uc, DATA, DATA + PAGE);
+
+    OK(uc_hook_add(uc, &h, UC_HOOK_MEM_READ, hook_mem, &reads, DATA, DATA + PAGE - 1));
+    run_copy(uc, DATA, DATA + PAGE);
+    assert_int_equal(reads.count, 1);
+
+    OK(uc_hook_del(uc, h));
+    run_copy(uc, DATA, DATA + PAGE);
+    assert_int_equal(reads.count, 1);
+}
+
+static size_t query(uc_engine *uc, uc_query_type type)
+{
+    size_t result;
+
+    OK(uc_query(uc, type, &result));
+    return result;
+}
+
+static void hook_mem_eip(uc_engine *uc, uc_mem_type type, uint64_t address,
+        int size, int64_t value, void *user_data)
+{
+    uint32_t *eip = user_data;
+
+    OK(uc_reg_read(uc, UC_X86_REG_EIP, eip));
+}
+
+// Memory hooks only reset the TLB: the cached code is kept, and hooks added
+// after it was translated still see EIP at the accessing instruction.
+static void test_mem_hook_tlb_no_retranslate(void **state)
+{
+    uc_engine *uc = *state;
+    const uint8_t code[] = {
+        0x8B, 0x06,                     // mov  eax, [esi]
+        0x89, 0x07,                     // mov  [edi], eax
+        0xEB, 0x01,                     // jmp  $+3, ending a block cached across runs
+        0x90,                           // nop
+    };
+    uint32_t src = DATA, dst = DATA + PAGE;
+    uint32_t read_eip = 0, write_eip = 0;
+    size_t translated, per_run;
+    uc_hook h1, h2;
+
+    OK(uc_mem_write(uc, CODE, code, sizeof(code)));
+    OK(uc_reg_write(uc, UC_X86_REG_ESI, &src));
+    OK(uc_reg_write(uc, UC_X86_REG_EDI, &dst));
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+    translated = query(uc, UC_QUERY_TB_TRANSLATED);
+    // the empty block at the until address is translated on each run
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+    per_run = query(uc, UC_QUERY_TB_TRANSLATED) - translated;
+    assert_int_equal(per_run, 1);
+    translated += per_run;
+
+    OK(uc_hook_add(uc, &h1, UC_HOOK_MEM_READ, hook_mem_eip, &read_eip, DATA, DATA + 3));
+    OK(uc_hook_add(uc, &h2, UC_HOOK_MEM_WRITE, hook_mem_eip, &write_eip, 1, 0));
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+    assert_int_equal(read_eip, CODE);
+    assert_int_equal(write_eip, CODE + 2);
+
+    OK(uc_hook_del(uc, h1));
+    OK(uc_hook_del(uc, h2));
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+    assert_int_equal(query(uc, UC_QUERY_TB_TRANSLATED), translated + 2 * per_run);
+    assert_int_equal(query(uc, UC_QUERY_TB_FLUSHES), 0);
+}
+
+static bool hook_invalid_eip(uc_engine *uc, uc_mem_type type, uint64_t address,
+        int size, int64_t value, void *user_data)
+{
+    uint32_t *eip = user_data;
+
+    OK(uc_reg_read(uc, UC_X86_REG_EIP, eip));
+    return false;
+}
+
+// Hooks on unmapped or protected memory see EIP at the faulting instruction,
+// also after hooked accesses of the same block.
+static void test_mem_hook_tlb_invalid_eip(void **state)
+{
+    uc_engine *uc = *state;
+    uint8_t code[] = {
+        0xB8, 0x00, 0x30, 0x00, 0x02,           // mov  eax, DATA + 0x3000
+        0x8B, 0x08,                             // mov  ecx, [eax]
+        0x89, 0x48, 0x04,                       // mov  [eax + 4], ecx
+        0x8B, 0x15, 0x00, 0x00, 0x50, 0x00,     // mov  edx, [0x500000]
+    };
+    struct access reads = { 0 }, writes = { 0 };
+    uint32_t unmapped_eip = 0, prot_eip = 0;
+    uc_hook h1, h2, h3, h4;
+
+    OK(uc_mem_write(uc, CODE, code, sizeof(code)));
+    OK(uc_hook_add(uc, &h1, UC_HOOK_MEM_READ, hook_mem, &reads, DATA + 0x3000, DATA + 0x3fff));
+    OK(uc_hook_add(uc, &h2, UC_HOOK_MEM_WRITE, hook_mem, &writes, DATA + 0x3000, DATA + 0x3fff));
+    OK(uc_hook_add(uc, &h3, UC_HOOK_MEM_READ_UNMAPPED, hook_invalid_eip, &unmapped_eip, 1, 0));
+    OK(uc_hook_add(uc, &h4, UC_HOOK_MEM_WRITE_PROT, hook_invalid_eip, &prot_eip, 1, 0));
+
+    uc_assert_err(UC_ERR_READ_UNMAPPED, uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+    assert_int_equal(reads.count, 1);
+    assert_int_equal(writes.count, 1);
+    assert_int_equal(unmapped_eip, CODE + 10);
+
+    // mov  [DATA + 0x8000], edx
+    code[10] = 0x89;
+    code[12] = 0x00;
+    code[13] = 0x80;
+    code[14] = 0x00;
+    code[15] = 0x02;
+    OK(uc_mem_write(uc, CODE, code, sizeof(code)));
+    OK(uc_mem_protect(uc, DATA + 0x8000, PAGE, UC_PROT_READ));
+    uc_assert_err(UC_ERR_WRITE_PROT, uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+    assert_int_equal(reads.count, 2);
+    assert_int_equal(writes.count, 2);
+    assert_int_equal(prot_eip, CODE + 10);
+}
+
+// Micro-benchmark: a loop over unhooked memory while a bounded read hook
+// watches another page, which used to force every access to the slow path.
+static void test_mem_hook_tlb_bench(void **state)
+{
+    uc_engine *uc = *state;
+    struct access reads = { 0 };
+    struct timespec start, end;
+    uc_hook h;
+    const uint8_t code[] = {
+        0xB9, 0x40, 0x42, 0x0F, 0x00,   // mov  ecx, 1000000
+        0x8B, 0x06,                     // loop: mov eax, [esi]
+        0x89, 0x07,                     // mov  [edi], eax
+        0x49,                           // dec  ecx
+        0x75, 0xF9,                     // jnz  loop
+    };
+    uint32_t src = DATA, dst = DATA + PAGE;
+
+    OK(uc_mem_write(uc, CODE, code, sizeof(code)));
+    OK(uc_hook_add(uc, &h, UC_HOOK_MEM_READ, hook_mem, &reads, DATA + 8 * PAGE, DATA + 8 * PAGE + 3));
+    OK(uc_reg_write(uc, UC_X86_REG_ESI, &src));
+    OK(uc_reg_write(uc, UC_X86_REG_EDI, &dst));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    assert_int_equal(reads.count, 0);
+    printf("1000000 iterations in %.3f s\n",
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_mem_hook_tlb_bounded, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_mem_hook_tlb_hook_change, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_mem_hook_tlb_no_retranslate, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_mem_hook_tlb_invalid_eip, setup32, teardown),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test_setup_teardown(test_mem_hook_tlb_bench, setup32, teardown),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,170 @@
+#include "unicorn_test.h"
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define BASE    0x100000
+#define SIZE    0x4000
+
+/******************************************************************************/
+
+static uc_engine *open_x86(void)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, BASE, SIZE, UC_PROT_ALL));
+
+    return uc;
+}
+
+// The pointer and the copying API see the same bytes.
+static void test_host_ptr_rw(void **state)
+{
+    uc_engine *uc = open_x86();
+    uint32_t val = 0x11223344;
+    uint8_t *ptr;
+
+    OK(uc_mem_get_host_ptr(uc, BASE + 0x1000, 0x1000, (void **)&ptr));
+
+    OK(uc_mem_write(uc, BASE + 0x1010, &val, sizeof(val)));
+    assert_memory_equal(ptr + 0x10, &val, sizeof(val));
+
+    ptr[0x20] = 0xAB;
+    OK(uc_mem_host_written(uc, BASE + 0x1020, 1));
+    OK(uc_mem_read(uc, BASE + 0x1020, &val, 1));
+    assert_int_equal(val & 0xFF, 0xAB);
+
+    OK(uc_close(uc));
+}
+
+// Code patched through the pointer runs once the write is reported.
+static void test_host_ptr_code(void **state)
+{
+    uc_engine *uc = open_x86();
+    const uint8_t code[] = { 0xB8, 0x01, 0x00, 0x00, 0x00 };   // mov eax, 1
+    uint8_t *ptr;
+    uint32_t eax;
+
+    OK(uc_mem_get_host_ptr(uc, BASE, sizeof(code), (void **)&ptr));
+    memcpy(ptr, code, sizeof(code));
+    OK(uc_mem_host_written(uc, BASE, sizeof(code)));
+
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    assert_int_equal(eax, 1);
+
+    ptr[1] = 0x02;
+    OK(uc_mem_host_written(uc, BASE + 1, 1));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    assert_int_equal(eax, 2);
+
+    OK(uc_close(uc));
+}
+
+// Reported writes are rolled back by a snapshot.
+static void test_host_ptr_snapshot(void **state)
+{
+    uc_engine *uc = open_x86();
+    uc_snapshot *snap;
+    uint8_t *ptr;
+
+    OK(uc_mem_get_host_ptr(uc, BASE, SIZE, (void **)&ptr));
+    ptr[0x2000] = 1;
+    OK(uc_snapshot_take(uc, &snap));
+
+    ptr[0x2000] = 2;
+    OK(uc_mem_host_written(uc, BASE + 0x2000, 1));
+    OK(uc_snapshot_restore(uc, snap));
+    assert_int_equal(ptr[0x2000], 1);
+
+    OK(uc_snapshot_free(snap));
+    OK(uc_close(uc));
+}
+
+static void test_host_ptr_arg(void **state)
+{
+    uc_engine *uc = open_x86();
+    void *ptr;
+
+    OK(uc_mem_map(uc, BASE + SIZE, 0x1000, UC_PROT_ALL));
+
+    OK(uc_mem_get_host_ptr(uc, BASE + SIZE - 4, 4, &ptr));
+    uc_assert_err(UC_ERR_ARG, uc_mem_get_host_ptr(uc, BASE, 0, &ptr));
+    // adjacent regions are not contiguous on the host
+    uc_assert_err(UC_ERR_ARG, uc_mem_get_host_ptr(uc, BASE + SIZE - 4, 8, &ptr));
+    uc_assert_err(UC_ERR_READ_UNMAPPED, uc_mem_get_host_ptr(uc, BASE - 4, 4, &ptr));
+
+    // but a write may cover both
+    OK(uc_mem_host_written(uc, BASE + SIZE - 4, 8));
+    uc_assert_err(UC_ERR_WRITE_UNMAPPED, uc_mem_host_written(uc, BASE + SIZE, 0x2000));
+
+    OK(uc_close(uc));
+}
+
+/******************************************************************************/
+
+#define BENCH_SIZE (16 * 1024 * 1024)
+#define BENCH_LOOPS 10
+
+// Micro-benchmark: reading a large region by copy or in place
+static void test_host_ptr_bench(void **state)
+{
+    uc_engine *uc;
+    uint8_t *copy = malloc(BENCH_SIZE), *ptr;
+    struct timespec start, end;
+    double copied, direct;
+    uint64_t sum = 0;
+    size_t i;
+    int n;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, BASE, BENCH_SIZE, UC_PROT_ALL));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (n = 0; n < BENCH_LOOPS; n++) {
+        OK(uc_mem_read(uc, BASE, copy, BENCH_SIZE));
+        sum += copy[n];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    copied = ((end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6) / BENCH_LOOPS;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (n = 0; n < BENCH_LOOPS; n++) {
+        OK(uc_mem_get_host_ptr(uc, BASE, BENCH_SIZE, (void **)&ptr));
+        sum += ptr[n];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    direct = ((end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6) / BENCH_LOOPS;
+
+    printf("ms to get %d MB: %.3f with uc_mem_read, %.3f with uc_mem_get_host_ptr\n",
+           BENCH_SIZE >> 20, copied, direct);
+
+    for (i = 0; i < BENCH_SIZE; i += 4096) {
+        sum += ptr[i];
+    }
+    assert_int_equal(sum, 0);
+
+    free(copy);
+    OK(uc_close(uc));
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_host_ptr_rw),
+        cmocka_unit_test(test_host_ptr_code),
+        cmocka_unit_test(test_host_ptr_snapshot),
+        cmocka_unit_test(test_host_ptr_arg),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_host_ptr_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
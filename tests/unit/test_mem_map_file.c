@@ -0,0 +1,219 @@
+#include "unicorn_test.h"
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define BASE    0x100000
+#define PAGE    0x1000
+
+/******************************************************************************/
+
+// resident memory of this process, in KB
+static long rss_kb(void)
+{
+    FILE *f = fopen("/proc/self/statm", "r");
+    long size, resident = 0;
+
+    if (f) {
+        if (fscanf(f, "%ld %ld", &size, &resident) != 2)
+            resident = 0;
+        fclose(f);
+    }
+
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// a temporary file holding @size bytes of @data, or zeros past it
+static int temp_file(const void *data, size_t len, size_t size)
+{
+    char path[] = "/tmp/unicorn_map_XXXXXX";
+    int fd = mkstemp(path);
+
+    assert_true(fd >= 0);
+    unlink(path);
+    assert_int_equal(ftruncate(fd, size), 0);
+    assert_int_equal(pwrite(fd, data, len, 0), len);
+
+    return fd;
+}
+
+#define SPARSE_BASE 0x100000000ULL
+#define SPARSE_SIZE (64ULL << 30)
+
+// Only the pages touched in a 64 GB mapping take memory.
+static void test_map_sparse(void **state)
+{
+    uc_engine *uc;
+    uint64_t i, val;
+    long before, after;
+
+    // no room for it on a 32-bit host
+    if (sizeof(size_t) < 8)
+        return;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_64, &uc));
+    before = rss_kb();
+    OK(uc_mem_map_file(uc, SPARSE_BASE, (size_t)SPARSE_SIZE, UC_PROT_READ | UC_PROT_WRITE,
+                       -1, 0, true));
+
+    for (i = 0; i < 64; i++) {
+        val = i + 1;
+        OK(uc_mem_write(uc, SPARSE_BASE + i * (1ULL << 30), &val, sizeof(val)));
+    }
+    for (i = 0; i < 64; i++) {
+        OK(uc_mem_read(uc, SPARSE_BASE + i * (1ULL << 30), &val, sizeof(val)));
+        assert_int_equal(val, i + 1);
+        OK(uc_mem_read(uc, SPARSE_BASE + i * (1ULL << 30) + 8, &val, sizeof(val)));
+        assert_int_equal(val, 0);
+    }
+    after = rss_kb();
+
+    // the bookkeeping per page is a few bits, the pages themselves are not there
+    assert_true(after - before < 64 * 1024);
+
+    OK(uc_mem_unmap(uc, SPARSE_BASE, (size_t)SPARSE_SIZE));
+    OK(uc_close(uc));
+}
+
+// A private mapping runs the code of the file, and keeps its writes.
+static void test_map_file_private(void **state)
+{
+    const uint8_t code[] = {
+        0xA1, 0x00, 0x10, 0x10, 0x00,   // mov eax, [BASE + PAGE]
+        0x40,                           // inc eax
+        0xA3, 0x00, 0x10, 0x10, 0x00,   // mov [BASE + PAGE], eax
+    };
+    uint8_t image[PAGE + 4] = { 0 };
+    uint32_t eax, val;
+    uc_engine *uc;
+    int fd;
+
+    memcpy(image, code, sizeof(code));
+    image[PAGE] = 41;
+    fd = temp_file(image, sizeof(image), 2 * PAGE);
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map_file(uc, BASE, PAGE, UC_PROT_READ | UC_PROT_EXEC, fd, 0, true));
+    OK(uc_mem_map_file(uc, BASE + PAGE, PAGE, UC_PROT_READ | UC_PROT_WRITE, fd, PAGE, true));
+    close(fd);
+
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    assert_int_equal(eax, 42);
+    OK(uc_mem_read(uc, BASE + PAGE, &val, sizeof(val)));
+    assert_int_equal(val, 42);
+
+    OK(uc_close(uc));
+}
+
+// A shared mapping writes to the file.
+static void test_map_file_shared(void **state)
+{
+    uint32_t val = 0x12345678, in_file = 0;
+    uc_engine *uc;
+    int fd = temp_file(&in_file, sizeof(in_file), PAGE);
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map_file(uc, BASE, PAGE, UC_PROT_READ | UC_PROT_WRITE, fd, 0, false));
+    OK(uc_mem_write(uc, BASE + 4, &val, sizeof(val)));
+
+    assert_int_equal(pread(fd, &in_file, sizeof(in_file), 4), sizeof(in_file));
+    assert_int_equal(in_file, 0x12345678);
+
+    // the private mapping of the same file does not write to it
+    OK(uc_mem_map_file(uc, BASE + PAGE, PAGE, UC_PROT_READ | UC_PROT_WRITE, fd, 0, true));
+    val = 1;
+    OK(uc_mem_write(uc, BASE + PAGE + 4, &val, sizeof(val)));
+    assert_int_equal(pread(fd, &in_file, sizeof(in_file), 4), sizeof(in_file));
+    assert_int_equal(in_file, 0x12345678);
+
+    close(fd);
+    OK(uc_close(uc));
+}
+
+static void test_map_file_arg(void **state)
+{
+    uc_engine *uc;
+    int fd = temp_file("", 0, 2 * PAGE);
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    uc_assert_err(UC_ERR_ARG, uc_mem_map_file(uc, BASE + 1, PAGE, UC_PROT_ALL, fd, 0, true));
+    uc_assert_err(UC_ERR_ARG, uc_mem_map_file(uc, BASE, 0, UC_PROT_ALL, fd, 0, true));
+    uc_assert_err(UC_ERR_ARG, uc_mem_map_file(uc, BASE, PAGE, UC_PROT_ALL, -2, 0, true));
+    // not an open file
+    uc_assert_err(UC_ERR_ARG, uc_mem_map_file(uc, BASE, PAGE, UC_PROT_ALL, fd + 100, 0, true));
+    // past the end of the file
+    uc_assert_err(UC_ERR_ARG, uc_mem_map_file(uc, BASE, 3 * PAGE, UC_PROT_ALL, fd, 0, true));
+    uc_assert_err(UC_ERR_ARG, uc_mem_map_file(uc, BASE, 2 * PAGE, UC_PROT_ALL, fd, PAGE, true));
+    uc_assert_err(UC_ERR_ARG, uc_mem_map_file(uc, BASE, PAGE, UC_PROT_ALL, fd, 4 * PAGE, true));
+    // not aligned to the host pages
+    uc_assert_err(UC_ERR_NOMEM, uc_mem_map_file(uc, BASE, PAGE, UC_PROT_ALL, fd, 1, true));
+
+    // nothing left behind by the failures
+    OK(uc_mem_map_file(uc, BASE, PAGE, UC_PROT_ALL, fd, 0, true));
+    uc_assert_err(UC_ERR_MAP, uc_mem_map(uc, BASE, PAGE, UC_PROT_ALL));
+
+    close(fd);
+    OK(uc_close(uc));
+}
+
+/******************************************************************************/
+
+#define BENCH_SIZE (64 * 1024 * 1024)
+
+// Micro-benchmark: loading an image by copy or by mapping it
+static void test_map_file_bench(void **state)
+{
+    uint8_t *image = calloc(1, BENCH_SIZE);
+    struct timespec start, end;
+    double copied, mapped;
+    uc_engine *uc;
+    int fd;
+
+    image[BENCH_SIZE - 1] = 0x90;
+    fd = temp_file(image, BENCH_SIZE, BENCH_SIZE);
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert_int_equal(pread(fd, image, BENCH_SIZE, 0), BENCH_SIZE);
+    OK(uc_mem_map(uc, BASE, BENCH_SIZE, UC_PROT_ALL));
+    OK(uc_mem_write(uc, BASE, image, BENCH_SIZE));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    copied = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    OK(uc_mem_unmap(uc, BASE, BENCH_SIZE));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    OK(uc_mem_map_file(uc, BASE, BENCH_SIZE, UC_PROT_ALL, fd, 0, true));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    mapped = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+
+    printf("ms to load a %d MB image: %.3f with uc_mem_write, %.3f with uc_mem_map_file\n",
+           BENCH_SIZE >> 20, copied, mapped);
+
+    OK(uc_emu_start(uc, BASE + BENCH_SIZE - 1, BASE + BENCH_SIZE, 0, 0));
+
+    close(fd);
+    free(image);
+    OK(uc_close(uc));
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_map_sparse),
+        cmocka_unit_test(test_map_file_private),
+        cmocka_unit_test(test_map_file_shared),
+        cmocka_unit_test(test_map_file_arg),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_map_file_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
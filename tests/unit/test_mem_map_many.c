@@ -0,0 +1,167 @@
+#include "unicorn_test.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define BASE        0x100000
+#define PAGE        0x1000
+#define NB_REGIONS  500
+// QEMU encodes the section index of a page in its TLB entry,
+// which caps a flat view to TARGET_PAGE_SIZE sections
+#define NB_REGIONS_MAX  4000
+#define NB_READS    1000000
+
+/* Called before every test to set up a new instance */
+static int setup32(void **state)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+
+    *state = uc;
+    return 0;
+}
+
+/* Called after every test to clean up */
+static int teardown(void **state)
+{
+    uc_engine *uc = *state;
+
+    OK(uc_close(uc));
+
+    *state = NULL;
+    return 0;
+}
+
+/******************************************************************************/
+
+static double elapsed(const struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// region i lives at BASE + 2 * i * PAGE, leaving a one page hole after it
+static uint64_t region_addr(unsigned int i)
+{
+    return BASE + 2ULL * i * PAGE;
+}
+
+static void shuffle(unsigned int *order, unsigned int n)
+{
+    unsigned int i, j, tmp;
+
+    for (i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    for (i = n - 1; i > 0; i--) {
+        j = rand() % (i + 1);
+        tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+}
+
+// Regions mapped out of order are still found, reported sorted,
+// and holes between them stay unmapped.
+static void test_mem_map_unordered(void **state)
+{
+    uc_engine *uc = *state;
+    unsigned int order[64];
+    uc_mem_region *regions;
+    uint32_t count, i;
+    uint32_t val;
+
+    srand(1);
+    shuffle(order, 64);
+    for (i = 0; i < 64; i++) {
+        OK(uc_mem_map(uc, region_addr(order[i]), PAGE, UC_PROT_ALL));
+        val = order[i];
+        OK(uc_mem_write(uc, region_addr(order[i]), &val, sizeof(val)));
+    }
+
+    for (i = 0; i < 64; i++) {
+        OK(uc_mem_read(uc, region_addr(i), &val, sizeof(val)));
+        assert_int_equal(val, i);
+        uc_assert_err(UC_ERR_READ_UNMAPPED, uc_mem_read(uc, region_addr(i) + PAGE, &val, sizeof(val)));
+    }
+
+    // overlapping with the first, the last and a middle region
+    uc_assert_err(UC_ERR_MAP, uc_mem_map(uc, BASE - PAGE, 2 * PAGE, UC_PROT_ALL));
+    uc_assert_err(UC_ERR_MAP, uc_mem_map(uc, region_addr(63), PAGE, UC_PROT_ALL));
+    uc_assert_err(UC_ERR_MAP, uc_mem_map(uc, region_addr(10) + PAGE, 3 * PAGE, UC_PROT_ALL));
+    // filling a hole is fine
+    OK(uc_mem_map(uc, region_addr(10) + PAGE, PAGE, UC_PROT_ALL));
+    OK(uc_mem_unmap(uc, region_addr(10) + PAGE, PAGE));
+
+    OK(uc_mem_unmap(uc, region_addr(20), PAGE));
+    uc_assert_err(UC_ERR_READ_UNMAPPED, uc_mem_read(uc, region_addr(20), &val, sizeof(val)));
+    OK(uc_mem_read(uc, region_addr(21), &val, sizeof(val)));
+    assert_int_equal(val, 21);
+
+    OK(uc_mem_regions(uc, &regions, &count));
+    assert_int_equal(count, 63);
+    for (i = 1; i < count; i++) {
+        assert_true(regions[i - 1].end < regions[i].begin);
+    }
+    OK(uc_free(regions));
+}
+
+// Map @nb_regions regions, then read them in random order.
+static void mem_map_bench(uc_engine *uc, unsigned int nb_regions)
+{
+    static unsigned int order[NB_REGIONS_MAX];
+    struct timespec start;
+    unsigned int i;
+    uint32_t val;
+    double t;
+
+    srand(2);
+    shuffle(order, nb_regions);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < nb_regions; i++) {
+        OK(uc_mem_map(uc, region_addr(order[i]), PAGE, UC_PROT_ALL));
+    }
+    t = elapsed(&start);
+    printf("mapped %u regions in %.3f s (%.1f us each)\n", nb_regions, t,
+           t * 1e6 / nb_regions);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < NB_READS; i++) {
+        OK(uc_mem_read(uc, region_addr(rand() % nb_regions), &val, sizeof(val)));
+    }
+    printf("%d random reads in %.3f s\n", NB_READS, elapsed(&start));
+}
+
+// Micro-benchmark: map many regions, then read them in random order.
+static void test_mem_map_bench(void **state)
+{
+    mem_map_bench(*state, NB_REGIONS);
+}
+
+// Same with as many regions as a flat view can hold, to check how mapping
+// scales. Takes a while.
+static void test_mem_map_bench_max(void **state)
+{
+    mem_map_bench(*state, NB_REGIONS_MAX);
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_mem_map_unordered, setup32, teardown),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test_setup_teardown(test_mem_map_bench, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_mem_map_bench_max, setup32, teardown),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
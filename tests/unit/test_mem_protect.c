@@ -0,0 +1,250 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define CODE    0x1000
+#define DATA    0x100000
+#define PAGE    0x1000
+#define PAGES   16
+
+/******************************************************************************/
+
+// mov dword ptr [ebx], eax
+static const uint8_t x86_store[] = { 0x89, 0x03 };
+
+static uc_engine *open_x86(void)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, CODE, PAGE, UC_PROT_READ | UC_PROT_EXEC));
+    OK(uc_mem_write(uc, CODE, x86_store, sizeof(x86_store)));
+    OK(uc_mem_map(uc, DATA, PAGES * PAGE, UC_PROT_READ | UC_PROT_WRITE));
+
+    return uc;
+}
+
+static uc_err store(uc_engine *uc, uint64_t address, uint32_t value)
+{
+    uint32_t ebx = (uint32_t)address;
+
+    OK(uc_reg_write(uc, UC_X86_REG_EBX, &ebx));
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &value));
+
+    return uc_emu_start(uc, CODE, CODE + sizeof(x86_store), 0, 0);
+}
+
+static uint32_t count_regions(uc_engine *uc)
+{
+    uc_mem_region *regions;
+    uint32_t count;
+
+    OK(uc_mem_regions(uc, &regions, &count));
+    uc_free(regions);
+
+    return count;
+}
+
+// One page changes, its neighbours and the data stay as they were.
+static void test_protect_page(void **state)
+{
+    uc_engine *uc = open_x86();
+    uc_mem_region *regions;
+    uint32_t count, val = 0x11223344;
+    void *before, *after;
+
+    OK(uc_mem_write(uc, DATA + 5 * PAGE, &val, sizeof(val)));
+    OK(uc_mem_get_host_ptr(uc, DATA, PAGES * PAGE, &before));
+    // warm the TLB entry of the page first
+    OK(store(uc, DATA + 5 * PAGE + 8, 1));
+
+    OK(uc_mem_protect(uc, DATA + 5 * PAGE, PAGE, UC_PROT_READ));
+
+    uc_assert_err(UC_ERR_WRITE_PROT, store(uc, DATA + 5 * PAGE + 8, 2));
+    OK(store(uc, DATA + 4 * PAGE, 3));
+    OK(store(uc, DATA + 6 * PAGE, 4));
+
+    // the region did not move
+    OK(uc_mem_get_host_ptr(uc, DATA, PAGES * PAGE, &after));
+    assert_true(before == after);
+    OK(uc_mem_read(uc, DATA + 5 * PAGE, &val, sizeof(val)));
+    assert_int_equal(val, 0x11223344);
+    OK(uc_mem_read(uc, DATA + 5 * PAGE + 8, &val, sizeof(val)));
+    assert_int_equal(val, 1);
+
+    OK(uc_mem_regions(uc, &regions, &count));
+    assert_int_equal(count, 4);
+    assert_int_equal(regions[1].begin, DATA);
+    assert_int_equal(regions[1].end, DATA + 5 * PAGE - 1);
+    assert_int_equal(regions[1].perms, UC_PROT_READ | UC_PROT_WRITE);
+    assert_int_equal(regions[2].begin, DATA + 5 * PAGE);
+    assert_int_equal(regions[2].end, DATA + 6 * PAGE - 1);
+    assert_int_equal(regions[2].perms, UC_PROT_READ);
+    assert_int_equal(regions[3].begin, DATA + 6 * PAGE);
+    assert_int_equal(regions[3].end, DATA + PAGES * PAGE - 1);
+    uc_free(regions);
+
+    // back to a single region once the pages agree again
+    OK(uc_mem_protect(uc, DATA + 5 * PAGE, PAGE, UC_PROT_READ | UC_PROT_WRITE));
+    assert_int_equal(count_regions(uc), 2);
+    OK(store(uc, DATA + 5 * PAGE + 8, 2));
+
+    OK(uc_close(uc));
+}
+
+// A writable page in a read-only region.
+static void test_protect_writable_page(void **state)
+{
+    uc_engine *uc = open_x86();
+
+    OK(uc_mem_protect(uc, DATA, PAGES * PAGE, UC_PROT_READ));
+    OK(uc_mem_protect(uc, DATA + 2 * PAGE, PAGE, UC_PROT_READ | UC_PROT_WRITE));
+
+    OK(store(uc, DATA + 2 * PAGE, 1));
+    uc_assert_err(UC_ERR_WRITE_PROT, store(uc, DATA + 3 * PAGE, 1));
+    uc_assert_err(UC_ERR_WRITE_PROT, store(uc, DATA + PAGE, 1));
+
+    OK(uc_close(uc));
+}
+
+// Removing EXEC from a page drops the code already translated from it.
+static void test_protect_exec(void **state)
+{
+    uc_engine *uc = open_x86();
+    const uint8_t code[] = { 0x40, 0x40 };  // inc eax (x2)
+
+    OK(uc_mem_protect(uc, DATA, PAGES * PAGE, UC_PROT_ALL));
+    OK(uc_mem_write(uc, DATA + 3 * PAGE, code, sizeof(code)));
+    OK(uc_emu_start(uc, DATA + 3 * PAGE, DATA + 3 * PAGE + sizeof(code), 0, 0));
+
+    OK(uc_mem_protect(uc, DATA + 3 * PAGE, PAGE, UC_PROT_READ | UC_PROT_WRITE));
+    uc_assert_err(UC_ERR_FETCH_PROT,
+                  uc_emu_start(uc, DATA + 3 * PAGE, DATA + 3 * PAGE + sizeof(code), 0, 0));
+
+    // but the data of the page is still writable
+    OK(store(uc, DATA + 3 * PAGE + 0x100, 1));
+
+    OK(uc_close(uc));
+}
+
+// Memory of uc_mem_map_ptr() stays the caller's buffer.
+static void test_protect_ptr(void **state)
+{
+    static uint32_t buffer[PAGES * PAGE / 4];
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, CODE, PAGE, UC_PROT_READ | UC_PROT_EXEC));
+    OK(uc_mem_write(uc, CODE, x86_store, sizeof(x86_store)));
+    OK(uc_mem_map_ptr(uc, DATA, sizeof(buffer), UC_PROT_READ | UC_PROT_WRITE, buffer));
+
+    OK(uc_mem_protect(uc, DATA + PAGE, PAGE, UC_PROT_READ));
+    uc_assert_err(UC_ERR_WRITE_PROT, store(uc, DATA + PAGE, 1));
+    OK(store(uc, DATA + 2 * PAGE, 0x55667788));
+    assert_int_equal(buffer[2 * PAGE / 4], 0x55667788);
+
+    OK(uc_close(uc));
+}
+
+// Snapshots bring the page permissions back.
+static void test_protect_snapshot(void **state)
+{
+    uc_engine *uc = open_x86();
+    uc_snapshot *snap;
+
+    OK(uc_mem_protect(uc, DATA + PAGE, PAGE, UC_PROT_READ));
+    OK(uc_snapshot_take(uc, &snap));
+
+    OK(uc_mem_protect(uc, DATA + PAGE, PAGE, UC_PROT_READ | UC_PROT_WRITE));
+    OK(uc_mem_protect(uc, DATA + 7 * PAGE, PAGE, UC_PROT_NONE));
+    OK(store(uc, DATA + PAGE, 1));
+
+    OK(uc_snapshot_restore(uc, snap));
+    assert_int_equal(count_regions(uc), 4);
+    uc_assert_err(UC_ERR_WRITE_PROT, store(uc, DATA + PAGE, 2));
+    OK(store(uc, DATA + 7 * PAGE, 3));
+
+    OK(uc_snapshot_free(snap));
+    OK(uc_close(uc));
+}
+
+// Pieces left by a partial unmap keep the permissions of their pages.
+static void test_protect_unmap(void **state)
+{
+    uc_engine *uc = open_x86();
+
+    OK(uc_mem_protect(uc, DATA + PAGE, PAGE, UC_PROT_READ));
+    OK(uc_mem_protect(uc, DATA + 12 * PAGE, PAGE, UC_PROT_READ));
+    OK(uc_mem_unmap(uc, DATA + 8 * PAGE, PAGE));
+
+    uc_assert_err(UC_ERR_WRITE_PROT, store(uc, DATA + PAGE, 1));
+    uc_assert_err(UC_ERR_WRITE_PROT, store(uc, DATA + 12 * PAGE, 1));
+    uc_assert_err(UC_ERR_WRITE_UNMAPPED, store(uc, DATA + 8 * PAGE, 1));
+    OK(store(uc, DATA + 13 * PAGE, 1));
+    // code, 3 runs, 3 runs
+    assert_int_equal(count_regions(uc), 7);
+
+    OK(uc_close(uc));
+}
+
+/******************************************************************************/
+
+#define BENCH_SIZE (256 * 1024 * 1024)
+#define BENCH_LOOPS 100
+
+static double protect_bench(uc_engine *uc)
+{
+    struct timespec start, end;
+    int n;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (n = 0; n < BENCH_LOOPS; n++) {
+        OK(uc_mem_protect(uc, DATA + 0x1000, PAGE, UC_PROT_READ));
+        OK(uc_mem_protect(uc, DATA + 0x1000, PAGE, UC_PROT_READ | UC_PROT_WRITE));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6) / (2 * BENCH_LOOPS);
+}
+
+// Micro-benchmark: flipping the protection of one page of a large region,
+// first alone, then while another page keeps different perms
+static void test_protect_bench(void **state)
+{
+    uc_engine *uc;
+    double alone, differing;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, DATA, BENCH_SIZE, UC_PROT_READ | UC_PROT_WRITE));
+
+    alone = protect_bench(uc);
+    OK(uc_mem_protect(uc, DATA + BENCH_SIZE - PAGE, PAGE, UC_PROT_READ));
+    differing = protect_bench(uc);
+    assert_int_equal(count_regions(uc), 2);
+
+    printf("ms per uc_mem_protect() of one page in a %d MB region: %.3f, %.3f "
+           "with other pages differing\n", BENCH_SIZE >> 20, alone, differing);
+
+    OK(uc_close(uc));
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_protect_page),
+        cmocka_unit_test(test_protect_writable_page),
+        cmocka_unit_test(test_protect_exec),
+        cmocka_unit_test(test_protect_ptr),
+        cmocka_unit_test(test_protect_snapshot),
+        cmocka_unit_test(test_protect_unmap),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_protect_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,262 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define BASE    0x100000
+#define DATA    0x102000
+#define OTHER   0x103000
+
+/******************************************************************************/
+
+// mov dword ptr [DATA], 42 ; mov eax, [DATA] ; mov dword ptr [OTHER], 7
+static const uint8_t x86_code[] = {
+    0xC7, 0x05, 0x00, 0x20, 0x10, 0x00, 0x2A, 0x00, 0x00, 0x00,
+    0xA1, 0x00, 0x20, 0x10, 0x00,
+    0xC7, 0x05, 0x00, 0x30, 0x10, 0x00, 0x07, 0x00, 0x00, 0x00,
+};
+
+// every record received, and the number of calls
+struct trace {
+    int flushes;
+    size_t n;
+    uc_mem_access records[16];
+};
+
+static void trace_flush(uc_engine *uc, const uc_mem_access *records,
+                        size_t count, void *user_data)
+{
+    struct trace *trace = user_data;
+    size_t i;
+
+    trace->flushes++;
+    for (i = 0; i < count; i++) {
+        if (trace->n < 16) {
+            trace->records[trace->n] = records[i];
+        }
+        trace->n++;
+    }
+}
+
+static uc_engine *open_x86(const uint8_t *code, size_t size)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, BASE, 0x4000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, BASE, code, size));
+
+    return uc;
+}
+
+static void check_record(const uc_mem_access *rec, uint32_t type, uint64_t pc,
+                         uint64_t address, uint32_t size, uint64_t value)
+{
+    assert_int_equal(rec->type, type);
+    assert_int_equal(rec->pc, pc);
+    assert_int_equal(rec->address, address);
+    assert_int_equal(rec->size, size);
+    assert_int_equal(rec->value, value);
+}
+
+static void test_mem_trace_x86(void **state)
+{
+    uc_engine *uc = open_x86(x86_code, sizeof(x86_code));
+    uc_mem_access buffer[2];
+    struct trace trace = { 0 };
+
+    OK(uc_mem_trace_enable(uc, buffer, 2, trace_flush, &trace));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(x86_code), 0, 0));
+
+    // once full, then when uc_emu_start() returns
+    assert_int_equal(trace.flushes, 2);
+    assert_int_equal(trace.n, 3);
+    check_record(&trace.records[0], UC_MEM_WRITE, BASE, DATA, 4, 42);
+    check_record(&trace.records[1], UC_MEM_READ, BASE + 10, DATA, 4, 42);
+    check_record(&trace.records[2], UC_MEM_WRITE, BASE + 15, OTHER, 4, 7);
+
+    // disabled: nothing more, the cached code runs at full speed again
+    OK(uc_mem_trace_enable(uc, NULL, 0, NULL, NULL));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(x86_code), 0, 0));
+    assert_int_equal(trace.n, 3);
+
+    OK(uc_close(uc));
+}
+
+// Disabling hands the records still in the buffer over first.
+static void trace_disable(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    OK(uc_mem_trace_enable(uc, NULL, 0, NULL, NULL));
+}
+
+static void test_mem_trace_disable(void **state)
+{
+    uc_engine *uc = open_x86(x86_code, sizeof(x86_code));
+    uc_mem_access buffer[8];
+    struct trace trace = { 0 };
+    uc_hook hook;
+
+    OK(uc_hook_add(uc, &hook, UC_HOOK_CODE, trace_disable, NULL, BASE + 15, BASE + 15));
+    OK(uc_mem_trace_enable(uc, buffer, 8, trace_flush, &trace));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(x86_code), 0, 0));
+
+    assert_int_equal(trace.flushes, 1);
+    assert_int_equal(trace.n, 2);
+
+    OK(uc_close(uc));
+}
+
+// A store & a load crossing from DATA into OTHER are one record each.
+static void test_mem_trace_page_crossing(void **state)
+{
+    const uint8_t code[] = {
+        0xC7, 0x05, 0xFE, 0x2F, 0x10, 0x00, 0x44, 0x33, 0x22, 0x11, // mov dword ptr [OTHER - 2], 0x11223344
+        0xA1, 0xFE, 0x2F, 0x10, 0x00,                               // mov eax, [OTHER - 2]
+    };
+    uc_engine *uc = open_x86(code, sizeof(code));
+    uc_mem_access buffer[8];
+    struct trace trace = { 0 };
+
+    OK(uc_mem_trace_enable(uc, buffer, 8, trace_flush, &trace));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(code), 0, 0));
+
+    assert_int_equal(trace.n, 2);
+    check_record(&trace.records[0], UC_MEM_WRITE, BASE, OTHER - 2, 4, 0x11223344);
+    check_record(&trace.records[1], UC_MEM_READ, BASE + 10, OTHER - 2, 4, 0x11223344);
+
+    OK(uc_close(uc));
+}
+
+static void test_mem_trace_arg(void **state)
+{
+    uc_engine *uc;
+    uc_mem_access buffer[8];
+    struct trace trace = { 0 };
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    uc_assert_err(UC_ERR_ARG, uc_mem_trace_enable(uc, buffer, 0, trace_flush, &trace));
+    uc_assert_err(UC_ERR_ARG, uc_mem_trace_enable(uc, buffer, 8, NULL, &trace));
+    OK(uc_mem_trace_enable(uc, NULL, 0, NULL, NULL));
+    OK(uc_close(uc));
+}
+
+static void test_mem_trace_arm(void **state)
+{
+    const uint8_t code[] = {
+        0x00, 0x00, 0x81, 0xE5,     // str r0, [r1]
+        0x04, 0x20, 0x91, 0xE5,     // ldr r2, [r1, #4]
+    };
+    uc_engine *uc;
+    uc_mem_access buffer[8];
+    struct trace trace = { 0 };
+    uint32_t r0 = 0x1234, r1 = DATA, val = 0x5678;
+
+    OK(uc_open(UC_ARCH_ARM, UC_MODE_ARM, &uc));
+    OK(uc_mem_map(uc, BASE, 0x4000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, BASE, code, sizeof(code)));
+    OK(uc_mem_write(uc, DATA + 4, &val, sizeof(val)));
+    OK(uc_reg_write(uc, UC_ARM_REG_R0, &r0));
+    OK(uc_reg_write(uc, UC_ARM_REG_R1, &r1));
+
+    OK(uc_mem_trace_enable(uc, buffer, 8, trace_flush, &trace));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(code), 0, 0));
+
+    assert_int_equal(trace.n, 2);
+    check_record(&trace.records[0], UC_MEM_WRITE, BASE, DATA, 4, 0x1234);
+    check_record(&trace.records[1], UC_MEM_READ, BASE + 4, DATA + 4, 4, 0x5678);
+
+    OK(uc_close(uc));
+}
+
+/******************************************************************************/
+
+#define BENCH_LOOPS 2000000
+
+static uint64_t hook_sum;
+
+// what a tracer had to do before: a callback per access
+static void hook_mem(uc_engine *uc, uc_mem_type type, uint64_t address,
+                     int size, int64_t value, void *user_data)
+{
+    hook_sum += address;
+}
+
+static uint64_t trace_sum;
+
+static void trace_sum_flush(uc_engine *uc, const uc_mem_access *records,
+                            size_t count, void *user_data)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        trace_sum += records[i].address;
+    }
+}
+
+static double bench_run(uc_engine *uc, const uint8_t *code, size_t size)
+{
+    uint32_t loops = BENCH_LOOPS;
+    struct timespec start, end;
+
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &loops));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    OK(uc_emu_start(uc, BASE, BASE + size, 0, 0));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / BENCH_LOOPS;
+}
+
+// Micro-benchmark: cost per access of the trace buffer versus a hook
+static void test_mem_trace_bench(void **state)
+{
+    const uint8_t code[] = {
+        0xA1, 0x00, 0x20, 0x10, 0x00,   // a: mov eax, [DATA]
+        0x49,                           // dec ecx
+        0x75, 0xF8,                     // jnz a
+    };
+    static uc_mem_access buffer[4096];
+    uc_engine *uc = open_x86(code, sizeof(code));
+    uc_hook hook;
+    double none, trace, hooked;
+
+    bench_run(uc, code, sizeof(code));
+    none = bench_run(uc, code, sizeof(code));
+
+    OK(uc_mem_trace_enable(uc, buffer, 4096, trace_sum_flush, NULL));
+    bench_run(uc, code, sizeof(code));
+    trace = bench_run(uc, code, sizeof(code));
+    OK(uc_mem_trace_enable(uc, NULL, 0, NULL, NULL));
+
+    OK(uc_hook_add(uc, &hook, UC_HOOK_MEM_READ, hook_mem, NULL, 1, 0));
+    bench_run(uc, code, sizeof(code));
+    hooked = bench_run(uc, code, sizeof(code));
+    OK(uc_hook_del(uc, hook));
+
+    printf("ns per access: %.2f untraced, %.2f with the trace buffer, %.2f with UC_HOOK_MEM_READ\n",
+           none, trace, hooked);
+
+    // both ways see the same accesses
+    assert_int_equal(trace_sum, hook_sum);
+    assert_int_equal(trace_sum, 2ull * BENCH_LOOPS * DATA);
+
+    OK(uc_close(uc));
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_mem_trace_x86),
+        cmocka_unit_test(test_mem_trace_disable),
+        cmocka_unit_test(test_mem_trace_page_crossing),
+        cmocka_unit_test(test_mem_trace_arg),
+        cmocka_unit_test(test_mem_trace_arm),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_mem_trace_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
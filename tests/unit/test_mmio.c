@@ -0,0 +1,331 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define CODE    0x100000
+#define DATA    0x200000
+#define DEVICE  0x400000
+#define PAGE    0x1000
+
+/******************************************************************************/
+
+// A UART: characters written to TX are sent, STATUS tells how many
+#define UART_TX     0
+#define UART_STATUS 4
+
+struct uart {
+    char sent[64];
+    int count;
+    int reads;
+};
+
+static uint64_t uart_read(uc_engine *uc, uint64_t offset, unsigned size, void *user_data)
+{
+    struct uart *uart = user_data;
+
+    uart->reads++;
+    if (offset == UART_STATUS)
+        return uart->count;
+
+    return 0;
+}
+
+static void uart_write(uc_engine *uc, uint64_t offset, unsigned size, uint64_t value, void *user_data)
+{
+    struct uart *uart = user_data;
+
+    if (offset == UART_TX && uart->count < (int)sizeof(uart->sent) - 1)
+        uart->sent[uart->count++] = (char)value;
+}
+
+// ARM firmware prints a string on the UART.
+static void test_mmio_uart_arm(void **state)
+{
+    const uint32_t code[] = {
+        0xE4D30001,     // loop: ldrb r0, [r3], #1
+        0xE3500000,     // cmp r0, #0
+        0x15810000,     // strne r0, [r1]
+        0x1AFFFFFB,     // bne loop
+        0xE5912004,     // ldr r2, [r1, #4]
+    };
+    const char hello[] = "Hello, UART";
+    struct uart uart = { { 0 } };
+    uint32_t r1 = DEVICE, r3 = DATA, r2;
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_ARM, UC_MODE_ARM, &uc));
+    OK(uc_mem_map(uc, CODE, PAGE, UC_PROT_ALL));
+    OK(uc_mem_map(uc, DATA, PAGE, UC_PROT_READ | UC_PROT_WRITE));
+    OK(uc_mmio_map(uc, DEVICE, PAGE, uart_read, uart_write, &uart));
+    OK(uc_mem_write(uc, CODE, code, sizeof(code)));
+    OK(uc_mem_write(uc, DATA, hello, sizeof(hello)));
+    OK(uc_reg_write(uc, UC_ARM_REG_R1, &r1));
+    OK(uc_reg_write(uc, UC_ARM_REG_R3, &r3));
+
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+
+    assert_int_equal(strcmp(uart.sent, hello), 0);
+    OK(uc_reg_read(uc, UC_ARM_REG_R2, &r2));
+    assert_int_equal(r2, strlen(hello));
+    assert_int_equal(uart.reads, 1);
+
+    OK(uc_close(uc));
+}
+
+// A timer: every read of COUNT ticks it, writing COUNT sets it
+#define TIMER_COUNT 0
+
+struct timer {
+    uint32_t count;
+    unsigned last_size;
+};
+
+static uint64_t timer_read(uc_engine *uc, uint64_t offset, unsigned size, void *user_data)
+{
+    struct timer *timer = user_data;
+
+    timer->last_size = size;
+    if (offset == TIMER_COUNT)
+        return timer->count++;
+
+    return 0;
+}
+
+static void timer_write(uc_engine *uc, uint64_t offset, unsigned size, uint64_t value, void *user_data)
+{
+    struct timer *timer = user_data;
+
+    timer->last_size = size;
+    if (offset == TIMER_COUNT)
+        timer->count = (uint32_t)value;
+}
+
+// x86 code sets the timer, then samples it twice.
+static void test_mmio_timer_x86(void **state)
+{
+    const uint8_t code[] = {
+        0xC7, 0x05, 0x00, 0x00, 0x40, 0x00, 0x64, 0x00, 0x00, 0x00, // mov dword [DEVICE], 100
+        0xA1, 0x00, 0x00, 0x40, 0x00,                               // mov eax, [DEVICE]
+        0x8B, 0x1D, 0x00, 0x00, 0x40, 0x00,                         // mov ebx, [DEVICE]
+        0x66, 0x8B, 0x0D, 0x00, 0x00, 0x40, 0x00,                   // mov cx, [DEVICE]
+    };
+    struct timer timer = { 0 };
+    uint32_t eax, ebx, ecx = 0;
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, CODE, PAGE, UC_PROT_ALL));
+    OK(uc_mmio_map(uc, DEVICE, PAGE, timer_read, timer_write, &timer));
+    OK(uc_mem_write(uc, CODE, code, sizeof(code)));
+
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    OK(uc_reg_read(uc, UC_X86_REG_EBX, &ebx));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &ecx));
+    assert_int_equal(eax, 100);
+    assert_int_equal(ebx, 101);
+    assert_int_equal(ecx, 102);
+    assert_int_equal(timer.last_size, 2);
+    assert_int_equal(timer.count, 103);
+
+    OK(uc_close(uc));
+}
+
+// The missing callbacks decide what the program may do with the region.
+static void test_mmio_prot(void **state)
+{
+    const uint8_t load[] = { 0xA1, 0x00, 0x00, 0x40, 0x00 };    // mov eax, [DEVICE]
+    const uint8_t store[] = { 0xA3, 0x00, 0x00, 0x40, 0x00 };   // mov [DEVICE], eax
+    struct timer timer = { 0 };
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, CODE, PAGE, UC_PROT_ALL));
+    OK(uc_mmio_map(uc, DEVICE, PAGE, timer_read, NULL, &timer));
+    OK(uc_mmio_map(uc, DEVICE + PAGE, PAGE, NULL, timer_write, &timer));
+
+    OK(uc_mem_write(uc, CODE, store, sizeof(store)));
+    uc_assert_err(UC_ERR_WRITE_PROT, uc_emu_start(uc, CODE, CODE + sizeof(store), 0, 0));
+
+    OK(uc_mem_write(uc, CODE, load, sizeof(load)));
+    OK(uc_mem_write(uc, CODE + 2, "\x10", 1));                 // mov eax, [DEVICE + PAGE]
+    uc_assert_err(UC_ERR_READ_PROT, uc_emu_start(uc, CODE, CODE + sizeof(load), 0, 0));
+
+    // never executable
+    uc_assert_err(UC_ERR_FETCH_PROT, uc_emu_start(uc, DEVICE, DEVICE + 1, 0, 0));
+
+    OK(uc_close(uc));
+}
+
+// The API reaches the callbacks, and keeps the region whole.
+static void test_mmio_api(void **state)
+{
+    struct timer timer = { 0 };
+    uint32_t val = 7;
+    uc_mem_region *regions;
+    uint32_t count;
+    void *ptr;
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_ARM, UC_MODE_ARM, &uc));
+    OK(uc_mmio_map(uc, DEVICE, 2 * PAGE, timer_read, timer_write, &timer));
+
+    OK(uc_mem_write(uc, DEVICE, &val, sizeof(val)));
+    assert_int_equal(timer.count, 7);
+    assert_int_equal(timer.last_size, 4);
+    OK(uc_mem_read(uc, DEVICE, &val, sizeof(val)));
+    assert_int_equal(val, 7);
+    assert_int_equal(timer.count, 8);
+
+    OK(uc_mem_regions(uc, &regions, &count));
+    assert_int_equal(count, 1);
+    assert_int_equal(regions[0].begin, DEVICE);
+    assert_int_equal(regions[0].end, DEVICE + 2 * PAGE - 1);
+    assert_int_equal(regions[0].perms, UC_PROT_READ | UC_PROT_WRITE);
+    uc_free(regions);
+
+    uc_assert_err(UC_ERR_ARG, uc_mem_get_host_ptr(uc, DEVICE, 4, &ptr));
+    uc_assert_err(UC_ERR_ARG, uc_mem_protect(uc, DEVICE, PAGE, UC_PROT_ALL));
+    uc_assert_err(UC_ERR_ARG, uc_mem_unmap(uc, DEVICE + PAGE, PAGE));
+    uc_assert_err(UC_ERR_MAP, uc_mem_map(uc, DEVICE + PAGE, PAGE, UC_PROT_ALL));
+    uc_assert_err(UC_ERR_MAP, uc_mmio_map(uc, DEVICE, PAGE, timer_read, NULL, NULL));
+    uc_assert_err(UC_ERR_ARG, uc_mmio_map(uc, DEVICE + 2 * PAGE + 1, PAGE, timer_read, NULL, NULL));
+
+    OK(uc_mem_unmap(uc, DEVICE, 2 * PAGE));
+    OK(uc_mem_map(uc, DEVICE, PAGE, UC_PROT_ALL));
+
+    OK(uc_close(uc));
+}
+
+// A snapshot keeps the mapping of a peripheral, not its state.
+static void test_mmio_snapshot(void **state)
+{
+    struct timer timer = { 0 };
+    uc_snapshot *snap;
+    uint32_t val;
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, DATA, PAGE, UC_PROT_ALL));
+    OK(uc_mmio_map(uc, DEVICE, PAGE, timer_read, timer_write, &timer));
+    OK(uc_snapshot_take(uc, &snap));
+
+    OK(uc_mem_unmap(uc, DEVICE, PAGE));
+    OK(uc_mmio_map(uc, DEVICE + PAGE, PAGE, timer_read, NULL, &timer));
+    OK(uc_snapshot_restore(uc, snap));
+
+    val = 50;
+    OK(uc_mem_write(uc, DEVICE, &val, sizeof(val)));
+    assert_int_equal(timer.count, 50);
+    uc_assert_err(UC_ERR_READ_UNMAPPED, uc_mem_read(uc, DEVICE + PAGE, &val, sizeof(val)));
+
+    // restored in place, when nothing changed
+    OK(uc_snapshot_restore(uc, snap));
+    OK(uc_mem_read(uc, DEVICE, &val, sizeof(val)));
+    assert_int_equal(val, 50);
+
+    OK(uc_snapshot_free(snap));
+    OK(uc_close(uc));
+}
+
+/******************************************************************************/
+
+#define BENCH_LOOPS 1000000
+
+struct bench_device {
+    uint32_t count;
+};
+
+static void hook_device(uc_engine *uc, uc_mem_type type, uint64_t address, int size,
+        int64_t value, void *user_data)
+{
+    struct bench_device *dev = user_data;
+
+    if (address >= DEVICE && address < DEVICE + PAGE) {
+        if (type == UC_MEM_READ) {
+            value = dev->count++;
+            uc_mem_write(uc, address, &value, size);
+        }
+    }
+}
+
+static uint64_t bench_read(uc_engine *uc, uint64_t offset, unsigned size, void *user_data)
+{
+    struct bench_device *dev = user_data;
+
+    return dev->count++;
+}
+
+static double bench_run(bool hooked)
+{
+    // RAM traffic with a device poll every 16 iterations
+    const uint8_t code[] = {
+        0x8B, 0x06,                         // loop: mov eax, [esi]
+        0x03, 0x46, 0x04,                   // add eax, [esi + 4]
+        0xF6, 0xC1, 0x0F,                   // test cl, 15
+        0x75, 0x06,                         // jnz skip
+        0x8B, 0x15, 0x00, 0x00, 0x40, 0x00, // mov edx, [DEVICE]
+        0x49,                               // skip: dec ecx
+        0x75, 0xED,                         // jnz loop
+    };
+    struct bench_device dev = { 0 };
+    struct timespec start, end;
+    uint32_t ecx = BENCH_LOOPS, esi = DATA;
+    uc_engine *uc;
+    uc_hook hh;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, CODE, PAGE, UC_PROT_ALL));
+    OK(uc_mem_map(uc, DATA, PAGE, UC_PROT_READ | UC_PROT_WRITE));
+    if (hooked) {
+        OK(uc_mem_map(uc, DEVICE, PAGE, UC_PROT_READ | UC_PROT_WRITE));
+        OK(uc_hook_add(uc, &hh, UC_HOOK_MEM_READ | UC_HOOK_MEM_WRITE, hook_device, &dev, 1, 0));
+    } else {
+        OK(uc_mmio_map(uc, DEVICE, PAGE, bench_read, NULL, &dev));
+    }
+    OK(uc_mem_write(uc, CODE, code, sizeof(code)));
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &ecx));
+    OK(uc_reg_write(uc, UC_X86_REG_ESI, &esi));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    assert_int_equal(dev.count, BENCH_LOOPS / 16);
+    OK(uc_close(uc));
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / BENCH_LOOPS;
+}
+
+// Micro-benchmark: a device modelled by memory hooks or by uc_mmio_map()
+static void test_mmio_bench(void **state)
+{
+    double hooked, mmio;
+
+    hooked = bench_run(true);
+    mmio = bench_run(false);
+
+    printf("ns per loop iteration: %.1f with memory hooks, %.1f with uc_mmio_map\n",
+           hooked, mmio);
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_mmio_uart_arm),
+        cmocka_unit_test(test_mmio_timer_x86),
+        cmocka_unit_test(test_mmio_prot),
+        cmocka_unit_test(test_mmio_api),
+        cmocka_unit_test(test_mmio_snapshot),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_mmio_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,83 @@
+#include "unicorn_test.h"
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define NB_ENGINES 100
+#define ENGINE_MAX_KB 2048     // about 1.8 MB on x86-64 hosts, 3 MB before
+
+/******************************************************************************/
+
+// resident set size in KB, 0 if unknown
+static long rss_kb(void)
+{
+    long size = 0, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+
+    if (f == NULL)
+        return 0;
+    if (fscanf(f, "%ld %ld", &size, &resident) != 2)
+        resident = 0;
+    fclose(f);
+
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Open NB_ENGINES engines, returns the KB each takes (0 if unknown) and
+// the ms opening each took.
+static long open_engines(double *ms)
+{
+    static uc_engine *uc[NB_ENGINES];
+    struct timespec start, end;
+    long rss, per_engine;
+    int i;
+
+    rss = rss_kb();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < NB_ENGINES; i++) {
+        OK(uc_open(UC_ARCH_ARM, UC_MODE_ARM, &uc[i]));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    // unknown without /proc
+    per_engine = rss != 0 ? (rss_kb() - rss) / NB_ENGINES : 0;
+    *ms = ((end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6) / NB_ENGINES;
+
+    for (i = 0; i < NB_ENGINES; i++) {
+        OK(uc_close(uc[i]));
+    }
+
+    return per_engine;
+}
+
+// Fixed memory cost of each engine.
+static void test_multi_engine_footprint(void **state)
+{
+    double ms;
+
+    assert_true(open_engines(&ms) <= ENGINE_MAX_KB);
+}
+
+// Micro-benchmark: memory and time to open an engine
+static void test_multi_engine_bench(void **state)
+{
+    double ms;
+    long per_engine = open_engines(&ms);
+
+    printf("%d engines: %ld KB and %.2f ms each\n", NB_ENGINES, per_engine, ms);
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_multi_engine_footprint),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_multi_engine_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
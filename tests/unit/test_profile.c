@@ -0,0 +1,202 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define CODE    0x1000000
+
+// two nested loops: the outer block runs the first inner iteration, the
+// inner block the 9 others
+static const uint8_t loops[] = {
+    0xBB, 0x0A, 0x00, 0x00, 0x00,   // outer: mov ebx, 10
+    0x4B,                           // inner: dec ebx
+    0x75, 0xFD,                     // jnz inner
+    0x49,                           // dec ecx
+    0x75, 0xF5,                     // jnz outer
+    0x90,                           // nop
+};
+
+#define OUTER   CODE
+#define INNER   (CODE + 5)
+#define NEXT    (CODE + 8)
+
+static uc_engine *setup_loops(void)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, CODE, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, CODE, loops, sizeof(loops)));
+
+    return uc;
+}
+
+static void run_loops(uc_engine *uc, uint32_t count)
+{
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &count));
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(loops), 0, 0));
+}
+
+/******************************************************************************/
+
+// The hottest blocks come first, with their exact counts.
+static void test_profile_top(void **state)
+{
+    uc_engine *uc = setup_loops();
+    uc_tb_profile blocks[8];
+    size_t count = 8;
+
+    OK(uc_profile_enable(uc, true));
+    run_loops(uc, 100);
+
+    OK(uc_profile_top(uc, blocks, &count));
+    assert_int_equal(count, 3);
+    assert_true(blocks[0].pc == INNER);
+    assert_true(blocks[0].count == 900);
+    assert_int_equal(blocks[0].size, 3);
+    assert_true(blocks[0].host_size > 0);
+    assert_true(blocks[1].count == 100);
+    assert_true(blocks[1].pc == OUTER || blocks[1].pc == NEXT);
+    assert_true(blocks[2].count == 100);
+    assert_true(blocks[2].pc == OUTER || blocks[2].pc == NEXT);
+
+    // counts add up across runs
+    run_loops(uc, 10);
+    count = 1;
+    OK(uc_profile_top(uc, blocks, &count));
+    assert_int_equal(count, 1);
+    assert_true(blocks[0].pc == INNER);
+    assert_true(blocks[0].count == 990);
+
+    OK(uc_close(uc));
+}
+
+// Nothing is counted unless enabled, and disabling drops the counts.
+static void test_profile_enable(void **state)
+{
+    uc_engine *uc = setup_loops();
+    uc_tb_profile blocks[8];
+    size_t count = 8;
+
+    run_loops(uc, 10);
+    OK(uc_profile_top(uc, blocks, &count));
+    assert_int_equal(count, 0);
+
+    // the blocks already translated are dropped, to count from now on
+    OK(uc_profile_enable(uc, true));
+    run_loops(uc, 10);
+    count = 8;
+    OK(uc_profile_top(uc, blocks, &count));
+    assert_int_equal(count, 3);
+    assert_true(blocks[0].count == 90);
+
+    OK(uc_profile_enable(uc, false));
+    run_loops(uc, 10);
+    count = 8;
+    OK(uc_profile_top(uc, blocks, &count));
+    assert_int_equal(count, 0);
+
+    OK(uc_close(uc));
+}
+
+static void hook_enable(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    uc_hook *hh = user_data;
+
+    OK(uc_profile_enable(uc, true));
+    OK(uc_hook_del(uc, *hh));
+}
+
+// Profiling can start from a callback, in the middle of a block.
+static void test_profile_callback(void **state)
+{
+    uc_engine *uc = setup_loops();
+    uc_tb_profile blocks[8];
+    size_t count = 8;
+    uc_hook hh;
+
+    OK(uc_hook_add(uc, &hh, UC_HOOK_CODE, hook_enable, &hh, NEXT, NEXT));
+    run_loops(uc, 2);
+
+    // only the second outer iteration ran with the counters
+    OK(uc_profile_top(uc, blocks, &count));
+    assert_int_equal(count, 3);
+    assert_true(blocks[0].pc == INNER);
+    assert_true(blocks[0].count == 9);
+
+    OK(uc_close(uc));
+}
+
+static void test_profile_arg(void **state)
+{
+    uc_engine *uc = setup_loops();
+    size_t count = 1;
+
+    uc_assert_err(UC_ERR_ARG, uc_profile_top(uc, NULL, &count));
+    count = 0;
+    OK(uc_profile_top(uc, NULL, &count));
+
+    OK(uc_close(uc));
+}
+
+/******************************************************************************/
+
+#define BENCH_LOOPS 1000000
+
+static void hook_block(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    (*(uint64_t *)user_data)++;
+}
+
+static double bench_run(int mode)
+{
+    struct timespec start, end;
+    uint64_t runs = 0;
+    uc_engine *uc = setup_loops();
+    uc_hook hh;
+
+    if (mode == 1)
+        OK(uc_profile_enable(uc, true));
+    else if (mode == 2)
+        OK(uc_hook_add(uc, &hh, UC_HOOK_BLOCK, hook_block, &runs, 1, 0));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    run_loops(uc, BENCH_LOOPS / 10);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    OK(uc_close(uc));
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / (1.1 * BENCH_LOOPS);
+}
+
+// Micro-benchmark: blocks run without counting, with the counters and with
+// a UC_HOOK_BLOCK callback counting them
+static void test_profile_bench(void **state)
+{
+    double plain, counted, hooked;
+
+    plain = bench_run(0);
+    counted = bench_run(1);
+    hooked = bench_run(2);
+
+    printf("ns per block: %.1f plain, %.1f with profiling, %.1f with UC_HOOK_BLOCK\n",
+           plain, counted, hooked);
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_profile_top),
+        cmocka_unit_test(test_profile_enable),
+        cmocka_unit_test(test_profile_callback),
+        cmocka_unit_test(test_profile_arg),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_profile_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
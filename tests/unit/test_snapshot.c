@@ -0,0 +1,350 @@
+#include "unicorn_test.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define BASE        0x100000
+#define PAGE        0x1000
+#define NB_SLOTS    16      // slot i lives at BASE + i * SLOT_SIZE
+#define SLOT_SIZE   (4 * PAGE)
+#define ROUNDS      200
+// the last two slots stay mapped from the caller's memory and from a file
+#define PTR_SLOT    (NB_SLOTS - 2)
+#define FILE_SLOT   (NB_SLOTS - 1)
+
+/* Called before every test to set up a new instance */
+static int setup32(void **state)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+
+    *state = uc;
+    return 0;
+}
+
+/* Called after every test to clean up */
+static int teardown(void **state)
+{
+    uc_engine *uc = *state;
+
+    OK(uc_close(uc));
+
+    *state = NULL;
+    return 0;
+}
+
+/******************************************************************************/
+
+static uint32_t read32(uc_engine *uc, uint64_t address)
+{
+    uint32_t val;
+
+    OK(uc_mem_read(uc, address, &val, sizeof(val)));
+    return val;
+}
+
+static void write32(uc_engine *uc, uint64_t address, uint32_t val)
+{
+    OK(uc_mem_write(uc, address, &val, sizeof(val)));
+}
+
+// Writes from uc_mem_write() and from emulated code are both rolled back.
+static void test_snapshot_restore(void **state)
+{
+    uc_engine *uc = *state;
+    uc_snapshot *snap;
+    const uint8_t code[] = {
+        0xC7, 0x05, 0x00, 0x20, 0x10, 0x00, 0x2A, 0x00, 0x00, 0x00,  // mov dword ptr [0x102000], 42
+    };
+    int i;
+
+    OK(uc_mem_map(uc, BASE, 4 * PAGE, UC_PROT_ALL));
+    OK(uc_mem_write(uc, BASE, code, sizeof(code)));
+    write32(uc, BASE + 2 * PAGE, 1);
+
+    OK(uc_snapshot_take(uc, &snap));
+
+    for (i = 0; i < 3; i++) {
+        write32(uc, BASE + 3 * PAGE, 7);
+        OK(uc_emu_start(uc, BASE, BASE + sizeof(code), 0, 0));
+        assert_int_equal(read32(uc, BASE + 2 * PAGE), 42);
+        assert_int_equal(read32(uc, BASE + 3 * PAGE), 7);
+
+        OK(uc_snapshot_restore(uc, snap));
+        assert_int_equal(read32(uc, BASE + 2 * PAGE), 1);
+        assert_int_equal(read32(uc, BASE + 3 * PAGE), 0);
+    }
+
+    OK(uc_snapshot_free(snap));
+}
+
+// Pages the emulated code already wrote before the snapshot are tracked again.
+static void test_snapshot_written_before(void **state)
+{
+    uc_engine *uc = *state;
+    uc_snapshot *snap;
+    const uint8_t code[] = {
+        0xA3, 0x00, 0x20, 0x10, 0x00,   // mov  [0x102000], eax
+    };
+    uint32_t eax = 1;
+
+    OK(uc_mem_map(uc, BASE, 4 * PAGE, UC_PROT_ALL));
+    OK(uc_mem_write(uc, BASE, code, sizeof(code)));
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &eax));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(code), 0, 0));
+    assert_int_equal(read32(uc, BASE + 2 * PAGE), 1);
+
+    OK(uc_snapshot_take(uc, &snap));
+
+    eax = 2;
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &eax));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(code), 0, 0));
+    assert_int_equal(read32(uc, BASE + 2 * PAGE), 2);
+
+    OK(uc_snapshot_restore(uc, snap));
+    assert_int_equal(read32(uc, BASE + 2 * PAGE), 1);
+
+    OK(uc_snapshot_free(snap));
+}
+
+// Code overwritten after the snapshot runs again as it was once restored.
+static void test_snapshot_code(void **state)
+{
+    uc_engine *uc = *state;
+    uc_snapshot *snap;
+    const uint8_t code[] = {
+        0xB8, 0x01, 0x00, 0x00, 0x00,   // mov  eax, 1
+    };
+    const uint8_t imm = 0x02;
+    uint32_t eax;
+
+    OK(uc_mem_map(uc, BASE, PAGE, UC_PROT_ALL));
+    OK(uc_mem_write(uc, BASE, code, sizeof(code)));
+    OK(uc_snapshot_take(uc, &snap));
+
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    assert_int_equal(eax, 1);
+
+    OK(uc_mem_write(uc, BASE + 1, &imm, sizeof(imm)));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    assert_int_equal(eax, 2);
+
+    OK(uc_snapshot_restore(uc, snap));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    assert_int_equal(eax, 1);
+
+    OK(uc_snapshot_free(snap));
+}
+
+// Two snapshots restored alternately, each one must come back whole.
+static void test_snapshot_two(void **state)
+{
+    uc_engine *uc = *state;
+    uc_snapshot *first, *second;
+    int i;
+
+    OK(uc_mem_map(uc, BASE, 4 * PAGE, UC_PROT_ALL));
+    write32(uc, BASE, 1);
+    OK(uc_snapshot_take(uc, &first));
+    write32(uc, BASE + PAGE, 2);
+    OK(uc_snapshot_take(uc, &second));
+
+    for (i = 0; i < 3; i++) {
+        write32(uc, BASE + 3 * PAGE, 3);
+        OK(uc_snapshot_restore(uc, first));
+        assert_int_equal(read32(uc, BASE), 1);
+        assert_int_equal(read32(uc, BASE + PAGE), 0);
+        assert_int_equal(read32(uc, BASE + 3 * PAGE), 0);
+
+        write32(uc, BASE, 4);
+        OK(uc_snapshot_restore(uc, second));
+        assert_int_equal(read32(uc, BASE), 1);
+        assert_int_equal(read32(uc, BASE + PAGE), 2);
+    }
+
+    OK(uc_snapshot_free(first));
+    OK(uc_snapshot_free(second));
+}
+
+// What the test expects a slot to look like
+struct slot {
+    bool mapped;
+    uint32_t perms;
+    uint32_t words[SLOT_SIZE / PAGE];   // first word of each page
+};
+
+static void check_slots(uc_engine *uc, const struct slot *slots)
+{
+    uc_mem_region *regions;
+    uint32_t count, i, j, n = 0;
+
+    for (i = 0; i < NB_SLOTS; i++) {
+        uint64_t addr = BASE + i * SLOT_SIZE;
+        uint32_t val;
+
+        if (!slots[i].mapped) {
+            uc_assert_err(UC_ERR_READ_UNMAPPED, uc_mem_read(uc, addr, &val, sizeof(val)));
+            continue;
+        }
+        n++;
+        for (j = 0; j < SLOT_SIZE / PAGE; j++) {
+            assert_int_equal(read32(uc, addr + j * PAGE), slots[i].words[j]);
+        }
+    }
+
+    OK(uc_mem_regions(uc, &regions, &count));
+    assert_int_equal(count, n);
+    for (i = 0; i < count; i++) {
+        j = (uint32_t)((regions[i].begin - BASE) / SLOT_SIZE);
+        assert_int_equal(regions[i].begin, BASE + j * SLOT_SIZE);
+        assert_int_equal(regions[i].end, BASE + (j + 1) * SLOT_SIZE - 1);
+        assert_int_equal(regions[i].perms, slots[j].perms);
+    }
+    OK(uc_free(regions));
+}
+
+// Map slot @s with @perms, from anonymous memory or zero-filled by
+// uc_mem_map_file() depending on @zero.
+static void map_slot(uc_engine *uc, unsigned int s, uint32_t perms, bool zero)
+{
+    uint64_t addr = BASE + s * SLOT_SIZE;
+
+    if (zero)
+        OK(uc_mem_map_file(uc, addr, SLOT_SIZE, perms, -1, 0, true));
+    else
+        OK(uc_mem_map(uc, addr, SLOT_SIZE, perms));
+}
+
+// Random writes, maps, unmaps and protects between take and restore.
+static void test_snapshot_stress(void **state)
+{
+    static uint32_t ptr_mem[SLOT_SIZE / 4];
+    uc_engine *uc = *state;
+    struct slot saved[NB_SLOTS], cur[NB_SLOTS];
+    char path[] = "/tmp/unicorn_snapshot_XXXXXX";
+    uc_snapshot *snap, *snap2;
+    uint32_t val;
+    int round, op, i, fd;
+
+    fd = mkstemp(path);
+    assert_true(fd >= 0);
+    unlink(path);
+    assert_int_equal(ftruncate(fd, SLOT_SIZE), 0);
+
+    srand(3);
+    memset(cur, 0, sizeof(cur));
+    for (i = 0; i < NB_SLOTS; i++) {
+        uint64_t addr = BASE + i * SLOT_SIZE;
+
+        if (i == PTR_SLOT)
+            OK(uc_mem_map_ptr(uc, addr, SLOT_SIZE, UC_PROT_ALL, ptr_mem));
+        else if (i == FILE_SLOT)
+            OK(uc_mem_map_file(uc, addr, SLOT_SIZE, UC_PROT_ALL, fd, 0, false));
+        else if (i % 2 == 0)
+            map_slot(uc, i, UC_PROT_ALL, i % 4 == 2);
+        else
+            continue;
+        cur[i].mapped = true;
+        cur[i].perms = UC_PROT_ALL;
+        cur[i].words[1] = i + 1;
+        write32(uc, addr + PAGE, i + 1);
+    }
+    memcpy(saved, cur, sizeof(saved));
+    OK(uc_snapshot_take(uc, &snap));
+
+    for (round = 0; round < ROUNDS; round++) {
+        for (op = 0; op < 8; op++) {
+            unsigned int s = rand() % NB_SLOTS;
+            unsigned int p = rand() % (SLOT_SIZE / PAGE);
+            uint64_t addr = BASE + s * SLOT_SIZE;
+            int action = rand() % 4;
+
+            // only write to the slots of the caller's memory and of the file
+            if (s >= PTR_SLOT && action != 0)
+                continue;
+            switch (action) {
+            case 0:     // write
+                if (cur[s].mapped) {
+                    cur[s].words[p] = rand();
+                    write32(uc, addr + p * PAGE, cur[s].words[p]);
+                }
+                break;
+            case 1:     // map
+                if (!cur[s].mapped) {
+                    map_slot(uc, s, UC_PROT_ALL, rand() % 2);
+                    memset(&cur[s], 0, sizeof(cur[s]));
+                    cur[s].mapped = true;
+                    cur[s].perms = UC_PROT_ALL;
+                }
+                break;
+            case 2:     // unmap
+                if (cur[s].mapped) {
+                    OK(uc_mem_unmap(uc, addr, SLOT_SIZE));
+                    cur[s].mapped = false;
+                }
+                break;
+            case 3:     // unmap and map again, perhaps at the same host address
+                if (cur[s].mapped) {
+                    OK(uc_mem_unmap(uc, addr, SLOT_SIZE));
+                    map_slot(uc, s, UC_PROT_READ, rand() % 2);
+                    memset(&cur[s], 0, sizeof(cur[s]));
+                    cur[s].mapped = true;
+                    cur[s].perms = UC_PROT_READ;
+                }
+                break;
+            }
+        }
+        // protect a whole slot, which keeps the region in one piece
+        i = rand() % NB_SLOTS;
+        if (cur[i].mapped) {
+            cur[i].perms = UC_PROT_READ | UC_PROT_WRITE;
+            OK(uc_mem_protect(uc, BASE + i * SLOT_SIZE, SLOT_SIZE, cur[i].perms));
+        }
+        check_slots(uc, cur);
+
+        OK(uc_snapshot_restore(uc, snap));
+        memcpy(cur, saved, sizeof(cur));
+        check_slots(uc, cur);
+        // still the caller's memory and the file
+        for (i = 0; i < SLOT_SIZE / PAGE; i++) {
+            assert_int_equal(ptr_mem[i * PAGE / 4], saved[PTR_SLOT].words[i]);
+            assert_int_equal(pread(fd, &val, sizeof(val), i * PAGE), sizeof(val));
+            assert_int_equal(val, saved[FILE_SLOT].words[i]);
+        }
+    }
+
+    // their memory may be gone once unmapped, so the snapshot cannot be
+    // restored any more, and nothing is changed
+    OK(uc_mem_unmap(uc, BASE + PTR_SLOT * SLOT_SIZE, SLOT_SIZE));
+    write32(uc, BASE, 0x1234);
+    uc_assert_err(UC_ERR_MAP, uc_snapshot_restore(uc, snap));
+    assert_int_equal(read32(uc, BASE), 0x1234);
+    uc_assert_err(UC_ERR_READ_UNMAPPED, uc_mem_read(uc, BASE + PTR_SLOT * SLOT_SIZE, &val, sizeof(val)));
+
+    OK(uc_mem_map_ptr(uc, BASE + PTR_SLOT * SLOT_SIZE, SLOT_SIZE, UC_PROT_ALL, ptr_mem));
+    OK(uc_snapshot_take(uc, &snap2));
+    OK(uc_mem_unmap(uc, BASE + FILE_SLOT * SLOT_SIZE, SLOT_SIZE));
+    uc_assert_err(UC_ERR_MAP, uc_snapshot_restore(uc, snap2));
+
+    OK(uc_snapshot_free(snap));
+    OK(uc_snapshot_free(snap2));
+    close(fd);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_snapshot_restore, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_snapshot_written_before, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_snapshot_code, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_snapshot_two, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_snapshot_stress, setup32, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,165 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define CODE    0x1000000
+
+static size_t query(uc_engine *uc, uc_query_type type)
+{
+    size_t result;
+
+    OK(uc_query(uc, type, &result));
+    return result;
+}
+
+static const uint8_t loop[] = {
+    0x49,           // loop: dec ecx
+    0x75, 0xFD,     // jnz loop
+    0x90,           // nop
+};
+
+static uc_engine *setup_loop(void)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, CODE, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, CODE, loop, sizeof(loop)));
+
+    return uc;
+}
+
+static void run_loop(uc_engine *uc, uint32_t count)
+{
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &count));
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(loop), 0, 0));
+}
+
+/******************************************************************************/
+
+// Blocks are counted when translated, and again when their code changes.
+static void test_stats_translation(void **state)
+{
+    uc_engine *uc = setup_loop();
+    size_t translated, invalidated;
+
+    run_loop(uc, 100);
+    translated = query(uc, UC_QUERY_TB_TRANSLATED);
+    invalidated = query(uc, UC_QUERY_TB_INVALIDATED);
+    assert_true(translated >= 2);
+    // the loop stays cached, the block stopping at the end does not
+    assert_true(query(uc, UC_QUERY_TB_HASH_ENTRIES) >= 1);
+    assert_true(query(uc, UC_QUERY_TB_HASH_USED) >= 1);
+    assert_true(query(uc, UC_QUERY_TB_HASH_BUCKETS) >= query(uc, UC_QUERY_TB_HASH_USED));
+    assert_true(query(uc, UC_QUERY_CODE_GEN_USED) > 0);
+    assert_true(query(uc, UC_QUERY_CODE_GEN_USED) < query(uc, UC_QUERY_CODE_GEN_SIZE));
+
+    // only the block at the end is translated again
+    run_loop(uc, 100);
+    assert_int_equal(query(uc, UC_QUERY_TB_TRANSLATED), translated + 1);
+
+    // rewriting the code drops the loop
+    OK(uc_mem_write(uc, CODE, loop, sizeof(loop)));
+    assert_true(query(uc, UC_QUERY_TB_INVALIDATED) > invalidated);
+    run_loop(uc, 100);
+    assert_int_equal(query(uc, UC_QUERY_TB_TRANSLATED), translated + 3);
+
+    OK(uc_close(uc));
+}
+
+static void hook_stop(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    uc_emu_stop(uc);
+}
+
+static void hook_nothing(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+}
+
+// Hook dispatches, CPU loop exits and TLB activity.
+static void test_stats_runtime(void **state)
+{
+    uc_engine *uc = setup_loop();
+    size_t calls, exits, flushes, fills;
+    uc_hook hh;
+
+    calls = query(uc, UC_QUERY_HOOK_CALLS);
+    OK(uc_hook_add(uc, &hh, UC_HOOK_CODE, hook_nothing, NULL, 1, 0));
+    run_loop(uc, 10);
+    // 10 times dec & jnz, then nop
+    assert_int_equal(query(uc, UC_QUERY_HOOK_CALLS), calls + 21);
+    OK(uc_hook_del(uc, hh));
+
+    exits = query(uc, UC_QUERY_CPU_EXITS);
+    OK(uc_hook_add(uc, &hh, UC_HOOK_CODE, hook_stop, NULL, CODE, CODE));
+    run_loop(uc, 10);
+    assert_true(query(uc, UC_QUERY_CPU_EXITS) > exits);
+    OK(uc_hook_del(uc, hh));
+
+    flushes = query(uc, UC_QUERY_TLB_FLUSHES);
+    fills = query(uc, UC_QUERY_TLB_FILLS);
+    OK(uc_mem_protect(uc, CODE, 0x1000, UC_PROT_READ | UC_PROT_EXEC));
+    assert_true(query(uc, UC_QUERY_TLB_FLUSHES) > flushes);
+    run_loop(uc, 10);
+    assert_true(query(uc, UC_QUERY_TLB_FILLS) > fills);
+
+    OK(uc_close(uc));
+}
+
+static void test_stats_arg(void **state)
+{
+    uc_engine *uc = setup_loop();
+    size_t result;
+
+    uc_assert_err(UC_ERR_ARG, uc_query(uc, UC_QUERY_HOOK_VECTORS + 1, &result));
+
+    OK(uc_close(uc));
+}
+
+/******************************************************************************/
+
+#define BENCH_LOOPS 10000
+
+static double bench_query(uc_engine *uc, uc_query_type type)
+{
+    struct timespec start, end;
+    size_t result;
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_LOOPS; i++)
+        OK(uc_query(uc, type, &result));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / BENCH_LOOPS;
+}
+
+// Micro-benchmark: the cost of reading the statistics
+static void test_stats_bench(void **state)
+{
+    uc_engine *uc = setup_loop();
+
+    run_loop(uc, 10);
+    printf("ns per uc_query(): %.1f for a counter, %.1f for the hash table occupancy\n",
+           bench_query(uc, UC_QUERY_TB_TRANSLATED), bench_query(uc, UC_QUERY_TB_HASH_ENTRIES));
+
+    OK(uc_close(uc));
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_stats_translation),
+        cmocka_unit_test(test_stats_runtime),
+        cmocka_unit_test(test_stats_arg),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_stats_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,232 @@
+#include "unicorn_test.h"
+#include <string.h>
+#include <time.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define ADDRESS 0x1000000
+
+/* Called before every test to set up a new instance */
+static int setup32(void **state)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, ADDRESS, 2 * 1024 * 1024, UC_PROT_ALL));
+
+    *state = uc;
+    return 0;
+}
+
+/* Called after every test to clean up */
+static int teardown(void **state)
+{
+    uc_engine *uc = *state;
+
+    OK(uc_close(uc));
+
+    *state = NULL;
+    return 0;
+}
+
+/******************************************************************************/
+
+static uint32_t run_from(uc_engine *uc, uint64_t begin, uint64_t until)
+{
+    uint32_t eax = 0;
+
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &eax));
+    OK(uc_emu_start(uc, begin, until, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+
+    return eax;
+}
+
+// Code written with uc_mem_write() between two runs must be retranslated.
+static void test_tb_cache_mem_write(void **state)
+{
+    uc_engine *uc = *state;
+    const uint8_t code[] = {
+        0xB8, 0x01, 0x00, 0x00, 0x00,   // mov  eax, 1
+    };
+    const uint8_t imm = 0x02;
+
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+    assert_int_equal(run_from(uc, ADDRESS, ADDRESS + sizeof(code)), 1);
+
+    OK(uc_mem_write(uc, ADDRESS + 1, &imm, sizeof(imm)));
+    assert_int_equal(run_from(uc, ADDRESS, ADDRESS + sizeof(code)), 2);
+}
+
+// Blocks cut short by @until must not be reused with another @until.
+static void test_tb_cache_until(void **state)
+{
+    uc_engine *uc = *state;
+    const uint8_t code[] = {
+        0x40, 0x40, 0x40, 0x40,   // inc  eax (x4)
+        0x40, 0x40, 0x40, 0x40,   // inc  eax (x4)
+    };
+
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+
+    assert_int_equal(run_from(uc, ADDRESS, ADDRESS + 2), 2);
+    assert_int_equal(run_from(uc, ADDRESS, ADDRESS + 6), 6);
+    assert_int_equal(run_from(uc, ADDRESS, ADDRESS + 3), 3);
+    assert_int_equal(run_from(uc, ADDRESS, ADDRESS + sizeof(code)), 8);
+    assert_int_equal(run_from(uc, ADDRESS + 4, ADDRESS + 6), 2);
+}
+
+static void count_insn(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    unsigned int *count = user_data;
+
+    (*count)++;
+}
+
+// Hooks added after the code was translated must still be called.
+static void test_tb_cache_hook_add(void **state)
+{
+    uc_engine *uc = *state;
+    uc_hook trace;
+    unsigned int count = 0;
+    const uint8_t code[] = {
+        0x40,   // inc  eax
+        0x40,   // inc  eax
+    };
+
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+    assert_int_equal(run_from(uc, ADDRESS, ADDRESS + sizeof(code)), 2);
+
+    OK(uc_hook_add(uc, &trace, UC_HOOK_CODE, count_insn, &count, 1, 0));
+    assert_int_equal(run_from(uc, ADDRESS, ADDRESS + sizeof(code)), 2);
+    assert_int_equal(count, 2);
+
+    OK(uc_hook_del(uc, trace));
+    assert_int_equal(run_from(uc, ADDRESS, ADDRESS + sizeof(code)), 2);
+    assert_int_equal(count, 2);
+}
+
+// Code the guest overwrites itself must be retranslated as well.
+static void test_tb_cache_smc(void **state)
+{
+    uc_engine *uc = *state;
+    const uint8_t code[] = {
+        0xC6, 0x05, 0x01, 0x01, 0x00, 0x01, 0x02,   // mov  byte ptr [ADDRESS + 0x101], 2
+        0xE9, 0xF4, 0x00, 0x00, 0x00,               // jmp  ADDRESS + 0x100
+    };
+    const uint8_t target[] = {
+        0xB8, 0x01, 0x00, 0x00, 0x00,   // mov  eax, 1
+    };
+
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+    OK(uc_mem_write(uc, ADDRESS + 0x100, target, sizeof(target)));
+    assert_int_equal(run_from(uc, ADDRESS + 0x100, ADDRESS + 0x105), 1);
+
+    assert_int_equal(run_from(uc, ADDRESS, ADDRESS + 0x105), 2);
+    assert_int_equal(run_from(uc, ADDRESS + 0x100, ADDRESS + 0x105), 2);
+}
+
+// Data stored next to the code must not be taken for code.
+static void test_tb_cache_data_next_to_code(void **state)
+{
+    uc_engine *uc = *state;
+    const uint8_t code[] = {
+        0xB9, 0x64, 0x00, 0x00, 0x00,   // mov  ecx, 100
+        0x40,                           // loop: inc eax
+        0xA3, 0x00, 0x08, 0x00, 0x01,   // mov  [ADDRESS + 0x800], eax
+        0x49,                           // dec  ecx
+        0x75, 0xF7,                     // jnz  loop
+    };
+    uint32_t data;
+
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+    assert_int_equal(run_from(uc, ADDRESS, ADDRESS + sizeof(code)), 100);
+    assert_int_equal(run_from(uc, ADDRESS, ADDRESS + sizeof(code)), 100);
+    OK(uc_mem_read(uc, ADDRESS + 0x800, &data, sizeof(data)));
+    assert_int_equal(data, 100);
+}
+
+// Many short uc_emu_start() calls over the same code, which used to
+// retranslate everything on each call.
+static void test_tb_cache_bench(void **state)
+{
+    uc_engine *uc = *state;
+    struct timespec start, end;
+    double elapsed;
+    int i;
+    const uint8_t code[] = {
+        0xB9, 0x64, 0x00, 0x00, 0x00,   // mov  ecx, 100
+        0x40,                           // loop: inc eax
+        0x49,                           // dec  ecx
+        0x75, 0xFC,                     // jnz  loop
+    };
+#define RUNS 10000
+
+    OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < RUNS; i++) {
+        assert_int_equal(run_from(uc, ADDRESS, ADDRESS + sizeof(code)), 100);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%d runs in %.3f s (%.2f us per uc_emu_start)\n",
+           RUNS, elapsed, elapsed * 1e6 / RUNS);
+#undef RUNS
+}
+
+// Guest stores to a data page, and to the page of the code storing.
+static void test_tb_cache_store_bench(void **state)
+{
+    uc_engine *uc = *state;
+    struct timespec start, end;
+    double elapsed;
+    int i;
+    uint8_t code[] = {
+        0xB9, 0x10, 0x27, 0x00, 0x00,   // mov  ecx, 10000
+        0x89, 0x0D, 0x00, 0x00, 0x00, 0x00,   // loop: mov  [data], ecx
+        0x49,                           // dec  ecx
+        0x75, 0xF7,                     // jnz  loop
+    };
+    const uint32_t data[] = { ADDRESS + 0x10000, ADDRESS + 0x800 };
+    const char *names[] = { "data page", "code page" };
+#define RUNS 100
+
+    for (i = 0; i < 2; i++) {
+        int j;
+
+        memcpy(code + 7, &data[i], sizeof(data[i]));
+        OK(uc_mem_write(uc, ADDRESS, code, sizeof(code)));
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < RUNS; j++) {
+            run_from(uc, ADDRESS, ADDRESS + sizeof(code));
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("stores to the %s: %.2f ns each\n", names[i],
+               elapsed * 1e9 / (RUNS * 10000));
+    }
+#undef RUNS
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_tb_cache_mem_write, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_tb_cache_until, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_tb_cache_hook_add, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_tb_cache_smc, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_tb_cache_data_next_to_code, setup32, teardown),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test_setup_teardown(test_tb_cache_bench, setup32, teardown),
+        cmocka_unit_test_setup_teardown(test_tb_cache_store_bench, setup32, teardown),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,257 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define BASE    0x100000
+#define DATA    0x102000
+#define OTHER   0x103000
+
+/******************************************************************************/
+
+// mov dword ptr [DATA], 42 ; mov eax, [DATA] ; mov dword ptr [OTHER], 7
+static const uint8_t x86_code[] = {
+    0xC7, 0x05, 0x00, 0x20, 0x10, 0x00, 0x2A, 0x00, 0x00, 0x00,
+    0xA1, 0x00, 0x20, 0x10, 0x00,
+    0xC7, 0x05, 0x00, 0x30, 0x10, 0x00, 0x07, 0x00, 0x00, 0x00,
+};
+
+struct access {
+    uc_mem_type type;
+    uint64_t address;
+    int size;
+    int64_t value;
+};
+
+struct log {
+    int n;
+    struct access accesses[8];
+};
+
+static void hook_watch(uc_engine *uc, uc_mem_type type, uint64_t address,
+                       int size, int64_t value, void *user_data)
+{
+    struct log *log = user_data;
+
+    if (log->n < 8) {
+        log->accesses[log->n].type = type;
+        log->accesses[log->n].address = address;
+        log->accesses[log->n].size = size;
+        log->accesses[log->n].value = value;
+    }
+    log->n++;
+}
+
+static uc_engine *open_x86(const uint8_t *code, size_t size)
+{
+    uc_engine *uc;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, BASE, 0x4000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, BASE, code, size));
+
+    return uc;
+}
+
+static void test_watchpoint_x86(void **state)
+{
+    uc_engine *uc = open_x86(x86_code, sizeof(x86_code));
+    struct log writes = { 0 }, reads = { 0 };
+
+    OK(uc_watchpoint_add(uc, DATA, 4, UC_HOOK_MEM_WRITE, hook_watch, &writes));
+    // overlapping a part of the access is enough
+    OK(uc_watchpoint_add(uc, DATA + 2, 1, UC_HOOK_MEM_READ, hook_watch, &reads));
+
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(x86_code), 0, 0));
+
+    assert_int_equal(writes.n, 1);
+    assert_int_equal(writes.accesses[0].type, UC_MEM_WRITE);
+    assert_int_equal(writes.accesses[0].address, DATA);
+    assert_int_equal(writes.accesses[0].size, 4);
+    assert_int_equal(writes.accesses[0].value, 42);
+
+    assert_int_equal(reads.n, 1);
+    assert_int_equal(reads.accesses[0].type, UC_MEM_READ);
+    assert_int_equal(reads.accesses[0].address, DATA);
+
+    // removed: the same, cached code no longer reports anything
+    OK(uc_watchpoint_del(uc, DATA, 4, UC_HOOK_MEM_WRITE));
+    OK(uc_watchpoint_del(uc, DATA + 2, 1, UC_HOOK_MEM_READ));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(x86_code), 0, 0));
+    assert_int_equal(writes.n, 1);
+    assert_int_equal(reads.n, 1);
+
+    OK(uc_close(uc));
+}
+
+// A range over two pages, set after the code already ran once.
+static void test_watchpoint_pages(void **state)
+{
+    uc_engine *uc = open_x86(x86_code, sizeof(x86_code));
+    struct log log = { 0 };
+
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(x86_code), 0, 0));
+
+    OK(uc_watchpoint_add(uc, DATA + 0x800, 0x1000,
+                         UC_HOOK_MEM_READ | UC_HOOK_MEM_WRITE, hook_watch, &log));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(x86_code), 0, 0));
+
+    assert_int_equal(log.n, 1);
+    assert_int_equal(log.accesses[0].type, UC_MEM_WRITE);
+    assert_int_equal(log.accesses[0].address, OTHER);
+    assert_int_equal(log.accesses[0].value, 7);
+
+    OK(uc_close(uc));
+}
+
+static void hook_watch_once(uc_engine *uc, uc_mem_type type, uint64_t address,
+                            int size, int64_t value, void *user_data)
+{
+    int *count = user_data;
+
+    (*count)++;
+    OK(uc_watchpoint_del(uc, DATA, 4, UC_HOOK_MEM_READ | UC_HOOK_MEM_WRITE));
+}
+
+// A callback may remove its own watchpoint.
+static void test_watchpoint_del_self(void **state)
+{
+    uc_engine *uc = open_x86(x86_code, sizeof(x86_code));
+    int count = 0;
+    uint32_t val;
+
+    OK(uc_watchpoint_add(uc, DATA, 4, UC_HOOK_MEM_READ | UC_HOOK_MEM_WRITE,
+                         hook_watch_once, &count));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(x86_code), 0, 0));
+    assert_int_equal(count, 1);
+
+    OK(uc_mem_read(uc, OTHER, &val, sizeof(val)));
+    assert_int_equal(val, 7);
+
+    OK(uc_close(uc));
+}
+
+static void test_watchpoint_arg(void **state)
+{
+    uc_engine *uc;
+    struct log log = { 0 };
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    uc_assert_err(UC_ERR_ARG, uc_watchpoint_add(uc, DATA, 0, UC_HOOK_MEM_READ, hook_watch, &log));
+    uc_assert_err(UC_ERR_ARG, uc_watchpoint_add(uc, DATA, 4, 0, hook_watch, &log));
+    uc_assert_err(UC_ERR_ARG, uc_watchpoint_add(uc, DATA, 4, UC_HOOK_CODE, hook_watch, &log));
+    uc_assert_err(UC_ERR_ARG, uc_watchpoint_add(uc, DATA, 4, UC_HOOK_MEM_READ, NULL, &log));
+
+    OK(uc_watchpoint_add(uc, DATA, 4, UC_HOOK_MEM_READ, hook_watch, &log));
+    uc_assert_err(UC_ERR_ARG, uc_watchpoint_add(uc, DATA, 4, UC_HOOK_MEM_READ, hook_watch, &log));
+    // another direction is another watchpoint
+    OK(uc_watchpoint_add(uc, DATA, 4, UC_HOOK_MEM_WRITE, hook_watch, &log));
+
+    OK(uc_watchpoint_del(uc, DATA, 4, UC_HOOK_MEM_READ));
+    uc_assert_err(UC_ERR_ARG, uc_watchpoint_del(uc, DATA, 4, UC_HOOK_MEM_READ));
+    uc_assert_err(UC_ERR_ARG, uc_watchpoint_del(uc, DATA, 8, UC_HOOK_MEM_WRITE));
+
+    // the one left is freed by uc_close()
+    OK(uc_close(uc));
+}
+
+static void test_watchpoint_arm(void **state)
+{
+    const uint8_t code[] = {
+        0x00, 0x00, 0x81, 0xE5,     // str r0, [r1]
+        0x00, 0x20, 0x91, 0xE5,     // ldr r2, [r1]
+    };
+    uc_engine *uc;
+    struct log log = { 0 };
+    uint32_t r0 = 0x1234, r1 = DATA, r2;
+
+    OK(uc_open(UC_ARCH_ARM, UC_MODE_ARM, &uc));
+    OK(uc_mem_map(uc, BASE, 0x4000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, BASE, code, sizeof(code)));
+    OK(uc_reg_write(uc, UC_ARM_REG_R0, &r0));
+    OK(uc_reg_write(uc, UC_ARM_REG_R1, &r1));
+
+    OK(uc_watchpoint_add(uc, DATA, 4, UC_HOOK_MEM_READ | UC_HOOK_MEM_WRITE,
+                         hook_watch, &log));
+    OK(uc_emu_start(uc, BASE, BASE + sizeof(code), 0, 0));
+
+    assert_int_equal(log.n, 2);
+    assert_int_equal(log.accesses[0].type, UC_MEM_WRITE);
+    assert_int_equal(log.accesses[0].value, 0x1234);
+    assert_int_equal(log.accesses[1].type, UC_MEM_READ);
+    assert_int_equal(log.accesses[1].address, DATA);
+
+    OK(uc_reg_read(uc, UC_ARM_REG_R2, &r2));
+    assert_int_equal(r2, 0x1234);
+
+    OK(uc_close(uc));
+}
+
+/******************************************************************************/
+
+#define BENCH_LOOPS 2000000
+
+static double bench_run(uc_engine *uc, const uint8_t *code, size_t size)
+{
+    uint32_t loops = BENCH_LOOPS;
+    struct timespec start, end;
+
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &loops));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    OK(uc_emu_start(uc, BASE, BASE + size, 0, 0));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / BENCH_LOOPS;
+}
+
+// Micro-benchmark: a watchpoint only slows down accesses to its own page
+static void test_watchpoint_bench(void **state)
+{
+    const uint8_t code[] = {
+        0xA1, 0x00, 0x20, 0x10, 0x00,   // a: mov eax, [DATA]
+        0x49,                           // dec ecx
+        0x75, 0xF8,                     // jnz a
+    };
+    uc_engine *uc = open_x86(code, sizeof(code));
+    struct log log = { 0 };
+    double none, other, same;
+
+    bench_run(uc, code, sizeof(code));
+    none = bench_run(uc, code, sizeof(code));
+
+    OK(uc_watchpoint_add(uc, OTHER, 4, UC_HOOK_MEM_READ, hook_watch, &log));
+    bench_run(uc, code, sizeof(code));
+    other = bench_run(uc, code, sizeof(code));
+    assert_int_equal(log.n, 0);
+    OK(uc_watchpoint_del(uc, OTHER, 4, UC_HOOK_MEM_READ));
+
+    // same page, but another word: slow path without any callback
+    OK(uc_watchpoint_add(uc, DATA + 0x100, 4, UC_HOOK_MEM_READ, hook_watch, &log));
+    bench_run(uc, code, sizeof(code));
+    same = bench_run(uc, code, sizeof(code));
+    assert_int_equal(log.n, 0);
+
+    printf("ns per iteration: %.2f without watchpoints, %.2f watching another page, "
+           "%.2f watching the same page\n", none, other, same);
+
+    OK(uc_close(uc));
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_watchpoint_x86),
+        cmocka_unit_test(test_watchpoint_pages),
+        cmocka_unit_test(test_watchpoint_del_self),
+        cmocka_unit_test(test_watchpoint_arg),
+        cmocka_unit_test(test_watchpoint_arm),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_watchpoint_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,159 @@
+#include "unicorn_test.h"
+#include <time.h>
+#include <string.h>
+
+#define OK(x)   uc_assert_success(x)
+
+#define CODE    0x1000000
+
+/******************************************************************************/
+
+struct flags_seen {
+    int count;
+    uint32_t eflags[8];
+};
+
+static void hook_read_eflags(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+    struct flags_seen *seen = user_data;
+    uint32_t eflags;
+
+    OK(uc_reg_read(uc, UC_X86_REG_EFLAGS, &eflags));
+    if (seen->count < 8)
+        seen->eflags[seen->count++] = eflags;
+}
+
+// A code hook reads the flags left by the previous instruction.
+static void test_eflags_in_hook(void **state)
+{
+    const uint8_t code[] = {
+        0x31, 0xC0,         // xor eax, eax
+        0x40,               // inc eax
+        0x48,               // dec eax
+        0x83, 0xF8, 0x01,   // cmp eax, 1
+        0x90,               // nop
+    };
+    const uint32_t expected[] = { 0x2, 0x46, 0x2, 0x46, 0x97 };
+    struct flags_seen seen = { 0 };
+    uint32_t eflags = 0x2;
+    uc_engine *uc;
+    uc_hook hh;
+    int i;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, CODE, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, CODE, code, sizeof(code)));
+    OK(uc_reg_write(uc, UC_X86_REG_EFLAGS, &eflags));
+    OK(uc_hook_add(uc, &hh, UC_HOOK_CODE, hook_read_eflags, &seen, 1, 0));
+
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+
+    assert_int_equal(seen.count, 5);
+    for (i = 0; i < 5; i++)
+        assert_int_equal(seen.eflags[i], expected[i]);
+    OK(uc_reg_read(uc, UC_X86_REG_EFLAGS, &eflags));
+    assert_int_equal(eflags, 0x97);
+
+    OK(uc_close(uc));
+}
+
+static uint32_t run_carry_chain(bool hooked)
+{
+    const uint8_t code[] = {
+        0xF9,               // stc
+        0x83, 0xD0, 0x00,   // adc eax, 0
+        0xF9,               // stc
+        0x19, 0xC8,         // sbb eax, ecx
+    };
+    struct flags_seen seen = { 0 };
+    uint32_t eax = 0x55, ecx = 0x77;
+    uc_engine *uc;
+    uc_hook hh;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, CODE, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, CODE, code, sizeof(code)));
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &eax));
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &ecx));
+    if (hooked)
+        OK(uc_hook_add(uc, &hh, UC_HOOK_CODE, hook_read_eflags, &seen, 1, 0));
+
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &eax));
+    OK(uc_close(uc));
+
+    return eax;
+}
+
+// ADC and SBB consume the carry left by the previous instruction.
+static void test_carry_chain(void **state)
+{
+    assert_int_equal(run_carry_chain(false), 0xffffffde);
+    assert_int_equal(run_carry_chain(true), 0xffffffde);
+}
+
+/******************************************************************************/
+
+#define BENCH_LOOPS 1000000
+
+static void hook_nothing(uc_engine *uc, uint64_t address, uint32_t size, void *user_data)
+{
+}
+
+static double bench_run(uc_cb_hookcode_t cb, void *user_data)
+{
+    const uint8_t code[] = {
+        0x01, 0xD8,         // loop: add eax, ebx
+        0x83, 0xD2, 0x00,   // adc edx, 0
+        0x49,               // dec ecx
+        0x75, 0xF8,         // jnz loop
+    };
+    struct timespec start, end;
+    uint32_t ecx = BENCH_LOOPS, ebx = 0x9e3779b9;
+    uc_engine *uc;
+    uc_hook hh;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, CODE, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, CODE, code, sizeof(code)));
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &ecx));
+    OK(uc_reg_write(uc, UC_X86_REG_EBX, &ebx));
+    OK(uc_hook_add(uc, &hh, UC_HOOK_CODE, cb, user_data, 1, 0));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    OK(uc_emu_start(uc, CODE, CODE + sizeof(code), 0, 0));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    OK(uc_close(uc));
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / (4.0 * BENCH_LOOPS);
+}
+
+// Micro-benchmark: code hooks over flag-heavy code
+static void test_eflags_bench(void **state)
+{
+    struct flags_seen seen;
+    double quiet, reading;
+
+    quiet = bench_run(hook_nothing, NULL);
+    seen.count = 8;
+    reading = bench_run(hook_read_eflags, &seen);
+
+    printf("ns per hooked instruction: %.1f with an empty hook, %.1f reading EFLAGS\n",
+           quiet, reading);
+}
+
+int main(int argc, char **argv)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_eflags_in_hook),
+        cmocka_unit_test(test_carry_chain),
+    };
+    const struct CMUnitTest benches[] = {
+        cmocka_unit_test(test_eflags_bench),
+    };
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return cmocka_run_group_tests(benches, NULL, NULL);
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -10,6 +10,9 @@
 #endif
 
 #include <time.h>   // nanosleep
+#ifndef _WIN32
+#include <sys/stat.h>   // fstat
+#endif
 
 #include <string.h>
 
@@ -102,6 +105,8 @@ const char *uc_strerror(uc_err code)
             return "Insufficient resource (UC_ERR_RESOURCE)";
         case UC_ERR_EXCEPTION:
             return "Unhandled CPU exception (UC_ERR_EXCEPTION)";
+        case UC_ERR_BREAKPOINT:
+            return "Breakpoint hit (UC_ERR_BREAKPOINT)";
     }
 }
 
@@ -152,6 +157,8 @@ uc_err uc_open(uc_arch arch, uc_mode mode, uc_engine **result)
         uc->errnum = UC_ERR_OK;
         uc->arch = arch;
         uc->mode = mode;
+        // not emulating until uc_emu_start()
+        uc->emulation_done = true;
 
         // uc->ram_list = { .blocks = QLIST_HEAD_INITIALIZER(ram_list.blocks) };
         uc->ram_list.blocks.lh_first = NULL;
@@ -281,6 +288,48 @@ uc_err uc_open(uc_arch arch, uc_mode mode, uc_engine **result)
     }
 }
 
+static void hook_vector_unref(struct hook_vector *vector)
+{
+    if (vector != NULL && --vector->refs == 0) {
+        vector->uc->stats.hook_vectors--;
+        g_free(vector);
+    }
+}
+
+static void hook_table_free(struct hook_table *table)
+{
+    uint32_t i;
+
+    if (table == NULL)
+        return;
+
+    free(table->starts);
+    free(table->offsets);
+    free(table->hooks);
+    if (table->vectors != NULL) {
+        for (i = 0; i < table->count; i++)
+            hook_vector_unref(table->vectors[i]);
+        free(table->vectors);
+    }
+    free(table);
+}
+
+// free hooks deleted & tables replaced during the last emulation
+static void free_stale_hooks(uc_engine *uc)
+{
+    struct list_item *cur;
+
+    for (cur = uc->hooks_to_free.head; cur != NULL; cur = cur->next)
+        free(cur->data);
+    list_clear(&uc->hooks_to_free);
+
+    for (cur = uc->hook_tables_to_free.head; cur != NULL; cur = cur->next)
+        hook_table_free(cur->data);
+    list_clear(&uc->hook_tables_to_free);
+
+    hook_vectors_reset(uc);
+}
+
 static void free_hooks(uc_engine *uc)
 {
     struct list_item *cur;
@@ -300,6 +349,33 @@ static void free_hooks(uc_engine *uc)
             cur = cur->next;
         }
         list_clear(&uc->hook[i]);
+        hook_table_free(uc->hook_table[i]);
+        uc->hook_table[i] = NULL;
+    }
+
+    // IN & OUT hooks are only in their own list
+    for (i = 0; i < UC_HOOK_PORT_MAX; i++) {
+        for (cur = uc->hook_port[i].head; cur != NULL; cur = cur->next)
+            free(cur->data);
+        list_clear(&uc->hook_port[i]);
+        hook_table_free(uc->hook_port_table[i]);
+        uc->hook_port_table[i] = NULL;
+    }
+
+    free_stale_hooks(uc);
+}
+
+// breakpoints and watchpoints left by the user
+static void free_debug_points(CPUState *cpu)
+{
+    CPUBreakpoint *bp, *next_bp;
+    CPUWatchpoint *wp, *next_wp;
+
+    QTAILQ_FOREACH_SAFE(bp, &cpu->breakpoints, entry, next_bp) {
+        g_free(bp);
+    }
+    QTAILQ_FOREACH_SAFE(wp, &cpu->watchpoints, entry, next_wp) {
+        g_free(wp);
     }
 }
 
@@ -307,12 +383,13 @@ UNICORN_EXPORT
 uc_err uc_close(uc_engine *uc)
 {
     // Cleanup internally.
+    // also frees tcg_init_ctx, the TCG context of the vCPU
     if (uc->release) {
         uc->release(uc->tcg_init_ctx);
     }
-    g_free(uc->tcg_init_ctx);
 
     // Cleanup CPU.
+    free_debug_points(uc->cpu);
     g_free(uc->cpu->cpu_ases);
     g_free(uc->cpu->thread);
 
@@ -349,6 +426,7 @@ uc_err uc_close(uc_engine *uc)
 
     free_hooks(uc);
     free(uc->mapped_blocks);
+    g_free(uc->mem_trace_pcs);
 
     // finally, free uc itself.
     memset(uc, 0, sizeof(*uc));
@@ -463,20 +541,23 @@ uc_err uc_mem_write(uc_engine *uc, uint64_t address, const void *_bytes, size_t
     // memory area can overlap adjacent memory blocks
     while(count < size) {
         MemoryRegion *mr = memory_mapping(uc, address);
-        if (mr) {
-            uint32_t operms = mr->perms;
-            if (!(operms & UC_PROT_WRITE)) // write protected
-                // but this is not the program accessing memory, so temporarily mark writable
-                uc->readonly_mem(mr, false);
+        uint8_t *ptr = mr ? uc->memory_host_ptr(uc, mr, address - mr->addr) : NULL;
+        if (ptr) {
+            // RAM is written in place whatever its protection, toggling
+            // it would rebuild the memory topology every time
+            len = (size_t)MIN(size - count, mr->end - address);
+            memcpy(ptr, bytes, len);
+            uc->memory_host_written(uc, mr, address - mr->addr, len);
 
+            count += len;
+            address += len;
+            bytes += len;
+        } else if (mr) {
+            // MMIO: the write goes to the callback, or nowhere without one
             len = (size_t)MIN(size - count, mr->end - address);
             if (uc->write_mem(uc->cpu->as, address, bytes, len) == false)
                 break;
 
-            if (!(operms & UC_PROT_WRITE)) // write protected
-                // now write protect it again
-                uc->readonly_mem(mr, true);
-
             count += len;
             address += len;
             bytes += len;
@@ -490,52 +571,153 @@ uc_err uc_mem_write(uc_engine *uc, uint64_t address, const void *_bytes, size_t
         return UC_ERR_WRITE_UNMAPPED;
 }
 
-#define TIMEOUT_STEP 2    // microseconds
+UNICORN_EXPORT
+uc_err uc_mem_get_host_ptr(uc_engine *uc, uint64_t address, size_t size, void **ptr)
+{
+    MemoryRegion *mr;
+
+    if (uc->mem_redirect) {
+        address = uc->mem_redirect(address);
+    }
+
+    mr = memory_mapping(uc, address);
+    if (mr == NULL)
+        return UC_ERR_READ_UNMAPPED;
+
+    // the range must be contiguous on the host, so in a single region
+    if (size == 0 || size - 1 > mr->end - 1 - address)
+        return UC_ERR_ARG;
+
+    *ptr = uc->memory_host_ptr(uc, mr, address - mr->addr);
+    if (*ptr == NULL)
+        return UC_ERR_ARG;
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_mem_host_written(uc_engine *uc, uint64_t address, size_t size)
+{
+    size_t count = 0, len;
+
+    if (uc->mem_redirect) {
+        address = uc->mem_redirect(address);
+    }
+
+    if (!check_mem_area(uc, address, size))
+        return UC_ERR_WRITE_UNMAPPED;
+
+    // memory area can overlap adjacent memory blocks
+    while(count < size) {
+        MemoryRegion *mr = memory_mapping(uc, address);
+
+        len = (size_t)MIN(size - count, mr->end - address);
+        uc->memory_host_written(uc, mr, address - mr->addr, len);
+
+        count += len;
+        address += len;
+    }
+
+    return UC_ERR_OK;
+}
+
+// Timeouts of all engines in the process are served by a single thread,
+// sleeping until the earliest deadline. It exits once no engine needed
+// it for TIMER_IDLE, and is started again on demand.
+#define TIMER_IDLE 1000000000LL     // nanoseconds
+
+static QemuMutex timer_lock = QEMU_MUTEX_INITIALIZER;
+static QemuCond timer_cond = QEMU_COND_INITIALIZER;
+static struct uc_struct *timer_engines;    // emulating with a timeout
+static bool timer_running;
+
 static void *_timeout_fn(void *arg)
 {
-    struct uc_struct *uc = arg;
-    int64_t current_time = get_clock();
+    struct uc_struct *uc, **prev;
+    int64_t now, next;
+
+    qemu_mutex_lock(&timer_lock);
+    for (;;) {
+        now = get_clock();
+        next = now + TIMER_IDLE;
+
+        for (prev = &timer_engines; (uc = *prev) != NULL; ) {
+            if (uc->timeout_deadline <= now) {
+                // force emulation to stop, disable_emu_timer() waits
+                // for this since we hold the lock
+                *prev = uc->timeout_next;
+                uc_emu_stop(uc);
+            } else {
+                if (uc->timeout_deadline < next)
+                    next = uc->timeout_deadline;
+                prev = &uc->timeout_next;
+            }
+        }
 
-    do {
-        usleep(TIMEOUT_STEP);
-        // perhaps emulation is even done before timeout?
-        if (uc->emulation_done)
+        if (!qemu_cond_timedwait(&timer_cond, &timer_lock, next - now) &&
+                timer_engines == NULL) {
+            // idle for TIMER_IDLE
             break;
-    } while((uint64_t)(get_clock() - current_time) < uc->timeout);
-
-    // timeout before emulation is done?
-    if (!uc->emulation_done) {
-        // force emulation to stop
-        uc_emu_stop(uc);
+        }
     }
+    timer_running = false;
+    qemu_mutex_unlock(&timer_lock);
 
     return NULL;
 }
 
-static void enable_emu_timer(uc_engine *uc, uint64_t timeout)
+static uc_err enable_emu_timer(uc_engine *uc, uint64_t timeout)
 {
-    uc->timeout = timeout;
-    qemu_thread_create(uc, &uc->timer, "timeout", _timeout_fn,
-            uc, QEMU_THREAD_JOINABLE);
+    QemuThread thread;
+    uc_err err = UC_ERR_OK;
+
+    qemu_mutex_lock(&timer_lock);
+    uc->timeout_deadline = get_clock() + timeout;
+    uc->timeout_next = timer_engines;
+    timer_engines = uc;
+
+    if (timer_running) {
+        // the new deadline may be the earliest
+        qemu_cond_signal(&timer_cond);
+    } else if (qemu_thread_create(NULL, &thread, "timeout", _timeout_fn,
+                NULL, QEMU_THREAD_DETACHED)) {
+        timer_engines = uc->timeout_next;
+        err = UC_ERR_RESOURCE;
+    } else {
+        timer_running = true;
+    }
+    qemu_mutex_unlock(&timer_lock);
+
+    return err;
 }
 
-static void hook_count_cb(struct uc_struct *uc, uint64_t address, uint32_t size, void *user_data)
+static void disable_emu_timer(uc_engine *uc)
 {
-    // count this instruction. ah ah ah.
-    uc->emu_counter++;
+    struct uc_struct **prev;
 
-    if (uc->emu_counter > uc->emu_count)
-        uc_emu_stop(uc);
+    qemu_mutex_lock(&timer_lock);
+    // not found if the timer already stopped it
+    for (prev = &timer_engines; *prev != NULL; prev = &(*prev)->timeout_next) {
+        if (*prev == uc) {
+            *prev = uc->timeout_next;
+            break;
+        }
+    }
+    qemu_mutex_unlock(&timer_lock);
 }
 
+static uc_err hook_tables_refresh(uc_engine *uc);
+
 UNICORN_EXPORT
 uc_err uc_emu_start(uc_engine* uc, uint64_t begin, uint64_t until, uint64_t timeout, size_t count)
 {
-    // reset the counter
-    uc->emu_counter = 0;
+    // index the hooks changed since the last run
+    uc_err err = hook_tables_refresh(uc);
+    if (err != UC_ERR_OK)
+        return err;
+
     uc->invalid_error = UC_ERR_OK;
     uc->block_full = false;
-    uc->emulation_done = false;
 
     switch(uc->arch) {
         default:
@@ -586,94 +768,244 @@ uc_err uc_emu_start(uc_engine* uc, uint64_t begin, uint64_t until, uint64_t time
 #endif
     }
 
-    uc->stop_request = false;
-
+    // counted in the translated code, which is generated separately
+    // for runs with and without a limit
     uc->emu_count = count;
-    // remove count hook if counting isn't necessary
-    if (count <= 0 && uc->count_hook != 0) {
-        uc_hook_del(uc, uc->count_hook);
-        uc->count_hook = 0;
-    }
-    // set up count hook to count instructions.
-    if (count > 0 && uc->count_hook == 0) {
-        uc_err err;
-        // callback to count instructions must be run before everything else,
-        // so instead of appending, we must insert the hook at the begin
-        // of the hook list
-        uc->hook_insert = 1;
-        err = uc_hook_add(uc, &uc->count_hook, UC_HOOK_CODE, hook_count_cb, NULL, 1, 0);
-        // restore to append mode for uc_hook_add()
-        uc->hook_insert = 0;
+
+    // edges are counted from the start of each run
+    uc->coverage_prev = 0;
+
+    // stop requests made before this point are ignored
+    atomic_set(&uc->stop_request, false);
+    atomic_set(&uc->emulation_done, false);
+
+    // cached blocks were translated for another @until, drop any running over it
+    uc->addr_end = until;
+    uc->uc_invalidate_tb(uc, until, 1);
+
+    if (timeout) {
+        err = enable_emu_timer(uc, timeout * 1000);   // microseconds -> nanoseconds
         if (err != UC_ERR_OK) {
             return err;
         }
     }
 
-    uc->addr_end = until;
-
-    if (timeout)
-        enable_emu_timer(uc, timeout * 1000);   // microseconds -> nanoseconds
-
     if (uc->vm_start(uc)) {
+        if (timeout)
+            disable_emu_timer(uc);
         return UC_ERR_RESOURCE;
     }
 
     // emulation is done
-    uc->emulation_done = true;
+    atomic_set(&uc->emulation_done, true);
+    free_stale_hooks(uc);
+    uc_mem_trace_flush(uc);
 
-    if (timeout) {
-        // wait for the timer to finish
-        qemu_thread_join(&uc->timer);
-    }
+    if (timeout)
+        disable_emu_timer(uc);
 
     return uc->invalid_error;
 }
 
 
+// set @request and make the vCPU leave its current TB. Only atomic
+// accesses, as this may be called from another thread or a signal handler.
+static void emu_exit_request(uc_engine *uc, bool *request)
+{
+    CPUState *cpu;
+
+    if (atomic_read(&uc->emulation_done))
+        return;
+
+    // read after the TB exits, see tcg_exec_all(). Ordered before reading
+    // current_cpu: cpu_exec() sets it, then checks for a stop request, so
+    // at least one of us sees the other
+    atomic_set(request, true);
+    smp_mb();
+    cpu = atomic_read(&uc->current_cpu);
+    if (cpu) {
+        // exit the current TB
+        cpu_exit(cpu);
+    }
+}
+
 UNICORN_EXPORT
 uc_err uc_emu_stop(uc_engine *uc)
 {
-    if (uc->emulation_done)
-        return UC_ERR_OK;
+    emu_exit_request(uc, &uc->stop_request);
 
-    uc->stop_request = true;
-    // TODO: make this atomic somehow?
-    if (uc->current_cpu) {
-        // exit the current TB
-        cpu_exit(uc->current_cpu);
+    return UC_ERR_OK;
+}
+
+void uc_emu_quit_tb(struct uc_struct *uc)
+{
+    emu_exit_request(uc, &uc->quit_request);
+}
+
+UNICORN_EXPORT
+uc_err uc_coverage_enable(uc_engine *uc, uint8_t *bitmap, size_t size)
+{
+    if (bitmap != NULL && (size == 0 || (size & (size - 1)) != 0 || size > 0x80000000))
+        return UC_ERR_ARG;
+
+    // the map and its mask are compiled into the translated code
+    uc->coverage_map = bitmap;
+    uc->coverage_mask = bitmap != NULL ? (uint32_t)(size - 1) : 0;
+    uc->coverage_prev = 0;
+    uc->tb_flush_request = true;
+    // called from a callback? then quit TB and continue at the same place
+    uc_emu_quit_tb(uc);
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_profile_enable(uc_engine *uc, bool enable)
+{
+    // the counters are compiled into the translated code
+    uc->profile_enabled = enable;
+    uc->tb_flush_request = true;
+    // called from a callback? then quit TB and continue at the same place
+    uc_emu_quit_tb(uc);
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_profile_top(uc_engine *uc, uc_tb_profile *blocks, size_t *count)
+{
+    if (*count != 0 && blocks == NULL)
+        return UC_ERR_ARG;
+
+    uc->profile_top(uc, blocks, count);
+
+    return UC_ERR_OK;
+}
+
+// hand the records of the trace buffer over to the user
+void uc_mem_trace_flush(struct uc_struct *uc)
+{
+    size_t count = uc->mem_trace_count;
+
+    if (count == 0)
+        return;
+
+    // the callback may disable tracing or replace the buffer
+    uc->mem_trace_count = 0;
+    uc->mem_trace_callback(uc, uc->mem_trace, count, uc->mem_trace_data);
+}
+
+UNICORN_EXPORT
+uc_err uc_mem_trace_enable(uc_engine *uc, uc_mem_access *buffer, size_t count,
+        uc_cb_mem_trace_t callback, void *user_data)
+{
+    if (buffer != NULL && (count == 0 || callback == NULL))
+        return UC_ERR_ARG;
+
+    // records of the previous buffer go to its own callback
+    if (uc->mem_trace != NULL)
+        uc_mem_trace_flush(uc);
+
+    uc->mem_trace = buffer;
+    uc->mem_trace_size = buffer != NULL ? count : 0;
+    uc->mem_trace_count = 0;
+    uc->mem_trace_callback = callback;
+    uc->mem_trace_data = user_data;
+
+    // traced accesses all take the slow path, see tlb_hooked_flag()
+    uc->uc_tlb_flush(uc);
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_breakpoint_add(uc_engine *uc, uint64_t address)
+{
+    if (cpu_breakpoint_test(uc->cpu, address, BP_GDB))
+        return UC_ERR_ARG;
+
+    // this only drops the translations of @address
+    uc->breakpoint_insert(uc->cpu, address, BP_GDB, NULL);
+    // called from a callback? then quit TB and continue at the same place
+    uc_emu_quit_tb(uc);
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_breakpoint_del(uc_engine *uc, uint64_t address)
+{
+    if (uc->breakpoint_remove(uc->cpu, address, BP_GDB) != 0)
+        return UC_ERR_ARG;
+
+    uc_emu_quit_tb(uc);
+
+    return UC_ERR_OK;
+}
+
+// BP_MEM_* flags of a watchpoint, 0 if @type is invalid
+static int watchpoint_flags(int type)
+{
+    if (type == 0 || (type & ~(UC_HOOK_MEM_READ | UC_HOOK_MEM_WRITE)))
+        return 0;
+
+    return BP_GDB | ((type & UC_HOOK_MEM_READ) ? BP_MEM_READ : 0) |
+        ((type & UC_HOOK_MEM_WRITE) ? BP_MEM_WRITE : 0);
+}
+
+UNICORN_EXPORT
+uc_err uc_watchpoint_add(uc_engine *uc, uint64_t address, size_t size, int type,
+        void *callback, void *user_data)
+{
+    CPUWatchpoint *wp;
+    int flags = watchpoint_flags(type);
+
+    if (flags == 0 || callback == NULL)
+        return UC_ERR_ARG;
+
+    QTAILQ_FOREACH(wp, &uc->cpu->watchpoints, entry) {
+        if (wp->vaddr == address && wp->len == size && wp->flags == flags)
+            return UC_ERR_ARG;
     }
 
+    // this only flushes the TLB entries of the watched pages
+    if (uc->watchpoint_insert(uc->cpu, address, size, flags, &wp) != 0)
+        return UC_ERR_ARG;
+    wp->callback = callback;
+    wp->user_data = user_data;
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_watchpoint_del(uc_engine *uc, uint64_t address, size_t size, int type)
+{
+    int flags = watchpoint_flags(type);
+
+    if (flags == 0 || uc->watchpoint_remove(uc->cpu, address, size, flags) != 0)
+        return UC_ERR_ARG;
+
     return UC_ERR_OK;
 }
 
 // find if a memory range overlaps with existing mapped regions
 static bool memory_overlap(struct uc_struct *uc, uint64_t begin, size_t size)
 {
-    unsigned int i;
+    uint32_t i;
     uint64_t end = begin + size - 1;
 
-    for(i = 0; i < uc->mapped_block_count; i++) {
-        // begin address falls inside this region?
-        if (begin >= uc->mapped_blocks[i]->addr && begin <= uc->mapped_blocks[i]->end - 1)
-            return true;
-
-        // end address falls inside this region?
-        if (end >= uc->mapped_blocks[i]->addr && end <= uc->mapped_blocks[i]->end - 1)
-            return true;
-
-        // this region falls totally inside this range?
-        if (begin < uc->mapped_blocks[i]->addr && end > uc->mapped_blocks[i]->end - 1)
-            return true;
-    }
+    // the first region ending after @begin is the only candidate,
+    // all the following ones start even later
+    i = mapped_block_bsearch(uc, begin);
 
-    // not found
-    return false;
+    return i < uc->mapped_block_count && uc->mapped_blocks[i]->addr <= end;
 }
 
 // common setup/error checking shared between uc_mem_map and uc_mem_map_ptr
 static uc_err mem_map(uc_engine *uc, uint64_t address, size_t size, uint32_t perms, MemoryRegion *block)
 {
     MemoryRegion **regions;
+    uint32_t i;
 
     if (block == NULL)
         return UC_ERR_NOMEM;
@@ -687,7 +1019,11 @@ static uc_err mem_map(uc_engine *uc, uint64_t address, size_t size, uint32_t per
         uc->mapped_blocks = regions;
     }
 
-    uc->mapped_blocks[uc->mapped_block_count] = block;
+    // keep the array sorted by address
+    i = mapped_block_bsearch(uc, address);
+    memmove(&uc->mapped_blocks[i + 1], &uc->mapped_blocks[i],
+            sizeof(MemoryRegion*) * (uc->mapped_block_count - i));
+    uc->mapped_blocks[i] = block;
     uc->mapped_block_count++;
 
     return UC_ERR_OK;
@@ -758,55 +1094,237 @@ uc_err uc_mem_map_ptr(uc_engine *uc, uint64_t address, size_t size, uint32_t per
     return mem_map(uc, address, size, UC_PROT_ALL, uc->memory_map_ptr(uc, address, size, perms, ptr));
 }
 
-// Create a backup copy of the indicated MemoryRegion.
-// Generally used in prepartion for splitting a MemoryRegion.
-static uint8_t *copy_region(struct uc_struct *uc, MemoryRegion *mr)
+UNICORN_EXPORT
+uc_err uc_mem_map_file(uc_engine *uc, uint64_t address, size_t size, uint32_t perms,
+        int fd, uint64_t offset, bool private_map)
 {
-    uint8_t *block = (uint8_t *)g_malloc0((size_t)int128_get64(mr->size));
-    if (block != NULL) {
-        uc_err err = uc_mem_read(uc, mr->addr, block, (size_t)int128_get64(mr->size));
-        if (err != UC_ERR_OK) {
-            free(block);
-            block = NULL;
-        }
+    uc_err res;
+
+    if (fd < -1)
+        return UC_ERR_ARG;
+
+    if (uc->mem_redirect) {
+        address = uc->mem_redirect(address);
     }
 
-    return block;
-}
+    res = mem_map_check(uc, address, size, perms);
+    if (res)
+        return res;
 
-/*
-   Split the given MemoryRegion at the indicated address for the indicated size
-   this may result in the create of up to 3 spanning sections. If the delete
-   parameter is true, the no new section will be created to replace the indicate
-   range. This functions exists to support uc_mem_protect and uc_mem_unmap.
+#ifndef _WIN32
+    // the pages of a regular file past its end could not be accessed
+    if (fd >= 0) {
+        struct stat st;
 
-   This is a static function and callers have already done some preliminary
-   parameter validation.
+        if (fstat(fd, &st) != 0)
+            return UC_ERR_ARG;
+        if (S_ISREG(st.st_mode) &&
+                (offset > (uint64_t)st.st_size || size > (uint64_t)st.st_size - offset))
+            return UC_ERR_ARG;
+    }
+#endif
 
-   The do_delete argument indicates that we are being called to support
-   uc_mem_unmap. In this case we save some time by choosing NOT to remap
-   the areas that are intended to get unmapped
- */
-// TODO: investigate whether qemu region manipulation functions already offered
-// this capability
-static bool split_region(struct uc_struct *uc, MemoryRegion *mr, uint64_t address,
-        size_t size, bool do_delete)
+    return mem_map(uc, address, size, perms,
+            uc->memory_map_fd(uc, address, size, perms, fd, offset, !private_map));
+}
+
+UNICORN_EXPORT
+uc_err uc_mmio_map(uc_engine *uc, uint64_t address, size_t size,
+        uc_cb_mmio_read_t read_cb, uc_cb_mmio_write_t write_cb, void *user_data)
 {
-    uint8_t *backup;
-    uint32_t perms;
-    uint64_t begin, end, chunk_end;
-    size_t l_size, m_size, r_size;
+    uc_err res;
 
-    chunk_end = address + size;
+    if (uc->mem_redirect) {
+        address = uc->mem_redirect(address);
+    }
 
-    // if this region belongs to area [address, address+size],
-    // then there is no work to do.
-    if (address <= mr->addr && chunk_end >= mr->end)
-        return true;
+    res = mem_map_check(uc, address, size, UC_PROT_NONE);
+    if (res)
+        return res;
 
-    if (size == 0)
-        // trivial case
-        return true;
+    return mem_map(uc, address, size, UC_PROT_NONE,
+            uc->memory_map_io(uc, address, size, read_cb, write_cb, user_data));
+}
+
+// does [address, address + size) only cover whole MMIO regions, or
+// none at all if !@whole?
+static bool mmio_range_ok(struct uc_struct *uc, uint64_t address, size_t size, bool whole)
+{
+    uint64_t end = address + size;
+    uint32_t i;
+
+    for (i = mapped_block_bsearch(uc, address); i < uc->mapped_block_count; i++) {
+        MemoryRegion *mr = uc->mapped_blocks[i];
+
+        if (mr->addr >= end)
+            break;
+        if (memory_region_is_ram(mr))
+            continue;
+        if (!whole || mr->addr < address || mr->end > end)
+            return false;
+    }
+
+    return true;
+}
+
+// number of pages of this region
+static size_t region_pages(struct uc_struct *uc, MemoryRegion *mr)
+{
+    return (size_t)((mr->end - mr->addr) / uc->target_page_size);
+}
+
+// permissions of the page of this address in its region @mr
+uint32_t memory_page_perms(struct uc_struct *uc, MemoryRegion *mr, uint64_t address)
+{
+    if (mr->page_perms == NULL)
+        return mr->perms;
+
+    if (uc->mem_redirect) {
+        address = uc->mem_redirect(address);
+    }
+
+    return mr->page_perms[(address - mr->addr) / uc->target_page_size];
+}
+
+// Recompute the permissions of the region after its pages changed, from
+// the page counts of each perms value. mr->perms is the union of the page
+// perms, and the per-page array is dropped once all the pages agree again.
+// Only a region without any writable page is read-only for QEMU, single
+// pages are write protected by their TLB entries.
+static void region_perms_update(struct uc_struct *uc, MemoryRegion *mr)
+{
+    uint32_t perms, all = 0;
+    bool same = false;
+
+    if (mr->page_perms) {
+        for (perms = 0; perms <= UC_PROT_ALL; perms++) {
+            if (mr->page_perms_count[perms] != 0)
+                all |= perms;
+            if (mr->page_perms_count[perms] == region_pages(uc, mr))
+                same = true;
+        }
+        if (same) {
+            g_free(mr->page_perms);
+            mr->page_perms = NULL;
+        }
+        mr->perms = all;
+    }
+
+    uc->readonly_mem(mr, (mr->perms & UC_PROT_WRITE) == 0);
+}
+
+// Give @perms to the pages of [address, address + size) in @mr, without
+// touching its data. size is a multiple of the page size. Only the changed
+// pages are visited.
+static void region_protect(struct uc_struct *uc, MemoryRegion *mr,
+        uint64_t address, size_t size, uint32_t perms)
+{
+    size_t first = (size_t)((address - mr->addr) / uc->target_page_size);
+    size_t i, last = first + size / uc->target_page_size;
+
+    if (address == mr->addr && address + size == mr->end) {
+        g_free(mr->page_perms);
+        mr->page_perms = NULL;
+        mr->perms = perms;
+    } else {
+        if (mr->page_perms == NULL) {
+            mr->page_perms = g_malloc(region_pages(uc, mr));
+            memset(mr->page_perms, mr->perms, region_pages(uc, mr));
+            memset(mr->page_perms_count, 0, sizeof(mr->page_perms_count));
+            mr->page_perms_count[mr->perms] = region_pages(uc, mr);
+        }
+        for (i = first; i < last; i++) {
+            mr->page_perms_count[mr->page_perms[i]]--;
+            mr->page_perms_count[perms]++;
+            mr->page_perms[i] = perms;
+        }
+    }
+
+    region_perms_update(uc, mr);
+}
+
+// Set all the permissions of @mr: @perms, or the per-page @page_perms
+// when not NULL
+static void region_perms_set(struct uc_struct *uc, MemoryRegion *mr,
+        uint32_t perms, const uint8_t *page_perms)
+{
+    size_t i;
+
+    g_free(mr->page_perms);
+    mr->page_perms = NULL;
+    mr->perms = perms;
+    if (page_perms) {
+        mr->page_perms = g_memdup(page_perms, region_pages(uc, mr));
+        memset(mr->page_perms_count, 0, sizeof(mr->page_perms_count));
+        for (i = 0; i < region_pages(uc, mr); i++)
+            mr->page_perms_count[page_perms[i]]++;
+    }
+
+    region_perms_update(uc, mr);
+}
+
+// does @mr have these permissions, as given to region_perms_set()?
+static bool region_perms_equal(struct uc_struct *uc, MemoryRegion *mr,
+        uint32_t perms, const uint8_t *page_perms)
+{
+    if (mr->perms != perms)
+        return false;
+
+    if (mr->page_perms == NULL || page_perms == NULL)
+        return mr->page_perms == page_perms;
+
+    return memcmp(mr->page_perms, page_perms, region_pages(uc, mr)) == 0;
+}
+
+// Create a backup copy of the indicated MemoryRegion.
+// Generally used in prepartion for splitting a MemoryRegion.
+static uint8_t *copy_region(struct uc_struct *uc, MemoryRegion *mr)
+{
+    uint8_t *block = (uint8_t *)g_malloc0((size_t)int128_get64(mr->size));
+    if (block != NULL) {
+        uc_err err = uc_mem_read(uc, mr->addr, block, (size_t)int128_get64(mr->size));
+        if (err != UC_ERR_OK) {
+            free(block);
+            block = NULL;
+        }
+    }
+
+    return block;
+}
+
+/*
+   Split the given MemoryRegion at the indicated address for the indicated size
+   this may result in the create of up to 3 spanning sections. If the delete
+   parameter is true, the no new section will be created to replace the indicate
+   range. This functions exists to support uc_mem_unmap.
+
+   This is a static function and callers have already done some preliminary
+   parameter validation.
+
+   The do_delete argument indicates that we are being called to support
+   uc_mem_unmap. In this case we save some time by choosing NOT to remap
+   the areas that are intended to get unmapped
+ */
+// TODO: investigate whether qemu region manipulation functions already offered
+// this capability
+static bool split_region(struct uc_struct *uc, MemoryRegion *mr, uint64_t address,
+        size_t size, bool do_delete)
+{
+    uint8_t *backup, *page_perms;
+    uint32_t perms;
+    uint64_t begin, end, chunk_end;
+    size_t l_size, m_size, r_size;
+
+    chunk_end = address + size;
+
+    // if this region belongs to area [address, address+size],
+    // then there is no work to do.
+    if (address <= mr->addr && chunk_end >= mr->end)
+        return true;
+
+    if (size == 0)
+        // trivial case
+        return true;
 
     if (address >= mr->end || chunk_end <= mr->addr)
         // impossible case
@@ -818,6 +1336,8 @@ static bool split_region(struct uc_struct *uc, MemoryRegion *mr, uint64_t addres
 
     // save the essential information required for the split before mr gets deleted
     perms = mr->perms;
+    page_perms = mr->page_perms;
+    mr->page_perms = NULL;
     begin = mr->addr;
     end = mr->end;
 
@@ -852,6 +1372,8 @@ static bool split_region(struct uc_struct *uc, MemoryRegion *mr, uint64_t addres
             goto error;
         if (uc_mem_write(uc, begin, backup, l_size) != UC_ERR_OK)
             goto error;
+        if (page_perms)
+            region_perms_set(uc, memory_mapping(uc, begin), perms, page_perms);
     }
 
     if (m_size > 0 && !do_delete) {
@@ -859,6 +1381,9 @@ static bool split_region(struct uc_struct *uc, MemoryRegion *mr, uint64_t addres
             goto error;
         if (uc_mem_write(uc, address, backup + l_size, m_size) != UC_ERR_OK)
             goto error;
+        if (page_perms)
+            region_perms_set(uc, memory_mapping(uc, address), perms,
+                    page_perms + l_size / uc->target_page_size);
     }
 
     if (r_size > 0) {
@@ -866,12 +1391,17 @@ static bool split_region(struct uc_struct *uc, MemoryRegion *mr, uint64_t addres
             goto error;
         if (uc_mem_write(uc, chunk_end, backup + l_size + m_size, r_size) != UC_ERR_OK)
             goto error;
+        if (page_perms)
+            region_perms_set(uc, memory_mapping(uc, chunk_end), perms,
+                    page_perms + (l_size + m_size) / uc->target_page_size);
     }
 
+    g_free(page_perms);
     free(backup);
     return true;
 
 error:
+    g_free(page_perms);
     free(backup);
     return false;
 }
@@ -908,31 +1438,34 @@ uc_err uc_mem_protect(struct uc_struct *uc, uint64_t address, size_t size, uint3
     if (!check_mem_area(uc, address, size))
         return UC_ERR_NOMEM;
 
+    // the perms of an MMIO region come from its callbacks
+    if (!mmio_range_ok(uc, address, size, false))
+        return UC_ERR_ARG;
+
     // Now we know entire region is mapped, so change permissions
-    // We may need to split regions if this area spans adjacent regions
+    // Regions are not split: their pages keep their own permissions
     addr = address;
     count = 0;
     while(count < size) {
         mr = memory_mapping(uc, addr);
         len = (size_t)MIN(size - count, mr->end - addr);
-        if (!split_region(uc, mr, addr, len, false))
-            return UC_ERR_NOMEM;
-
-        mr = memory_mapping(uc, addr);
         // will this remove EXEC permission?
         if (((mr->perms & UC_PROT_EXEC) != 0) && ((perms & UC_PROT_EXEC) == 0))
             remove_exec = true;
-        mr->perms = perms;
-        uc->readonly_mem(mr, (perms & UC_PROT_WRITE) == 0);
+        region_protect(uc, mr, addr, len, perms);
 
         count += len;
         addr += len;
     }
 
+    // cached TLB entries still carry the old permissions
+    uc->uc_tlb_flush(uc);
+
     // if EXEC permission is removed, then quit TB and continue at the same place
     if (remove_exec) {
-        uc->quit_request = true;
-        uc_emu_stop(uc);
+        // code translated from these pages must not run again
+        uc->uc_invalidate_tb(uc, address, size);
+        uc_emu_quit_tb(uc);
     }
 
     return UC_ERR_OK;
@@ -965,6 +1498,10 @@ uc_err uc_mem_unmap(struct uc_struct *uc, uint64_t address, size_t size)
     if (!check_mem_area(uc, address, size))
         return UC_ERR_NOMEM;
 
+    // an MMIO region cannot be split
+    if (!mmio_range_ok(uc, address, size, true))
+        return UC_ERR_ARG;
+
     // Now we know entire region is mapped, so do the unmap
     // We may need to split regions if this area spans adjacent regions
     addr = address;
@@ -972,6 +1509,8 @@ uc_err uc_mem_unmap(struct uc_struct *uc, uint64_t address, size_t size)
     while(count < size) {
         mr = memory_mapping(uc, addr);
         len = (size_t)MIN(size - count, mr->end - addr);
+        // the RAM behind this region may be reused by a later mapping
+        uc->uc_invalidate_tb(uc, mr->addr, (size_t)(mr->end - mr->addr));
         if (!split_region(uc, mr, addr, len, true))
             return UC_ERR_NOMEM;
 
@@ -987,6 +1526,24 @@ uc_err uc_mem_unmap(struct uc_struct *uc, uint64_t address, size_t size)
     return UC_ERR_OK;
 }
 
+// find the index of the first memory region ending after this address,
+// or mapped_block_count if there is none
+uint32_t mapped_block_bsearch(struct uc_struct *uc, uint64_t address)
+{
+    uint32_t left = 0, right = uc->mapped_block_count, mid;
+
+    // mapped_blocks is sorted by address and regions never overlap
+    while (left < right) {
+        mid = left + (right - left) / 2;
+        if (uc->mapped_blocks[mid]->end - 1 < address)
+            left = mid + 1;
+        else
+            right = mid;
+    }
+
+    return left;
+}
+
 // find the memory region of this address
 MemoryRegion *memory_mapping(struct uc_struct* uc, uint64_t address)
 {
@@ -1005,18 +1562,370 @@ MemoryRegion *memory_mapping(struct uc_struct* uc, uint64_t address)
     if (i < uc->mapped_block_count && address >= uc->mapped_blocks[i]->addr && address < uc->mapped_blocks[i]->end)
         return uc->mapped_blocks[i];
 
-    for(i = 0; i < uc->mapped_block_count; i++) {
-        if (address >= uc->mapped_blocks[i]->addr && address <= uc->mapped_blocks[i]->end - 1) {
-            // cache this index for the next query
-            uc->mapped_block_cache_index = i;
-            return uc->mapped_blocks[i];
-        }
+    i = mapped_block_bsearch(uc, address);
+    if (i < uc->mapped_block_count && address >= uc->mapped_blocks[i]->addr) {
+        // cache this index for the next query
+        uc->mapped_block_cache_index = i;
+        return uc->mapped_blocks[i];
     }
 
     // not found
     return NULL;
 }
 
+// a hook starting or stopping to cover @addr
+struct hook_event {
+    uint64_t addr;
+    uint32_t pos;   // of the hook in its list
+    bool start;
+};
+
+static int cmp_hook_event(const void *a, const void *b)
+{
+    const struct hook_event *x = a, *y = b;
+
+    return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+// rebuild the index @slot of hook list @list after it changed, leaving out
+// @skip (if not NULL) which is about to be removed from the list.
+// A single sweep over the sorted bounds, keeping the set of hooks covering
+// the current interval: O(n log n) on top of the size of the table.
+static uc_err hook_table_rebuild(uc_engine *uc, struct list *list, struct hook_table **slot,
+        struct hook *skip)
+{
+    struct hook_table *table = NULL;
+    struct hook **hooks = NULL;
+    struct hook_event *events = NULL;
+    uint32_t *active = NULL, *where = NULL, *order = NULL;
+    struct list_item *cur;
+    struct hook *hook;
+    uint32_t nb_hooks = 0, nb_events = 0, nb_active, n, i, k, e, pos, pass;
+
+    for (cur = list->head; cur != NULL; cur = cur->next) {
+        if (cur->data != skip)
+            nb_hooks++;
+    }
+
+    if (nb_hooks) {
+        table = calloc(1, sizeof(*table));
+        hooks = malloc(nb_hooks * sizeof(struct hook *));
+        events = malloc(2 * nb_hooks * sizeof(struct hook_event));
+        active = malloc(nb_hooks * sizeof(uint32_t));
+        where = malloc(nb_hooks * sizeof(uint32_t));
+        order = malloc(nb_hooks * sizeof(uint32_t));
+        if (table == NULL || hooks == NULL || events == NULL || active == NULL ||
+                where == NULL || order == NULL)
+            goto nomem;
+
+        n = 0;
+        for (cur = list->head; cur != NULL; cur = cur->next) {
+            hook = (struct hook *)cur->data;
+            if (hook == skip)
+                continue;
+            if (hook->begin <= hook->end) {
+                events[nb_events].addr = hook->begin;
+                events[nb_events].pos = n;
+                events[nb_events++].start = true;
+                if (hook->end != UINT64_MAX) {
+                    events[nb_events].addr = hook->end + 1;
+                    events[nb_events].pos = n;
+                    events[nb_events++].start = false;
+                }
+            }
+            hooks[n++] = hook;
+        }
+        qsort(events, nb_events, sizeof(struct hook_event), cmp_hook_event);
+
+        // interval bounds: 0, then where each bounded hook starts & stops covering
+        table->starts = malloc((nb_events + 1) * sizeof(uint64_t));
+        if (table->starts == NULL)
+            goto nomem;
+        table->starts[0] = 0;
+        for (e = 0, k = 1; e < nb_events; e++) {
+            if (events[e].addr != table->starts[k - 1])
+                table->starts[k++] = events[e].addr;
+        }
+        table->count = k;
+
+        table->offsets = malloc((table->count + 1) * sizeof(uint32_t));
+        table->vectors = calloc(table->count, sizeof(struct hook_vector *));
+        if (table->offsets == NULL || table->vectors == NULL)
+            goto nomem;
+
+        // sweep twice: count the hooks covering each interval, then list them
+        for (pass = 0; pass < 2; pass++) {
+            // unbounded hooks cover every interval
+            nb_active = 0;
+            for (i = 0; i < nb_hooks; i++) {
+                if (hooks[i]->begin > hooks[i]->end) {
+                    where[i] = nb_active;
+                    active[nb_active++] = i;
+                }
+            }
+            n = 0;
+            for (i = 0, e = 0; i < table->count; i++) {
+                for (; e < nb_events && events[e].addr == table->starts[i]; e++) {
+                    pos = events[e].pos;
+                    if (events[e].start) {
+                        where[pos] = nb_active;
+                        active[nb_active++] = pos;
+                    } else {
+                        active[where[pos]] = active[--nb_active];
+                        where[active[where[pos]]] = where[pos];
+                    }
+                }
+                if (pass == 0) {
+                    table->offsets[i] = n;
+                } else {
+                    // in the order of the hook list
+                    memcpy(order, active, nb_active * sizeof(uint32_t));
+                    if (nb_active > 1)
+                        qsort(order, nb_active, sizeof(uint32_t), cmp_u32);
+                    for (k = 0; k < nb_active; k++)
+                        table->hooks[n + k] = hooks[order[k]];
+                }
+                n += nb_active;
+            }
+            if (pass == 0) {
+                table->offsets[i] = n;
+                table->hooks = malloc((n ? n : 1) * sizeof(struct hook *));
+                if (table->hooks == NULL)
+                    goto nomem;
+            }
+        }
+
+        free(hooks);
+        free(events);
+        free(active);
+        free(where);
+        free(order);
+    }
+
+    // a callback may be walking the old table right now
+    if (!atomic_read(&uc->emulation_done) && *slot != NULL) {
+        if (list_append(&uc->hook_tables_to_free, *slot) == NULL) {
+            hook_table_free(table);
+            return UC_ERR_NOMEM;
+        }
+    } else {
+        hook_table_free(*slot);
+    }
+    *slot = table;
+
+    return UC_ERR_OK;
+
+nomem:
+    free(hooks);
+    free(events);
+    free(active);
+    free(where);
+    free(order);
+    hook_table_free(table);
+    return UC_ERR_NOMEM;
+}
+
+// index hook list @list after it changed, see hook_table_rebuild().
+// Only a callback can change the hooks while emulating, and then the table
+// must be rebuilt right away; otherwise it is marked @stale and rebuilt once
+// by uc_emu_start(), so that adding many hooks costs a single rebuild.
+static uc_err hook_table_changed(uc_engine *uc, struct list *list, struct hook_table **slot,
+        bool *stale, struct hook *skip)
+{
+    if (atomic_read(&uc->emulation_done)) {
+        *stale = true;
+        return UC_ERR_OK;
+    }
+
+    return hook_table_rebuild(uc, list, slot, skip);
+}
+
+// rebuild the address index of hook list @idx after it changed
+static uc_err hook_table_update(uc_engine *uc, int idx)
+{
+    return hook_table_changed(uc, &uc->hook[idx], &uc->hook_table[idx],
+            &uc->hook_table_stale[idx], NULL);
+}
+
+// rebuild the port index of IN or OUT hook list @idx after it changed
+static uc_err hook_port_table_update(uc_engine *uc, int idx)
+{
+    return hook_table_changed(uc, &uc->hook_port[idx], &uc->hook_port_table[idx],
+            &uc->hook_port_table_stale[idx], NULL);
+}
+
+// rebuild the tables left stale by hooks changed since the last run
+static uc_err hook_tables_refresh(uc_engine *uc)
+{
+    uc_err err;
+    int i;
+
+    for (i = 0; i < UC_HOOK_MAX; i++) {
+        if (uc->hook_table_stale[i]) {
+            err = hook_table_rebuild(uc, &uc->hook[i], &uc->hook_table[i], NULL);
+            if (err != UC_ERR_OK)
+                return err;
+            uc->hook_table_stale[i] = false;
+        }
+    }
+    for (i = 0; i < UC_HOOK_PORT_MAX; i++) {
+        if (uc->hook_port_table_stale[i]) {
+            err = hook_table_rebuild(uc, &uc->hook_port[i], &uc->hook_port_table[i], NULL);
+            if (err != UC_ERR_OK)
+                return err;
+            uc->hook_port_table_stale[i] = false;
+        }
+    }
+
+    return UC_ERR_OK;
+}
+
+// list of the IN & OUT hooks for @insn, or -1 for the other instructions
+static int hook_port_idx(uc_engine *uc, int insn)
+{
+    if (uc->arch != UC_ARCH_X86)
+        return -1;
+
+    switch (insn) {
+        case UC_X86_INS_IN:
+            return UC_HOOK_PORT_IN_IDX;
+        case UC_X86_INS_OUT:
+            return UC_HOOK_PORT_OUT_IDX;
+        default:
+            return -1;
+    }
+}
+
+struct hook_vector *hook_vector_get(struct uc_struct *uc, int idx, uint64_t pc)
+{
+    struct hook_table *table = uc->hook_table[idx];
+    struct hook_vector *vector = NULL;
+    struct hook **hooks = NULL, **end = NULL;
+    uint32_t i = 0;
+
+    if (table != NULL) {
+        i = hook_table_interval(table, pc);
+        vector = table->vectors[i];
+        if (vector == NULL)
+            hooks = hook_table_lookup(table, pc, &end);
+    }
+
+    if (vector == NULL) {
+        vector = g_malloc(sizeof(*vector) + (end - hooks) * sizeof(struct hook *));
+        vector->uc = uc;
+        vector->refs = 0;
+        vector->count = (uint32_t)(end - hooks);
+        if (vector->count)
+            memcpy(vector->hooks, hooks, vector->count * sizeof(struct hook *));
+        uc->stats.hook_vectors++;
+        if (table != NULL) {
+            vector->refs++;
+            table->vectors[i] = vector;
+        }
+    }
+
+    // consecutive instructions mostly share a vector, a block takes one
+    // reference per run
+    if (uc->tb_hook_vectors.tail == NULL || uc->tb_hook_vectors.tail->data != vector) {
+        vector->refs++;
+        list_append(&uc->tb_hook_vectors, vector);
+    }
+
+    return vector;
+}
+
+struct hook_vector **hook_vectors_take(struct uc_struct *uc)
+{
+    struct list_item *cur;
+    struct hook_vector **vectors;
+    size_t n = 0;
+
+    for (cur = uc->tb_hook_vectors.head; cur != NULL; cur = cur->next)
+        n++;
+    if (n == 0)
+        return NULL;
+
+    vectors = g_new(struct hook_vector *, n + 1);
+    n = 0;
+    for (cur = uc->tb_hook_vectors.head; cur != NULL; cur = cur->next)
+        vectors[n++] = cur->data;
+    vectors[n] = NULL;
+    list_clear(&uc->tb_hook_vectors);
+
+    return vectors;
+}
+
+void hook_vectors_release(struct hook_vector **vectors)
+{
+    size_t i;
+
+    if (vectors == NULL)
+        return;
+
+    for (i = 0; vectors[i] != NULL; i++)
+        hook_vector_unref(vectors[i]);
+    g_free(vectors);
+}
+
+void hook_vectors_release_later(struct hook_vector **vectors)
+{
+    struct uc_struct *uc;
+
+    if (vectors == NULL)
+        return;
+
+    // the block may be the one running, e.g. when a callback deleted a hook
+    uc = vectors[0]->uc;
+    if (atomic_read(&uc->emulation_done))
+        hook_vectors_release(vectors);
+    else
+        list_append(&uc->hook_vectors_to_release, vectors);
+}
+
+void hook_vectors_reset(struct uc_struct *uc)
+{
+    struct list_item *cur;
+
+    for (cur = uc->tb_hook_vectors.head; cur != NULL; cur = cur->next)
+        hook_vector_unref(cur->data);
+    list_clear(&uc->tb_hook_vectors);
+
+    for (cur = uc->hook_vectors_to_release.head; cur != NULL; cur = cur->next)
+        hook_vectors_release(cur->data);
+    list_clear(&uc->hook_vectors_to_release);
+}
+
+// hooks checked while translating are compiled into the cached blocks
+#define UC_HOOK_TRANSLATION_MASK (UC_HOOK_CODE | UC_HOOK_BLOCK)
+
+// memory hooks that mark the pages they cover in the TLB
+#define UC_HOOK_TLB_MASK (UC_HOOK_MEM_READ | UC_HOOK_MEM_WRITE | UC_HOOK_MEM_READ_AFTER)
+
+static void hook_invalidate_tb(uc_engine *uc, int type, struct hook *hook)
+{
+    if (type & UC_HOOK_TLB_MASK)
+        uc->uc_tlb_flush(uc);
+
+    if ((type & UC_HOOK_TRANSLATION_MASK) == 0)
+        return;
+
+    if (hook->begin <= hook->end) {
+        // only blocks overlapping the hook range have it compiled in
+        uc->uc_invalidate_tb_pc(uc, hook->begin, hook->end);
+    } else {
+        uc->tb_flush_request = true;
+    }
+    // changed from a callback? then quit TB and continue at the same place
+    uc_emu_quit_tb(uc);
+}
+
 UNICORN_EXPORT
 uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
         void *user_data, uint64_t begin, uint64_t end, ...)
@@ -1037,9 +1946,11 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
     hook->refs = 0;
     *hh = (uc_hook)hook;
 
-    // UC_HOOK_INSN has an extra argument for instruction ID
-    if (type & UC_HOOK_INSN) {
+    // UC_HOOK_INSN & UC_HOOK_INSN_PORT have an extra argument for instruction ID
+    if (type & (UC_HOOK_INSN | UC_HOOK_INSN_PORT)) {
         va_list valist;
+        struct list *list;
+        int port;
 
         va_start(valist, end);
         hook->insn = va_arg(valist, int);
@@ -1052,20 +1963,34 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
             }
         }
 
+        port = hook_port_idx(uc, hook->insn);
+        if (type & UC_HOOK_INSN_PORT) {
+            if (port < 0) {
+                free(hook);
+                return UC_ERR_HOOK;
+            }
+        } else if (port >= 0) {
+            // plain IN & OUT hooks are called for every port
+            hook->begin = 1;
+            hook->end = 0;
+        }
+        list = port < 0 ? &uc->hook[UC_HOOK_INSN_IDX] : &uc->hook_port[port];
         if (uc->hook_insert) {
-            if (list_insert(&uc->hook[UC_HOOK_INSN_IDX], hook) == NULL) {
+            if (list_insert(list, hook) == NULL) {
                 free(hook);
                 return UC_ERR_NOMEM;
             }
         } else {
-            if (list_append(&uc->hook[UC_HOOK_INSN_IDX], hook) == NULL) {
+            if (list_append(list, hook) == NULL) {
                 free(hook);
                 return UC_ERR_NOMEM;
             }
         }
 
         hook->refs++;
-        return UC_ERR_OK;
+        if (port < 0)
+            return hook_table_update(uc, UC_HOOK_INSN_IDX);
+        return hook_port_table_update(uc, port);
     }
 
     while ((type >> i) > 0) {
@@ -1088,6 +2013,10 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
                     }
                 }
                 hook->refs++;
+                ret = hook_table_update(uc, i);
+                if (ret != UC_ERR_OK) {
+                    return ret;
+                }
             }
         }
         i++;
@@ -1097,6 +2026,8 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
     // TODO: return an error?
     if (hook->refs == 0) {
         free(hook);
+    } else {
+        hook_invalidate_tb(uc, type, hook);
     }
 
     return ret;
@@ -1106,6 +2037,8 @@ UNICORN_EXPORT
 uc_err uc_hook_del(uc_engine *uc, uc_hook hh)
 {
     int i;
+    int type = 0;
+    uc_err ret = UC_ERR_OK;
     struct hook *hook = (struct hook *)hh;
     // we can't dereference hook->type if hook is invalid
     // so for now we need to iterate over all possible types to remove the hook
@@ -1113,45 +2046,121 @@ uc_err uc_hook_del(uc_engine *uc, uc_hook hh)
     // an optimization would be to align the hook pointer
     // and store the type mask in the hook pointer.
     for (i = 0; i < UC_HOOK_MAX; i++) {
-        if (list_remove(&uc->hook[i], (void *)hook)) {
+        if (list_exists(&uc->hook[i], (void *)hook)) {
+            // index the list without the hook before unlinking it, so that
+            // on error it is still registered for the types left
+            ret = hook_table_changed(uc, &uc->hook[i], &uc->hook_table[i],
+                    &uc->hook_table_stale[i], hook);
+            if (ret != UC_ERR_OK) {
+                break;
+            }
+            list_remove(&uc->hook[i], (void *)hook);
+            type |= 1 << i;
             if (--hook->refs == 0) {
-                free(hook);
                 break;
             }
         }
     }
-    return UC_ERR_OK;
+    for (i = 0; i < UC_HOOK_PORT_MAX && type == 0 && ret == UC_ERR_OK; i++) {
+        if (list_exists(&uc->hook_port[i], (void *)hook)) {
+            ret = hook_table_changed(uc, &uc->hook_port[i], &uc->hook_port_table[i],
+                    &uc->hook_port_table_stale[i], hook);
+            if (ret != UC_ERR_OK) {
+                break;
+            }
+            list_remove(&uc->hook_port[i], (void *)hook);
+            type = UC_HOOK_INSN;
+            hook->refs--;
+        }
+    }
+
+    if (type) {
+        hook_invalidate_tb(uc, type, hook);
+    }
+
+    if (type && hook->refs == 0) {
+        if (!atomic_read(&uc->emulation_done)) {
+            // a callback may be walking a hook table that still has it
+            hook->to_delete = true;
+            list_append(&uc->hooks_to_free, hook);
+        } else {
+            free(hook);
+        }
+    }
+
+    return ret;
 }
 
 // TCG helper
 void helper_uc_tracecode(int32_t size, uc_hook_type type, void *handle, int64_t address);
 void helper_uc_tracecode(int32_t size, uc_hook_type type, void *handle, int64_t address)
 {
-    struct uc_struct *uc = handle;
-    struct list_item *cur = uc->hook[type].head;
+    // exactly the hooks matching this address, see gen_uc_tracecode()
+    struct hook_vector *vector = handle;
+    struct uc_struct *uc = vector->uc;
     struct hook *hook;
+    uint32_t i;
+
+    uc->stats.hook_calls++;
 
     // sync PC in CPUArchState with address
     if (uc->set_pc) {
         uc->set_pc(uc, address);
     }
 
-    while (cur != NULL && !uc->stop_request) {
-        hook = (struct hook *)cur->data;
-        if (HOOK_BOUND_CHECK(hook, (uint64_t)address)) {
+    for (i = 0; i < vector->count && !uc_exit_requested(uc); i++) {
+        hook = vector->hooks[i];
+        if (!hook->to_delete) {
             ((uc_cb_hookcode_t)hook->callback)(uc, address, size, hook->user_data);
         }
-        cur = cur->next;
     }
 }
 
+// List the runs of pages with the same permissions in @mr into @r, when
+// not NULL, and return their number
+static uint32_t region_runs(struct uc_struct *uc, MemoryRegion *mr, uc_mem_region *r)
+{
+    size_t i, pages;
+    uint32_t n = 0;
+
+    if (mr->page_perms == NULL) {
+        if (r) {
+            r->begin = mr->addr;
+            r->end = mr->end - 1;
+            r->perms = mr->perms;
+        }
+        return 1;
+    }
+
+    pages = region_pages(uc, mr);
+    for (i = 0; i < pages; i++) {
+        if (i > 0 && mr->page_perms[i] == mr->page_perms[i - 1]) {
+            if (r)
+                r[n - 1].end += uc->target_page_size;
+            continue;
+        }
+        if (r) {
+            r[n].begin = mr->addr + i * uc->target_page_size;
+            r[n].end = r[n].begin + uc->target_page_size - 1;
+            r[n].perms = mr->page_perms[i];
+        }
+        n++;
+    }
+
+    return n;
+}
+
 UNICORN_EXPORT
 uint32_t uc_mem_regions(uc_engine *uc, uc_mem_region **regions, uint32_t *count)
 {
-    uint32_t i;
+    uint32_t i, n;
     uc_mem_region *r = NULL;
 
-    *count = uc->mapped_block_count;
+    // pages of a region with different perms are listed apart
+    *count = 0;
+    for (i = 0; i < uc->mapped_block_count; i++) {
+        *count += region_runs(uc, uc->mapped_blocks[i], NULL);
+    }
 
     if (*count) {
         r = g_malloc0(*count * sizeof(uc_mem_region));
@@ -1161,10 +2170,9 @@ uint32_t uc_mem_regions(uc_engine *uc, uc_mem_region **regions, uint32_t *count)
         }
     }
 
-    for (i = 0; i < *count; i++) {
-        r[i].begin = uc->mapped_blocks[i]->addr;
-        r[i].end = uc->mapped_blocks[i]->end - 1;
-        r[i].perms = uc->mapped_blocks[i]->perms;
+    n = 0;
+    for (i = 0; i < uc->mapped_block_count; i++) {
+        n += region_runs(uc, uc->mapped_blocks[i], r + n);
     }
 
     *regions = r;
@@ -1185,6 +2193,37 @@ uc_err uc_query(uc_engine *uc, uc_query_type type, size_t *result)
         return UC_ERR_OK;
     }
 
+    switch(type) {
+        case UC_QUERY_TB_TRANSLATED:
+            *result = (size_t)uc->stats.tb_translated;
+            return UC_ERR_OK;
+        case UC_QUERY_TLB_FLUSHES:
+            *result = (size_t)uc->stats.tlb_flushes;
+            return UC_ERR_OK;
+        case UC_QUERY_TLB_FILLS:
+            *result = (size_t)uc->stats.tlb_fills;
+            return UC_ERR_OK;
+        case UC_QUERY_HOOK_CALLS:
+            *result = (size_t)uc->stats.hook_calls;
+            return UC_ERR_OK;
+        case UC_QUERY_CPU_EXITS:
+            *result = (size_t)uc->stats.cpu_exits;
+            return UC_ERR_OK;
+        case UC_QUERY_HOOK_VECTORS:
+            *result = (size_t)uc->stats.hook_vectors;
+            return UC_ERR_OK;
+        case UC_QUERY_TB_FLUSHES:
+        case UC_QUERY_TB_INVALIDATED:
+        case UC_QUERY_CODE_GEN_USED:
+        case UC_QUERY_CODE_GEN_SIZE:
+        case UC_QUERY_TB_HASH_ENTRIES:
+        case UC_QUERY_TB_HASH_BUCKETS:
+        case UC_QUERY_TB_HASH_USED:
+            return uc->stats_query(uc, type, result);
+        default:
+            break;
+    }
+
     switch(uc->arch) {
 #ifdef UNICORN_HAS_ARM
         case UC_ARCH_ARM:
@@ -1275,3 +2314,179 @@ uc_err uc_context_restore(uc_engine *uc, uc_context *context)
     memcpy(uc->cpu->env_ptr, _context->data, _context->size);
     return UC_ERR_OK;
 }
+
+UNICORN_EXPORT
+uc_err uc_snapshot_take(uc_engine *uc, uc_snapshot **snapshot)
+{
+    struct uc_snapshot *snap;
+    uint32_t i;
+
+    snap = calloc(1, sizeof(*snap));
+    if (snap == NULL)
+        return UC_ERR_NOMEM;
+
+    if (uc->mapped_block_count) {
+        snap->regions = calloc(uc->mapped_block_count, sizeof(*snap->regions));
+        if (snap->regions == NULL) {
+            free(snap);
+            return UC_ERR_NOMEM;
+        }
+    }
+
+    for (i = 0; i < uc->mapped_block_count; i++) {
+        MemoryRegion *mr = uc->mapped_blocks[i];
+        struct uc_snapshot_region *r = &snap->regions[i];
+
+        r->mr = mr;
+        r->begin = mr->addr;
+        r->end = mr->end;
+        r->perms = mr->perms;
+        if (!memory_region_is_ram(mr)) {
+            // the state of a peripheral is its own, only keep its mapping
+            r->mmio = *(struct uc_mmio *)mr->opaque;
+            snap->count++;
+            continue;
+        }
+
+        r->backing = mr->backing;
+        r->data = malloc(mr->end - mr->addr);
+        if (r->data == NULL) {
+            uc_snapshot_free(snap);
+            return UC_ERR_NOMEM;
+        }
+        if (mr->page_perms) {
+            r->page_perms = g_memdup(mr->page_perms, region_pages(uc, mr));
+        }
+        uc->snapshot_save(uc, mr, r->data);
+        snap->count++;
+    }
+
+    uc->snapshot_last = snap;
+    *snapshot = snap;
+
+    return UC_ERR_OK;
+}
+
+// is @mr still the region this snapshot copied, at the same place?
+static bool snapshot_has(struct uc_snapshot *snap, MemoryRegion *mr)
+{
+    uint32_t lo = 0, hi = snap->count;
+
+    // regions are sorted and do not overlap
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (snap->regions[mid].end <= mr->addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo < snap->count && snap->regions[lo].mr == mr &&
+        snap->regions[lo].begin == mr->addr && snap->regions[lo].end == mr->end;
+}
+
+UNICORN_EXPORT
+uc_err uc_snapshot_restore(uc_engine *uc, uc_snapshot *snapshot)
+{
+    struct uc_snapshot *snap = snapshot;
+    // the dirty pages are only known relative to the latest snapshot
+    bool full = (uc->snapshot_last != snap);
+    uc_err err;
+    uint32_t i;
+
+    // the memory of the user or the file behind a region unmapped since may
+    // be gone, so it cannot be brought back: check before changing anything
+    for (i = 0; i < snap->count; i++) {
+        struct uc_snapshot_region *r = &snap->regions[i];
+        MemoryRegion *mr;
+
+        if (r->backing != UC_MEM_BACKING_PTR && r->backing != UC_MEM_BACKING_FILE)
+            continue;
+        mr = memory_mapping(uc, r->begin);
+        if (mr != r->mr || mr->addr != r->begin || mr->end != r->end)
+            return UC_ERR_MAP;
+    }
+
+    // drop what was mapped (or remapped) after the snapshot
+    i = 0;
+    while (i < uc->mapped_block_count) {
+        MemoryRegion *mr = uc->mapped_blocks[i];
+
+        if (snapshot_has(snap, mr)) {
+            i++;
+            continue;
+        }
+        // this shifts the remaining blocks down to index i
+        err = uc_mem_unmap(uc, mr->addr, (size_t)(mr->end - mr->addr));
+        if (err)
+            return err;
+    }
+
+    for (i = 0; i < snap->count; i++) {
+        struct uc_snapshot_region *r = &snap->regions[i];
+        size_t size = (size_t)(r->end - r->begin);
+        MemoryRegion *mr = memory_mapping(uc, r->begin);
+
+        if (mr == NULL && r->data == NULL) {
+            // a peripheral unmapped after the snapshot
+            err = uc_mmio_map(uc, r->begin, size, r->mmio.read, r->mmio.write,
+                    r->mmio.user_data);
+            if (err)
+                return err;
+            r->mr = memory_mapping(uc, r->begin);
+            continue;
+        }
+
+        if (mr == NULL) {
+            // unmapped after the snapshot, bring it back the same way
+            if (r->backing == UC_MEM_BACKING_ANON)
+                err = uc_mem_map(uc, r->begin, size, r->perms);
+            else
+                err = uc_mem_map_file(uc, r->begin, size, r->perms, -1, 0,
+                        r->backing == UC_MEM_BACKING_ZERO_SHARED);
+            if (err)
+                return err;
+            r->mr = memory_mapping(uc, r->begin);
+            if (r->page_perms) {
+                region_perms_set(uc, r->mr, r->perms, r->page_perms);
+                uc->uc_tlb_flush(uc);
+            }
+            uc->snapshot_restore(uc, r->mr, r->data, true);
+            continue;
+        }
+
+        if (r->data == NULL)
+            continue;
+
+        if (!region_perms_equal(uc, mr, r->perms, r->page_perms)) {
+            // the code of pages which lost EXEC since must not run again
+            if (mr->perms & UC_PROT_EXEC)
+                uc->uc_invalidate_tb(uc, r->begin, size);
+            region_perms_set(uc, mr, r->perms, r->page_perms);
+            uc->uc_tlb_flush(uc);
+        }
+        uc->snapshot_restore(uc, mr, r->data, full);
+    }
+
+    uc->snapshot_last = snap;
+
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_snapshot_free(uc_snapshot *snapshot)
+{
+    struct uc_snapshot *snap = snapshot;
+    uint32_t i;
+
+    for (i = 0; i < snap->count; i++) {
+        free(snap->regions[i].data);
+        g_free(snap->regions[i].page_perms);
+    }
+
+    free(snap->regions);
+    free(snap);
+
+    return UC_ERR_OK;
+}